@@ -0,0 +1,111 @@
+#include "benchmark.h"
+#include "hidra_async.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "hidra_benchmark";
+
+#define BENCHMARK_DURATION_US   (2 * 1000 * 1000)
+#define BENCHMARK_TIMEOUT_MS    50
+
+static const hidra_bus_speed_t benchmark_speeds[] = {
+    HIDRA_SPEED_STANDARD,
+    HIDRA_SPEED_FAST,
+    HIDRA_SPEED_FAST_PLUS,
+};
+
+static void benchmark_speed(hidra_bus_handle_t bus_handle, uint8_t i2c_address, hidra_bus_speed_t speed)
+{
+    hidra_device_handle_t device;
+    esp_err_t ret = hidra_add_device_to_bus_with_speed(bus_handle, i2c_address, speed, &device);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "%4d kHz: failed to add device: %s", (int)speed / 1000, esp_err_to_name(ret));
+        return;
+    }
+
+    // Zero-motion mouse reports: smallest payload, nothing visible on the host
+    const uint8_t report[4] = {0};
+    uint32_t sent = 0;
+    uint32_t failed = 0;
+    int64_t start = esp_timer_get_time();
+    int64_t elapsed = 0;
+    while (elapsed < BENCHMARK_DURATION_US) {
+        if (hidra_send_generic_report(device, HIDRA_REG_MOUSE, report, sizeof(report), BENCHMARK_TIMEOUT_MS) == ESP_OK) {
+            sent++;
+        } else {
+            failed++;
+        }
+        elapsed = esp_timer_get_time() - start;
+    }
+
+    uint8_t status = 0;
+    hidra_read_status(device, &status, BENCHMARK_TIMEOUT_MS);
+    ESP_LOGI(TAG, "%4d kHz: %lu reports/s sustained (%lu sent, %lu failed, last status 0x%02X)",
+             (int)speed / 1000, (unsigned long)((uint64_t)sent * 1000000 / elapsed),
+             (unsigned long)sent, (unsigned long)failed, status);
+
+    hidra_remove_device_from_bus(device);
+}
+
+// Same load through the async queue: the caller only pays for the submit
+static void benchmark_async(hidra_device_handle_t device, hidra_bus_speed_t speed)
+{
+    const hidra_async_config_t config = {
+        .timeout_ms = BENCHMARK_TIMEOUT_MS,
+        .task_priority = 5,
+    };
+    hidra_async_handle_t async;
+    esp_err_t ret = hidra_async_create(device, &config, &async);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start async submission: %s", esp_err_to_name(ret));
+        return;
+    }
+
+    const uint8_t report[4] = {0};
+    int64_t submit_max_us = 0;
+    int64_t start = esp_timer_get_time();
+    int64_t elapsed = 0;
+    while (elapsed < BENCHMARK_DURATION_US) {
+        int64_t before = esp_timer_get_time();
+        ret = hidra_async_submit(async, HIDRA_REG_MOUSE, report, sizeof(report), NULL, NULL);
+        int64_t after = esp_timer_get_time();
+        if (ret == ESP_OK) {
+            if (after - before > submit_max_us) {
+                submit_max_us = after - before;
+            }
+        } else {
+            // Queue full: let the flush task catch up
+            vTaskDelay(1);
+        }
+        elapsed = after - start;
+    }
+    hidra_async_flush(async, 1000);
+    elapsed = esp_timer_get_time() - start;
+
+    hidra_async_stats_t stats;
+    hidra_async_get_stats(async, &stats);
+    ESP_LOGI(TAG, "%4d kHz async: %lu reports/s in %lu writes (%lu failed), slowest submit %lld us",
+             (int)speed / 1000, (unsigned long)((uint64_t)stats.reports * 1000000 / elapsed),
+             (unsigned long)stats.writes, (unsigned long)stats.errors, (long long)submit_max_us);
+
+    hidra_async_delete(async);
+}
+
+void run_speed_benchmark(hidra_bus_handle_t bus_handle, uint8_t i2c_address)
+{
+    ESP_LOGI(TAG, "Benchmarking device 0x%02X, %d s per speed", i2c_address, BENCHMARK_DURATION_US / 1000000);
+    for (int i = 0; i < sizeof(benchmark_speeds) / sizeof(benchmark_speeds[0]); i++) {
+        benchmark_speed(bus_handle, i2c_address, benchmark_speeds[i]);
+    }
+
+    // What the probe would pick for this wiring
+    hidra_device_handle_t device;
+    hidra_bus_speed_t speed;
+    if (hidra_add_device_probed(bus_handle, i2c_address, HIDRA_SPEED_FAST_PLUS, &device, &speed) == ESP_OK) {
+        ESP_LOGI(TAG, "Probe selected %d kHz", (int)speed / 1000);
+        benchmark_async(device, speed);
+        hidra_remove_device_from_bus(device);
+    }
+}
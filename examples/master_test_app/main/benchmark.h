@@ -0,0 +1,6 @@
+#pragma once
+
+#include "hidra.h"
+
+// Measure sustained report throughput to one device at each bus speed
+void run_speed_benchmark(hidra_bus_handle_t bus_handle, uint8_t i2c_address);
@@ -1,8 +1,10 @@
 #include <stdio.h>
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "hidra.h"
+#include "benchmark.h"
 
 static const char *TAG = "hidra_example";
 
@@ -67,7 +69,17 @@ void app_main(void)
         ESP_LOGI(TAG, "Sent mouse report");
     }
 
-    // 7. Example of reconfiguring device to new address
+    // 7. Sustained throughput at 100 kHz, 400 kHz and 1 MHz
+    hidra_remove_device_from_bus(device);
+    run_speed_benchmark(bus_handle, DEFAULT_I2C_ADDR);
+    ret = hidra_add_device_to_bus(bus_handle, DEFAULT_I2C_ADDR, &device);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to re-add device: %s", esp_err_to_name(ret));
+        hidra_master_bus_deinit(bus_handle);
+        return;
+    }
+
+    // 8. Example of reconfiguring device to new address
     ESP_LOGI(TAG, "Reconfiguring device address from 0x%02X to 0x42", DEFAULT_I2C_ADDR);
     ret = hidra_reconfigure_address(&device, 0x42, 1000);
     if (ret == ESP_OK) {
@@ -82,7 +94,7 @@ void app_main(void)
         ESP_LOGE(TAG, "Failed to reconfigure device address");
     }
 
-    // 8. Cleanup
+    // 9. Cleanup
     hidra_remove_device_from_bus(device);
     hidra_master_bus_deinit(bus_handle);
     
@@ -0,0 +1,259 @@
+#include "config_store.h"
+#include "hidra_protocol.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+#include <string.h>
+
+static const char *TAG = "config_store";
+
+_Static_assert(sizeof(((hidra_config_t *)0)->manufacturer) == CONFIG_BLOB_STRING_SIZE,
+               "blob string fields must match hidra_config_t");
+_Static_assert(CONFIG_BLOB_SIZE <= UINT16_MAX, "blob length must fit its header field");
+
+// Keys of the one-value-per-key layout, read once for migration
+static const char *const legacy_keys[] = {
+    NVS_KEY_I2C_ADDR, NVS_KEY_USB_VID, NVS_KEY_USB_PID, NVS_KEY_MANUFACTURER, NVS_KEY_PRODUCT,
+    NVS_KEY_SERIAL, NVS_KEY_COMPOSITE_LAYOUT, NVS_KEY_POLL_INTERVALS, NVS_KEY_IRQ_GPIO,
+};
+
+static uint8_t *put_u16(uint8_t *p, uint16_t value)
+{
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    return p + 2;
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+bool config_valid(const hidra_config_t *config)
+{
+    return config->i2c_addr >= I2C_ADDR_MIN && config->i2c_addr <= I2C_ADDR_MAX &&
+           usb_layout_fits(config->composite_layout);
+}
+
+bool config_repair(hidra_config_t *config)
+{
+    bool repaired = false;
+    if (config->i2c_addr < I2C_ADDR_MIN || config->i2c_addr > I2C_ADDR_MAX) {
+        ESP_LOGW(TAG, "Stored I2C address 0x%02X is out of range, using 0x%02X",
+                 config->i2c_addr, DEFAULT_I2C_ADDR);
+        config->i2c_addr = DEFAULT_I2C_ADDR;
+        repaired = true;
+    }
+    if (!usb_layout_fits(config->composite_layout)) {
+        // A layout the baseline accepted may no longer fit
+        ESP_LOGW(TAG, "Stored layout 0x%04X does not fit, using 0x%04X",
+                 config->composite_layout, DEFAULT_COMPOSITE_LAYOUT);
+        config->composite_layout = DEFAULT_COMPOSITE_LAYOUT;
+        repaired = true;
+    }
+    return repaired;
+}
+
+esp_err_t config_blob_encode(const hidra_config_t *config, uint8_t *blob, size_t len)
+{
+    if (!config || !blob) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len < CONFIG_BLOB_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint8_t *p = &blob[CONFIG_BLOB_HEADER_SIZE];
+    *p++ = config->i2c_addr;
+    p = put_u16(p, config->usb_vid);
+    p = put_u16(p, config->usb_pid);
+    p = put_u16(p, config->composite_layout);
+    *p++ = config->irq_gpio;
+    memcpy(p, config->poll_interval_ms, LAYOUT_BIT_COUNT);
+    p += LAYOUT_BIT_COUNT;
+    // strncpy zero-fills, so no stack bytes end up in flash
+    strncpy((char *)p, config->manufacturer, CONFIG_BLOB_STRING_SIZE);
+    p += CONFIG_BLOB_STRING_SIZE;
+    strncpy((char *)p, config->product, CONFIG_BLOB_STRING_SIZE);
+    p += CONFIG_BLOB_STRING_SIZE;
+    strncpy((char *)p, config->serial, CONFIG_BLOB_STRING_SIZE);
+
+    uint32_t crc = esp_rom_crc32_le(0, &blob[CONFIG_BLOB_HEADER_SIZE], CONFIG_BLOB_PAYLOAD_SIZE);
+    blob[0] = CONFIG_BLOB_VERSION;
+    put_u16(&blob[1], CONFIG_BLOB_PAYLOAD_SIZE);
+    put_u16(&blob[3], crc & 0xFFFF);
+    put_u16(&blob[5], crc >> 16);
+    return ESP_OK;
+}
+
+static void get_string(char *dst, const uint8_t *src)
+{
+    memcpy(dst, src, CONFIG_BLOB_STRING_SIZE);
+    dst[CONFIG_BLOB_STRING_SIZE - 1] = '\0';
+}
+
+esp_err_t config_blob_decode(const uint8_t *blob, size_t len, hidra_config_t *config_out)
+{
+    if (!blob || !config_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len < CONFIG_BLOB_HEADER_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (blob[0] != CONFIG_BLOB_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (get_u16(&blob[1]) != CONFIG_BLOB_PAYLOAD_SIZE || len < CONFIG_BLOB_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const uint8_t *p = &blob[CONFIG_BLOB_HEADER_SIZE];
+    uint32_t crc = get_u16(&blob[3]) | ((uint32_t)get_u16(&blob[5]) << 16);
+    if (esp_rom_crc32_le(0, p, CONFIG_BLOB_PAYLOAD_SIZE) != crc) {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    hidra_config_t config;
+    config.i2c_addr = *p++;
+    config.usb_vid = get_u16(p);
+    config.usb_pid = get_u16(p + 2);
+    config.composite_layout = get_u16(p + 4);
+    p += 6;
+    config.irq_gpio = *p++;
+    memcpy(config.poll_interval_ms, p, LAYOUT_BIT_COUNT);
+    p += LAYOUT_BIT_COUNT;
+    get_string(config.manufacturer, p);
+    get_string(config.product, p + CONFIG_BLOB_STRING_SIZE);
+    get_string(config.serial, p + 2 * CONFIG_BLOB_STRING_SIZE);
+
+    // A matching CRC only says the bytes are the ones written
+    config_repair(&config);
+    if (!config_valid(&config)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    *config_out = config;
+    return ESP_OK;
+}
+
+// Read the one-key-per-field layout over the defaults. Returns true if any
+// key was present.
+static bool load_legacy(nvs_handle_t handle, hidra_config_t *config)
+{
+    bool found = false;
+    size_t size;
+
+    found |= nvs_get_u8(handle, NVS_KEY_I2C_ADDR, &config->i2c_addr) == ESP_OK;
+    found |= nvs_get_u16(handle, NVS_KEY_USB_VID, &config->usb_vid) == ESP_OK;
+    found |= nvs_get_u16(handle, NVS_KEY_USB_PID, &config->usb_pid) == ESP_OK;
+    found |= nvs_get_u16(handle, NVS_KEY_COMPOSITE_LAYOUT, &config->composite_layout) == ESP_OK;
+
+    size = sizeof(config->manufacturer);
+    found |= nvs_get_str(handle, NVS_KEY_MANUFACTURER, config->manufacturer, &size) == ESP_OK;
+    size = sizeof(config->product);
+    found |= nvs_get_str(handle, NVS_KEY_PRODUCT, config->product, &size) == ESP_OK;
+    size = sizeof(config->serial);
+    found |= nvs_get_str(handle, NVS_KEY_SERIAL, config->serial, &size) == ESP_OK;
+    size = sizeof(config->poll_interval_ms);
+    found |= nvs_get_blob(handle, NVS_KEY_POLL_INTERVALS, config->poll_interval_ms, &size) == ESP_OK;
+    found |= nvs_get_u8(handle, NVS_KEY_IRQ_GPIO, &config->irq_gpio) == ESP_OK;
+
+    return found;
+}
+
+static esp_err_t write_blob(nvs_handle_t handle, const hidra_config_t *config)
+{
+    uint8_t blob[CONFIG_BLOB_SIZE];
+    esp_err_t err = config_blob_encode(config, blob, sizeof(blob));
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, NVS_KEY_CONFIG_BLOB, blob, sizeof(blob));
+    }
+    return err;
+}
+
+static esp_err_t migrate_legacy(nvs_handle_t handle, const hidra_config_t *config)
+{
+    // The blob is committed together with the key removal; if power fails
+    // before the commit, the next boot migrates again
+    esp_err_t err = write_blob(handle, config);
+    for (size_t i = 0; err == ESP_OK && i < sizeof(legacy_keys) / sizeof(legacy_keys[0]); i++) {
+        esp_err_t erase = nvs_erase_key(handle, legacy_keys[i]);
+        if (erase != ESP_OK && erase != ESP_ERR_NVS_NOT_FOUND) {
+            err = erase;
+        }
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    return err;
+}
+
+esp_err_t config_store_load(hidra_config_t *config)
+{
+    if (!config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    uint8_t blob[CONFIG_BLOB_SIZE];
+    size_t size = sizeof(blob);
+    err = nvs_get_blob(handle, NVS_KEY_CONFIG_BLOB, blob, &size);
+    if (err == ESP_OK) {
+        err = config_blob_decode(blob, size, config);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Stored configuration is invalid (%s), using defaults", esp_err_to_name(err));
+        }
+    } else if (err == ESP_ERR_NVS_INVALID_LENGTH) {
+        ESP_LOGW(TAG, "Stored configuration has the wrong size, using defaults");
+    } else if (err == ESP_ERR_NVS_NOT_FOUND) {
+        // Decode into a copy so a half-read legacy store cannot leave mixed values
+        hidra_config_t legacy = *config;
+        if (load_legacy(handle, &legacy)) {
+            // The migrated blob holds the repaired values
+            config_repair(&legacy);
+            bool valid = config_valid(&legacy);
+            if (valid) {
+                *config = legacy;
+            }
+            err = migrate_legacy(handle, config);
+            if (err == ESP_OK) {
+                ESP_LOGI(TAG, "Migrated per-key configuration to a single blob");
+            } else {
+                // The legacy keys still hold the configuration: use it anyway
+                ESP_LOGW(TAG, "Configuration migration failed: %s", esp_err_to_name(err));
+                err = ESP_OK;
+            }
+            if (!valid) {
+                err = ESP_ERR_INVALID_STATE;
+            }
+        }
+    }
+
+    nvs_close(handle);
+    return err;
+}
+
+esp_err_t config_store_save(const hidra_config_t *config)
+{
+    if (!config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = write_blob(handle, config);
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return err;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "usb_descriptors.h"
+
+// The configuration lives in one NVS blob (NVS_KEY_CONFIG_BLOB):
+//   [0]     CONFIG_BLOB_VERSION
+//   [1..2]  payload length, little endian
+//   [3..6]  CRC-32 of the payload, little endian
+//   [7..]   payload: i2c_addr, usb_vid, usb_pid, composite_layout, irq_gpio,
+//           poll_interval_ms[LAYOUT_BIT_COUNT], manufacturer, product, serial
+// Multi-byte fields are little endian, strings are fixed 64-byte fields.
+// Bump the version when the payload changes and migrate older blobs on load.
+#define CONFIG_BLOB_VERSION         1
+#define CONFIG_BLOB_HEADER_SIZE     7
+#define CONFIG_BLOB_STRING_SIZE     (MAX_STRING_LENGTH + 1)
+#define CONFIG_BLOB_PAYLOAD_SIZE    (8 + LAYOUT_BIT_COUNT + 3 * CONFIG_BLOB_STRING_SIZE)
+#define CONFIG_BLOB_SIZE            (CONFIG_BLOB_HEADER_SIZE + CONFIG_BLOB_PAYLOAD_SIZE)
+
+#define I2C_ADDR_MIN    0x08  // 7-bit addresses outside 0x08-0x77 are reserved
+#define I2C_ADDR_MAX    0x77
+
+// Whether the configuration can go live: a usable I2C address and a layout
+// this firmware can enumerate
+bool config_valid(const hidra_config_t *config);
+
+// Reset the fields that fail config_valid() to their defaults (I2C address
+// DEFAULT_I2C_ADDR, layout DEFAULT_COMPOSITE_LAYOUT) and keep the rest.
+// Returns true if a field was reset.
+bool config_repair(hidra_config_t *config);
+
+// Serialize config into blob. ESP_ERR_INVALID_SIZE if len < CONFIG_BLOB_SIZE.
+esp_err_t config_blob_encode(const hidra_config_t *config, uint8_t *blob, size_t len);
+
+// Parse a blob into config_out, which is only written on success.
+// ESP_ERR_INVALID_VERSION for an unknown version, ESP_ERR_INVALID_SIZE for a
+// truncated blob, ESP_ERR_INVALID_CRC for a corrupted payload and
+// ESP_ERR_INVALID_STATE for values config_repair() cannot fix. Fields it can
+// fix come back repaired.
+esp_err_t config_blob_decode(const uint8_t *blob, size_t len, hidra_config_t *config_out);
+
+// Load the configuration over the defaults already in config. A store written
+// with the old one-key-per-field layout is migrated to the blob in place.
+// ESP_ERR_NVS_NOT_FOUND if nothing is stored; any error leaves the defaults.
+// Stored fields that fail config_valid() are reset by config_repair(), so a
+// layout that no longer fits keeps the address, IDs and strings; migrated
+// per-key values are saved repaired.
+esp_err_t config_store_load(hidra_config_t *config);
+
+// Write the configuration as one blob and commit
+esp_err_t config_store_save(const hidra_config_t *config);
@@ -0,0 +1,65 @@
+#include "hid_batch.h"
+#include "hidra_protocol.h"
+#include <string.h>
+
+esp_err_t hid_batch_validate(const uint8_t *payload, size_t len, size_t *count_out)
+{
+    if (!payload || len == 0 || len > MAX_BATCH_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    size_t count = 0;
+    size_t offset = 0;
+    while (offset < len) {
+        if (len - offset < BATCH_RECORD_HEADER_SIZE) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        uint8_t report_len = payload[offset + 1];
+        if (report_len == 0 || report_len > MAX_REPORT_SIZE ||
+            report_len > len - offset - BATCH_RECORD_HEADER_SIZE) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        offset += BATCH_RECORD_HEADER_SIZE + report_len;
+        count++;
+    }
+
+    if (count_out) {
+        *count_out = count;
+    }
+    return ESP_OK;
+}
+
+bool hid_batch_next(const uint8_t *payload, size_t len, size_t *offset, hid_batch_record_t *record_out)
+{
+    if (*offset + BATCH_RECORD_HEADER_SIZE > len) {
+        return false;
+    }
+
+    const uint8_t *record = payload + *offset;
+    if (record[1] > len - *offset - BATCH_RECORD_HEADER_SIZE) {
+        return false;
+    }
+
+    record_out->hid_register = record[0];
+    record_out->len = record[1];
+    record_out->report = record + BATCH_RECORD_HEADER_SIZE;
+    *offset += BATCH_RECORD_HEADER_SIZE + record[1];
+    return true;
+}
+
+esp_err_t hid_batch_append(uint8_t *payload, size_t capacity, size_t *len, uint8_t hid_register,
+                           const uint8_t *report, size_t report_len)
+{
+    if (!payload || !len || !report || report_len == 0 || report_len > MAX_REPORT_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (*len + BATCH_RECORD_HEADER_SIZE + report_len > capacity) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    payload[*len] = hid_register;
+    payload[*len + 1] = report_len;
+    memcpy(&payload[*len + BATCH_RECORD_HEADER_SIZE], report, report_len);
+    *len += BATCH_RECORD_HEADER_SIZE + report_len;
+    return ESP_OK;
+}
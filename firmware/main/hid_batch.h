@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// One [register, length, report...] record of a HIDRA_REG_BATCH payload.
+// report points into the payload; it is not copied.
+typedef struct {
+    uint8_t hid_register;
+    uint8_t len;
+    const uint8_t *report;
+} hid_batch_record_t;
+
+// Check the framing of a whole batch before any record is acted on.
+// ESP_ERR_INVALID_SIZE for an empty batch, a truncated record, a zero-length
+// report or a report longer than MAX_REPORT_SIZE. count_out may be NULL.
+esp_err_t hid_batch_validate(const uint8_t *payload, size_t len, size_t *count_out);
+
+// Walk the records of a validated batch. offset starts at 0; returns false
+// once there are no more records.
+bool hid_batch_next(const uint8_t *payload, size_t len, size_t *offset, hid_batch_record_t *record_out);
+
+// Append a record to a batch being built in payload (capacity bytes, *len
+// used so far). ESP_ERR_INVALID_SIZE for a zero-length report or one longer
+// than MAX_REPORT_SIZE, ESP_ERR_NO_MEM if the record does not fit.
+esp_err_t hid_batch_append(uint8_t *payload, size_t capacity, size_t *len, uint8_t hid_register,
+                           const uint8_t *report, size_t report_len);
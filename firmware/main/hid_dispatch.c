@@ -0,0 +1,480 @@
+#include "hid_dispatch.h"
+#include "report_ring.h"
+#include "mouse_coalesce.h"
+#include "touch_frame.h"
+#include "usb_descriptors.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+#include <stdatomic.h>
+#include <string.h>
+
+static const char *TAG = "hid_dispatch";
+
+// How a channel queues its reports
+typedef enum {
+    CHANNEL_RING,       // Every report in order
+    CHANNEL_MOUSE,      // Relative motion summed per button state
+    CHANNEL_TOUCH,      // Multi-touch contacts merged per complete frame
+} channel_kind_t;
+
+// Per-interface dispatch state. Producers (i2c_task, macro_task,
+// schedule_task) take turns under main.c's g_producer_lock; the USB task is
+// the only consumer of each channel.
+typedef struct {
+    report_ring_t ring;
+    uint16_t report_len;
+    channel_kind_t kind;
+    union {                             // Guarded by g_motion_lock
+        mouse_coalesce_queue_t motion;  // CHANNEL_MOUSE
+        touch_frame_t touch;            // CHANNEL_TOUCH
+    };
+    uint32_t dropped;               // Producer: reports rejected
+    uint32_t coalesced;             // Consumer: reports merged into another
+    bool in_flight;                 // Consumer: endpoint owns a report
+    uint8_t *last_report;           // Consumer: last report sent, for GET_REPORT
+    uint16_t last_len;
+    uint32_t rx_stamp[HID_DISPATCH_RING_DEPTH];  // Receive time per ring slot
+} hid_channel_t;
+
+_Static_assert(HID_DISPATCH_MAX_INSTANCES <= EXT_STATUS_MAX_INTERFACES,
+               "extended status block must have an entry for every interface");
+
+// Rings are carved out of a static pool
+static uint8_t g_ring_pool[HID_DISPATCH_MAX_INSTANCES *
+                          REPORT_RING_STORAGE_SIZE(MAX_REPORT_SIZE, HID_DISPATCH_RING_DEPTH)];
+// Last sent report per channel, carved by report length
+static uint8_t g_last_pool[HID_DISPATCH_MAX_INSTANCES * MAX_REPORT_SIZE];
+static hid_channel_t g_channels[HID_DISPATCH_MAX_INSTANCES];
+static uint8_t g_channel_count = 0;
+static uint8_t g_next_instance = 0;
+static hid_dispatch_transport_t g_transport;
+static portMUX_TYPE g_motion_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Set by the producer when it asks for a pump, cleared by the pump
+static atomic_bool g_wake_pending = false;
+
+static hid_dispatch_latency_t g_latency;
+static portMUX_TYPE g_latency_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Default TinyUSB transport
+static bool tinyusb_ready(uint8_t instance)
+{
+    // Instances sharing one USB interface also share its endpoint
+    return tud_hid_n_ready(usb_get_hid_itf_for_instance(instance));
+}
+
+static bool tinyusb_send(uint8_t instance, const uint8_t *report, uint16_t len)
+{
+    usb_hid_route_t route;
+    if (!usb_route_hid_report(instance, report, len, &route)) {
+        return false;
+    }
+    return tud_hid_n_report(route.itf, route.report_id, route.data, route.len);
+}
+
+static void tinyusb_deferred_pump(void *param)
+{
+    hid_dispatch_pump();
+}
+
+static void tinyusb_wake(void)
+{
+    // Queue the pump as a TinyUSB event: tud_task() in the USB task wakes
+    // up and runs it, so no polling delay sits between I2C and USB
+    usbd_defer_func(tinyusb_deferred_pump, NULL, false);
+}
+
+static const hid_dispatch_transport_t tinyusb_transport = {
+    .interface_count = usb_get_hid_interface_count,
+    .instance_for_register = usb_get_hid_instance_for_register,
+    .register_for_instance = usb_get_hid_register_for_instance,
+    .report_len = usb_get_hid_report_len,
+    .ready = tinyusb_ready,
+    .send = tinyusb_send,
+    .wake = tinyusb_wake,
+};
+
+esp_err_t hid_dispatch_init(const hid_dispatch_transport_t *transport)
+{
+    hid_dispatch_deinit();
+
+    g_transport = transport ? *transport : tinyusb_transport;
+    if (!g_transport.interface_count || !g_transport.instance_for_register ||
+        !g_transport.register_for_instance || !g_transport.report_len ||
+        !g_transport.ready || !g_transport.send) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t count = g_transport.interface_count();
+    if (count > HID_DISPATCH_MAX_INSTANCES) {
+        ESP_LOGE(TAG, "%d interfaces exceed dispatcher limit of %d", count, HID_DISPATCH_MAX_INSTANCES);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    size_t offset = 0;
+    size_t last_offset = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        hid_channel_t *ch = &g_channels[i];
+        ch->report_len = g_transport.report_len(i);
+        if (ch->report_len == 0 || ch->report_len > MAX_REPORT_SIZE) {
+            ESP_LOGE(TAG, "Invalid report length %d for instance %d", ch->report_len, i);
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        // Until the first send the host reads an idle, all-zero report
+        ch->last_report = &g_last_pool[last_offset];
+        ch->last_len = ch->report_len;
+        memset(ch->last_report, 0, ch->report_len);
+        last_offset += ch->report_len;
+
+        // Relative mouse motion and touch frames are merged as they arrive
+        // and need no ring
+        uint8_t hid_register = g_transport.register_for_instance(i);
+        if (hid_register == HIDRA_REG_MOUSE) {
+            ch->kind = CHANNEL_MOUSE;
+            mouse_coalesce_queue_reset(&ch->motion);
+            continue;
+        }
+        if (hid_register == HIDRA_REG_TOUCHSCREEN || hid_register == HIDRA_REG_TOUCHPAD) {
+            ch->kind = CHANNEL_TOUCH;
+            touch_frame_reset(&ch->touch, hid_register == HIDRA_REG_TOUCHPAD);
+            ch->last_report[0] = TOUCH_REPORT_ID;
+            continue;
+        }
+        ch->kind = CHANNEL_RING;
+
+        esp_err_t ret = report_ring_init(&ch->ring, &g_ring_pool[offset], ch->report_len, HID_DISPATCH_RING_DEPTH);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        offset += REPORT_RING_STORAGE_SIZE(ch->report_len, HID_DISPATCH_RING_DEPTH);
+    }
+    g_channel_count = count;
+
+    ESP_LOGI(TAG, "Dispatcher ready - %d rings, %d bytes", g_channel_count, (int)offset);
+    return ESP_OK;
+}
+
+void hid_dispatch_deinit(void)
+{
+    g_channel_count = 0;
+    g_next_instance = 0;
+    memset(g_channels, 0, sizeof(g_channels));
+    atomic_store(&g_wake_pending, false);
+    hid_dispatch_reset_latency();
+}
+
+static void record_latency(uint32_t stamp)
+{
+    uint32_t latency = (uint32_t)esp_timer_get_time() - stamp;
+    int bucket = 0;
+    while (bucket < HID_DISPATCH_LATENCY_BUCKETS - 1 &&
+           latency >= ((uint32_t)HID_DISPATCH_LATENCY_BASE_US << bucket)) {
+        bucket++;
+    }
+
+    portENTER_CRITICAL(&g_latency_lock);
+    if (g_latency.count == 0 || latency < g_latency.min_us) {
+        g_latency.min_us = latency;
+    }
+    if (latency > g_latency.max_us) {
+        g_latency.max_us = latency;
+    }
+    g_latency.count++;
+    g_latency.total_us += latency;
+    g_latency.histogram[bucket]++;
+    portEXIT_CRITICAL(&g_latency_lock);
+}
+
+esp_err_t hid_dispatch_submit(uint8_t hid_register, const uint8_t *report, size_t len, uint32_t stamp)
+{
+    uint8_t instance = g_channel_count ? g_transport.instance_for_register(hid_register) : 0xFF;
+    if (instance >= g_channel_count) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    hid_channel_t *ch = &g_channels[instance];
+    if (ch->kind == CHANNEL_TOUCH) {
+        // Touch writes carry contacts, not the USB report
+        portENTER_CRITICAL(&g_motion_lock);
+        esp_err_t ret = touch_frame_add(&ch->touch, report, len, stamp);
+        portEXIT_CRITICAL(&g_motion_lock);
+        if (ret != ESP_OK) {
+            if (ret == ESP_ERR_NO_MEM) {
+                ch->dropped++;
+            }
+            return ret;
+        }
+    } else {
+        if (len > ch->report_len) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        bool accepted;
+        if (ch->kind == CHANNEL_MOUSE) {
+            portENTER_CRITICAL(&g_motion_lock);
+            accepted = mouse_coalesce_queue_add(&ch->motion, report, len, stamp);
+            portEXIT_CRITICAL(&g_motion_lock);
+        } else {
+            // A full ring's head slot is the one the USB task is sending
+            accepted = report_ring_has_space(&ch->ring);
+            if (accepted) {
+                ch->rx_stamp[report_ring_head_slot(&ch->ring)] = stamp;
+                accepted = report_ring_push(&ch->ring, report, len);
+            }
+        }
+
+        if (!accepted) {
+            ch->dropped++;
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // One outstanding wake-up is enough: the pump drains every ring
+    if (g_transport.wake && !atomic_exchange(&g_wake_pending, true)) {
+        g_transport.wake();
+    }
+    return ESP_OK;
+}
+
+static void remember_report(hid_channel_t *ch, const uint8_t *report, size_t len)
+{
+    memcpy(ch->last_report, report, len);
+    ch->last_len = len;
+    if (ch->kind == CHANNEL_MOUSE) {
+        // Motion was delivered once; reading the state back must not repeat it
+        memset(&ch->last_report[1], 0, len - 1);
+    }
+}
+
+static void pump_coalesced(uint8_t instance, hid_channel_t *ch)
+{
+    if (!g_transport.ready(instance)) {
+        return;
+    }
+
+    // Everything queued with the front button state goes out as one report;
+    // motion beyond the int8 range stays queued for the next interval
+    uint8_t out[MAX_REPORT_SIZE];
+    uint32_t reports = 0;
+    uint32_t stamp = 0;
+    portENTER_CRITICAL(&g_motion_lock);
+    size_t len = mouse_coalesce_queue_build(&ch->motion, out, ch->report_len, &reports, &stamp);
+    portEXIT_CRITICAL(&g_motion_lock);
+    if (len == 0) {
+        return;
+    }
+
+    if (g_transport.send(instance, out, len)) {
+        // Reports folded in since the build stay pending: consume only
+        // subtracts what was sent
+        portENTER_CRITICAL(&g_motion_lock);
+        mouse_coalesce_queue_consume(&ch->motion, out, len);
+        portEXIT_CRITICAL(&g_motion_lock);
+        remember_report(ch, out, len);
+        if (reports > 1) {
+            ch->coalesced += reports - 1;
+        }
+        ch->in_flight = true;
+        record_latency(stamp);
+    }
+}
+
+static void pump_touch(uint8_t instance, hid_channel_t *ch)
+{
+    if (!g_transport.ready(instance)) {
+        return;
+    }
+
+    // The latest complete frame goes out, with any lift or tap the frames
+    // in between would otherwise hide
+    uint8_t out[MAX_REPORT_SIZE];
+    uint32_t frames = 0;
+    uint32_t stamp = 0;
+    portENTER_CRITICAL(&g_motion_lock);
+    size_t len = touch_frame_build(&ch->touch, out, sizeof(out), &frames, &stamp);
+    portEXIT_CRITICAL(&g_motion_lock);
+    if (len == 0) {
+        return;
+    }
+
+    if (g_transport.send(instance, out, len)) {
+        portENTER_CRITICAL(&g_motion_lock);
+        touch_frame_consume(&ch->touch);
+        portEXIT_CRITICAL(&g_motion_lock);
+        remember_report(ch, out, len);
+        if (frames > 1) {
+            ch->coalesced += frames - 1;
+        }
+        ch->in_flight = true;
+        if (frames) {
+            record_latency(stamp);
+        }
+    }
+}
+
+void hid_dispatch_pump(void)
+{
+    // Cleared before the rings are read, so a report pushed after this point
+    // requests a new wake-up
+    atomic_store(&g_wake_pending, false);
+
+    // Each endpoint holds at most one report, so a single pass fills every
+    // idle endpoint. Rotate the start so no interface is always served last.
+    uint8_t start = g_next_instance;
+    for (uint8_t n = 0; n < g_channel_count; n++) {
+        uint8_t instance = (start + n) % g_channel_count;
+        hid_channel_t *ch = &g_channels[instance];
+        if (ch->in_flight) {
+            continue;
+        }
+
+        if (ch->kind == CHANNEL_MOUSE) {
+            pump_coalesced(instance, ch);
+            continue;
+        }
+        if (ch->kind == CHANNEL_TOUCH) {
+            pump_touch(instance, ch);
+            continue;
+        }
+
+        size_t len;
+        const uint8_t *report = report_ring_peek(&ch->ring, &len);
+        if (!report || !g_transport.ready(instance)) {
+            continue;
+        }
+
+        // The transport copies the report into the endpoint buffer
+        if (g_transport.send(instance, report, len)) {
+            record_latency(ch->rx_stamp[report_ring_tail_slot(&ch->ring)]);
+            remember_report(ch, report, len);
+            report_ring_pop(&ch->ring);
+            ch->in_flight = true;
+        }
+    }
+    if (g_channel_count) {
+        g_next_instance = (start + 1) % g_channel_count;
+    }
+}
+
+void hid_dispatch_report_complete(uint8_t instance)
+{
+    if (instance < HID_DISPATCH_MAX_INSTANCES) {
+        g_channels[instance].in_flight = false;
+    }
+    hid_dispatch_pump();
+}
+
+size_t hid_dispatch_get_last_report(uint8_t instance, uint8_t *buffer, size_t len)
+{
+    if (!buffer || instance >= g_channel_count) {
+        return 0;
+    }
+
+    const hid_channel_t *ch = &g_channels[instance];
+    if (len < ch->last_len) {
+        return 0;
+    }
+    memcpy(buffer, ch->last_report, ch->last_len);
+    return ch->last_len;
+}
+
+uint8_t hid_dispatch_instance_count(void)
+{
+    return g_channel_count;
+}
+
+esp_err_t hid_dispatch_get_stats(uint8_t instance, hid_dispatch_stats_t *stats_out)
+{
+    if (!stats_out || instance >= g_channel_count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const hid_channel_t *ch = &g_channels[instance];
+    *stats_out = (hid_dispatch_stats_t){
+        .hid_register = g_transport.register_for_instance(instance),
+        .slot_size = ch->report_len,
+        .dropped = ch->dropped,
+        .coalesced = ch->coalesced,
+    };
+    if (ch->kind == CHANNEL_MOUSE) {
+        stats_out->capacity = MOUSE_COALESCE_SEGMENTS;
+        stats_out->depth = ch->motion.count;
+        stats_out->high_water = ch->motion.high_water;
+    } else if (ch->kind == CHANNEL_TOUCH) {
+        stats_out->capacity = TOUCH_MAX_CONTACTS;
+        stats_out->depth = touch_frame_slots_used(&ch->touch);
+        stats_out->high_water = ch->touch.high_water;
+    } else {
+        stats_out->capacity = ch->ring.slot_count;
+        stats_out->depth = report_ring_depth(&ch->ring);
+        stats_out->high_water = ch->ring.high_water;
+    }
+    return ESP_OK;
+}
+
+bool hid_dispatch_queue_high(void)
+{
+    for (uint8_t i = 0; i < g_channel_count; i++) {
+        hid_dispatch_stats_t stats;
+        hid_dispatch_get_stats(i, &stats);
+        if (stats.depth * 4 >= stats.capacity * 3) {
+            return true;
+        }
+    }
+    return false;
+}
+
+esp_err_t hid_dispatch_encode_ext_status(uint8_t usb_state, uint8_t last_error, uint8_t *block, size_t len)
+{
+    if (!block || len < EXT_STATUS_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(block, 0, EXT_STATUS_SIZE);
+    block[0] = EXT_STATUS_VERSION;
+    block[1] = usb_state;
+    block[2] = last_error;
+    block[3] = g_channel_count;
+
+    uint32_t dropped = 0;
+    uint8_t *entry = &block[EXT_STATUS_HEADER_SIZE];
+    for (uint8_t i = 0; i < g_channel_count; i++) {
+        hid_dispatch_stats_t stats;
+        hid_dispatch_get_stats(i, &stats);
+        uint16_t free_slots = stats.capacity - stats.depth;
+        entry[0] = stats.hid_register;
+        entry[1] = stats.depth > UINT8_MAX ? UINT8_MAX : stats.depth;
+        entry[2] = free_slots > UINT8_MAX ? UINT8_MAX : free_slots;
+        entry += EXT_STATUS_ENTRY_SIZE;
+        dropped += stats.dropped;
+    }
+
+    block[4] = dropped & 0xFF;
+    block[5] = (dropped >> 8) & 0xFF;
+    block[6] = (dropped >> 16) & 0xFF;
+    block[7] = (dropped >> 24) & 0xFF;
+    return ESP_OK;
+}
+
+esp_err_t hid_dispatch_get_latency(hid_dispatch_latency_t *latency_out)
+{
+    if (!latency_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&g_latency_lock);
+    *latency_out = g_latency;
+    portEXIT_CRITICAL(&g_latency_lock);
+    return ESP_OK;
+}
+
+void hid_dispatch_reset_latency(void)
+{
+    portENTER_CRITICAL(&g_latency_lock);
+    memset(&g_latency, 0, sizeof(g_latency));
+    portEXIT_CRITICAL(&g_latency_lock);
+}
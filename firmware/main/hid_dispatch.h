@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "hidra_protocol.h"
+
+// Maximum number of HID interfaces the dispatcher tracks
+#define HID_DISPATCH_MAX_INSTANCES  8
+// Reports buffered per interface (power of two)
+#define HID_DISPATCH_RING_DEPTH     16
+
+// Receive-to-send latency histogram: bucket i counts reports sent within
+// HID_DISPATCH_LATENCY_BASE_US << i, the last bucket everything slower
+#define HID_DISPATCH_LATENCY_BUCKETS 8
+#define HID_DISPATCH_LATENCY_BASE_US 125
+
+// USB-side hooks used by the dispatcher. Passing NULL to hid_dispatch_init()
+// selects the TinyUSB implementation; tests substitute their own. wake is
+// optional: it is called from the producer when reports are waiting and no
+// pump is pending, and must make the USB task call hid_dispatch_pump().
+typedef struct {
+    uint8_t (*interface_count)(void);
+    uint8_t (*instance_for_register)(uint8_t hid_register);
+    uint8_t (*register_for_instance)(uint8_t instance);
+    uint16_t (*report_len)(uint8_t instance);
+    bool (*ready)(uint8_t instance);
+    bool (*send)(uint8_t instance, const uint8_t *report, uint16_t len);
+    void (*wake)(void);
+} hid_dispatch_transport_t;
+
+// Per-interface ring statistics
+typedef struct {
+    uint8_t hid_register;
+    uint16_t slot_size;     // Report length of the interface
+    uint16_t capacity;      // Slots in the ring (button-state segments for the mouse,
+                            // contact slots for touch)
+    uint16_t depth;         // Reports (mouse: segments, touch: contacts) currently queued
+    uint16_t high_water;    // Deepest fill level since init
+    uint32_t dropped;       // Reports rejected because the ring was full
+    uint32_t coalesced;     // Mouse reports or touch frames merged into a neighbouring report
+} hid_dispatch_stats_t;
+
+// Time from the I2C write being received (or a macro or scheduled report
+// being released) to its report being handed to tud_hid_n_report(), over all
+// interfaces. Coalesced mouse reports count
+// from the oldest report folded in.
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t histogram[HID_DISPATCH_LATENCY_BUCKETS];
+} hid_dispatch_latency_t;
+
+// Dispatcher lifecycle. Call after usb_descriptors_init(): one ring is
+// created per enabled interface, sized to that interface's report length
+// (the mouse gets a coalescing motion queue, touch interfaces a contact
+// frame instead).
+esp_err_t hid_dispatch_init(const hid_dispatch_transport_t *transport);
+void hid_dispatch_deinit(void);
+
+// Producer side (i2c_task, macro_task, schedule_task, one at a time). stamp
+// is the esp_timer time, low 32 bits, the report came into being: the
+// receive time of its I2C write, or the release time of a macro or
+// scheduled report. Latency and touch scan time count from it. Returns ESP_ERR_NOT_FOUND if no interface serves
+// the register, ESP_ERR_INVALID_SIZE if the report is longer than the
+// interface's report and ESP_ERR_NO_MEM if its ring is full. Relative mouse
+// reports are coalesced instead: motion with the same button state is summed
+// into one report per interval, so only a burst of button changes can fill
+// the queue and no distance is lost to a slow host. Touch writes carry
+// [frame flags, contact...] (see TOUCH_FRAME_END) rather than the USB report;
+// frames completed faster than the host polls collapse into one report, and
+// ESP_ERR_NO_MEM means every contact slot is held by a finger the host has
+// not yet seen lift.
+esp_err_t hid_dispatch_submit(uint8_t hid_register, const uint8_t *report, size_t len, uint32_t stamp);
+
+// Producer side: true while any interface queue is at least 3/4 full
+bool hid_dispatch_queue_high(void);
+
+// Consumer side (usb_task / TinyUSB callbacks)
+void hid_dispatch_pump(void);
+void hid_dispatch_report_complete(uint8_t instance);
+// Consumer side: copy the last report sent on the interface, as handed to
+// the transport, for answering GET_REPORT. Relative mouse motion reads back
+// as zero so it is never applied twice; before the first send the report is
+// idle (all zero, touch reports carrying TOUCH_REPORT_ID). Returns the length,
+// or 0 for an unknown instance or a buffer that is too short.
+size_t hid_dispatch_get_last_report(uint8_t instance, uint8_t *buffer, size_t len);
+
+// Diagnostics
+uint8_t hid_dispatch_instance_count(void);
+esp_err_t hid_dispatch_get_stats(uint8_t instance, hid_dispatch_stats_t *stats_out);
+esp_err_t hid_dispatch_get_latency(hid_dispatch_latency_t *latency_out);
+// Encode the EXT_STATUS_REG block: queue depth and free slots per interface
+// plus the total of dropped reports. len must be at least EXT_STATUS_SIZE.
+esp_err_t hid_dispatch_encode_ext_status(uint8_t usb_state, uint8_t last_error, uint8_t *block, size_t len);
+void hid_dispatch_reset_latency(void);
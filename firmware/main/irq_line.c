@@ -0,0 +1,80 @@
+#include "irq_line.h"
+#include "driver/gpio.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+
+static const char *TAG = "irq_line";
+
+static uint8_t g_irq_gpio = IRQ_GPIO_DISABLED;
+static uint8_t g_irq_cause = 0;
+static portMUX_TYPE g_irq_lock = portMUX_INITIALIZER_UNLOCKED;
+
+esp_err_t irq_line_init(uint8_t gpio)
+{
+    if (gpio != IRQ_GPIO_DISABLED && !GPIO_IS_VALID_OUTPUT_GPIO((gpio_num_t)gpio)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Moving the line: let go of the old pin. Latched causes carry over.
+    portENTER_CRITICAL(&g_irq_lock);
+    uint8_t old_gpio = g_irq_gpio;
+    g_irq_gpio = IRQ_GPIO_DISABLED;
+    portEXIT_CRITICAL(&g_irq_lock);
+    if (old_gpio != IRQ_GPIO_DISABLED) {
+        gpio_reset_pin(old_gpio);
+    }
+
+    if (gpio == IRQ_GPIO_DISABLED) {
+        return ESP_OK;
+    }
+
+    // Released before the pin becomes an output; the pull-up is on the master side
+    gpio_set_level(gpio, 1);
+    gpio_config_t io_conf = {
+        .intr_type = GPIO_INTR_DISABLE,
+        .mode = GPIO_MODE_OUTPUT_OD,
+        .pin_bit_mask = (1ULL << gpio),
+        .pull_down_en = 0,
+        .pull_up_en = 0,
+    };
+    esp_err_t ret = gpio_config(&io_conf);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    portENTER_CRITICAL(&g_irq_lock);
+    g_irq_gpio = gpio;
+    if (g_irq_cause) {
+        gpio_set_level(gpio, 0);
+    }
+    portEXIT_CRITICAL(&g_irq_lock);
+    ESP_LOGI(TAG, "Interrupt line on GPIO %d", gpio);
+    return ESP_OK;
+}
+
+void irq_line_raise(uint8_t cause)
+{
+    portENTER_CRITICAL(&g_irq_lock);
+    g_irq_cause |= cause;
+    if (g_irq_gpio != IRQ_GPIO_DISABLED) {
+        gpio_set_level(g_irq_gpio, 0);
+    }
+    portEXIT_CRITICAL(&g_irq_lock);
+}
+
+uint8_t irq_line_ack(void)
+{
+    portENTER_CRITICAL(&g_irq_lock);
+    uint8_t cause = g_irq_cause;
+    g_irq_cause = 0;
+    if (g_irq_gpio != IRQ_GPIO_DISABLED) {
+        gpio_set_level(g_irq_gpio, 1);
+    }
+    portEXIT_CRITICAL(&g_irq_lock);
+    return cause;
+}
+
+uint8_t irq_line_pending(void)
+{
+    return g_irq_cause;
+}
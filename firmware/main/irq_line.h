@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "hidra_protocol.h"
+
+// Open-drain interrupt line to the master. Causes (IRQ_CAUSE_*) are latched
+// and the line is held low until the master reads IRQ_CAUSE_REG. With
+// IRQ_GPIO_DISABLED causes are still latched but no pin is driven. Calling
+// it again moves the line; causes already latched stay asserted.
+esp_err_t irq_line_init(uint8_t gpio);
+
+// Safe from any task
+void irq_line_raise(uint8_t cause);
+// Return and clear the latched causes, releasing the line
+uint8_t irq_line_ack(void);
+uint8_t irq_line_pending(void);
@@ -0,0 +1,163 @@
+#include "keyboard_state.h"
+#include <string.h>
+
+static bool is_modifier(uint8_t usage)
+{
+    return usage >= KEYBOARD_USAGE_MOD_FIRST && usage <= KEYBOARD_USAGE_MOD_LAST;
+}
+
+void keyboard_state_reset(keyboard_state_t *ks)
+{
+    memset(ks, 0, sizeof(*ks));
+}
+
+static bool overflow_has(const keyboard_state_t *ks, uint8_t usage)
+{
+    return ks->overflow[usage / 8] & (1 << (usage % 8));
+}
+
+static void overflow_set(keyboard_state_t *ks, uint8_t usage, bool held)
+{
+    if (held) {
+        ks->overflow[usage / 8] |= 1 << (usage % 8);
+        ks->overflow_count++;
+    } else {
+        ks->overflow[usage / 8] &= ~(1 << (usage % 8));
+        ks->overflow_count--;
+    }
+}
+
+bool keyboard_state_apply(keyboard_state_t *ks, uint8_t usage, bool pressed)
+{
+    if (usage == 0) {
+        return false;
+    }
+
+    if (is_modifier(usage)) {
+        uint8_t bit = 1 << (usage - KEYBOARD_USAGE_MOD_FIRST);
+        uint8_t before = ks->modifiers;
+        ks->modifiers = pressed ? (before | bit) : (before & ~bit);
+        return ks->modifiers != before;
+    }
+
+    int slot = -1;
+    for (int i = 0; i < KEYBOARD_MAX_KEYS; i++) {
+        if (ks->keys[i] == usage) {
+            slot = i;
+            break;
+        }
+    }
+
+    if (pressed) {
+        if (slot >= 0 || overflow_has(ks, usage)) {
+            return false;
+        }
+        for (int i = 0; i < KEYBOARD_MAX_KEYS; i++) {
+            if (ks->keys[i] == 0) {
+                ks->keys[i] = usage;
+                return ks->overflow_count == 0;
+            }
+        }
+        // Seventh key: the host sees ErrorRollOver until enough keys are released
+        overflow_set(ks, usage, true);
+        return ks->overflow_count == 1;
+    }
+
+    if (slot < 0) {
+        // Release of a key that did not fit in the six slots, or of an idle key
+        if (!overflow_has(ks, usage)) {
+            return false;
+        }
+        overflow_set(ks, usage, false);
+        return ks->overflow_count == 0;
+    }
+
+    // Keep press order so the report stays stable for the host
+    memmove(&ks->keys[slot], &ks->keys[slot + 1], KEYBOARD_MAX_KEYS - slot - 1);
+    ks->keys[KEYBOARD_MAX_KEYS - 1] = 0;
+    if (ks->overflow_count == 0) {
+        return true;
+    }
+
+    // A key still held beyond the slots takes the freed one (lowest usage first)
+    for (int held = KEYBOARD_USAGE_FIRST_KEY; held < 256; held++) {
+        if (overflow_has(ks, held)) {
+            overflow_set(ks, held, false);
+            ks->keys[KEYBOARD_MAX_KEYS - 1] = held;
+            break;
+        }
+    }
+    return ks->overflow_count == 0;
+}
+
+void keyboard_state_load(keyboard_state_t *ks, const uint8_t *report, size_t len)
+{
+    keyboard_state_reset(ks);
+    if (len > 0) {
+        ks->modifiers = report[0];
+    }
+
+    int n = 0;
+    for (size_t i = 2; i < len && i < KEYBOARD_REPORT_LEN; i++) {
+        if (report[i] >= KEYBOARD_USAGE_FIRST_KEY) {
+            ks->keys[n++] = report[i];
+        }
+    }
+}
+
+size_t keyboard_state_build(const keyboard_state_t *ks, uint8_t *report_out, size_t len)
+{
+    if (len < KEYBOARD_REPORT_LEN) {
+        return 0;
+    }
+
+    report_out[0] = ks->modifiers;
+    report_out[1] = 0;
+    if (ks->overflow_count > 0) {
+        memset(&report_out[2], KEYBOARD_USAGE_ERR_ROLLOVER, KEYBOARD_MAX_KEYS);
+    } else {
+        memcpy(&report_out[2], ks->keys, KEYBOARD_MAX_KEYS);
+    }
+    return KEYBOARD_REPORT_LEN;
+}
+
+void nkro_state_reset(nkro_state_t *ns)
+{
+    memset(ns, 0, sizeof(*ns));
+}
+
+bool nkro_state_apply(nkro_state_t *ns, uint8_t usage, bool pressed)
+{
+    uint8_t *byte;
+    uint8_t bit;
+    if (is_modifier(usage)) {
+        byte = &ns->report[0];
+        bit = 1 << (usage - KEYBOARD_USAGE_MOD_FIRST);
+    } else if (usage >= KEYBOARD_USAGE_FIRST_KEY && usage < NKRO_KEY_BITMAP_BYTES * 8) {
+        byte = &ns->report[1 + usage / 8];
+        bit = 1 << (usage % 8);
+    } else {
+        return false;
+    }
+
+    uint8_t before = *byte;
+    *byte = pressed ? (before | bit) : (before & ~bit);
+    return *byte != before;
+}
+
+void nkro_state_load(nkro_state_t *ns, const uint8_t *report, size_t len)
+{
+    nkro_state_reset(ns);
+    memcpy(ns->report, report, len < NKRO_REPORT_SIZE ? len : NKRO_REPORT_SIZE);
+    // Error usages have no key behind them
+    ns->report[1] &= ~((1 << KEYBOARD_USAGE_FIRST_KEY) - 1);
+}
+
+size_t nkro_state_build(const nkro_state_t *ns, uint8_t *report_out, size_t len)
+{
+    if (len < NKRO_REPORT_SIZE) {
+        return 0;
+    }
+    memcpy(report_out, ns->report, NKRO_REPORT_SIZE);
+    return NKRO_REPORT_SIZE;
+}
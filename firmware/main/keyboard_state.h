@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hidra_protocol.h"
+
+// Boot keyboard report: [modifiers, reserved, key1..key6]
+#define KEYBOARD_REPORT_LEN         8
+#define KEYBOARD_MAX_KEYS           6
+#define KEYBOARD_USAGE_ERR_ROLLOVER 0x01
+#define KEYBOARD_USAGE_FIRST_KEY    0x04  // Below are error codes (ErrorRollOver, POSTFail, ErrorUndefined)
+#define KEYBOARD_USAGE_MOD_FIRST    0xE0  // Left Control
+#define KEYBOARD_USAGE_MOD_LAST     0xE7  // Right GUI
+
+// Keyboard state maintained on the slave from key events, so the master no
+// longer has to track and resend the whole boot report.
+typedef struct {
+    uint8_t modifiers;
+    uint8_t keys[KEYBOARD_MAX_KEYS];  // Pressed usages in press order, 0 = free
+    uint8_t overflow[256 / 8];        // Held usages that did not fit in the six slots
+    uint8_t overflow_count;
+} keyboard_state_t;
+
+void keyboard_state_reset(keyboard_state_t *ks);
+
+// Apply a press or release. Returns true if the boot report changed.
+bool keyboard_state_apply(keyboard_state_t *ks, uint8_t usage, bool pressed);
+
+// Adopt a full boot report written by the master
+void keyboard_state_load(keyboard_state_t *ks, const uint8_t *report, size_t len);
+
+// Build the boot report. Reports ErrorRollOver while more than six keys are held.
+size_t keyboard_state_build(const keyboard_state_t *ks, uint8_t *report_out, size_t len);
+
+// N-key rollover state: the report itself, modifiers then one bit per usage
+typedef struct {
+    uint8_t report[NKRO_REPORT_SIZE];
+} nkro_state_t;
+
+void nkro_state_reset(nkro_state_t *ns);
+
+// Set or clear one key. Returns true if the report changed.
+bool nkro_state_apply(nkro_state_t *ns, uint8_t usage, bool pressed);
+
+// Adopt a full NKRO report written by the master
+void nkro_state_load(nkro_state_t *ns, const uint8_t *report, size_t len);
+
+size_t nkro_state_build(const nkro_state_t *ns, uint8_t *report_out, size_t len);
@@ -0,0 +1,358 @@
+#include "macro.h"
+#include "keyboard_state.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "macro";
+
+#define KEYMAP_MOD_SHIFT    0x02  // Left Shift in the boot report's modifier byte
+
+typedef struct {
+    uint8_t script[MACRO_SLOT_SIZE];
+    uint16_t len;
+} macro_slot_t;
+
+static macro_slot_t g_slots[MACRO_SLOT_COUNT];
+
+// US layout: characters on the same key as their unshifted neighbour
+static const struct {
+    char plain;
+    char shifted;
+    uint8_t usage;
+} us_symbols[] = {
+    {'1', '!', 0x1E}, {'2', '@', 0x1F}, {'3', '#', 0x20}, {'4', '$', 0x21}, {'5', '%', 0x22},
+    {'6', '^', 0x23}, {'7', '&', 0x24}, {'8', '*', 0x25}, {'9', '(', 0x26}, {'0', ')', 0x27},
+    {'-', '_', 0x2D}, {'=', '+', 0x2E}, {'[', '{', 0x2F}, {']', '}', 0x30}, {'\\', '|', 0x31},
+    {';', ':', 0x33}, {'\'', '"', 0x34}, {'`', '~', 0x35}, {',', '<', 0x36}, {'.', '>', 0x37},
+    {'/', '?', 0x38},
+};
+
+static void keymap_reset(macro_player_t *mp)
+{
+    memset(mp->keymap, 0, sizeof(mp->keymap));
+    for (int c = 'a'; c <= 'z'; c++) {
+        mp->keymap[c][0] = 0x04 + (c - 'a');
+        mp->keymap[c - 'a' + 'A'][0] = 0x04 + (c - 'a');
+        mp->keymap[c - 'a' + 'A'][1] = KEYMAP_MOD_SHIFT;
+    }
+    for (size_t i = 0; i < sizeof(us_symbols) / sizeof(us_symbols[0]); i++) {
+        mp->keymap[(uint8_t)us_symbols[i].plain][0] = us_symbols[i].usage;
+        mp->keymap[(uint8_t)us_symbols[i].shifted][0] = us_symbols[i].usage;
+        mp->keymap[(uint8_t)us_symbols[i].shifted][1] = KEYMAP_MOD_SHIFT;
+    }
+    mp->keymap['\n'][0] = 0x28;  // Enter
+    mp->keymap['\b'][0] = 0x2A;  // Backspace
+    mp->keymap['\t'][0] = 0x2B;  // Tab
+    mp->keymap[' '][0] = 0x2C;
+}
+
+// Size of the step at pc, or 0 if it is unknown or runs past the script
+static size_t step_size(const uint8_t *script, size_t len, size_t pc)
+{
+    size_t size;
+    switch (script[pc]) {
+        case MACRO_OP_REPORT:
+            if (pc + 3 > len || script[pc + 2] == 0 || script[pc + 2] > MAX_REPORT_SIZE) {
+                return 0;
+            }
+            size = 3 + script[pc + 2];
+            break;
+        case MACRO_OP_DELAY: size = 3; break;
+        case MACRO_OP_REPEAT: size = 2; break;
+        case MACRO_OP_LOOP: size = 1; break;
+        case MACRO_OP_TEXT:
+            size = pc + 2 <= len ? 2 + script[pc + 1] : 0;
+            break;
+        case MACRO_OP_KEYMAP:
+            size = pc + 2 <= len ? 2 + script[pc + 1] * MACRO_KEYMAP_ENTRY_SIZE : 0;
+            break;
+        default:
+            return 0;
+    }
+    return size && pc + size <= len ? size : 0;
+}
+
+esp_err_t macro_validate(const uint8_t *script, size_t len)
+{
+    if (!script || len == 0 || len > MACRO_SLOT_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    int depth = 0;
+    for (size_t pc = 0; pc < len;) {
+        size_t size = step_size(script, len, pc);
+        if (size == 0) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if (script[pc] == MACRO_OP_REPEAT) {
+            if (script[pc + 1] == 0 || ++depth > MACRO_MAX_DEPTH) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+        } else if (script[pc] == MACRO_OP_LOOP && --depth < 0) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        pc += size;
+    }
+    return depth == 0 ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+esp_err_t macro_player_start(macro_player_t *mp, uint8_t slot, const uint8_t *script, size_t len)
+{
+    if (!mp) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = macro_validate(script, len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    memset(mp, 0, offsetof(macro_player_t, keymap));
+    keymap_reset(mp);
+    mp->script = script;
+    mp->len = len;
+    mp->slot = slot;
+    mp->state = MACRO_STATE_RUNNING;
+    return ESP_OK;
+}
+
+bool macro_player_running(const macro_player_t *mp)
+{
+    return mp && mp->state == MACRO_STATE_RUNNING;
+}
+
+void macro_player_stop(macro_player_t *mp, macro_submit_fn submit)
+{
+    if (!macro_player_running(mp)) {
+        return;
+    }
+    if (mp->key_down && submit) {
+        // Best effort: a full queue leaves the key to the master
+        uint8_t release[KEYBOARD_REPORT_LEN] = {0};
+        submit(HIDRA_REG_KEYBOARD, release, sizeof(release));
+    }
+    mp->state = MACRO_STATE_STOPPED;
+}
+
+// Queue one report. False if playback has to pause or stop.
+static bool submit_report(macro_player_t *mp, macro_submit_fn submit, uint8_t hid_register,
+                          const uint8_t *report, size_t len, uint32_t *wait_us)
+{
+    esp_err_t ret = submit(hid_register, report, len);
+    if (ret == ESP_ERR_NO_MEM) {
+        *wait_us = MACRO_RETRY_US;
+        return false;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Macro %d failed at offset %d: %s", mp->slot, mp->pc, esp_err_to_name(ret));
+        mp->state = MACRO_STATE_FAILED;
+        return false;
+    }
+    mp->reports++;
+    return true;
+}
+
+// Type the characters of the MACRO_OP_TEXT step at pc, one press and one
+// release report each. False if playback has to pause or stop.
+static bool run_text(macro_player_t *mp, macro_submit_fn submit, uint32_t *wait_us)
+{
+    const uint8_t *chars = &mp->script[mp->pc + 2];
+    uint8_t count = mp->script[mp->pc + 1];
+    while (mp->text_pos < count) {
+        const uint8_t *key = mp->keymap[chars[mp->text_pos]];
+        if (key[0] == 0) {
+            mp->text_pos++;
+            continue;
+        }
+
+        uint8_t report[KEYBOARD_REPORT_LEN] = {0};
+        if (!mp->key_down) {
+            report[0] = key[1];
+            report[2] = key[0];
+        }
+        if (!submit_report(mp, submit, HIDRA_REG_KEYBOARD, report, sizeof(report), wait_us)) {
+            return false;
+        }
+        if (mp->key_down) {
+            mp->text_pos++;
+        }
+        mp->key_down = !mp->key_down;
+    }
+    mp->text_pos = 0;
+    return true;
+}
+
+uint32_t macro_player_run(macro_player_t *mp, uint32_t now_us, macro_submit_fn submit)
+{
+    if (!macro_player_running(mp) || !submit) {
+        return 0;
+    }
+    if (mp->waiting) {
+        int32_t left = (int32_t)(mp->resume_us - now_us);
+        if (left > 0) {
+            return left;
+        }
+        mp->waiting = false;
+    }
+
+    uint32_t wait_us = 0;
+    for (int budget = 0; budget < MACRO_RUN_BUDGET; budget++) {
+        if (mp->pc >= mp->len) {
+            mp->state = MACRO_STATE_DONE;
+            return 0;
+        }
+
+        const uint8_t *step = &mp->script[mp->pc];
+        size_t size = step_size(mp->script, mp->len, mp->pc);
+        switch (step[0]) {
+            case MACRO_OP_REPORT:
+                if (!submit_report(mp, submit, step[1], &step[3], step[2], &wait_us)) {
+                    return wait_us;
+                }
+                break;
+
+            case MACRO_OP_DELAY: {
+                uint32_t delay_us = (step[1] | (step[2] << 8)) * 1000u;
+                mp->pc += size;
+                if (delay_us) {
+                    mp->resume_us = now_us + delay_us;
+                    mp->waiting = true;
+                    return delay_us;
+                }
+                continue;
+            }
+
+            case MACRO_OP_REPEAT:
+                mp->loops[mp->depth++] = (macro_loop_t){.start = mp->pc + size, .remaining = step[1]};
+                break;
+
+            case MACRO_OP_LOOP: {
+                macro_loop_t *loop = &mp->loops[mp->depth - 1];
+                if (--loop->remaining) {
+                    mp->pc = loop->start;
+                    continue;
+                }
+                mp->depth--;
+                break;
+            }
+
+            case MACRO_OP_TEXT:
+                if (!run_text(mp, submit, &wait_us)) {
+                    return wait_us;
+                }
+                break;
+
+            case MACRO_OP_KEYMAP:
+                for (uint8_t i = 0; i < step[1]; i++) {
+                    const uint8_t *entry = &step[2 + i * MACRO_KEYMAP_ENTRY_SIZE];
+                    mp->keymap[entry[0]][0] = entry[1];
+                    mp->keymap[entry[0]][1] = entry[2];
+                }
+                break;
+        }
+        mp->pc += size;
+    }
+    return 0;
+}
+
+esp_err_t macro_player_encode_status(const macro_player_t *mp, uint8_t *block, size_t len)
+{
+    if (!mp || !block || len < MACRO_STATUS_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    block[0] = mp->state;
+    block[1] = mp->slot;
+    block[2] = mp->pc & 0xFF;
+    block[3] = (mp->pc >> 8) & 0xFF;
+    block[4] = mp->len & 0xFF;
+    block[5] = (mp->len >> 8) & 0xFF;
+    block[6] = mp->reports & 0xFF;
+    block[7] = (mp->reports >> 8) & 0xFF;
+    return ESP_OK;
+}
+
+esp_err_t macro_slot_write(uint8_t slot, uint16_t offset, const uint8_t *data, size_t len)
+{
+    if (slot >= MACRO_SLOT_COUNT || (len > 0 && !data)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    macro_slot_t *s = &g_slots[slot];
+    if ((offset != 0 && offset != s->len) || offset + len > MACRO_SLOT_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (len > 0) {
+        memcpy(&s->script[offset], data, len);
+    }
+    s->len = offset + len;
+    return ESP_OK;
+}
+
+const uint8_t *macro_slot_get(uint8_t slot, size_t *len_out)
+{
+    if (slot >= MACRO_SLOT_COUNT) {
+        return NULL;
+    }
+    if (len_out) {
+        *len_out = g_slots[slot].len;
+    }
+    return g_slots[slot].script;
+}
+
+static void slot_key(uint8_t slot, char *key, size_t len)
+{
+    snprintf(key, len, "%s%d", NVS_KEY_MACRO_PREFIX, slot);
+}
+
+esp_err_t macro_slot_save(uint8_t slot)
+{
+    if (slot >= MACRO_SLOT_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    char key[16];
+    slot_key(slot, key, sizeof(key));
+    const macro_slot_t *s = &g_slots[slot];
+    if (s->len > 0) {
+        err = nvs_set_blob(handle, key, s->script, s->len);
+    } else {
+        err = nvs_erase_key(handle, key);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
+        }
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return err;
+}
+
+void macro_slots_load(void)
+{
+    nvs_handle_t handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
+
+    for (uint8_t slot = 0; slot < MACRO_SLOT_COUNT; slot++) {
+        char key[16];
+        slot_key(slot, key, sizeof(key));
+        size_t size = MACRO_SLOT_SIZE;
+        if (nvs_get_blob(handle, key, g_slots[slot].script, &size) == ESP_OK) {
+            g_slots[slot].len = size;
+            ESP_LOGI(TAG, "Macro slot %d loaded, %d bytes", slot, (int)size);
+        } else {
+            g_slots[slot].len = 0;
+        }
+    }
+    nvs_close(handle);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "hidra_protocol.h"
+
+// Steps run per macro_player_run() call before it yields, so a script of
+// empty loops cannot hold the producer side
+#define MACRO_RUN_BUDGET    256
+// Wait before retrying a report that found its queue full
+#define MACRO_RETRY_US      1000
+
+// Where playback puts its reports: on the slave, the same path as a write to
+// the report's register, so key events and NKRO updates play too
+typedef esp_err_t (*macro_submit_fn)(uint8_t hid_register, const uint8_t *report, size_t len);
+
+typedef struct {
+    uint16_t start;         // First step of the block
+    uint8_t remaining;      // Runs left, the current one included
+} macro_loop_t;
+
+// Playback of one script. Not thread safe: the caller serializes it with
+// every other producer of the dispatcher.
+typedef struct {
+    const uint8_t *script;
+    uint16_t len;
+    uint16_t pc;                        // Offset of the current step
+    uint8_t slot;
+    uint8_t state;                      // MACRO_STATE_*
+    uint16_t reports;                   // Reports queued so far
+    macro_loop_t loops[MACRO_MAX_DEPTH];
+    uint8_t depth;
+    uint8_t text_pos;                   // Character of the current MACRO_OP_TEXT step
+    bool key_down;                      // Its press is queued, the release is not
+    bool waiting;                       // Inside a MACRO_OP_DELAY
+    uint32_t resume_us;
+    uint8_t keymap[256][2];             // Character -> [usage, modifiers]
+} macro_player_t;
+
+// Check a script's structure: known opcodes, complete operands, repeat
+// counts of 1-255 and balanced blocks at most MACRO_MAX_DEPTH deep.
+// ESP_ERR_INVALID_SIZE for an empty or malformed script.
+esp_err_t macro_validate(const uint8_t *script, size_t len);
+
+// Validate and start playing. The script must stay unchanged while playing.
+esp_err_t macro_player_start(macro_player_t *mp, uint8_t slot, const uint8_t *script, size_t len);
+
+// Queue reports until the script ends, waits or finds a full queue. Returns
+// the microseconds to wait before the next call while still running (0:
+// call again right away).
+uint32_t macro_player_run(macro_player_t *mp, uint32_t now_us, macro_submit_fn submit);
+
+// Abort a running macro (MACRO_STATE_STOPPED). A character a MACRO_OP_TEXT
+// step still holds is released through submit, which may be NULL when the
+// interfaces are gone anyway.
+void macro_player_stop(macro_player_t *mp, macro_submit_fn submit);
+
+bool macro_player_running(const macro_player_t *mp);
+
+// Encode the MACRO_STATUS_REG block. len must be at least MACRO_STATUS_SIZE.
+esp_err_t macro_player_encode_status(const macro_player_t *mp, uint8_t *block, size_t len);
+
+// Script slots, written over I2C and optionally kept in NVS. Owned by the
+// same producer side as the player.
+
+// Write a chunk at offset: 0 starts the slot over, anything else must
+// append. ESP_ERR_INVALID_ARG for an unknown slot, ESP_ERR_INVALID_SIZE for
+// a gap or a script beyond MACRO_SLOT_SIZE.
+esp_err_t macro_slot_write(uint8_t slot, uint16_t offset, const uint8_t *data, size_t len);
+
+// Script in the slot; NULL for an unknown slot
+const uint8_t *macro_slot_get(uint8_t slot, size_t *len_out);
+
+// Keep the slot in NVS, or erase its key if the slot is empty
+esp_err_t macro_slot_save(uint8_t slot);
+
+// Fill the slots from NVS at boot; slots with nothing saved stay empty
+void macro_slots_load(void);
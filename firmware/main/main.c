@@ -2,45 +2,67 @@
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_system.h"
 #include "esp_mac.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
-#include "nvs.h"
 #include "driver/gpio.h"
 #include "driver/i2c_slave.h"
-#include "tinyusb.h"
+#include "soc/soc_caps.h"
+#include "esp_private/usb_phy.h"
 #include "tusb.h"
+#include "device/usbd_pvt.h"
 #include "hidra_protocol.h"
 #include "usb_descriptors.h"
+#include "hid_dispatch.h"
+#include "keyboard_state.h"
+#include "hid_batch.h"
+#include "irq_line.h"
+#include "output_cache.h"
+#include "macro.h"
+#include "report_schedule.h"
+#include "config_store.h"
 #include "version.h"
 
 static const char *TAG = "hidra_slave";
 
-// Device configuration structure
-typedef struct {
-    uint8_t i2c_addr;
-    uint16_t usb_vid;
-    uint16_t usb_pid;
-    char manufacturer[MAX_STRING_LENGTH + 1];
-    char product[MAX_STRING_LENGTH + 1];
-    char serial[MAX_STRING_LENGTH + 1];
-    uint16_t composite_layout;
-} hidra_config_t;
+#define I2C_SDA_GPIO    GPIO_NUM_4
+#define I2C_SCL_GPIO    GPIO_NUM_5
+
+// Time the USB device stays detached so the host drops the old configuration
+#define USB_DETACH_MS   100
+
+// What a configuration change needs to take effect without a restart
+#define APPLY_USB       (1 << 0)  // Rebuild descriptors and re-enumerate
+#define APPLY_I2C_ADDR  (1 << 1)  // Recreate the I2C slave device at the new address
+#define APPLY_IRQ_LINE  (1 << 2)  // Move the interrupt line
 
 // Global variables
 static hidra_config_t g_config;
 static uint8_t g_status_register = 0;
+static uint8_t g_last_error = 0;     // Error bits of the last failed command
 static i2c_slave_dev_handle_t g_i2c_slave_handle = NULL;
-static QueueHandle_t g_hid_queue = NULL;
-
-// HID report structure
-typedef struct {
-    uint8_t hid_register;
-    uint8_t report[MAX_REPORT_SIZE];
-    size_t report_size;
-} hid_report_t;
+static usb_phy_handle_t g_usb_phy = NULL;
+static SemaphoreHandle_t g_usb_rebuilt = NULL;   // Given by the deferred USB rebuild
+static esp_timer_handle_t g_usb_connect_timer = NULL;  // Reattaches USB once the host has seen the detach
+static esp_err_t g_usb_rebuild_result = ESP_OK;
+static int64_t g_reconfig_start_us = 0;          // Start of the last live reconfiguration
+static hidra_config_t g_staged_config;           // Target of config writes, checked before it goes live
+static bool g_staging = false;
+static uint8_t g_staged_apply = 0;               // APPLY_* bits the staged changes need
+static uint8_t g_staged_error = 0;               // Error bits of failed writes inside the transaction
+static keyboard_state_t g_keyboard_state;  // Guarded by g_producer_lock
+static nkro_state_t g_nkro_state;          // Guarded by g_producer_lock
+static SemaphoreHandle_t g_producer_lock = NULL;  // i2c_task, macro_task and schedule_task all queue reports
+static macro_player_t g_macro_player;             // Guarded by g_producer_lock
+static uint32_t g_submit_stamp = 0;               // Stamp submit_input() gives reports, guarded by g_producer_lock
+static TaskHandle_t g_macro_task = NULL;
+static TaskHandle_t g_schedule_task = NULL;
+static esp_timer_handle_t g_schedule_timer = NULL;  // Wakes schedule_task at the next due time
+static uint8_t g_stage[STAGE_SIZE];                  // Staged reports as batch records, guarded by g_producer_lock
+static size_t g_stage_len = 0;
 
 // Function prototypes
 static void load_config_from_nvs(void);
@@ -49,10 +71,23 @@ static void generate_serial_from_mac(char *serial_out);
 static void factory_reset_check(void);
 static void i2c_task(void *pvParameters);
 static void usb_task(void *pvParameters);
+static void macro_task(void *pvParameters);
+static void schedule_task(void *pvParameters);
 static void handle_i2c_command(uint8_t reg_addr, const uint8_t *data, size_t len);
+static esp_err_t submit_input(uint8_t reg_addr, const uint8_t *data, size_t len);
+static bool handle_input_register(uint8_t reg_addr, const uint8_t *data, size_t len);
+static void handle_batch(const uint8_t *data, size_t len);
+static void handle_macro_register(uint8_t reg_addr, const uint8_t *data, size_t len);
+static void handle_schedule_register(const uint8_t *data, size_t len);
+static void handle_stage_register(uint8_t reg_addr, const uint8_t *data, size_t len);
 static void set_status_bit(uint8_t bit);
+static void set_submit_status(esp_err_t ret);
 static void clear_status_bit(uint8_t bit);
 static esp_err_t init_usb_system(void);
+static void usb_connect_timer_cb(void *arg);
+static esp_err_t create_i2c_slave(void);
+static void apply_config(uint8_t apply);
+static void handle_config_register(uint8_t reg_addr, const uint8_t *data, size_t len);
 
 void app_main(void)
 {
@@ -78,40 +113,45 @@ void app_main(void)
     // Initialize USB system with dynamic descriptors
     ESP_ERROR_CHECK(init_usb_system());
 
-    // Create HID report queue
-    g_hid_queue = xQueueCreate(10, sizeof(hid_report_t));
-    if (g_hid_queue == NULL) {
-        ESP_LOGE(TAG, "Failed to create HID queue");
+    // Reattaches USB after a live reconfiguration
+    const esp_timer_create_args_t connect_args = {
+        .callback = usb_connect_timer_cb,
+        .name = "usb_connect",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&connect_args, &g_usb_connect_timer));
+
+    // Create per-interface HID report rings (TinyUSB transport)
+    if (hid_dispatch_init(NULL) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create HID dispatcher");
         return;
     }
 
-    // Initialize I2C slave
-    i2c_slave_config_t i2c_slv_config = {
-        .addr_bit_len = I2C_ADDR_BIT_LEN_7,
-        .clk_source = I2C_CLK_SRC_DEFAULT,
-        .i2c_port = I2C_NUM_0,
-        .send_buf_depth = 256,
-        .scl_io_num = GPIO_NUM_5,
-        .sda_io_num = GPIO_NUM_4,
-        .slave_addr = g_config.i2c_addr,
-    };
+    // Macro slots the master saved
+    macro_slots_load();
+
+    // Optional interrupt line to the master
+    if (irq_line_init(g_config.irq_gpio) != ESP_OK) {
+        ESP_LOGW(TAG, "Interrupt line on GPIO %d unavailable", g_config.irq_gpio);
+    }
 
-    ESP_ERROR_CHECK(i2c_new_slave_device(&i2c_slv_config, &g_i2c_slave_handle));
+    // Initialize I2C slave
+    g_usb_rebuilt = xSemaphoreCreateBinary();
+    g_producer_lock = xSemaphoreCreateMutex();
+    ESP_ERROR_CHECK(create_i2c_slave());
 
     // Create tasks
     xTaskCreate(i2c_task, "i2c_task", 4096, NULL, 5, NULL);
     xTaskCreate(usb_task, "usb_task", 4096, NULL, 4, NULL);
+    xTaskCreate(macro_task, "macro_task", 4096, NULL, 5, &g_macro_task);
+    // Above i2c_task: a due report should not wait behind command handling
+    xTaskCreate(schedule_task, "schedule_task", 4096, NULL, 6, &g_schedule_task);
 
     ESP_LOGI(TAG, "HIDra Slave initialized - I2C addr: 0x%02X, VID: 0x%04X, PID: 0x%04X, Layout: 0x%04X", 
              g_config.i2c_addr, g_config.usb_vid, g_config.usb_pid, g_config.composite_layout);
 }
 
-static void load_config_from_nvs(void)
+static void set_default_config(void)
 {
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
-    
-    // Set defaults first
     g_config.i2c_addr = DEFAULT_I2C_ADDR;
     g_config.usb_vid = DEFAULT_USB_VID;
     g_config.usb_pid = DEFAULT_USB_PID;
@@ -119,54 +159,35 @@ static void load_config_from_nvs(void)
     strcpy(g_config.product, DEFAULT_PRODUCT);
     generate_serial_from_mac(g_config.serial);
     g_config.composite_layout = DEFAULT_COMPOSITE_LAYOUT;
+    memset(g_config.poll_interval_ms, DEFAULT_POLL_INTERVAL_MS, sizeof(g_config.poll_interval_ms));
+    g_config.irq_gpio = DEFAULT_IRQ_GPIO;
+}
 
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "NVS not found, using defaults");
-        return;
-    }
+static void load_config_from_nvs(void)
+{
+    int64_t start_us = esp_timer_get_time();
 
-    // Load values from NVS, keeping defaults if not found
-    size_t required_size;
-    
-    nvs_get_u8(nvs_handle, NVS_KEY_I2C_ADDR, &g_config.i2c_addr);
-    nvs_get_u16(nvs_handle, NVS_KEY_USB_VID, &g_config.usb_vid);
-    nvs_get_u16(nvs_handle, NVS_KEY_USB_PID, &g_config.usb_pid);
-    nvs_get_u16(nvs_handle, NVS_KEY_COMPOSITE_LAYOUT, &g_config.composite_layout);
-    
-    required_size = sizeof(g_config.manufacturer);
-    nvs_get_str(nvs_handle, NVS_KEY_MANUFACTURER, g_config.manufacturer, &required_size);
-    
-    required_size = sizeof(g_config.product);
-    nvs_get_str(nvs_handle, NVS_KEY_PRODUCT, g_config.product, &required_size);
-    
-    required_size = sizeof(g_config.serial);
-    nvs_get_str(nvs_handle, NVS_KEY_SERIAL, g_config.serial, &required_size);
+    // Set defaults first
+    set_default_config();
 
-    nvs_close(nvs_handle);
-    ESP_LOGI(TAG, "Configuration loaded from NVS");
+    // One blob lookup; a missing or corrupted blob leaves the defaults, and a
+    // stored field this firmware cannot apply (a layout the baseline accepted
+    // may no longer fit) comes back reset, so the boot never aborts on it
+    esp_err_t err = config_store_load(&g_config);
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Configuration loaded from NVS in %lld us", (long long)elapsed_us);
+    } else {
+        ESP_LOGW(TAG, "No valid configuration in NVS (%s), using defaults - %lld us",
+                 esp_err_to_name(err), (long long)elapsed_us);
+    }
 }
 
 static void save_config_to_nvs(void)
 {
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) {
-        set_status_bit(ERROR_NVS_WRITE_FAILED);
-        return;
-    }
-
-    nvs_set_u8(nvs_handle, NVS_KEY_I2C_ADDR, g_config.i2c_addr);
-    nvs_set_u16(nvs_handle, NVS_KEY_USB_VID, g_config.usb_vid);
-    nvs_set_u16(nvs_handle, NVS_KEY_USB_PID, g_config.usb_pid);
-    nvs_set_u16(nvs_handle, NVS_KEY_COMPOSITE_LAYOUT, g_config.composite_layout);
-    nvs_set_str(nvs_handle, NVS_KEY_MANUFACTURER, g_config.manufacturer);
-    nvs_set_str(nvs_handle, NVS_KEY_PRODUCT, g_config.product);
-    nvs_set_str(nvs_handle, NVS_KEY_SERIAL, g_config.serial);
-
-    err = nvs_commit(nvs_handle);
-    nvs_close(nvs_handle);
-
+    esp_err_t err = config_store_save(&g_config);
     if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save configuration: %s", esp_err_to_name(err));
         set_status_bit(ERROR_NVS_WRITE_FAILED);
     } else {
         ESP_LOGI(TAG, "Configuration saved to NVS");
@@ -201,28 +222,99 @@ static void factory_reset_check(void)
 
 static void i2c_task(void *pvParameters)
 {
-    uint8_t buffer[MAX_REPORT_SIZE + 1]; // +1 for register address
+    uint8_t buffer[MAX_BATCH_SIZE + 1]; // +1 for register address
     
     while (1) {
         size_t size = 0;
         esp_err_t ret = i2c_slave_receive(g_i2c_slave_handle, buffer, sizeof(buffer), &size, portMAX_DELAY);
         
         if (ret == ESP_OK && size >= 1) {
+            // Reports of this write are timed from here, lock wait included
+            uint32_t rx_stamp = (uint32_t)esp_timer_get_time();
             uint8_t reg_addr = buffer[0];
             
             // Handle status register read
             if (reg_addr == STATUS_REG && size == 1) {
                 // This is a status register read request
-                uint8_t status = g_status_register;
+                xSemaphoreTake(g_producer_lock, portMAX_DELAY);
+                bool macro_running = macro_player_running(&g_macro_player);
+                xSemaphoreGive(g_producer_lock);
+                uint8_t status = g_status_register | (macro_running ? STATUS_MACRO_RUNNING : 0);
                 g_status_register = 0; // Clear on read
                 
                 ret = i2c_slave_transmit(g_i2c_slave_handle, &status, 1, 1000);
                 if (ret != ESP_OK) {
                     ESP_LOGE(TAG, "Failed to send status: %s", esp_err_to_name(ret));
                 }
+            } else if (reg_addr == IRQ_CAUSE_REG && size == 1) {
+                // Reading the causes releases the interrupt line
+                uint8_t cause = irq_line_ack();
+                ret = i2c_slave_transmit(g_i2c_slave_handle, &cause, 1, 1000);
+                if (ret != ESP_OK) {
+                    ESP_LOGE(TAG, "Failed to send interrupt cause: %s", esp_err_to_name(ret));
+                }
+            } else if (reg_addr == EXT_STATUS_REG && size == 1) {
+                // Extended status: a snapshot, nothing is cleared
+                uint8_t usb_state = (tud_mounted() ? EXT_USB_MOUNTED : 0) |
+                                    (tud_suspended() ? EXT_USB_SUSPENDED : 0);
+                uint8_t block[EXT_STATUS_SIZE];
+                hid_dispatch_encode_ext_status(usb_state, g_last_error, block, sizeof(block));
+
+                ret = i2c_slave_transmit(g_i2c_slave_handle, block, sizeof(block), 1000);
+                if (ret != ESP_OK) {
+                    ESP_LOGE(TAG, "Failed to send extended status: %s", esp_err_to_name(ret));
+                }
+            } else if (reg_addr == OUTPUT_REPORTS_REG && size == 1) {
+                // Latest host-to-device report of every interface in one read
+                uint8_t block[OUTPUT_REPORTS_SIZE];
+                output_cache_encode(usb_get_hid_interface_count(), block, sizeof(block));
+
+                ret = i2c_slave_transmit(g_i2c_slave_handle, block, sizeof(block), 1000);
+                if (ret != ESP_OK) {
+                    ESP_LOGE(TAG, "Failed to send output reports: %s", esp_err_to_name(ret));
+                }
+            } else if (reg_addr == CLOCK_REG && size == 1) {
+                // Sampled as close to the request as possible; the master
+                // takes the midpoint of its own round trip
+                uint64_t now_us = esp_timer_get_time();
+                uint8_t block[CLOCK_SIZE];
+                for (int i = 0; i < CLOCK_SIZE; i++) {
+                    block[i] = (now_us >> (8 * i)) & 0xFF;
+                }
+
+                ret = i2c_slave_transmit(g_i2c_slave_handle, block, sizeof(block), 1000);
+                if (ret != ESP_OK) {
+                    ESP_LOGE(TAG, "Failed to send clock: %s", esp_err_to_name(ret));
+                }
+            } else if (reg_addr == MACRO_STATUS_REG && size == 1) {
+                uint8_t block[MACRO_STATUS_SIZE];
+                xSemaphoreTake(g_producer_lock, portMAX_DELAY);
+                macro_player_encode_status(&g_macro_player, block, sizeof(block));
+                xSemaphoreGive(g_producer_lock);
+
+                ret = i2c_slave_transmit(g_i2c_slave_handle, block, sizeof(block), 1000);
+                if (ret != ESP_OK) {
+                    ESP_LOGE(TAG, "Failed to send macro status: %s", esp_err_to_name(ret));
+                }
             } else if (size > 1) {
-                // This is a write command
+                // This is a write command; a playing macro queues reports too
+                xSemaphoreTake(g_producer_lock, portMAX_DELAY);
+                g_submit_stamp = rx_stamp;
                 handle_i2c_command(reg_addr, &buffer[1], size - 1);
+                xSemaphoreGive(g_producer_lock);
+
+                // Error bits of the last failed command survive status reads
+                uint8_t cause = 0;
+                if (g_status_register & ~STATUS_OK) {
+                    g_last_error = g_status_register & ~STATUS_OK;
+                    cause |= IRQ_CAUSE_ERROR;
+                }
+                if (hid_dispatch_queue_high()) {
+                    cause |= IRQ_CAUSE_QUEUE_HIGH;
+                }
+                if (cause) {
+                    irq_line_raise(cause);
+                }
             }
         }
     }
@@ -230,17 +322,112 @@ static void i2c_task(void *pvParameters)
 
 static void usb_task(void *pvParameters)
 {
+    // tud_task() blocks on TinyUSB's event queue. New reports wake it through
+    // a deferred pump posted by the dispatcher, and tud_hid_report_complete_cb
+    // keeps busy endpoints fed, so there is nothing to poll for.
     while (1) {
         tud_task();
-        vTaskDelay(pdMS_TO_TICKS(1));
     }
 }
 
-static void handle_i2c_command(uint8_t reg_addr, const uint8_t *data, size_t len)
+static void macro_task(void *pvParameters)
 {
-    // Clear previous status
-    g_status_register = 0;
+    // Sleeps until a macro starts, then between reports only while a delay
+    // runs or the interface queue is full
+    TickType_t wait = portMAX_DELAY;
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        xSemaphoreTake(g_producer_lock, portMAX_DELAY);
+        // Macro reports come into being when they are played, not when the
+        // last I2C write arrived
+        uint32_t now_us = (uint32_t)esp_timer_get_time();
+        g_submit_stamp = now_us;
+        bool was_running = macro_player_running(&g_macro_player);
+        uint32_t wait_us = macro_player_run(&g_macro_player, now_us, submit_input);
+        bool running = macro_player_running(&g_macro_player);
+        uint8_t state = g_macro_player.state;
+        xSemaphoreGive(g_producer_lock);
+
+        if (was_running && (state == MACRO_STATE_DONE || state == MACRO_STATE_FAILED)) {
+            irq_line_raise(IRQ_CAUSE_MACRO_DONE);
+        }
+        if (!running) {
+            wait = portMAX_DELAY;
+        } else if (wait_us == 0) {
+            wait = 0;
+            taskYIELD();
+        } else {
+            // Round up: waking early only costs another pass
+            wait = pdMS_TO_TICKS((wait_us + 999) / 1000);
+            if (wait == 0) {
+                wait = 1;
+            }
+        }
+    }
+}
+
+static void schedule_timer_cb(void *arg)
+{
+    xTaskNotifyGive(g_schedule_task);
+}
+
+static void schedule_task(void *pvParameters)
+{
+    // A one-shot esp_timer wakes the task at the next due time with
+    // microsecond resolution; a tick-based wait would round to the tick
+    const esp_timer_create_args_t timer_args = {
+        .callback = schedule_timer_cb,
+        .name = "schedule",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &g_schedule_timer));
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        xSemaphoreTake(g_producer_lock, portMAX_DELAY);
+        // Due reports are timed from their release, not from the write
+        // that queued them long before
+        uint32_t now_us = (uint32_t)esp_timer_get_time();
+        g_submit_stamp = now_us;
+        uint32_t wait_us = 0;
+        bool pending = report_schedule_release(now_us, submit_input, &wait_us);
+        xSemaphoreGive(g_producer_lock);
 
+        // A new report may be due before the one the timer was armed for
+        esp_timer_stop(g_schedule_timer);
+        if (pending) {
+            esp_timer_start_once(g_schedule_timer, wait_us);
+        }
+    }
+}
+
+// Layout bit of the interface a HID input register writes its report to, or
+// 0 if the register does not take a whole report
+static uint16_t interface_bit_for_register(uint8_t reg_addr)
+{
+    switch (reg_addr) {
+        case HIDRA_REG_KEYBOARD: return LAYOUT_KEYBOARD;
+        case HIDRA_REG_MOUSE: return LAYOUT_MOUSE;
+        case HIDRA_REG_GAMEPAD: return LAYOUT_GAMEPAD;
+        case HIDRA_REG_JOYSTICK: return LAYOUT_JOYSTICK;
+        case HIDRA_REG_CONSUMER: return LAYOUT_CONSUMER;
+        case HIDRA_REG_PEN: return LAYOUT_PEN;
+        case HIDRA_REG_TOUCHSCREEN: return LAYOUT_TOUCHSCREEN;
+        case HIDRA_REG_TOUCHPAD: return LAYOUT_TOUCHPAD;
+        case HIDRA_REG_NKRO_KEYBOARD: return LAYOUT_NKRO_KEYBOARD;
+        default: return 0;
+    }
+}
+
+// HID input registers, written on their own, as batch records, by a macro or
+// by the schedule: every path keeps the key state in step with the keyboard
+// reports the host got. ESP_ERR_NOT_SUPPORTED if reg_addr is not an input
+// register, ESP_ERR_INVALID_STATE if its interface is disabled,
+// ESP_ERR_INVALID_ARG for an unknown key or NKRO action, otherwise as
+// hid_dispatch_submit(). Reports carry g_submit_stamp, set by the calling task.
+static esp_err_t submit_input(uint8_t reg_addr, const uint8_t *data, size_t len)
+{
     switch (reg_addr) {
         case HIDRA_REG_KEYBOARD:
         case HIDRA_REG_MOUSE:
@@ -249,49 +436,352 @@ static void handle_i2c_command(uint8_t reg_addr, const uint8_t *data, size_t len
         case HIDRA_REG_CONSUMER:
         case HIDRA_REG_PEN:
         case HIDRA_REG_TOUCHSCREEN:
-        case HIDRA_REG_TOUCHPAD: {
+        case HIDRA_REG_TOUCHPAD:
+        case HIDRA_REG_NKRO_KEYBOARD: {
             // Check if interface is enabled
-            uint8_t interface_bit = 0;
-            switch (reg_addr) {
-                case HIDRA_REG_KEYBOARD: interface_bit = LAYOUT_KEYBOARD; break;
-                case HIDRA_REG_MOUSE: interface_bit = LAYOUT_MOUSE; break;
-                case HIDRA_REG_GAMEPAD: interface_bit = LAYOUT_GAMEPAD; break;
-                case HIDRA_REG_JOYSTICK: interface_bit = LAYOUT_JOYSTICK; break;
-                case HIDRA_REG_CONSUMER: interface_bit = LAYOUT_CONSUMER; break;
-                case HIDRA_REG_PEN: interface_bit = LAYOUT_PEN; break;
-                case HIDRA_REG_TOUCHSCREEN: interface_bit = LAYOUT_TOUCHSCREEN; break;
-                case HIDRA_REG_TOUCHPAD: interface_bit = LAYOUT_TOUCHPAD; break;
+            if (!(g_config.composite_layout & interface_bit_for_register(reg_addr))) {
+                return ESP_ERR_INVALID_STATE;
             }
-            
-            if (!(g_config.composite_layout & interface_bit)) {
-                set_status_bit(ERROR_INTERFACE_DISABLED);
-                return;
+
+            // Queue HID report on the interface's ring
+            esp_err_t ret = hid_dispatch_submit(reg_addr, data, len, g_submit_stamp);
+            if (ret == ESP_OK && reg_addr == HIDRA_REG_KEYBOARD) {
+                // Key events continue from the last full report
+                keyboard_state_load(&g_keyboard_state, data, len);
+            } else if (ret == ESP_OK && reg_addr == HIDRA_REG_NKRO_KEYBOARD) {
+                nkro_state_load(&g_nkro_state, data, len);
             }
+            return ret;
+        }
 
-            if (len > MAX_REPORT_SIZE) {
-                set_status_bit(ERROR_PAYLOAD_TOO_LARGE);
-                return;
+        case HIDRA_REG_KEY_EVENT: {
+            if (!(g_config.composite_layout & LAYOUT_KEYBOARD)) {
+                return ESP_ERR_INVALID_STATE;
+            }
+            if (len != 2) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            if (data[1] != KEY_EVENT_PRESS && data[1] != KEY_EVENT_RELEASE) {
+                return ESP_ERR_INVALID_ARG;
             }
 
-            // Queue HID report
-            hid_report_t report = {
-                .interface = reg_addr,
-                .report_size = len
-            };
-            memcpy(report.report, data, len);
-            
-            if (xQueueSend(g_hid_queue, &report, 0) == pdTRUE) {
-                set_status_bit(STATUS_OK);
+            // Only commit the new state once its report is queued, so the
+            // master can simply retry after ERROR_QUEUE_FULL
+            keyboard_state_t next = g_keyboard_state;
+            if (!keyboard_state_apply(&next, data[0], data[1] == KEY_EVENT_PRESS)) {
+                // Repeated press or release of an idle key: nothing to send
+                return ESP_OK;
             }
-            break;
+
+            uint8_t report[KEYBOARD_REPORT_LEN];
+            size_t report_len = keyboard_state_build(&next, report, sizeof(report));
+            esp_err_t ret = hid_dispatch_submit(HIDRA_REG_KEYBOARD, report, report_len, g_submit_stamp);
+            if (ret == ESP_OK) {
+                g_keyboard_state = next;
+            }
+            return ret;
+        }
+
+        case HIDRA_REG_NKRO_KEYS: {
+            if (!(g_config.composite_layout & LAYOUT_NKRO_KEYBOARD)) {
+                return ESP_ERR_INVALID_STATE;
+            }
+            uint8_t action = data[0];
+            if (action > NKRO_KEYS_REPLACE) {
+                return ESP_ERR_INVALID_ARG;
+            }
+
+            // The whole chord lands in one report; committed once queued
+            nkro_state_t next = g_nkro_state;
+            if (action == NKRO_KEYS_REPLACE) {
+                nkro_state_reset(&next);
+            }
+            for (size_t i = 1; i < len; i++) {
+                nkro_state_apply(&next, data[i], action != NKRO_KEYS_CLEAR);
+            }
+            if (memcmp(&next, &g_nkro_state, sizeof(next)) == 0) {
+                return ESP_OK;
+            }
+
+            uint8_t report[NKRO_REPORT_SIZE];
+            size_t report_len = nkro_state_build(&next, report, sizeof(report));
+            esp_err_t ret = hid_dispatch_submit(HIDRA_REG_NKRO_KEYBOARD, report, report_len, g_submit_stamp);
+            if (ret == ESP_OK) {
+                g_nkro_state = next;
+            }
+            return ret;
+        }
+
+        default:
+            return ESP_ERR_NOT_SUPPORTED;
+    }
+}
+
+// Returns false if reg_addr is not an input register
+static bool handle_input_register(uint8_t reg_addr, const uint8_t *data, size_t len)
+{
+    esp_err_t ret = submit_input(reg_addr, data, len);
+    if (ret == ESP_ERR_NOT_SUPPORTED) {
+        return false;
+    }
+    set_submit_status(ret);
+    return true;
+}
+
+static void handle_batch(const uint8_t *data, size_t len)
+{
+    // Reject a malformed batch before any record reaches the host
+    if (hid_batch_validate(data, len, NULL) != ESP_OK) {
+        set_status_bit(ERROR_PAYLOAD_TOO_LARGE);
+        return;
+    }
+
+    size_t offset = 0;
+    hid_batch_record_t record;
+    while (hid_batch_next(data, len, &offset, &record)) {
+        if (!handle_input_register(record.hid_register, record.report, record.len)) {
+            set_status_bit(ERROR_UNKNOWN_REGISTER);
+        }
+    }
+
+    // One result for the whole batch: OK only if every record was accepted
+    if (g_status_register & ~STATUS_OK) {
+        clear_status_bit(STATUS_OK);
+    }
+}
+
+static void handle_i2c_command(uint8_t reg_addr, const uint8_t *data, size_t len)
+{
+    // Clear previous status
+    g_status_register = 0;
+
+    if (handle_input_register(reg_addr, data, len)) {
+        return;
+    }
+    if (reg_addr == HIDRA_REG_BATCH) {
+        handle_batch(data, len);
+        return;
+    }
+    if (reg_addr == MACRO_DATA_REG || reg_addr == MACRO_PLAY_REG || reg_addr == MACRO_SAVE_REG) {
+        handle_macro_register(reg_addr, data, len);
+        return;
+    }
+    if (reg_addr == SCHEDULE_REG) {
+        handle_schedule_register(data, len);
+        return;
+    }
+    if (reg_addr == STAGE_REG || reg_addr == LATCH_REG) {
+        handle_stage_register(reg_addr, data, len);
+        return;
+    }
+
+    handle_config_register(reg_addr, data, len);
+
+    // A failed write inside a transaction fails its commit
+    if (g_staging && (g_status_register & ~STATUS_OK)) {
+        g_staged_error |= g_status_register & ~STATUS_OK;
+    }
+}
+
+// Runs with g_producer_lock held
+static void handle_macro_register(uint8_t reg_addr, const uint8_t *data, size_t len)
+{
+    if (reg_addr == MACRO_DATA_REG) {
+        if (len < MACRO_DATA_HEADER_SIZE) {
+            set_status_bit(ERROR_PAYLOAD_TOO_LARGE);
+            return;
+        }
+        // The playing script must not change under the player
+        uint8_t slot = data[0];
+        if (macro_player_running(&g_macro_player) && g_macro_player.slot == slot) {
+            set_status_bit(ERROR_QUEUE_FULL);
+            return;
+        }
+        uint16_t offset = data[1] | (data[2] << 8);
+        esp_err_t ret = macro_slot_write(slot, offset, &data[MACRO_DATA_HEADER_SIZE], len - MACRO_DATA_HEADER_SIZE);
+        set_status_bit(ret == ESP_OK ? STATUS_OK : ERROR_PAYLOAD_TOO_LARGE);
+        return;
+    }
+
+    if (len != 1) {
+        set_status_bit(ERROR_PAYLOAD_TOO_LARGE);
+        return;
+    }
+    uint8_t slot = data[0];
+
+    if (reg_addr == MACRO_SAVE_REG) {
+        esp_err_t ret = macro_slot_save(slot);
+        if (ret == ESP_ERR_INVALID_ARG) {
+            set_status_bit(ERROR_PAYLOAD_TOO_LARGE);
+        } else if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to save macro slot %d: %s", slot, esp_err_to_name(ret));
+            set_status_bit(ERROR_NVS_WRITE_FAILED);
+        } else {
+            set_status_bit(STATUS_OK);
+        }
+        return;
+    }
+
+    if (slot == MACRO_STOP) {
+        macro_player_stop(&g_macro_player, submit_input);
+        set_status_bit(STATUS_OK);
+        return;
+    }
+    size_t script_len = 0;
+    const uint8_t *script = macro_slot_get(slot, &script_len);
+    if (!script || macro_validate(script, script_len) != ESP_OK) {
+        set_status_bit(ERROR_PAYLOAD_TOO_LARGE);
+        return;
+    }
+    macro_player_stop(&g_macro_player, submit_input);
+    if (macro_player_start(&g_macro_player, slot, script, script_len) != ESP_OK) {
+        set_status_bit(ERROR_PAYLOAD_TOO_LARGE);
+        return;
+    }
+    set_status_bit(STATUS_OK);
+    xTaskNotifyGive(g_macro_task);
+}
+
+static void handle_schedule_register(const uint8_t *data, size_t len)
+{
+    if (len == 1) {
+        report_schedule_clear();
+        set_status_bit(STATUS_OK);
+        return;
+    }
+    if (len <= SCHEDULE_HEADER_SIZE) {
+        set_status_bit(ERROR_PAYLOAD_TOO_LARGE);
+        return;
+    }
+
+    // Only whole reports: key events and NKRO updates depend on the state
+    // at the time they are handled
+    uint8_t hid_register = data[4];
+    uint16_t interface_bit = interface_bit_for_register(hid_register);
+    if (interface_bit == 0) {
+        set_status_bit(ERROR_UNKNOWN_REGISTER);
+        return;
+    }
+    if (!(g_config.composite_layout & interface_bit)) {
+        set_status_bit(ERROR_INTERFACE_DISABLED);
+        return;
+    }
+
+    uint32_t due_us = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+    esp_err_t ret = report_schedule_add((uint32_t)esp_timer_get_time(), due_us, hid_register,
+                                        &data[SCHEDULE_HEADER_SIZE], len - SCHEDULE_HEADER_SIZE);
+    if (ret == ESP_ERR_INVALID_ARG) {
+        set_status_bit(ERROR_PAYLOAD_TOO_LARGE);
+        return;
+    }
+    set_submit_status(ret);
+    if (ret == ESP_OK) {
+        xTaskNotifyGive(g_schedule_task);
+    }
+}
+
+static void handle_stage_register(uint8_t reg_addr, const uint8_t *data, size_t len)
+{
+    if (reg_addr == LATCH_REG) {
+        if (len != 1) {
+            set_status_bit(ERROR_PAYLOAD_TOO_LARGE);
+            return;
+        }
+        if (g_stage_len == 0) {
+            set_status_bit(STATUS_OK);
+            return;
         }
+        // Released like a batch: same checks, one status for all records
+        handle_batch(g_stage, g_stage_len);
+        g_stage_len = 0;
+        return;
+    }
+
+    if (len == 1) {
+        g_stage_len = 0;
+        set_status_bit(STATUS_OK);
+        return;
+    }
+
+    // Anything a batch may carry; the interface is checked at the latch
+    uint8_t hid_register = data[0];
+    if (interface_bit_for_register(hid_register) == 0 &&
+        hid_register != HIDRA_REG_KEY_EVENT && hid_register != HIDRA_REG_NKRO_KEYS) {
+        set_status_bit(ERROR_UNKNOWN_REGISTER);
+        return;
+    }
+    esp_err_t ret = hid_batch_append(g_stage, sizeof(g_stage), &g_stage_len, hid_register, &data[1], len - 1);
+    set_submit_status(ret);
+}
+
+// The staged configuration replaces the live one only once it is valid as a
+// whole, so a rejected change leaves USB and I2C untouched
+static void commit_config(uint8_t apply)
+{
+    if (!config_valid(&g_staged_config)) {
+        set_status_bit(ERROR_INVALID_VALUE);
+        return;
+    }
+    if (!apply) {
+        set_status_bit(STATUS_OK);
+        return;
+    }
+    g_config = g_staged_config;
+    apply_config(apply);
+}
+
+// Apply a change now, or record what it needs when inside a transaction
+static void config_changed(uint8_t apply)
+{
+    if (g_staging) {
+        g_staged_apply |= apply;
+        set_status_bit(STATUS_OK);
+    } else {
+        commit_config(apply);
+    }
+}
+
+static void handle_config_register(uint8_t reg_addr, const uint8_t *data, size_t len)
+{
+    // Outside a transaction a write is staged and committed on its own
+    if (!g_staging) {
+        g_staged_config = g_config;
+    }
+    hidra_config_t *cfg = &g_staged_config;
+
+    switch (reg_addr) {
+        case CONFIG_BEGIN_REG:
+            // Starting over drops a transaction that was never committed
+            g_staged_config = g_config;
+            g_staged_apply = 0;
+            g_staged_error = 0;
+            g_staging = true;
+            set_status_bit(STATUS_OK);
+            break;
+
+        case CONFIG_COMMIT_REG:
+            if (!g_staging) {
+                set_status_bit(ERROR_UNKNOWN_REGISTER);
+                return;
+            }
+            g_staging = false;
+            if (g_staged_error) {
+                set_status_bit(g_staged_error);
+                return;
+            }
+            commit_config(g_staged_apply);
+            break;
+
+        case CONFIG_ABORT_REG:
+            g_staging = false;
+            set_status_bit(STATUS_OK);
+            break;
 
         case CONFIG_USB_IDS_REG:
             if (len == 4) {
-                g_config.usb_vid = (data[1] << 8) | data[0];
-                g_config.usb_pid = (data[3] << 8) | data[2];
-                save_config_to_nvs();
-                esp_restart();
+                cfg->usb_vid = (data[1] << 8) | data[0];
+                cfg->usb_pid = (data[3] << 8) | data[2];
+                config_changed(APPLY_USB);
             } else {
                 set_status_bit(ERROR_PAYLOAD_TOO_LARGE);
             }
@@ -303,14 +793,13 @@ static void handle_i2c_command(uint8_t reg_addr, const uint8_t *data, size_t len
             if (len <= MAX_STRING_LENGTH) {
                 char *target = NULL;
                 switch (reg_addr) {
-                    case CONFIG_MANUFACTURER_STR_REG: target = g_config.manufacturer; break;
-                    case CONFIG_PRODUCT_STR_REG: target = g_config.product; break;
-                    case CONFIG_SERIAL_STR_REG: target = g_config.serial; break;
+                    case CONFIG_MANUFACTURER_STR_REG: target = cfg->manufacturer; break;
+                    case CONFIG_PRODUCT_STR_REG: target = cfg->product; break;
+                    case CONFIG_SERIAL_STR_REG: target = cfg->serial; break;
                 }
                 memcpy(target, data, len);
                 target[len] = '\0';
-                save_config_to_nvs();
-                esp_restart();
+                config_changed(APPLY_USB);
             } else {
                 set_status_bit(ERROR_PAYLOAD_TOO_LARGE);
             }
@@ -318,9 +807,42 @@ static void handle_i2c_command(uint8_t reg_addr, const uint8_t *data, size_t len
 
         case CONFIG_COMPOSITE_DEVICE_REG:
             if (len == 2) {
-                g_config.composite_layout = (data[1] << 8) | data[0];
-                save_config_to_nvs();
-                esp_restart();
+                cfg->composite_layout = (data[1] << 8) | data[0];
+                config_changed(APPLY_USB);
+            } else {
+                set_status_bit(ERROR_PAYLOAD_TOO_LARGE);
+            }
+            break;
+
+        case CONFIG_POLL_INTERVAL_REG:
+            if (len == 2) {
+                int index = usb_get_layout_index_for_register(data[0]);
+                if (index < 0) {
+                    set_status_bit(ERROR_INTERFACE_DISABLED);
+                    return;
+                }
+                if (data[1] == 0) {
+                    set_status_bit(ERROR_INVALID_VALUE);
+                    return;
+                }
+                cfg->poll_interval_ms[index] = data[1];
+                config_changed(APPLY_USB);
+            } else {
+                set_status_bit(ERROR_PAYLOAD_TOO_LARGE);
+            }
+            break;
+
+        case CONFIG_IRQ_GPIO_REG:
+            if (len == 1) {
+                uint8_t gpio = data[0];
+                if (gpio != IRQ_GPIO_DISABLED &&
+                    (!GPIO_IS_VALID_OUTPUT_GPIO((gpio_num_t)gpio) || gpio == I2C_SDA_GPIO || gpio == I2C_SCL_GPIO ||
+                     gpio == FACTORY_RESET_GPIO)) {
+                    set_status_bit(ERROR_INVALID_VALUE);
+                    return;
+                }
+                cfg->irq_gpio = gpio;
+                config_changed(APPLY_IRQ_LINE);
             } else {
                 set_status_bit(ERROR_PAYLOAD_TOO_LARGE);
             }
@@ -328,9 +850,12 @@ static void handle_i2c_command(uint8_t reg_addr, const uint8_t *data, size_t len
 
         case CONFIG_I2C_ADDR_REG:
             if (len == 1) {
-                g_config.i2c_addr = data[0];
-                save_config_to_nvs();
-                esp_restart();
+                if (data[0] < I2C_ADDR_MIN || data[0] > I2C_ADDR_MAX) {
+                    set_status_bit(ERROR_INVALID_VALUE);
+                    return;
+                }
+                cfg->i2c_addr = data[0];
+                config_changed(APPLY_I2C_ADDR);
             } else {
                 set_status_bit(ERROR_PAYLOAD_TOO_LARGE);
             }
@@ -347,6 +872,171 @@ static void set_status_bit(uint8_t bit)
     g_status_register |= bit;
 }
 
+static esp_err_t create_i2c_slave(void)
+{
+    i2c_slave_config_t i2c_slv_config = {
+        .addr_bit_len = I2C_ADDR_BIT_LEN_7,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .i2c_port = I2C_NUM_0,
+        .send_buf_depth = 256,
+        .scl_io_num = I2C_SCL_GPIO,
+        .sda_io_num = I2C_SDA_GPIO,
+        .slave_addr = g_config.i2c_addr,
+#if SOC_I2C_SLAVE_SUPPORT_BROADCAST
+        // Also take general-call writes, so the master can reach every
+        // slave on the bus with one transaction
+        .flags.broadcast_en = 1,
+#endif
+    };
+
+#if !SOC_I2C_SLAVE_SUPPORT_BROADCAST
+    ESP_LOGW(TAG, "General-call writes not supported on this target");
+#endif
+    return i2c_new_slave_device(&i2c_slv_config, &g_i2c_slave_handle);
+}
+
+// Runs in usb_task, so no TinyUSB callback or dispatcher pump sees the
+// descriptors or rings half rebuilt
+static void usb_rebuild_deferred(void *param)
+{
+    tud_disconnect();
+    hid_dispatch_deinit();
+    output_cache_reset();
+    g_usb_rebuild_result = usb_descriptors_init(&g_config);
+    if (g_usb_rebuild_result == ESP_OK) {
+        g_usb_rebuild_result = hid_dispatch_init(NULL);
+    }
+    xSemaphoreGive(g_usb_rebuilt);
+}
+
+static void usb_connect_deferred(void *param)
+{
+    // The host's bus reset re-enumerates against the new descriptors
+    tud_connect();
+}
+
+static void usb_connect_timer_cb(void *arg)
+{
+    usbd_defer_func(usb_connect_deferred, NULL, false);
+}
+
+static esp_err_t reconfigure_usb(void)
+{
+    // A reattach still pending from an earlier change waits for this one
+    esp_timer_stop(g_usb_connect_timer);
+    usbd_defer_func(usb_rebuild_deferred, NULL, false);
+    xSemaphoreTake(g_usb_rebuilt, portMAX_DELAY);
+    if (g_usb_rebuild_result != ESP_OK) {
+        return g_usb_rebuild_result;
+    }
+
+    // Key state belonged to the old interfaces, and so did a playing macro
+    // and the reports still scheduled or staged
+    keyboard_state_reset(&g_keyboard_state);
+    nkro_state_reset(&g_nkro_state);
+    macro_player_stop(&g_macro_player, NULL);
+    report_schedule_clear();
+    g_stage_len = 0;
+
+    // Reattach from a timer: i2c_task holds g_producer_lock here, and the
+    // other producers and status reads must not wait out the detach
+    return esp_timer_start_once(g_usb_connect_timer, USB_DETACH_MS * 1000);
+}
+
+static esp_err_t reconfigure_i2c(void)
+{
+    // Called from i2c_task, the only user of the handle
+    esp_err_t ret = i2c_del_slave_device(g_i2c_slave_handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    g_i2c_slave_handle = NULL;
+    return create_i2c_slave();
+}
+
+static esp_err_t apply_config_live(uint8_t apply)
+{
+    // Several parts change together after a transaction commit
+    esp_err_t ret = ESP_OK;
+    if (apply & APPLY_USB) {
+        ret = reconfigure_usb();
+    }
+    if (ret == ESP_OK && (apply & APPLY_I2C_ADDR)) {
+        ret = reconfigure_i2c();
+    }
+    if (ret == ESP_OK && (apply & APPLY_IRQ_LINE)) {
+        ret = irq_line_init(g_config.irq_gpio);
+    }
+    return ret;
+}
+
+static void apply_config(uint8_t apply)
+{
+    g_reconfig_start_us = esp_timer_get_time();
+
+    esp_err_t ret = apply_config_live(apply);
+    if (ret != ESP_OK) {
+        // NVS still holds the previous configuration: go back to it
+        ESP_LOGE(TAG, "Live reconfiguration failed: %s", esp_err_to_name(ret));
+        load_config_from_nvs();
+        if (apply_config_live(apply) != ESP_OK) {
+            esp_restart();
+        }
+        set_status_bit(ERROR_INVALID_VALUE);
+        return;
+    }
+
+    save_config_to_nvs();
+    if (!(g_status_register & ERROR_NVS_WRITE_FAILED)) {
+        set_status_bit(STATUS_OK);
+    }
+    ESP_LOGI(TAG, "Configuration applied live in %lld us",
+             (long long)(esp_timer_get_time() - g_reconfig_start_us));
+}
+
+static esp_err_t init_usb_system(void)
+{
+    esp_err_t ret = usb_descriptors_init(&g_config);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // Internal PHY on the OTG controller, device mode
+    usb_phy_config_t phy_config = {
+        .controller = USB_PHY_CTRL_OTG,
+        .target = USB_PHY_TARGET_INT,
+        .otg_mode = USB_OTG_MODE_DEVICE,
+    };
+    ret = usb_new_phy(&phy_config, &g_usb_phy);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to init USB PHY: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // The stack runs in usb_task; TinyUSB creates no task of its own
+    if (!tusb_init()) {
+        ESP_LOGE(TAG, "Failed to init TinyUSB");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+// Map a dispatcher result onto the status register
+static void set_submit_status(esp_err_t ret)
+{
+    if (ret == ESP_OK) {
+        set_status_bit(STATUS_OK);
+    } else if (ret == ESP_ERR_INVALID_SIZE) {
+        set_status_bit(ERROR_PAYLOAD_TOO_LARGE);
+    } else if (ret == ESP_ERR_NO_MEM) {
+        set_status_bit(ERROR_QUEUE_FULL);
+    } else if (ret == ESP_ERR_INVALID_ARG) {
+        set_status_bit(ERROR_INVALID_VALUE);
+    } else {
+        set_status_bit(ERROR_INTERFACE_DISABLED);
+    }
+}
+
 static void clear_status_bit(uint8_t bit)
 {
     g_status_register &= ~bit;
@@ -355,7 +1045,11 @@ static void clear_status_bit(uint8_t bit)
 // TinyUSB callbacks (minimal implementation)
 void tud_mount_cb(void)
 {
-    ESP_LOGI(TAG, "USB mounted");
+    // Downtime as seen by the host: since boot, or since a live reconfiguration
+    int64_t since = g_reconfig_start_us;
+    ESP_LOGI(TAG, "USB mounted %lld ms after %s", (long long)((esp_timer_get_time() - since) / 1000),
+             since ? "reconfiguration" : "boot");
+    g_reconfig_start_us = 0;
 }
 
 void tud_umount_cb(void)
@@ -363,11 +1057,56 @@ void tud_umount_cb(void)
     ESP_LOGI(TAG, "USB unmounted");
 }
 
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const* report, uint16_t len)
+{
+    // Endpoint is free again: send the next queued report in the same frame.
+    // On a shared interface the report ID tells which device type it was.
+    hid_dispatch_report_complete(usb_get_hid_instance_for_report(instance, report, len));
+}
+
 uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t* buffer, uint16_t reqlen)
 {
-    return 0;
+    // Multi-touch hosts read the contact capabilities before enabling input
+    if (report_type == HID_REPORT_TYPE_FEATURE) {
+        return usb_get_hid_feature_report(instance, report_id, buffer, reqlen);
+    }
+
+    // Input state comes from the last report sent, so a host polling or
+    // reconnecting sees it without the master pushing it again
+    uint8_t owner;
+    if (report_type != HID_REPORT_TYPE_INPUT || !usb_get_hid_report_owner(instance, report_id, &owner, NULL)) {
+        return 0;
+    }
+    uint8_t report[MAX_REPORT_SIZE];
+    size_t len = hid_dispatch_get_last_report(owner, report, sizeof(report));
+    usb_hid_route_t route;
+    if (len == 0 || !usb_route_hid_report(owner, report, len, &route) || route.report_id != report_id) {
+        return 0;
+    }
+    // TinyUSB has already written the report ID
+    uint16_t copy_len = route.len < reqlen ? route.len : reqlen;
+    memcpy(buffer, route.data, copy_len);
+    return copy_len;
 }
 
+_Static_assert(HID_REPORT_TYPE_OUTPUT == OUTPUT_REPORT_TYPE_OUTPUT &&
+               HID_REPORT_TYPE_FEATURE == OUTPUT_REPORT_TYPE_FEATURE,
+               "OUTPUT_REPORTS_REG carries TinyUSB report types as is");
+
 void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t const* buffer, uint16_t bufsize)
 {
+    if (report_type != HID_REPORT_TYPE_OUTPUT && report_type != HID_REPORT_TYPE_FEATURE) {
+        return;
+    }
+
+    if (report_type == HID_REPORT_TYPE_FEATURE) {
+        usb_set_hid_feature_report(instance, report_id, buffer, bufsize);
+    }
+    // Keep it for OUTPUT_REPORTS_REG, then tell the master
+    uint8_t owner;
+    uint8_t local_id;
+    if (usb_get_hid_report_owner(instance, report_id, &owner, &local_id)) {
+        output_cache_store(owner, report_type, local_id, buffer, bufsize);
+        irq_line_raise(IRQ_CAUSE_OUTPUT_REPORT);
+    }
 }
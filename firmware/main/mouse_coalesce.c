@@ -0,0 +1,134 @@
+#include "mouse_coalesce.h"
+#include <string.h>
+
+static int32_t add_saturating(int32_t a, int32_t b)
+{
+    int64_t sum = (int64_t)a + b;
+    if (sum > INT32_MAX) return INT32_MAX;
+    if (sum < INT32_MIN) return INT32_MIN;
+    return (int32_t)sum;
+}
+
+static int8_t clamp_axis(int32_t value)
+{
+    if (value > MOUSE_COALESCE_MAX) return MOUSE_COALESCE_MAX;
+    if (value < MOUSE_COALESCE_MIN) return MOUSE_COALESCE_MIN;
+    return (int8_t)value;
+}
+
+static bool has_motion(const mouse_coalesce_t *mc)
+{
+    for (int i = 0; i < MOUSE_COALESCE_AXES; i++) {
+        if (mc->axis[i] != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void mouse_coalesce_reset(mouse_coalesce_t *mc)
+{
+    memset(mc, 0, sizeof(*mc));
+}
+
+bool mouse_coalesce_add(mouse_coalesce_t *mc, const uint8_t *report, size_t len, uint32_t stamp)
+{
+    if (len == 0) {
+        return true;
+    }
+    if (mc->pending && report[0] != mc->buttons) {
+        return false;
+    }
+
+    if (!mc->pending) {
+        mc->stamp = stamp;
+    }
+    mc->buttons = report[0];
+    for (size_t i = 0; i < MOUSE_COALESCE_AXES && i + 1 < len; i++) {
+        mc->axis[i] = add_saturating(mc->axis[i], (int8_t)report[i + 1]);
+    }
+    mc->pending = true;
+    mc->reports++;
+    return true;
+}
+
+size_t mouse_coalesce_build(const mouse_coalesce_t *mc, uint8_t *report_out, size_t len)
+{
+    if (len == 0) {
+        return 0;
+    }
+
+    report_out[0] = mc->buttons;
+    for (size_t i = 0; i + 1 < len; i++) {
+        report_out[i + 1] = (i < MOUSE_COALESCE_AXES) ? (uint8_t)clamp_axis(mc->axis[i]) : 0;
+    }
+    return len;
+}
+
+void mouse_coalesce_consume(mouse_coalesce_t *mc, const uint8_t *report, size_t len)
+{
+    for (size_t i = 0; i < MOUSE_COALESCE_AXES && i + 1 < len; i++) {
+        mc->axis[i] -= (int8_t)report[i + 1];
+    }
+    // Carried remainder keeps the accumulator pending; the button state was sent
+    mc->pending = has_motion(mc);
+    mc->reports = 0;
+}
+
+void mouse_coalesce_queue_reset(mouse_coalesce_queue_t *q)
+{
+    memset(q, 0, sizeof(*q));
+}
+
+bool mouse_coalesce_queue_add(mouse_coalesce_queue_t *q, const uint8_t *report, size_t len, uint32_t stamp)
+{
+    if (q->count > 0) {
+        mouse_coalesce_t *tail = &q->seg[(q->head + q->count - 1) % MOUSE_COALESCE_SEGMENTS];
+        if (mouse_coalesce_add(tail, report, len, stamp)) {
+            return true;
+        }
+    }
+    if (q->count == MOUSE_COALESCE_SEGMENTS) {
+        return false;
+    }
+
+    mouse_coalesce_t *seg = &q->seg[(q->head + q->count) % MOUSE_COALESCE_SEGMENTS];
+    mouse_coalesce_reset(seg);
+    mouse_coalesce_add(seg, report, len, stamp);
+    q->count++;
+    if (q->count > q->high_water) {
+        q->high_water = q->count;
+    }
+    return true;
+}
+
+size_t mouse_coalesce_queue_build(const mouse_coalesce_queue_t *q, uint8_t *report_out, size_t len,
+                                  uint32_t *reports_out, uint32_t *stamp_out)
+{
+    if (q->count == 0) {
+        return 0;
+    }
+
+    const mouse_coalesce_t *front = &q->seg[q->head];
+    if (reports_out) {
+        *reports_out = front->reports;
+    }
+    if (stamp_out) {
+        *stamp_out = front->stamp;
+    }
+    return mouse_coalesce_build(front, report_out, len);
+}
+
+void mouse_coalesce_queue_consume(mouse_coalesce_queue_t *q, const uint8_t *report, size_t len)
+{
+    if (q->count == 0) {
+        return;
+    }
+
+    mouse_coalesce_t *front = &q->seg[q->head];
+    mouse_coalesce_consume(front, report, len);
+    if (!front->pending) {
+        q->head = (q->head + 1) % MOUSE_COALESCE_SEGMENTS;
+        q->count--;
+    }
+}
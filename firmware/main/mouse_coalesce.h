@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Relative mouse report layout: [buttons, x, y, wheel, pan]
+#define MOUSE_COALESCE_AXES     4
+#define MOUSE_COALESCE_MAX      127
+#define MOUSE_COALESCE_MIN      (-127)
+// Button-state changes that can be queued behind a slow host
+#define MOUSE_COALESCE_SEGMENTS 8
+
+// Accumulates relative mouse reports that share a button state. Deltas are
+// summed at full precision; a built report is saturated to the int8 range
+// and whatever did not fit is carried into the next one.
+typedef struct {
+    int32_t axis[MOUSE_COALESCE_AXES];
+    uint8_t buttons;
+    bool pending;       // Something (motion or a button state) is waiting to go out
+    uint32_t reports;   // Reports folded in since the last consume
+    uint32_t stamp;     // Caller timestamp of the oldest report not yet sent
+} mouse_coalesce_t;
+
+// FIFO of accumulators, one per button state still waiting to be sent.
+// Motion is merged into the newest segment; a button change opens a new one,
+// so clicks keep their order relative to the motion around them.
+typedef struct {
+    mouse_coalesce_t seg[MOUSE_COALESCE_SEGMENTS];
+    uint8_t head;
+    uint8_t count;
+    uint8_t high_water;
+} mouse_coalesce_queue_t;
+
+void mouse_coalesce_reset(mouse_coalesce_t *mc);
+
+// Fold a report in. Returns false, leaving mc untouched, if the report changes
+// the button state while motion for the previous state is still pending.
+// stamp is kept from the first report folded into an idle accumulator.
+bool mouse_coalesce_add(mouse_coalesce_t *mc, const uint8_t *report, size_t len, uint32_t stamp);
+
+// Build the next report (len bytes, saturated) without consuming it
+size_t mouse_coalesce_build(const mouse_coalesce_t *mc, uint8_t *report_out, size_t len);
+
+// Remove a report produced by mouse_coalesce_build once it has been sent
+void mouse_coalesce_consume(mouse_coalesce_t *mc, const uint8_t *report, size_t len);
+
+// Segment queue. Not thread-safe: callers sharing a queue between tasks must
+// hold a lock around each call.
+void mouse_coalesce_queue_reset(mouse_coalesce_queue_t *q);
+bool mouse_coalesce_queue_add(mouse_coalesce_queue_t *q, const uint8_t *report, size_t len, uint32_t stamp);
+size_t mouse_coalesce_queue_build(const mouse_coalesce_queue_t *q, uint8_t *report_out, size_t len,
+                                  uint32_t *reports_out, uint32_t *stamp_out);
+void mouse_coalesce_queue_consume(mouse_coalesce_queue_t *q, const uint8_t *report, size_t len);
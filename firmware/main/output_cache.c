@@ -0,0 +1,87 @@
+#include "output_cache.h"
+#include "usb_descriptors.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+
+typedef struct {
+    uint8_t hid_register;
+    uint8_t report_type;
+    uint8_t report_id;
+    uint8_t length;
+    uint8_t data[OUTPUT_REPORT_DATA_SIZE];
+} output_cache_entry_t;
+
+_Static_assert(sizeof(output_cache_entry_t) == OUTPUT_REPORTS_ENTRY_SIZE, "entry is copied into the block as is");
+
+static output_cache_entry_t g_entries[OUTPUT_CACHE_MAX_INSTANCES];
+static uint16_t g_change_count = 0;
+static portMUX_TYPE g_output_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void output_cache_reset(void)
+{
+    portENTER_CRITICAL(&g_output_lock);
+    memset(g_entries, 0, sizeof(g_entries));
+    g_change_count++;
+    portEXIT_CRITICAL(&g_output_lock);
+}
+
+void output_cache_store(uint8_t instance, uint8_t report_type, uint8_t report_id,
+                        const uint8_t *data, size_t len)
+{
+    if (instance >= OUTPUT_CACHE_MAX_INSTANCES || (len > 0 && !data)) {
+        return;
+    }
+    if (len > OUTPUT_REPORT_DATA_SIZE) {
+        len = OUTPUT_REPORT_DATA_SIZE;
+    }
+
+    output_cache_entry_t entry = {
+        .report_type = report_type,
+        .report_id = report_id,
+        .length = len,
+    };
+    if (len > 0) {
+        memcpy(entry.data, data, len);
+    }
+
+    portENTER_CRITICAL(&g_output_lock);
+    g_entries[instance] = entry;
+    g_change_count++;
+    portEXIT_CRITICAL(&g_output_lock);
+}
+
+esp_err_t output_cache_encode(uint8_t interface_count, uint8_t *block, size_t len)
+{
+    if (!block || len < OUTPUT_REPORTS_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (interface_count > OUTPUT_CACHE_MAX_INSTANCES) {
+        interface_count = OUTPUT_CACHE_MAX_INSTANCES;
+    }
+
+    memset(block, 0, OUTPUT_REPORTS_SIZE);
+    block[0] = OUTPUT_REPORTS_VERSION;
+    block[1] = interface_count;
+
+    // One snapshot: the counter always matches the entries next to it
+    portENTER_CRITICAL(&g_output_lock);
+    block[2] = g_change_count & 0xFF;
+    block[3] = (g_change_count >> 8) & 0xFF;
+    memcpy(&block[OUTPUT_REPORTS_HEADER_SIZE], g_entries, interface_count * OUTPUT_REPORTS_ENTRY_SIZE);
+    portEXIT_CRITICAL(&g_output_lock);
+
+    // Every interface gets its entry, so the master finds it by register
+    // before the host has written to it
+    for (uint8_t i = 0; i < interface_count; i++) {
+        block[OUTPUT_REPORTS_HEADER_SIZE + i * OUTPUT_REPORTS_ENTRY_SIZE] = usb_get_hid_register_for_instance(i);
+    }
+    return ESP_OK;
+}
+
+uint16_t output_cache_change_count(void)
+{
+    portENTER_CRITICAL(&g_output_lock);
+    uint16_t count = g_change_count;
+    portEXIT_CRITICAL(&g_output_lock);
+    return count;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "hidra_protocol.h"
+
+// Interfaces the cache keeps a report for
+#define OUTPUT_CACHE_MAX_INSTANCES  EXT_STATUS_MAX_INTERFACES
+
+// Latest host-to-device report per interface, for OUTPUT_REPORTS_REG.
+// Safe from any task: the USB task stores, i2c_task encodes.
+
+// Forget every report, e.g. after the interfaces were rebuilt. Counts as a
+// change.
+void output_cache_reset(void);
+
+// Keep the first OUTPUT_REPORT_DATA_SIZE bytes of a report the host sent.
+// report_type is OUTPUT_REPORT_TYPE_*, report_id the interface's own ID.
+void output_cache_store(uint8_t instance, uint8_t report_type, uint8_t report_id,
+                        const uint8_t *data, size_t len);
+
+// Encode the OUTPUT_REPORTS_REG block for the first interface_count
+// interfaces, each under the HID register the USB side serves on it, written
+// to or not. len must be at least OUTPUT_REPORTS_SIZE.
+esp_err_t output_cache_encode(uint8_t interface_count, uint8_t *block, size_t len);
+
+uint16_t output_cache_change_count(void);
@@ -0,0 +1,97 @@
+#include "report_ring.h"
+#include <string.h>
+
+static inline uint8_t *slot_ptr(const report_ring_t *ring, uint32_t index)
+{
+    return ring->storage + (size_t)(index & (ring->slot_count - 1)) * (ring->slot_size + 1);
+}
+
+esp_err_t report_ring_init(report_ring_t *ring, uint8_t *storage, uint16_t slot_size, uint16_t slot_count)
+{
+    if (!ring || !storage || slot_size == 0 || slot_size > UINT8_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (slot_count == 0 || (slot_count & (slot_count - 1)) != 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    ring->storage = storage;
+    ring->slot_size = slot_size;
+    ring->slot_count = slot_count;
+    report_ring_reset(ring);
+    return ESP_OK;
+}
+
+void report_ring_reset(report_ring_t *ring)
+{
+    atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, 0, memory_order_relaxed);
+    ring->high_water = 0;
+}
+
+bool report_ring_has_space(const report_ring_t *ring)
+{
+    return report_ring_depth(ring) < ring->slot_count;
+}
+
+bool report_ring_push(report_ring_t *ring, const uint8_t *report, size_t len)
+{
+    if (len > ring->slot_size) {
+        return false;
+    }
+
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    uint32_t depth = head - tail;
+    if (depth >= ring->slot_count) {
+        return false;
+    }
+
+    uint8_t *slot = slot_ptr(ring, head);
+    slot[0] = (uint8_t)len;
+    memcpy(&slot[1], report, len);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    if (depth + 1 > ring->high_water) {
+        ring->high_water = depth + 1;
+    }
+    return true;
+}
+
+const uint8_t *report_ring_peek(report_ring_t *ring, size_t *len_out)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (head == tail) {
+        return NULL;
+    }
+
+    const uint8_t *slot = slot_ptr(ring, tail);
+    *len_out = slot[0];
+    return &slot[1];
+}
+
+void report_ring_pop(report_ring_t *ring)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+uint16_t report_ring_depth(const report_ring_t *ring)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return (uint16_t)(head - tail);
+}
+
+uint16_t report_ring_head_slot(const report_ring_t *ring)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    return (uint16_t)(head & (ring->slot_count - 1));
+}
+
+uint16_t report_ring_tail_slot(const report_ring_t *ring)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    return (uint16_t)(tail & (ring->slot_count - 1));
+}
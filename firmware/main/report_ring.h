@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Single-producer/single-consumer ring of variable-length HID reports.
+// Each slot holds a length byte followed by up to slot_size report bytes.
+// The producer only writes head, the consumer only writes tail, so no lock
+// or kernel object is needed between i2c_task and the USB task.
+typedef struct {
+    uint8_t *storage;
+    uint16_t slot_size;
+    uint16_t slot_count;     // Power of two
+    _Atomic uint32_t head;   // Next slot to write (producer)
+    _Atomic uint32_t tail;   // Next slot to read (consumer)
+    uint16_t high_water;     // Deepest fill level seen (producer)
+} report_ring_t;
+
+// Bytes of storage needed for a ring
+#define REPORT_RING_STORAGE_SIZE(slot_size, slot_count) ((size_t)((slot_size) + 1) * (slot_count))
+
+esp_err_t report_ring_init(report_ring_t *ring, uint8_t *storage, uint16_t slot_size, uint16_t slot_count);
+void report_ring_reset(report_ring_t *ring);
+
+// Producer side. Space only grows behind the producer's back, so a true
+// result from has_space holds until the next push.
+bool report_ring_has_space(const report_ring_t *ring);
+bool report_ring_push(report_ring_t *ring, const uint8_t *report, size_t len);
+
+// Consumer side: peek returns a pointer into the ring that stays valid until pop
+const uint8_t *report_ring_peek(report_ring_t *ring, size_t *len_out);
+void report_ring_pop(report_ring_t *ring);
+
+// Either side
+uint16_t report_ring_depth(const report_ring_t *ring);
+
+// Slot the next push writes (producer) and the slot peek returns (consumer),
+// for callers keeping per-report metadata in a parallel array. The producer
+// fills its entry before push, and only once report_ring_has_space() says
+// the slot is free: on a full ring the head slot is the one being read.
+// push publishes the entry along with the report.
+uint16_t report_ring_head_slot(const report_ring_t *ring);
+uint16_t report_ring_tail_slot(const report_ring_t *ring);
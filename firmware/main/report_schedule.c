@@ -0,0 +1,134 @@
+#include "report_schedule.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "report_schedule";
+
+typedef struct {
+    uint32_t due_us;
+    uint8_t hid_register;
+    uint8_t len;
+    uint8_t report[MAX_REPORT_SIZE];
+} schedule_entry_t;
+
+// Sorted by due time; equal times keep the order they were added in
+static schedule_entry_t g_entries[SCHEDULE_DEPTH];
+static uint16_t g_count = 0;
+static report_schedule_stats_t g_stats;
+
+// Wrap-safe: negative once the time has passed
+static int32_t time_until(uint32_t due_us, uint32_t now_us)
+{
+    return (int32_t)(due_us - now_us);
+}
+
+esp_err_t report_schedule_add(uint32_t now_us, uint32_t due_us, uint8_t hid_register,
+                              const uint8_t *report, size_t len)
+{
+    if (!report || len == 0 || len > MAX_REPORT_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (time_until(due_us, now_us) > SCHEDULE_MAX_LEAD_US) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (g_count >= SCHEDULE_DEPTH) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Entries are compared relative to now, so the order survives the wrap
+    size_t pos = g_count;
+    while (pos > 0 && time_until(g_entries[pos - 1].due_us, now_us) > time_until(due_us, now_us)) {
+        pos--;
+    }
+    memmove(&g_entries[pos + 1], &g_entries[pos], (g_count - pos) * sizeof(g_entries[0]));
+
+    schedule_entry_t *entry = &g_entries[pos];
+    entry->due_us = due_us;
+    entry->hid_register = hid_register;
+    entry->len = len;
+    memcpy(entry->report, report, len);
+    g_count++;
+    return ESP_OK;
+}
+
+static void remove_entry(size_t pos)
+{
+    g_count--;
+    memmove(&g_entries[pos], &g_entries[pos + 1], (g_count - pos) * sizeof(g_entries[0]));
+}
+
+bool report_schedule_release(uint32_t now_us, report_schedule_submit_fn submit, uint32_t *wait_us_out)
+{
+    uint32_t blocked[256 / 32] = {0};   // Registers whose queue was full in this pass
+    bool any_blocked = false;
+
+    size_t pos = 0;
+    while (pos < g_count && time_until(g_entries[pos].due_us, now_us) <= 0) {
+        schedule_entry_t *entry = &g_entries[pos];
+        uint32_t bit = 1u << (entry->hid_register % 32);
+        uint32_t *word = &blocked[entry->hid_register / 32];
+        if (*word & bit) {
+            pos++;
+            continue;
+        }
+
+        esp_err_t ret = submit(entry->hid_register, entry->report, entry->len);
+        if (ret == ESP_ERR_NO_MEM) {
+            *word |= bit;
+            any_blocked = true;
+            pos++;
+            continue;
+        }
+
+        if (ret == ESP_OK) {
+            uint32_t late_us = now_us - entry->due_us;
+            g_stats.released++;
+            if (late_us > REPORT_SCHEDULE_LATE_US) {
+                g_stats.late++;
+            }
+            if (late_us > g_stats.max_late_us) {
+                g_stats.max_late_us = late_us;
+            }
+        } else {
+            ESP_LOGW(TAG, "Scheduled report for register 0x%02X dropped: %s",
+                     entry->hid_register, esp_err_to_name(ret));
+            g_stats.failed++;
+        }
+        remove_entry(pos);
+    }
+
+    if (g_count == 0) {
+        *wait_us_out = 0;
+        return false;
+    }
+
+    // pos is the first entry not yet due, if any
+    uint32_t wait_us = UINT32_MAX;
+    if (pos < g_count) {
+        wait_us = time_until(g_entries[pos].due_us, now_us);
+    }
+    if (any_blocked && wait_us > REPORT_SCHEDULE_RETRY_US) {
+        wait_us = REPORT_SCHEDULE_RETRY_US;
+    }
+    *wait_us_out = wait_us;
+    return true;
+}
+
+void report_schedule_clear(void)
+{
+    g_count = 0;
+}
+
+void report_schedule_get_stats(report_schedule_stats_t *stats_out)
+{
+    if (!stats_out) {
+        return;
+    }
+    *stats_out = g_stats;
+    stats_out->pending = g_count;
+}
+
+void report_schedule_reset_stats(void)
+{
+    memset(&g_stats, 0, sizeof(g_stats));
+}
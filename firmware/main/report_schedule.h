@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "hidra_protocol.h"
+
+// Wait before retrying a report that found its queue full: one USB frame
+#define REPORT_SCHEDULE_RETRY_US    1000
+// Reports released later than this after their due time count as late
+#define REPORT_SCHEDULE_LATE_US     1000
+
+// Where due reports go: on the slave, the same path as a write to the
+// report's register, so a released keyboard report becomes the key state
+typedef esp_err_t (*report_schedule_submit_fn)(uint8_t hid_register, const uint8_t *report, size_t len);
+
+typedef struct {
+    uint16_t pending;
+    uint32_t released;
+    uint32_t late;          // Released more than REPORT_SCHEDULE_LATE_US after their time
+    uint32_t failed;        // Rejected by their interface and dropped
+    uint32_t max_late_us;
+} report_schedule_stats_t;
+
+// Reports waiting for their due time (SCHEDULE_REG), kept in time order.
+// Times are the low 32 bits of esp_timer_get_time(). Not thread safe: owned
+// by the producer side like the macro player.
+
+// Queue a report due at due_us. A time already passed is released on the
+// next call to report_schedule_release(). ESP_ERR_NO_MEM when SCHEDULE_DEPTH
+// reports are pending, ESP_ERR_INVALID_SIZE for an empty report or one over
+// MAX_REPORT_SIZE, ESP_ERR_INVALID_ARG for a time more than
+// SCHEDULE_MAX_LEAD_US ahead of now_us.
+esp_err_t report_schedule_add(uint32_t now_us, uint32_t due_us, uint8_t hid_register,
+                              const uint8_t *report, size_t len);
+
+// Submit every report that is due. Reports of one interface keep their
+// order: once one finds its queue full, later ones of that interface wait
+// for the retry. Returns true while reports are pending, with the
+// microseconds until the next one is due (or the retry) in wait_us_out.
+bool report_schedule_release(uint32_t now_us, report_schedule_submit_fn submit, uint32_t *wait_us_out);
+
+// Drop everything pending, e.g. after the interfaces were rebuilt
+void report_schedule_clear(void);
+
+void report_schedule_get_stats(report_schedule_stats_t *stats_out);
+void report_schedule_reset_stats(void);
@@ -0,0 +1,235 @@
+#include "touch_frame.h"
+#include <string.h>
+
+_Static_assert(1 + TOUCH_MAX_CONTACTS * TOUCH_CONTACT_SIZE <= MAX_REPORT_SIZE,
+               "a full frame must fit in one write");
+_Static_assert(TOUCHPAD_REPORT_SIZE <= MAX_REPORT_SIZE, "touch report must fit one endpoint packet");
+_Static_assert(TOUCH_MAX_CONTACT_ID < (1 << 6), "contact id is a 6-bit report field");
+
+static touch_slot_t *find_slot(touch_frame_t *tf, uint8_t id)
+{
+    for (int i = 0; i < TOUCH_MAX_CONTACTS; i++) {
+        if (tf->slots[i].used && tf->slots[i].contact.id == id) {
+            return &tf->slots[i];
+        }
+    }
+    return NULL;
+}
+
+static touch_slot_t *alloc_slot(touch_frame_t *tf)
+{
+    for (int i = 0; i < TOUCH_MAX_CONTACTS; i++) {
+        if (!tf->slots[i].used) {
+            memset(&tf->slots[i], 0, sizeof(tf->slots[i]));
+            tf->slots[i].used = true;
+            return &tf->slots[i];
+        }
+    }
+    return NULL;
+}
+
+// Tip state the host should see next
+static bool desired_tip(const touch_slot_t *slot)
+{
+    return slot->down || (slot->touched && !slot->reported);
+}
+
+void touch_frame_reset(touch_frame_t *tf, bool has_button)
+{
+    memset(tf, 0, sizeof(*tf));
+    tf->has_button = has_button;
+}
+
+uint8_t touch_frame_slots_used(const touch_frame_t *tf)
+{
+    uint8_t used = 0;
+    for (int i = 0; i < TOUCH_MAX_CONTACTS; i++) {
+        used += tf->slots[i].used;
+    }
+    return used;
+}
+
+static void end_frame(touch_frame_t *tf, uint8_t frame_flags, uint32_t stamp)
+{
+    uint32_t seq = tf->seq + 1;
+    for (uint8_t i = 0; i < tf->staged_count; i++) {
+        const touch_contact_t *c = &tf->staged[i];
+        touch_slot_t *slot = find_slot(tf, c->id);
+        if (c->flags & TOUCH_CONTACT_TIP) {
+            if (!slot) {
+                slot = alloc_slot(tf);  // Reserved by touch_frame_add
+            }
+            if (!slot->down) {
+                slot->touched = true;
+                slot->touch_seq = seq;
+            }
+            slot->down = true;
+            slot->contact = *c;
+        } else if (slot) {
+            // Lift at the last position the master gave
+            slot->down = false;
+            slot->contact = *c;
+        }
+    }
+    tf->staged_count = 0;
+    tf->button = (frame_flags & TOUCH_FRAME_BUTTON) ? 1 : 0;
+
+    if (tf->frames == 0) {
+        tf->stamp = stamp;
+    }
+    tf->frames++;
+    tf->seq = seq;
+
+    // Scan time runs on by the time between frames: the difference of two
+    // 32-bit stamps stays right across their wrap, the stamp itself does not
+    uint64_t elapsed = (uint64_t)tf->scan_rest_us + (uint32_t)(stamp - tf->scan_stamp);
+    tf->scan_time += (uint16_t)(elapsed / TOUCH_SCAN_TIME_UNIT_US);
+    tf->scan_rest_us = elapsed % TOUCH_SCAN_TIME_UNIT_US;
+    tf->scan_stamp = stamp;
+
+    uint8_t used = touch_frame_slots_used(tf);
+    if (used > tf->high_water) {
+        tf->high_water = used;
+    }
+}
+
+esp_err_t touch_frame_add(touch_frame_t *tf, const uint8_t *payload, size_t len, uint32_t stamp)
+{
+    if (len < 1 || (len - 1) % TOUCH_CONTACT_SIZE != 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Stage into a copy: a rejected write leaves the frame as it was
+    touch_contact_t staged[TOUCH_MAX_CONTACTS];
+    uint8_t count = tf->staged_count;
+    memcpy(staged, tf->staged, sizeof(staged));
+
+    for (size_t offset = 1; offset < len; offset += TOUCH_CONTACT_SIZE) {
+        const uint8_t *r = &payload[offset];
+        touch_contact_t c = {
+            .id = r[0],
+            .flags = r[1],
+            .x = r[2] | (r[3] << 8),
+            .y = r[4] | (r[5] << 8),
+        };
+        if (c.id > TOUCH_MAX_CONTACT_ID) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        // A contact repeated within the frame keeps its latest state
+        uint8_t i = 0;
+        while (i < count && staged[i].id != c.id) {
+            i++;
+        }
+        if (i == TOUCH_MAX_CONTACTS) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        staged[i] = c;
+        if (i == count) {
+            count++;
+        }
+    }
+
+    // Fingers going down need a slot; slots free up only once the host has
+    // seen their finger lift
+    uint8_t needed = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if ((staged[i].flags & TOUCH_CONTACT_TIP) && !find_slot(tf, staged[i].id)) {
+            needed++;
+        }
+    }
+    if (needed > TOUCH_MAX_CONTACTS - touch_frame_slots_used(tf)) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    memcpy(tf->staged, staged, sizeof(staged));
+    tf->staged_count = count;
+    if (payload[0] & TOUCH_FRAME_END) {
+        end_frame(tf, payload[0], stamp);
+    }
+    return ESP_OK;
+}
+
+size_t touch_frame_build(touch_frame_t *tf, uint8_t *report_out, size_t len,
+                         uint32_t *frames_out, uint32_t *stamp_out)
+{
+    size_t report_len = tf->has_button ? TOUCHPAD_REPORT_SIZE : TOUCHSCREEN_REPORT_SIZE;
+    if (len < report_len) {
+        return 0;
+    }
+
+    bool dirty = tf->frames > 0;
+    for (int i = 0; i < TOUCH_MAX_CONTACTS && !dirty; i++) {
+        const touch_slot_t *slot = &tf->slots[i];
+        dirty = slot->used && desired_tip(slot) != slot->reported;
+    }
+    if (!dirty) {
+        return 0;
+    }
+
+    memset(report_out, 0, report_len);
+    report_out[0] = TOUCH_REPORT_ID;
+    uint8_t *p = &report_out[1];
+    uint8_t count = 0;
+    for (int i = 0; i < TOUCH_MAX_CONTACTS; i++) {
+        touch_slot_t *slot = &tf->slots[i];
+        bool tip = slot->used && desired_tip(slot);
+        slot->in_report = slot->used && (tip || slot->reported);
+        slot->sent_tip = tip;
+        if (!slot->in_report) {
+            continue;
+        }
+
+        const touch_contact_t *c = &slot->contact;
+        p[0] = ((c->flags & TOUCH_CONTACT_CONFIDENCE) ? 0x01 : 0) | (tip ? 0x02 : 0) | (c->id << 2);
+        p[1] = c->x & 0xFF;
+        p[2] = (c->x >> 8) & 0xFF;
+        p[3] = c->y & 0xFF;
+        p[4] = (c->y >> 8) & 0xFF;
+        p += TOUCH_REPORT_CONTACT_SIZE;
+        count++;
+    }
+
+    uint8_t *tail = &report_out[1 + TOUCH_MAX_CONTACTS * TOUCH_REPORT_CONTACT_SIZE];
+    tail[0] = tf->scan_time & 0xFF;
+    tail[1] = (tf->scan_time >> 8) & 0xFF;
+    tail[2] = count;
+    if (tf->has_button) {
+        tail[3] = tf->button;
+    }
+
+    tf->built_seq = tf->seq;
+    if (frames_out) {
+        *frames_out = tf->frames;
+    }
+    if (stamp_out) {
+        *stamp_out = tf->stamp;
+    }
+    return report_len;
+}
+
+void touch_frame_consume(touch_frame_t *tf)
+{
+    for (int i = 0; i < TOUCH_MAX_CONTACTS; i++) {
+        touch_slot_t *slot = &tf->slots[i];
+        if (!slot->used || !slot->in_report) {
+            continue;
+        }
+        slot->in_report = false;
+        slot->reported = slot->sent_tip;
+        // A touch that started after the build has not been reported yet
+        if ((int32_t)(slot->touch_seq - tf->built_seq) <= 0) {
+            slot->touched = false;
+        }
+        if (!slot->reported && !slot->down && !slot->touched) {
+            slot->used = false;
+        }
+    }
+
+    // Frames completed after the build stay pending; their oldest receive
+    // time is not kept, so latency counts from the newest
+    tf->frames = tf->seq - tf->built_seq;
+    if (tf->frames) {
+        tf->stamp = tf->scan_stamp;
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "hidra_protocol.h"
+
+// USB input report of the multi-touch interfaces (report ID first):
+//   [report ID, contact x TOUCH_MAX_CONTACTS, scan time, contact count, (button)]
+// contact = [confidence | tip << 1 | id << 2, x (uint16), y (uint16)]
+// Multi-byte fields are little endian; unused contact entries are zero.
+#define TOUCH_REPORT_ID             1   // Input report
+#define TOUCH_FEATURE_MAX_COUNT_ID  2   // Feature: contact count maximum (and pad type)
+#define TOUCH_FEATURE_INPUT_MODE_ID 3   // Feature: touchpad input mode
+#define TOUCH_FEATURE_SELECTIVE_ID  4   // Feature: touchpad surface/button switches
+#define TOUCH_FEATURE_CERT_ID       5   // Feature: touchpad certification status blob
+#define TOUCH_CERT_BLOB_SIZE        256
+#define TOUCH_REPORT_CONTACT_SIZE   5
+#define TOUCHSCREEN_REPORT_SIZE     (1 + TOUCH_MAX_CONTACTS * TOUCH_REPORT_CONTACT_SIZE + 3)
+#define TOUCHPAD_REPORT_SIZE        (TOUCHSCREEN_REPORT_SIZE + 1)
+#define TOUCH_SCAN_TIME_UNIT_US     100
+
+// One finger as last reported by the master
+typedef struct {
+    uint8_t id;
+    uint8_t flags;      // TOUCH_CONTACT_*
+    uint16_t x;
+    uint16_t y;
+} touch_contact_t;
+
+// A finger the host has to hear about. Slots are freed once the host has
+// seen the finger lift.
+typedef struct {
+    touch_contact_t contact;
+    bool used;
+    bool down;          // Down in the latest complete frame
+    bool reported;      // Down as far as the host knows
+    bool touched;       // Went down since the last report: a tap shorter than
+                        // one interval is still reported down once
+    uint32_t touch_seq; // Frame that set touched
+    bool in_report;     // Included in the last built report
+    bool sent_tip;      // Tip state in the last built report
+} touch_slot_t;
+
+// Contacts arriving across several I2C writes are staged until the frame
+// ends, then merged into the slots in one step, so a report never mixes two
+// frames. Frames completed while the host is busy collapse into the next
+// report; lifts and short taps are never lost.
+typedef struct {
+    touch_slot_t slots[TOUCH_MAX_CONTACTS];
+    touch_contact_t staged[TOUCH_MAX_CONTACTS];
+    uint8_t staged_count;
+    bool has_button;        // Touchpad layout: report carries a button byte
+    uint8_t button;
+    uint32_t seq;           // Frames completed since reset
+    uint32_t built_seq;     // Latest frame in the last built report
+    uint32_t frames;        // Frames completed since the last report
+    uint32_t stamp;         // Receive time of the oldest frame not yet reported
+    uint32_t scan_stamp;    // Receive time of the newest frame
+    uint16_t scan_time;     // HID scan time of the newest frame, in TOUCH_SCAN_TIME_UNIT_US
+    uint8_t scan_rest_us;   // Elapsed time not yet counted in scan_time
+    uint8_t high_water;     // Most slots in use at once
+} touch_frame_t;
+
+void touch_frame_reset(touch_frame_t *tf, bool has_button);
+
+// Stage one write of [frame flags, contact...]. ESP_ERR_INVALID_SIZE for
+// bad framing, an id above TOUCH_MAX_CONTACT_ID or more than
+// TOUCH_MAX_CONTACTS contacts in one frame. ESP_ERR_NO_MEM, leaving tf
+// untouched, if the frame needs a slot while all are held by fingers the
+// host has not yet seen lift. stamp is the receive time of the write.
+esp_err_t touch_frame_add(touch_frame_t *tf, const uint8_t *payload, size_t len, uint32_t stamp);
+
+// Build the next report (TOUCHSCREEN_REPORT_SIZE or TOUCHPAD_REPORT_SIZE
+// bytes). Returns 0 if the host is up to date. frames_out and stamp_out may
+// be NULL.
+size_t touch_frame_build(touch_frame_t *tf, uint8_t *report_out, size_t len,
+                         uint32_t *frames_out, uint32_t *stamp_out);
+
+// Commit the last built report once it has been sent
+void touch_frame_consume(touch_frame_t *tf);
+
+uint8_t touch_frame_slots_used(const touch_frame_t *tf);
@@ -1,7 +1,7 @@
 #include "usb_descriptors.h"
+#include "touch_frame.h"
 #include "esp_log.h"
 #include <string.h>
-#include <stdlib.h>
 
 static const char *TAG = "usb_desc";
 
@@ -13,22 +13,52 @@ static const char *TAG = "usb_desc";
 #define USB_HID_DESC_LEN    (TUD_HID_DESC_LEN)
 #define USB_HID_IN_EP_SIZE  64
 
-// Interface and endpoint tracking
+// Worst case for the descriptor arena: every interface slot enabled and
+// every string at MAX_STRING_LENGTH
+#define USB_MAX_HID_INTERFACES      8
+#define USB_STRING_COUNT            4   // Language, Manufacturer, Product, Serial
+#define USB_CONFIG_DESC_MAX_LEN     (TUD_CONFIG_DESC_LEN + USB_MAX_HID_INTERFACES * TUD_HID_DESC_LEN)
+#define USB_STRING_DESC_MAX_UNITS   (1 + MAX_STRING_LENGTH)  // Header + UTF-16 code units
+
+// Each USB interface needs a TinyUSB HID instance and its own IN endpoint.
+// The ESP32-S3 OTG controller runs at most 5 IN endpoints at once, and EP0
+// IN is one of them, which leaves 4 for HID.
+#define USB_IN_ENDPOINT_COUNT       4
+#define USB_MAX_USB_INTERFACES      (CFG_TUD_HID < USB_IN_ENDPOINT_COUNT ? CFG_TUD_HID : USB_IN_ENDPOINT_COUNT)
+
+// Interface and endpoint tracking. In single-interface mode every entry
+// shares interface 0 and is told apart by report ID.
 typedef struct {
     uint8_t hid_register;
-    uint8_t interface_num;
+    uint8_t interface_num;      // USB interface, also the TinyUSB HID instance
     uint8_t endpoint_in;
     const uint8_t *report_desc;
     size_t report_desc_len;
+    uint16_t report_len;
+    uint8_t interval;
+    uint8_t report_id;          // Wire ID of the input report (own_ids: of local ID 1), 0 = none
+    uint8_t report_id_count;    // Wire IDs taken by the entry
+    bool own_ids;               // Descriptor declares IDs; reports start with the local ID
     bool enabled;
 } hid_interface_t;
 
-// Global descriptor storage
-static tusb_desc_device_t *g_device_desc = NULL;
-static uint8_t *g_config_desc = NULL;
-static uint16_t **g_string_desc = NULL;
-static hid_interface_t g_hid_interfaces[8];
+// Every descriptor is built in place here; a rebuild overwrites it while the
+// device is detached, so nothing is allocated at runtime
+static struct {
+    tusb_desc_device_t device;
+    uint8_t config[USB_CONFIG_DESC_MAX_LEN];
+    uint16_t strings[USB_STRING_COUNT][USB_STRING_DESC_MAX_UNITS];
+} g_desc_arena;
+
+_Static_assert(TUD_HID_DESC_LEN == 9 + 9 + 7, "HID interface block is interface + HID + endpoint descriptor");
+_Static_assert(USB_CONFIG_DESC_MAX_LEN <= UINT16_MAX, "wTotalLength must hold the largest configuration");
+_Static_assert(USB_STRING_DESC_MAX_UNITS * 2 <= UINT8_MAX, "bLength must hold the longest string descriptor");
+
+static bool g_desc_built = false;
+static hid_interface_t g_hid_interfaces[USB_MAX_HID_INTERFACES];
 static uint8_t g_interface_count = 0;
+static uint8_t g_usb_interface_count = 0;
+static bool g_single_interface = false;
 static uint8_t g_string_count = 0;
 
 // HID Report Descriptors
@@ -48,115 +78,437 @@ const uint8_t hid_report_descriptor_consumer[] = {
     TUD_HID_REPORT_DESC_CONSUMER()
 };
 
+// N-key rollover keyboard: modifier bits, then one bit for every usage up to
+// 0xDF so any chord fits in a single report
+const uint8_t hid_report_descriptor_nkro_keyboard[] = {
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+    HID_USAGE(HID_USAGE_DESKTOP_KEYBOARD),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+        HID_USAGE_PAGE(HID_USAGE_PAGE_KEYBOARD),
+        HID_USAGE_MIN(224),
+        HID_USAGE_MAX(231),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX(1),
+        HID_REPORT_COUNT(8),
+        HID_REPORT_SIZE(1),
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE_MIN(0),
+        HID_USAGE_MAX(NKRO_KEY_BITMAP_BYTES * 8 - 1),
+        HID_REPORT_COUNT(NKRO_KEY_BITMAP_BYTES * 8),
+        HID_REPORT_SIZE(1),
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+    HID_COLLECTION_END
+};
+
+// Digitizer usages (HID Usage Tables, page 0x0D)
+#define DIGITIZER_USAGE_TOUCH_SCREEN        0x04
+#define DIGITIZER_USAGE_TOUCH_PAD           0x05
+#define DIGITIZER_USAGE_CONFIGURATION       0x0E
+#define DIGITIZER_USAGE_FINGER              0x22
+#define DIGITIZER_USAGE_DEVICE_SETTINGS     0x23
+#define DIGITIZER_USAGE_TIP_SWITCH          0x42
+#define DIGITIZER_USAGE_CONFIDENCE          0x47
+#define DIGITIZER_USAGE_CONTACT_ID          0x51
+#define DIGITIZER_USAGE_DEVICE_MODE         0x52
+#define DIGITIZER_USAGE_CONTACT_COUNT       0x54
+#define DIGITIZER_USAGE_CONTACT_COUNT_MAX   0x55
+#define DIGITIZER_USAGE_SCAN_TIME           0x56
+#define DIGITIZER_USAGE_SURFACE_SWITCH      0x57
+#define DIGITIZER_USAGE_BUTTON_SWITCH       0x58
+#define DIGITIZER_USAGE_PAD_TYPE            0x59
+#define TOUCH_PAD_TYPE_CLICKPAD             0
+#define TOUCH_INPUT_MODE_MAX                10
+#define TOUCH_INPUT_MODE_MULTI_TOUCH        3
+#define TOUCH_SELECTIVE_SWITCHES            0x03    // Surface and button switch
+
+// Windows precision touchpad certification status (vendor page)
+#define TOUCH_USAGE_PAGE_VENDOR             0xFF00
+#define TOUCH_USAGE_CERT_STATUS             0xC5
+
+// TinyUSB answers GET_REPORT from its HID buffer, report ID included
+_Static_assert(CFG_TUD_HID_EP_BUFSIZE >= 1 + TOUCH_CERT_BLOB_SIZE,
+               "CONFIG_TINYUSB_HID_BUFSIZE must hold the certification status report");
+
+// Certification status the touchpad reports. All zero until the touchpad is
+// certified, which Windows treats as uncertified; replace it with the blob
+// issued at certification.
+static const uint8_t touch_cert_blob[TOUCH_CERT_BLOB_SIZE] = {0};
+
+// Physical extent of the X/Y range in 0.1 mm: 100 x 60 mm
+#define TOUCH_PHYSICAL_MAX_X                1000
+#define TOUCH_PHYSICAL_MAX_Y                600
+
+// One finger: confidence, tip and a 6-bit contact id in the first byte, then
+// X and Y. Matches the contact layout in touch_frame.h.
+#define TOUCH_FINGER_DESC \
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DIGITIZER), \
+    HID_USAGE(DIGITIZER_USAGE_FINGER), \
+    HID_COLLECTION(HID_COLLECTION_LOGICAL), \
+        HID_LOGICAL_MIN(0), \
+        HID_LOGICAL_MAX(1), \
+        HID_REPORT_SIZE(1), \
+        HID_REPORT_COUNT(1), \
+        HID_USAGE(DIGITIZER_USAGE_CONFIDENCE), \
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE), \
+        HID_USAGE(DIGITIZER_USAGE_TIP_SWITCH), \
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE), \
+        HID_REPORT_SIZE(6), \
+        HID_LOGICAL_MAX(TOUCH_MAX_CONTACT_ID), \
+        HID_USAGE(DIGITIZER_USAGE_CONTACT_ID), \
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE), \
+        HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP), \
+        HID_LOGICAL_MAX_N(TOUCH_LOGICAL_MAX, 2), \
+        HID_REPORT_SIZE(16), \
+        HID_UNIT_EXPONENT(0x0E), \
+        HID_UNIT(0x11), \
+        HID_USAGE(HID_USAGE_DESKTOP_X), \
+        HID_PHYSICAL_MIN(0), \
+        HID_PHYSICAL_MAX_N(TOUCH_PHYSICAL_MAX_X, 2), \
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE), \
+        HID_USAGE(HID_USAGE_DESKTOP_Y), \
+        HID_PHYSICAL_MAX_N(TOUCH_PHYSICAL_MAX_Y, 2), \
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE), \
+        HID_UNIT_EXPONENT(0), \
+        HID_UNIT(0), \
+        HID_PHYSICAL_MAX(0), \
+    HID_COLLECTION_END
+
+// Scan time (100 us units) and the number of valid contacts in this report
+#define TOUCH_FRAME_TAIL_DESC \
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DIGITIZER), \
+    HID_LOGICAL_MAX_N(0xFFFF, 3), \
+    HID_REPORT_SIZE(16), \
+    HID_REPORT_COUNT(1), \
+    HID_UNIT_EXPONENT(0x0C), \
+    HID_UNIT_N(0x1001, 2), \
+    HID_USAGE(DIGITIZER_USAGE_SCAN_TIME), \
+    HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE), \
+    HID_UNIT_EXPONENT(0), \
+    HID_UNIT(0), \
+    HID_LOGICAL_MAX(TOUCH_MAX_CONTACTS), \
+    HID_REPORT_SIZE(8), \
+    HID_USAGE(DIGITIZER_USAGE_CONTACT_COUNT), \
+    HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE)
+
+#define TOUCH_FINGERS_DESC \
+    TOUCH_FINGER_DESC, TOUCH_FINGER_DESC, TOUCH_FINGER_DESC, TOUCH_FINGER_DESC, TOUCH_FINGER_DESC, \
+    TOUCH_FINGER_DESC, TOUCH_FINGER_DESC, TOUCH_FINGER_DESC, TOUCH_FINGER_DESC, TOUCH_FINGER_DESC
+
+_Static_assert(TOUCH_MAX_CONTACTS == 10, "TOUCH_FINGERS_DESC lists one collection per contact");
+
+// Multi-touch screen: contacts are absolute screen positions
+const uint8_t hid_report_descriptor_touchscreen[] = {
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DIGITIZER),
+    HID_USAGE(DIGITIZER_USAGE_TOUCH_SCREEN),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+        HID_REPORT_ID(TOUCH_REPORT_ID)
+        TOUCH_FINGERS_DESC,
+        TOUCH_FRAME_TAIL_DESC,
+        HID_REPORT_ID(TOUCH_FEATURE_MAX_COUNT_ID)
+        HID_LOGICAL_MAX(TOUCH_MAX_CONTACTS),
+        HID_REPORT_SIZE(8),
+        HID_REPORT_COUNT(1),
+        HID_USAGE(DIGITIZER_USAGE_CONTACT_COUNT_MAX),
+        HID_FEATURE(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+    HID_COLLECTION_END
+};
+
+// Windows precision touchpad: contacts, scan time, contact count and the
+// click button, plus the capability and configuration features Windows reads
+const uint8_t hid_report_descriptor_touchpad[] = {
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DIGITIZER),
+    HID_USAGE(DIGITIZER_USAGE_TOUCH_PAD),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+        HID_REPORT_ID(TOUCH_REPORT_ID)
+        TOUCH_FINGERS_DESC,
+        TOUCH_FRAME_TAIL_DESC,
+        HID_USAGE_PAGE(HID_USAGE_PAGE_BUTTON),
+        HID_USAGE(1),
+        HID_LOGICAL_MAX(1),
+        HID_REPORT_SIZE(1),
+        HID_REPORT_COUNT(1),
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_REPORT_COUNT(7),
+        HID_INPUT(HID_CONSTANT),
+        HID_USAGE_PAGE(HID_USAGE_PAGE_DIGITIZER),
+        HID_REPORT_ID(TOUCH_FEATURE_MAX_COUNT_ID)
+        HID_LOGICAL_MAX(15),
+        HID_REPORT_SIZE(4),
+        HID_REPORT_COUNT(1),
+        HID_USAGE(DIGITIZER_USAGE_CONTACT_COUNT_MAX),
+        HID_FEATURE(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE(DIGITIZER_USAGE_PAD_TYPE),
+        HID_FEATURE(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE_PAGE_N(TOUCH_USAGE_PAGE_VENDOR, 2),
+        HID_REPORT_ID(TOUCH_FEATURE_CERT_ID)
+        HID_USAGE(TOUCH_USAGE_CERT_STATUS),
+        HID_LOGICAL_MAX_N(0xFF, 2),
+        HID_REPORT_SIZE(8),
+        HID_REPORT_COUNT_N(TOUCH_CERT_BLOB_SIZE, 2),
+        HID_FEATURE(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+    HID_COLLECTION_END,
+
+    // Input mode: the host switches the touchpad from mouse to multi-touch reports
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DIGITIZER),
+    HID_USAGE(DIGITIZER_USAGE_CONFIGURATION),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+        HID_REPORT_ID(TOUCH_FEATURE_INPUT_MODE_ID)
+        HID_USAGE(DIGITIZER_USAGE_FINGER),
+        HID_COLLECTION(HID_COLLECTION_LOGICAL),
+            HID_USAGE(DIGITIZER_USAGE_DEVICE_MODE),
+            HID_LOGICAL_MAX(10),
+            HID_REPORT_SIZE(8),
+            HID_REPORT_COUNT(1),
+            HID_FEATURE(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_COLLECTION_END,
+        HID_USAGE(DIGITIZER_USAGE_DEVICE_SETTINGS),
+        HID_COLLECTION(HID_COLLECTION_PHYSICAL),
+            HID_REPORT_ID(TOUCH_FEATURE_SELECTIVE_ID)
+            HID_USAGE(DIGITIZER_USAGE_SURFACE_SWITCH),
+            HID_USAGE(DIGITIZER_USAGE_BUTTON_SWITCH),
+            HID_LOGICAL_MAX(1),
+            HID_REPORT_SIZE(1),
+            HID_REPORT_COUNT(2),
+            HID_FEATURE(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+            HID_REPORT_COUNT(6),
+            HID_FEATURE(HID_CONSTANT),
+        HID_COLLECTION_END,
+    HID_COLLECTION_END
+};
+
 const size_t hid_report_descriptor_keyboard_len = sizeof(hid_report_descriptor_keyboard);
 const size_t hid_report_descriptor_mouse_len = sizeof(hid_report_descriptor_mouse);
 const size_t hid_report_descriptor_gamepad_len = sizeof(hid_report_descriptor_gamepad);
 const size_t hid_report_descriptor_consumer_len = sizeof(hid_report_descriptor_consumer);
+const size_t hid_report_descriptor_nkro_keyboard_len = sizeof(hid_report_descriptor_nkro_keyboard);
+const size_t hid_report_descriptor_touchscreen_len = sizeof(hid_report_descriptor_touchscreen);
+const size_t hid_report_descriptor_touchpad_len = sizeof(hid_report_descriptor_touchpad);
 
 // Helper functions
-static uint16_t *create_string_descriptor(const char *str);
+static void build_string_descriptor(uint16_t *desc, const char *str);
 static void build_device_descriptor(const hidra_config_t *config);
 static void build_configuration_descriptor(const hidra_config_t *config);
 static void build_string_descriptors(const hidra_config_t *config);
-static void setup_hid_interfaces(const hidra_config_t *config);
+static esp_err_t setup_hid_interfaces(const hidra_config_t *config);
+static esp_err_t build_merged_report_descriptor(void);
+
+// Interfaces with a report descriptor, in endpoint order
+static const struct {
+    uint16_t layout_bit;
+    uint8_t hid_register;
+    const uint8_t *report_desc;
+    size_t report_desc_len;
+    uint16_t report_len;
+} interface_map[] = {
+    {LAYOUT_KEYBOARD, HIDRA_REG_KEYBOARD, hid_report_descriptor_keyboard, sizeof(hid_report_descriptor_keyboard), sizeof(hid_keyboard_report_t)},
+    {LAYOUT_MOUSE, HIDRA_REG_MOUSE, hid_report_descriptor_mouse, sizeof(hid_report_descriptor_mouse), sizeof(hid_mouse_report_t)},
+    {LAYOUT_GAMEPAD, HIDRA_REG_GAMEPAD, hid_report_descriptor_gamepad, sizeof(hid_report_descriptor_gamepad), sizeof(hid_gamepad_report_t)},
+    {LAYOUT_CONSUMER, HIDRA_REG_CONSUMER, hid_report_descriptor_consumer, sizeof(hid_report_descriptor_consumer), sizeof(uint16_t)},
+    {LAYOUT_NKRO_KEYBOARD, HIDRA_REG_NKRO_KEYBOARD, hid_report_descriptor_nkro_keyboard, sizeof(hid_report_descriptor_nkro_keyboard), NKRO_REPORT_SIZE},
+    {LAYOUT_TOUCHSCREEN, HIDRA_REG_TOUCHSCREEN, hid_report_descriptor_touchscreen, sizeof(hid_report_descriptor_touchscreen), TOUCHSCREEN_REPORT_SIZE},
+    {LAYOUT_TOUCHPAD, HIDRA_REG_TOUCHPAD, hid_report_descriptor_touchpad, sizeof(hid_report_descriptor_touchpad), TOUCHPAD_REPORT_SIZE},
+};
+
+#define INTERFACE_MAP_COUNT (sizeof(interface_map) / sizeof(interface_map[0]))
+
+_Static_assert(INTERFACE_MAP_COUNT <= USB_MAX_HID_INTERFACES,
+               "descriptor arena is sized for USB_MAX_HID_INTERFACES interfaces");
+
+// Single-interface mode: every report descriptor back to back, each without
+// its own IDs behind a 2-byte Report ID item
+#define HID_ITEM_REPORT_ID          0x85    // Global item, 1 data byte
+#define HID_ITEM_LONG               0xFE
+#define USB_MERGED_REPORT_DESC_MAX_LEN \
+    (sizeof(hid_report_descriptor_keyboard) + sizeof(hid_report_descriptor_mouse) + \
+     sizeof(hid_report_descriptor_gamepad) + sizeof(hid_report_descriptor_consumer) + \
+     sizeof(hid_report_descriptor_nkro_keyboard) + sizeof(hid_report_descriptor_touchscreen) + \
+     sizeof(hid_report_descriptor_touchpad) + 2 * INTERFACE_MAP_COUNT)
+
+_Static_assert(USB_MERGED_REPORT_DESC_MAX_LEN <= UINT16_MAX, "wDescriptorLength must hold the merged descriptor");
+
+static uint8_t g_merged_report_desc[USB_MERGED_REPORT_DESC_MAX_LEN];
+static size_t g_merged_report_desc_len = 0;
+
+// Touchpad features the host writes; reads return what it last set
+static uint8_t g_touch_input_mode = TOUCH_INPUT_MODE_MULTI_TOUCH;
+static uint8_t g_touch_selective = TOUCH_SELECTIVE_SWITCHES;
 
 esp_err_t usb_descriptors_init(const hidra_config_t *config)
 {
+    if (!config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
     ESP_LOGI(TAG, "Initializing USB descriptors");
     
     // Clean up any existing descriptors
     usb_descriptors_deinit();
     
     // Setup HID interface mapping
-    setup_hid_interfaces(config);
+    esp_err_t ret = setup_hid_interfaces(config);
+    if (ret == ESP_OK && g_single_interface) {
+        ret = build_merged_report_descriptor();
+    }
+    if (ret != ESP_OK) {
+        usb_descriptors_deinit();
+        return ret;
+    }
     
     // Build descriptors
     build_device_descriptor(config);
     build_configuration_descriptor(config);
     build_string_descriptors(config);
+    g_desc_built = true;
     
-    ESP_LOGI(TAG, "USB descriptors initialized - %d interfaces, %d strings", 
-             g_interface_count, g_string_count);
+    ESP_LOGI(TAG, "USB descriptors initialized - %d interfaces on %d USB interfaces, %d strings", 
+             g_interface_count, g_usb_interface_count, g_string_count);
     
     return ESP_OK;
 }
 
 void usb_descriptors_deinit(void)
 {
-    // Free device descriptor
-    if (g_device_desc) {
-        free(g_device_desc);
-        g_device_desc = NULL;
-    }
-    
-    // Free configuration descriptor
-    if (g_config_desc) {
-        free(g_config_desc);
-        g_config_desc = NULL;
-    }
-    
-    // Free string descriptors
-    if (g_string_desc) {
-        for (int i = 0; i < g_string_count; i++) {
-            if (g_string_desc[i]) {
-                free(g_string_desc[i]);
-            }
-        }
-        free(g_string_desc);
-        g_string_desc = NULL;
-    }
-    
+    g_desc_built = false;
     g_interface_count = 0;
+    g_usb_interface_count = 0;
+    g_single_interface = false;
+    g_merged_report_desc_len = 0;
     g_string_count = 0;
+    g_touch_input_mode = TOUCH_INPUT_MODE_MULTI_TOUCH;
+    g_touch_selective = TOUCH_SELECTIVE_SWITCHES;
     memset(g_hid_interfaces, 0, sizeof(g_hid_interfaces));
 }
 
-static void setup_hid_interfaces(const hidra_config_t *config)
+// Length of the HID item at p: prefix, then 0, 1, 2 or 4 data bytes (long
+// items carry their size in the next byte)
+static size_t hid_item_len(const uint8_t *p)
+{
+    static const uint8_t data_len[] = {0, 1, 2, 4};
+    if (p[0] == HID_ITEM_LONG) {
+        return 3 + p[1];
+    }
+    return 1 + data_len[p[0] & 0x03];
+}
+
+// Highest report ID a descriptor declares, 0 if it uses none
+static uint8_t max_report_id(const uint8_t *desc, size_t len)
+{
+    uint8_t max_id = 0;
+    for (size_t i = 0; i + 1 < len; i += hid_item_len(&desc[i])) {
+        if (desc[i] == HID_ITEM_REPORT_ID && desc[i + 1] > max_id) {
+            max_id = desc[i + 1];
+        }
+    }
+    return max_id;
+}
+
+static esp_err_t setup_hid_interfaces(const hidra_config_t *config)
 {
     uint8_t interface_num = 0;
     uint8_t endpoint_in = 0x81; // Start from EP1 IN
+    unsigned next_report_id = 1;
+    uint8_t min_interval = UINT8_MAX;
     
-    // Define interface mappings
-    struct {
-        uint16_t layout_bit;
-        uint8_t hid_register;
-        const uint8_t *report_desc;
-        size_t report_desc_len;
-    } interface_map[] = {
-        {LAYOUT_KEYBOARD, HIDRA_REG_KEYBOARD, hid_report_descriptor_keyboard, hid_report_descriptor_keyboard_len},
-        {LAYOUT_MOUSE, HIDRA_REG_MOUSE, hid_report_descriptor_mouse, hid_report_descriptor_mouse_len},
-        {LAYOUT_GAMEPAD, HIDRA_REG_GAMEPAD, hid_report_descriptor_gamepad, hid_report_descriptor_gamepad_len},
-        {LAYOUT_CONSUMER, HIDRA_REG_CONSUMER, hid_report_descriptor_consumer, hid_report_descriptor_consumer_len},
-    };
-    
+    if (!usb_layout_fits(config->composite_layout)) {
+        ESP_LOGE(TAG, "Layout 0x%04X has no interface or more than %d USB interfaces",
+                 config->composite_layout, USB_MAX_USB_INTERFACES);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
     g_interface_count = 0;
+    g_single_interface = (config->composite_layout & LAYOUT_SINGLE_INTERFACE) != 0;
     
-    for (int i = 0; i < sizeof(interface_map) / sizeof(interface_map[0]); i++) {
+    for (int i = 0; i < INTERFACE_MAP_COUNT; i++) {
         if (config->composite_layout & interface_map[i].layout_bit) {
-            g_hid_interfaces[g_interface_count] = (hid_interface_t){
+            uint8_t interval = config->poll_interval_ms[__builtin_ctz(interface_map[i].layout_bit)];
+            uint8_t own_ids = max_report_id(interface_map[i].report_desc, interface_map[i].report_desc_len);
+            hid_interface_t *hid = &g_hid_interfaces[g_interface_count];
+            *hid = (hid_interface_t){
                 .hid_register = interface_map[i].hid_register,
-                .interface_num = interface_num++,
-                .endpoint_in = endpoint_in++,
+                .interface_num = interface_num,
+                .endpoint_in = endpoint_in,
                 .report_desc = interface_map[i].report_desc,
                 .report_desc_len = interface_map[i].report_desc_len,
+                .report_len = interface_map[i].report_len,
+                .interval = interval ? interval : DEFAULT_POLL_INTERVAL_MS,
+                .report_id = own_ids ? 1 : 0,
+                .report_id_count = own_ids,
+                .own_ids = own_ids > 0,
                 .enabled = true
             };
+            if (hid->interval < min_interval) {
+                min_interval = hid->interval;
+            }
+
+            if (g_single_interface) {
+                // Renumber into one ID space; TinyUSB prepends the ID byte
+                // to reports of descriptors that had none
+                hid->report_id = next_report_id;
+                hid->report_id_count = own_ids ? own_ids : 1;
+                next_report_id += hid->report_id_count;
+                if (next_report_id > UINT8_MAX + 1 ||
+                    hid->report_len + (own_ids ? 0 : 1) > USB_HID_IN_EP_SIZE) {
+                    ESP_LOGE(TAG, "Interface 0x%02X does not fit the shared interface", hid->hid_register);
+                    return ESP_ERR_INVALID_SIZE;
+                }
+            } else {
+                interface_num++;
+                endpoint_in++;
+            }
             g_interface_count++;
         }
     }
+
+    // The shared endpoint is polled as often as its most demanding member
+    if (g_single_interface) {
+        for (uint8_t i = 0; i < g_interface_count; i++) {
+            g_hid_interfaces[i].interval = min_interval;
+        }
+        g_usb_interface_count = g_interface_count ? 1 : 0;
+    } else {
+        g_usb_interface_count = g_interface_count;
+    }
     
-    ESP_LOGI(TAG, "Setup %d HID interfaces", g_interface_count);
+    ESP_LOGI(TAG, "Setup %d HID interfaces%s", g_interface_count,
+             g_single_interface ? " on one USB interface" : "");
+    return ESP_OK;
 }
 
-static void build_device_descriptor(const hidra_config_t *config)
+static esp_err_t build_merged_report_descriptor(void)
 {
-    g_device_desc = malloc(sizeof(tusb_desc_device_t));
-    if (!g_device_desc) {
-        ESP_LOGE(TAG, "Failed to allocate device descriptor");
-        return;
+    uint8_t *p = g_merged_report_desc;
+    const uint8_t *end = g_merged_report_desc + sizeof(g_merged_report_desc);
+
+    for (uint8_t i = 0; i < g_interface_count; i++) {
+        const hid_interface_t *hid = &g_hid_interfaces[i];
+        size_t needed = hid->report_desc_len + (hid->own_ids ? 0 : 2);
+        if (needed > (size_t)(end - p)) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        if (!hid->own_ids) {
+            // Report ID is a global item: it holds for the whole collection
+            *p++ = HID_ITEM_REPORT_ID;
+            *p++ = hid->report_id;
+        }
+        memcpy(p, hid->report_desc, hid->report_desc_len);
+        if (hid->own_ids) {
+            for (size_t j = 0; j + 1 < hid->report_desc_len; j += hid_item_len(&p[j])) {
+                if (p[j] == HID_ITEM_REPORT_ID) {
+                    p[j + 1] = hid->report_id + p[j + 1] - 1;
+                }
+            }
+        }
+        p += hid->report_desc_len;
     }
-    
-    *g_device_desc = (tusb_desc_device_t){
+
+    g_merged_report_desc_len = p - g_merged_report_desc;
+    return ESP_OK;
+}
+
+static void build_device_descriptor(const hidra_config_t *config)
+{
+    g_desc_arena.device = (tusb_desc_device_t){
         .bLength            = sizeof(tusb_desc_device_t),
         .bDescriptorType    = TUSB_DESC_DEVICE,
         .bcdUSB             = 0x0200,
@@ -177,30 +529,26 @@ static void build_device_descriptor(const hidra_config_t *config)
 static void build_configuration_descriptor(const hidra_config_t *config)
 {
     // Calculate total length
-    uint16_t total_len = TUD_CONFIG_DESC_LEN + (g_interface_count * TUD_HID_DESC_LEN);
-    
-    g_config_desc = malloc(total_len);
-    if (!g_config_desc) {
-        ESP_LOGE(TAG, "Failed to allocate configuration descriptor");
-        return;
-    }
+    uint16_t total_len = TUD_CONFIG_DESC_LEN + (g_usb_interface_count * TUD_HID_DESC_LEN);
     
-    uint8_t *desc = g_config_desc;
+    uint8_t *desc = g_desc_arena.config;
     
     // Configuration descriptor
     *desc++ = 9;                        // bLength
     *desc++ = TUSB_DESC_CONFIGURATION;  // bDescriptorType
     *desc++ = total_len & 0xFF;         // wTotalLength LSB
     *desc++ = (total_len >> 8) & 0xFF;  // wTotalLength MSB
-    *desc++ = g_interface_count;        // bNumInterfaces
+    *desc++ = g_usb_interface_count;    // bNumInterfaces
     *desc++ = 1;                        // bConfigurationValue
     *desc++ = 0;                        // iConfiguration
     *desc++ = 0x80;                     // bmAttributes (bus powered)
     *desc++ = 100;                      // bMaxPower (200mA)
     
-    // Add HID interface descriptors
-    for (int i = 0; i < g_interface_count; i++) {
+    // Add HID interface descriptors; in single-interface mode the first
+    // entry speaks for all of them
+    for (int i = 0; i < g_usb_interface_count; i++) {
         hid_interface_t *hid = &g_hid_interfaces[i];
+        size_t report_desc_len = g_single_interface ? g_merged_report_desc_len : hid->report_desc_len;
         
         // Interface descriptor
         *desc++ = 9;                    // bLength
@@ -221,8 +569,8 @@ static void build_configuration_descriptor(const hidra_config_t *config)
         *desc++ = 0;                    // bCountryCode
         *desc++ = 1;                    // bNumDescriptors
         *desc++ = HID_DESC_TYPE_REPORT; // bDescriptorType
-        *desc++ = hid->report_desc_len & 0xFF;        // wDescriptorLength LSB
-        *desc++ = (hid->report_desc_len >> 8) & 0xFF; // wDescriptorLength MSB
+        *desc++ = report_desc_len & 0xFF;             // wDescriptorLength LSB
+        *desc++ = (report_desc_len >> 8) & 0xFF;      // wDescriptorLength MSB
         
         // Endpoint descriptor
         *desc++ = 7;                    // bLength
@@ -231,68 +579,78 @@ static void build_configuration_descriptor(const hidra_config_t *config)
         *desc++ = TUSB_XFER_INTERRUPT;  // bmAttributes
         *desc++ = USB_HID_IN_EP_SIZE;   // wMaxPacketSize LSB
         *desc++ = 0;                    // wMaxPacketSize MSB
-        *desc++ = 10;                   // bInterval
+        *desc++ = hid->interval;        // bInterval (ms at full speed)
     }
 }
 
 static void build_string_descriptors(const hidra_config_t *config)
 {
-    g_string_count = 4; // Language, Manufacturer, Product, Serial
-    g_string_desc = malloc(g_string_count * sizeof(uint16_t*));
-    if (!g_string_desc) {
-        ESP_LOGE(TAG, "Failed to allocate string descriptor array");
-        return;
-    }
+    g_string_count = USB_STRING_COUNT;
     
     // Language descriptor
-    g_string_desc[0] = malloc(4);
-    g_string_desc[0][0] = (TUSB_DESC_STRING << 8) | 4;
-    g_string_desc[0][1] = 0x0409; // English (US)
+    g_desc_arena.strings[0][0] = (TUSB_DESC_STRING << 8) | 4;
+    g_desc_arena.strings[0][1] = 0x0409; // English (US)
     
     // String descriptors
-    g_string_desc[1] = create_string_descriptor(config->manufacturer);
-    g_string_desc[2] = create_string_descriptor(config->product);
-    g_string_desc[3] = create_string_descriptor(config->serial);
+    build_string_descriptor(g_desc_arena.strings[1], config->manufacturer);
+    build_string_descriptor(g_desc_arena.strings[2], config->product);
+    build_string_descriptor(g_desc_arena.strings[3], config->serial);
 }
 
-static uint16_t *create_string_descriptor(const char *str)
+static void build_string_descriptor(uint16_t *desc, const char *str)
 {
-    size_t len = strlen(str);
-    uint16_t *desc = malloc((len + 1) * 2);
-    if (!desc) return NULL;
+    size_t len = strnlen(str, MAX_STRING_LENGTH);
     
     desc[0] = (TUSB_DESC_STRING << 8) | ((len + 1) * 2);
     for (size_t i = 0; i < len; i++) {
         desc[i + 1] = str[i];
     }
-    return desc;
 }
 
 // TinyUSB descriptor callbacks
 uint8_t const *tud_descriptor_device_cb(void)
 {
-    return (uint8_t const *)g_device_desc;
+    return g_desc_built ? (uint8_t const *)&g_desc_arena.device : NULL;
 }
 
 uint8_t const *tud_descriptor_configuration_cb(uint8_t index)
 {
     (void)index;
-    return g_config_desc;
+    return g_desc_built ? g_desc_arena.config : NULL;
 }
 
 uint16_t const *tud_descriptor_string_cb(uint8_t index, uint16_t langid)
 {
     (void)langid;
     if (index >= g_string_count) return NULL;
-    return g_string_desc[index];
+    return g_desc_arena.strings[index];
 }
 
 uint8_t const *tud_hid_descriptor_report_cb(uint8_t instance)
 {
-    if (instance >= g_interface_count) return NULL;
+    if (instance >= g_usb_interface_count) return NULL;
+    if (g_single_interface) return g_merged_report_desc;
     return g_hid_interfaces[instance].report_desc;
 }
 
+// Entry that owns wire report_id on USB interface itf, with the ID its own
+// descriptor uses for it
+static const hid_interface_t *find_report_owner(uint8_t itf, uint8_t report_id, uint8_t *local_id_out)
+{
+    for (uint8_t i = 0; i < g_interface_count; i++) {
+        const hid_interface_t *hid = &g_hid_interfaces[i];
+        if (hid->interface_num != itf) {
+            continue;
+        }
+        if (hid->report_id_count == 0 ||
+            (report_id >= hid->report_id && report_id < hid->report_id + hid->report_id_count)) {
+            *local_id_out = hid->own_ids ? report_id - hid->report_id + 1 : 0;
+            return hid;
+        }
+    }
+    return NULL;
+}
+
 // Interface management functions
 uint8_t usb_get_hid_instance_for_register(uint8_t hid_register)
 {
@@ -313,3 +671,173 @@ bool usb_is_interface_enabled(uint8_t hid_register)
     }
     return false;
 }
+
+uint8_t usb_get_hid_interface_count(void)
+{
+    return g_interface_count;
+}
+
+uint8_t usb_get_hid_register_for_instance(uint8_t instance)
+{
+    if (instance >= g_interface_count) return 0;
+    return g_hid_interfaces[instance].hid_register;
+}
+
+uint16_t usb_get_hid_report_len(uint8_t instance)
+{
+    if (instance >= g_interface_count) return 0;
+    return g_hid_interfaces[instance].report_len;
+}
+
+bool usb_route_hid_report(uint8_t instance, const uint8_t *report, uint16_t len, usb_hid_route_t *route_out)
+{
+    if (instance >= g_interface_count || !report || !route_out) {
+        return false;
+    }
+
+    const hid_interface_t *hid = &g_hid_interfaces[instance];
+    *route_out = (usb_hid_route_t){
+        .itf = hid->interface_num,
+        .report_id = hid->report_id,
+        .data = report,
+        .len = len,
+    };
+    if (hid->own_ids) {
+        // The first byte is the descriptor's own ID; TinyUSB sends the wire ID
+        if (len < 1 || report[0] < 1 || report[0] > hid->report_id_count) {
+            return false;
+        }
+        route_out->report_id = hid->report_id + report[0] - 1;
+        route_out->data = report + 1;
+        route_out->len = len - 1;
+    }
+    return true;
+}
+
+uint8_t usb_get_hid_instance_for_report(uint8_t itf, const uint8_t *report, uint16_t len)
+{
+    if (!g_single_interface) {
+        return itf < g_interface_count ? itf : 0xFF;
+    }
+
+    uint8_t local_id;
+    const hid_interface_t *hid = (report && len > 0) ? find_report_owner(itf, report[0], &local_id) : NULL;
+    return hid ? hid - g_hid_interfaces : 0xFF;
+}
+
+bool usb_get_hid_report_owner(uint8_t itf, uint8_t report_id, uint8_t *instance_out, uint8_t *local_id_out)
+{
+    uint8_t local_id;
+    const hid_interface_t *hid = find_report_owner(itf, report_id, &local_id);
+    if (!hid) {
+        return false;
+    }
+    if (instance_out) {
+        *instance_out = hid - g_hid_interfaces;
+    }
+    if (local_id_out) {
+        *local_id_out = local_id;
+    }
+    return true;
+}
+
+uint8_t usb_get_hid_itf_for_instance(uint8_t instance)
+{
+    if (instance >= g_interface_count) return 0xFF;
+    return g_hid_interfaces[instance].interface_num;
+}
+
+bool usb_is_single_interface(void)
+{
+    return g_single_interface;
+}
+
+uint16_t usb_get_hid_feature_report(uint8_t itf, uint8_t report_id, uint8_t *buffer, uint16_t reqlen)
+{
+    uint8_t local_id;
+    const hid_interface_t *hid = find_report_owner(itf, report_id, &local_id);
+    if (!hid || reqlen < 1) {
+        return 0;
+    }
+    report_id = local_id;
+
+    // Multi-touch capabilities: contact count maximum (touchpad: low nibble,
+    // pad type in the high nibble), and the touchpad settings the host chose
+    uint8_t hid_register = hid->hid_register;
+    if (hid_register == HIDRA_REG_TOUCHSCREEN && report_id == TOUCH_FEATURE_MAX_COUNT_ID) {
+        buffer[0] = TOUCH_MAX_CONTACTS;
+        return 1;
+    }
+    if (hid_register == HIDRA_REG_TOUCHPAD) {
+        switch (report_id) {
+            case TOUCH_FEATURE_MAX_COUNT_ID:
+                buffer[0] = TOUCH_MAX_CONTACTS | (TOUCH_PAD_TYPE_CLICKPAD << 4);
+                return 1;
+            case TOUCH_FEATURE_INPUT_MODE_ID:
+                buffer[0] = g_touch_input_mode;
+                return 1;
+            case TOUCH_FEATURE_SELECTIVE_ID:
+                buffer[0] = g_touch_selective;
+                return 1;
+            case TOUCH_FEATURE_CERT_ID: {
+                // The host may ask for less than the whole blob
+                uint16_t len = reqlen < TOUCH_CERT_BLOB_SIZE ? reqlen : TOUCH_CERT_BLOB_SIZE;
+                memcpy(buffer, touch_cert_blob, len);
+                return len;
+            }
+        }
+    }
+    return 0;
+}
+
+bool usb_set_hid_feature_report(uint8_t itf, uint8_t report_id, const uint8_t *buffer, uint16_t len)
+{
+    uint8_t local_id;
+    const hid_interface_t *hid = find_report_owner(itf, report_id, &local_id);
+    if (!hid || hid->hid_register != HIDRA_REG_TOUCHPAD || len < 1) {
+        return false;
+    }
+    switch (local_id) {
+        case TOUCH_FEATURE_INPUT_MODE_ID:
+            if (buffer[0] > TOUCH_INPUT_MODE_MAX) {
+                return false;
+            }
+            g_touch_input_mode = buffer[0];
+            return true;
+        case TOUCH_FEATURE_SELECTIVE_ID:
+            g_touch_selective = buffer[0] & TOUCH_SELECTIVE_SWITCHES;
+            return true;
+    }
+    return false;
+}
+
+uint16_t usb_get_supported_layout(void)
+{
+    uint16_t layout = 0;
+    for (int i = 0; i < sizeof(interface_map) / sizeof(interface_map[0]); i++) {
+        layout |= interface_map[i].layout_bit;
+    }
+    return layout;
+}
+
+bool usb_layout_fits(uint16_t layout)
+{
+    int interfaces = __builtin_popcount(layout & usb_get_supported_layout());
+    if (interfaces == 0) {
+        return false;
+    }
+    if (layout & LAYOUT_SINGLE_INTERFACE) {
+        return true;
+    }
+    return interfaces <= USB_MAX_USB_INTERFACES;
+}
+
+int usb_get_layout_index_for_register(uint8_t hid_register)
+{
+    for (int i = 0; i < sizeof(interface_map) / sizeof(interface_map[0]); i++) {
+        if (interface_map[i].hid_register == hid_register) {
+            return __builtin_ctz(interface_map[i].layout_bit);
+        }
+    }
+    return -1;
+}
@@ -12,6 +12,8 @@ typedef struct {
     char product[64];
     char serial[64];
     uint16_t composite_layout;
+    uint8_t poll_interval_ms[LAYOUT_BIT_COUNT];  // bInterval per layout bit, 0 = default
+    uint8_t irq_gpio;                            // Interrupt line GPIO, IRQ_GPIO_DISABLED if none
 } hidra_config_t;
 
 // USB descriptor builder interface
@@ -24,17 +26,63 @@ uint8_t const *tud_descriptor_configuration_cb(uint8_t index);
 uint16_t const *tud_descriptor_string_cb(uint8_t index, uint16_t langid);
 uint8_t const *tud_hid_descriptor_report_cb(uint8_t instance);
 
-// HID interface management
+// HID interface management. An instance is one device type; in
+// single-interface mode (LAYOUT_SINGLE_INTERFACE) all instances share USB
+// interface 0 and are told apart by report ID.
 uint8_t usb_get_hid_instance_for_register(uint8_t hid_register);
 bool usb_is_interface_enabled(uint8_t hid_register);
+uint8_t usb_get_hid_interface_count(void);
+uint8_t usb_get_hid_register_for_instance(uint8_t instance);
+uint16_t usb_get_hid_report_len(uint8_t instance);
+// Layout bit index of the interface serving a HID register, -1 if none
+int usb_get_layout_index_for_register(uint8_t hid_register);
+// Feature report for a GET_REPORT request on TinyUSB instance itf, without
+// the report ID. Returns the length written, 0 if there is no such report.
+uint16_t usb_get_hid_feature_report(uint8_t itf, uint8_t report_id, uint8_t *buffer, uint16_t reqlen);
+// Feature report from a SET_REPORT request, without the report ID. Returns
+// false if the report is not writable or the value is out of range.
+bool usb_set_hid_feature_report(uint8_t itf, uint8_t report_id, const uint8_t *buffer, uint16_t len);
+
+// Where a report of an instance goes out: TinyUSB instance, report ID
+// (0 = none) and the data after the ID
+typedef struct {
+    uint8_t itf;
+    uint8_t report_id;
+    const uint8_t *data;
+    uint16_t len;
+} usb_hid_route_t;
+
+// Reports of interfaces whose descriptor declares its own report IDs (touch)
+// start with that local ID, which is translated to the wire ID. Returns
+// false for an unknown instance or local ID.
+bool usb_route_hid_report(uint8_t instance, const uint8_t *report, uint16_t len, usb_hid_route_t *route_out);
+// Instance a report sent on TinyUSB instance itf belongs to (report starts
+// with the wire ID when report IDs are in use), 0xFF if none
+uint8_t usb_get_hid_instance_for_report(uint8_t itf, const uint8_t *report, uint16_t len);
+// Instance and its own report ID for a report ID received on TinyUSB
+// instance itf (SET_REPORT, GET_REPORT). Either output may be NULL.
+bool usb_get_hid_report_owner(uint8_t itf, uint8_t report_id, uint8_t *instance_out, uint8_t *local_id_out);
+uint8_t usb_get_hid_itf_for_instance(uint8_t instance);
+bool usb_is_single_interface(void);
+// Layout bits this firmware has an interface for
+uint16_t usb_get_supported_layout(void);
+// Whether a layout enables at least one interface and no more USB
+// interfaces than there are TinyUSB HID instances and IN endpoints for
+bool usb_layout_fits(uint16_t layout);
 
 // HID report descriptors
 extern const uint8_t hid_report_descriptor_keyboard[];
 extern const uint8_t hid_report_descriptor_mouse[];
 extern const uint8_t hid_report_descriptor_gamepad[];
 extern const uint8_t hid_report_descriptor_consumer[];
+extern const uint8_t hid_report_descriptor_nkro_keyboard[];
+extern const uint8_t hid_report_descriptor_touchscreen[];
+extern const uint8_t hid_report_descriptor_touchpad[];
 
 extern const size_t hid_report_descriptor_keyboard_len;
 extern const size_t hid_report_descriptor_mouse_len;
 extern const size_t hid_report_descriptor_gamepad_len;
 extern const size_t hid_report_descriptor_consumer_len;
+extern const size_t hid_report_descriptor_nkro_keyboard_len;
+extern const size_t hid_report_descriptor_touchscreen_len;
+extern const size_t hid_report_descriptor_touchpad_len;
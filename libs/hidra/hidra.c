@@ -1,11 +1,25 @@
 #include "hidra.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <string.h>
 
 static const char *TAG = "hidra_master";
 
+// Status reads per speed during probing
+#define PROBE_STATUS_READS  8
+#define PROBE_TIMEOUT_MS    50
+// Status reads while the slave recreates its I2C device at a new address
+#define READDRESS_ATTEMPTS  10
+#define READDRESS_RETRY_MS  5
+
+static const hidra_bus_speed_t probe_speeds[] = {
+    HIDRA_SPEED_FAST_PLUS,
+    HIDRA_SPEED_FAST,
+    HIDRA_SPEED_STANDARD,
+};
+
 esp_err_t hidra_master_bus_init(i2c_port_num_t i2c_port, int sda_io_num, int scl_io_num, hidra_bus_handle_t* bus_handle_out)
 {
     if (!bus_handle_out) {
@@ -42,24 +56,91 @@ esp_err_t hidra_master_bus_deinit(hidra_bus_handle_t bus_handle)
 }
 
 esp_err_t hidra_add_device_to_bus(hidra_bus_handle_t bus_handle, uint8_t i2c_address, hidra_device_handle_t* device_handle_out)
+{
+    return hidra_add_device_to_bus_with_speed(bus_handle, i2c_address, HIDRA_SPEED_STANDARD, device_handle_out);
+}
+
+esp_err_t hidra_add_device_to_bus_with_speed(hidra_bus_handle_t bus_handle, uint8_t i2c_address, hidra_bus_speed_t speed, hidra_device_handle_t* device_handle_out)
 {
     if (!bus_handle || !device_handle_out) {
         return ESP_ERR_INVALID_ARG;
     }
+    if (speed != HIDRA_SPEED_STANDARD && speed != HIDRA_SPEED_FAST && speed != HIDRA_SPEED_FAST_PLUS) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
     i2c_device_config_t dev_cfg = {
         .dev_addr_length = I2C_ADDR_BIT_LEN_7,
         .device_address = i2c_address,
-        .scl_speed_hz = 100000, // 100kHz
+        .scl_speed_hz = speed,
     };
 
     esp_err_t ret = i2c_master_bus_add_device(bus_handle, &dev_cfg, device_handle_out);
     if (ret == ESP_OK) {
-        ESP_LOGI(TAG, "HIDra device added at address 0x%02X", i2c_address);
+        ESP_LOGI(TAG, "HIDra device added at address 0x%02X, %d kHz", i2c_address, (int)speed / 1000);
     }
     return ret;
 }
 
+// Bit errors at too high a clock show up as status or extended status
+// values a healthy slave never sends
+static bool probe_reads_clean(hidra_device_handle_t device)
+{
+    for (int i = 0; i < PROBE_STATUS_READS; i++) {
+        uint8_t reg_addr = STATUS_REG;
+        uint8_t status = 0;
+        if (i2c_master_transmit_receive(device, &reg_addr, 1, &status, 1, PROBE_TIMEOUT_MS) != ESP_OK) {
+            return false;
+        }
+        // The first read returns and clears whatever the slave had latched;
+        // the probe writes nothing, so later reads only show a running macro
+        if (i > 0 && (status & ~STATUS_MACRO_RUNNING) != 0) {
+            return false;
+        }
+    }
+
+    // A longer transfer with a known version byte and a bounded count
+    uint8_t reg_addr = EXT_STATUS_REG;
+    uint8_t block[EXT_STATUS_SIZE];
+    if (i2c_master_transmit_receive(device, &reg_addr, 1, block, sizeof(block), PROBE_TIMEOUT_MS) != ESP_OK) {
+        return false;
+    }
+    return block[0] == EXT_STATUS_VERSION && block[3] <= EXT_STATUS_MAX_INTERFACES;
+}
+
+esp_err_t hidra_add_device_probed(hidra_bus_handle_t bus_handle, uint8_t i2c_address, hidra_bus_speed_t max_speed, hidra_device_handle_t* device_handle_out, hidra_bus_speed_t* speed_out)
+{
+    if (!bus_handle || !device_handle_out || max_speed < HIDRA_SPEED_STANDARD) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int i = 0; i < sizeof(probe_speeds) / sizeof(probe_speeds[0]); i++) {
+        hidra_bus_speed_t speed = probe_speeds[i];
+        if (speed > max_speed) {
+            continue;
+        }
+
+        hidra_device_handle_t device;
+        esp_err_t ret = hidra_add_device_to_bus_with_speed(bus_handle, i2c_address, speed, &device);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        if (probe_reads_clean(device)) {
+            *device_handle_out = device;
+            if (speed_out) {
+                *speed_out = speed;
+            }
+            return ESP_OK;
+        }
+
+        ESP_LOGW(TAG, "Device 0x%02X unreliable at %d kHz, stepping down", i2c_address, (int)speed / 1000);
+        i2c_master_bus_rm_device(device);
+    }
+
+    ESP_LOGE(TAG, "Device 0x%02X did not respond at any speed", i2c_address);
+    return ESP_ERR_NOT_FOUND;
+}
+
 esp_err_t hidra_remove_device_from_bus(hidra_device_handle_t device_handle)
 {
     if (!device_handle) {
@@ -92,14 +173,70 @@ esp_err_t hidra_send_generic_report(hidra_device_handle_t device, uint8_t hid_re
     return ret;
 }
 
+// HIDRA_REG_BATCH write into buffer (MAX_BATCH_SIZE + 1 bytes); 0 if the
+// reports are malformed or do not fit
+static size_t encode_batch(const hidra_report_t* reports, size_t count, uint8_t* buffer)
+{
+    size_t offset = 1;
+    buffer[0] = HIDRA_REG_BATCH;
+
+    for (size_t i = 0; i < count; i++) {
+        const hidra_report_t* r = &reports[i];
+        if (!r->report || r->report_size == 0 || r->report_size > MAX_REPORT_SIZE ||
+            offset + BATCH_RECORD_HEADER_SIZE + r->report_size > MAX_BATCH_SIZE + 1) {
+            return 0;
+        }
+        buffer[offset++] = r->hid_register;
+        buffer[offset++] = (uint8_t)r->report_size;
+        memcpy(&buffer[offset], r->report, r->report_size);
+        offset += r->report_size;
+    }
+    return offset;
+}
+
+esp_err_t hidra_send_batch(hidra_device_handle_t device, const hidra_report_t* reports, size_t count, int timeout_ms)
+{
+    if (!device || !reports || count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t buffer[MAX_BATCH_SIZE + 1];
+    size_t len = encode_batch(reports, count, buffer);
+    if (len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = i2c_master_transmit(device, buffer, len, timeout_ms);
+    if (ret == ESP_OK) {
+        ESP_LOGD(TAG, "Sent batch of %zu reports, size: %zu", count, len - 1);
+    } else {
+        ESP_LOGE(TAG, "Failed to send report batch: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+static const hidra_transport_t i2c_transport = {
+    .transmit = i2c_master_transmit,
+    .transmit_receive = i2c_master_transmit_receive,
+};
+
 esp_err_t hidra_read_status(hidra_device_handle_t device, uint8_t* status_out, int timeout_ms)
+{
+    return hidra_transport_read_status(NULL, device, status_out, timeout_ms);
+}
+
+esp_err_t hidra_transport_read_status(const hidra_transport_t* transport, hidra_device_handle_t device,
+                                      uint8_t* status_out, int timeout_ms)
 {
     if (!device || !status_out) {
         return ESP_ERR_INVALID_ARG;
     }
+    if (!transport) {
+        transport = &i2c_transport;
+    }
 
     uint8_t reg_addr = STATUS_REG;
-    esp_err_t ret = i2c_master_transmit_receive(device, &reg_addr, 1, status_out, 1, timeout_ms);
+    esp_err_t ret = transport->transmit_receive(device, &reg_addr, 1, status_out, 1, timeout_ms);
     
     if (ret == ESP_OK) {
         ESP_LOGD(TAG, "Read status: 0x%02X", *status_out);
@@ -109,6 +246,671 @@ esp_err_t hidra_read_status(hidra_device_handle_t device, uint8_t* status_out, i
     return ret;
 }
 
+void hidra_report_batch_init(hidra_report_batch_t* batch)
+{
+    batch->count = 0;
+    batch->size = 0;
+}
+
+bool hidra_report_batch_add(hidra_report_batch_t* batch, uint8_t hid_register, const uint8_t* report, size_t report_size)
+{
+    size_t record = BATCH_RECORD_HEADER_SIZE + report_size;
+    if (batch->count >= HIDRA_REPORT_BATCH_MAX_REPORTS || batch->size + record > MAX_BATCH_SIZE) {
+        return false;
+    }
+    batch->reports[batch->count++] = (hidra_report_t){hid_register, report, report_size};
+    batch->size += record;
+    return true;
+}
+
+esp_err_t hidra_report_batch_send(const hidra_transport_t* transport, hidra_device_handle_t device,
+                                  const hidra_report_batch_t* batch, uint8_t* status_out, int timeout_ms)
+{
+    if (!device || !batch || batch->count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!transport) {
+        transport = &i2c_transport;
+    }
+
+    uint8_t buffer[MAX_BATCH_SIZE + 1];
+    size_t len;
+    const hidra_report_t* first = &batch->reports[0];
+    if (batch->count == 1 && first->report && first->report_size > 0 && first->report_size <= MAX_REPORT_SIZE) {
+        buffer[0] = first->hid_register;
+        memcpy(&buffer[1], first->report, first->report_size);
+        len = first->report_size + 1;
+    } else {
+        len = encode_batch(batch->reports, batch->count, buffer);
+        if (len == 0) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    esp_err_t ret = transport->transmit(device, buffer, len, timeout_ms);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to send %zu queued reports: %s", batch->count, esp_err_to_name(ret));
+        return ret;
+    }
+    return status_out ? hidra_transport_read_status(transport, device, status_out, timeout_ms) : ESP_OK;
+}
+
+esp_err_t hidra_parse_extended_status(const uint8_t* block, size_t len, hidra_ext_status_t* status_out)
+{
+    if (!block || !status_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len < EXT_STATUS_SIZE || block[0] != EXT_STATUS_VERSION || block[3] > EXT_STATUS_MAX_INTERFACES) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    memset(status_out, 0, sizeof(*status_out));
+    status_out->usb_mounted = block[1] & EXT_USB_MOUNTED;
+    status_out->usb_suspended = block[1] & EXT_USB_SUSPENDED;
+    status_out->last_error = block[2];
+    status_out->interface_count = block[3];
+    status_out->dropped = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+
+    const uint8_t* entry = &block[EXT_STATUS_HEADER_SIZE];
+    for (uint8_t i = 0; i < status_out->interface_count; i++) {
+        status_out->interfaces[i].hid_register = entry[0];
+        status_out->interfaces[i].queued = entry[1];
+        status_out->interfaces[i].free_slots = entry[2];
+        entry += EXT_STATUS_ENTRY_SIZE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t hidra_read_extended_status(hidra_device_handle_t device, hidra_ext_status_t* status_out, int timeout_ms)
+{
+    if (!device || !status_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t reg_addr = EXT_STATUS_REG;
+    uint8_t block[EXT_STATUS_SIZE];
+    esp_err_t ret = i2c_master_transmit_receive(device, &reg_addr, 1, block, sizeof(block), timeout_ms);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read extended status: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = hidra_parse_extended_status(block, sizeof(block), status_out);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Malformed extended status (version %d)", block[0]);
+    }
+    return ret;
+}
+
+int hidra_ext_status_free_slots(const hidra_ext_status_t* status, uint8_t hid_register)
+{
+    if (!status) {
+        return -1;
+    }
+
+    for (uint8_t i = 0; i < status->interface_count; i++) {
+        if (status->interfaces[i].hid_register == hid_register) {
+            return status->interfaces[i].free_slots;
+        }
+    }
+    return -1;
+}
+
+esp_err_t hidra_parse_output_reports(const uint8_t* block, size_t len, hidra_output_reports_t* reports_out)
+{
+    if (!block || !reports_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len < OUTPUT_REPORTS_SIZE || block[0] != OUTPUT_REPORTS_VERSION || block[1] > EXT_STATUS_MAX_INTERFACES) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    memset(reports_out, 0, sizeof(*reports_out));
+    reports_out->interface_count = block[1];
+    reports_out->change_count = block[2] | (block[3] << 8);
+    const uint8_t* entry = &block[OUTPUT_REPORTS_HEADER_SIZE];
+    for (uint8_t i = 0; i < reports_out->interface_count; i++) {
+        hidra_output_report_t* report = &reports_out->interfaces[i];
+        report->hid_register = entry[0];
+        report->report_type = entry[1];
+        report->report_id = entry[2];
+        report->length = entry[3] > OUTPUT_REPORT_DATA_SIZE ? OUTPUT_REPORT_DATA_SIZE : entry[3];
+        memcpy(report->data, &entry[4], report->length);
+        entry += OUTPUT_REPORTS_ENTRY_SIZE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t hidra_read_output_reports(hidra_device_handle_t device, hidra_output_reports_t* reports, bool* changed_out, int timeout_ms)
+{
+    if (!device || !reports) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t reg_addr = OUTPUT_REPORTS_REG;
+    uint8_t block[OUTPUT_REPORTS_SIZE];
+    esp_err_t ret = i2c_master_transmit_receive(device, &reg_addr, 1, block, sizeof(block), timeout_ms);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read output reports: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    uint16_t previous = reports->change_count;
+    ret = hidra_parse_output_reports(block, sizeof(block), reports);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Malformed output reports (version %d)", block[0]);
+        return ret;
+    }
+    if (changed_out) {
+        *changed_out = reports->change_count != previous;
+    }
+    return ESP_OK;
+}
+
+const hidra_output_report_t* hidra_find_output_report(const hidra_output_reports_t* reports, uint8_t hid_register)
+{
+    if (!reports) {
+        return NULL;
+    }
+
+    for (uint8_t i = 0; i < reports->interface_count; i++) {
+        if (reports->interfaces[i].hid_register == hid_register) {
+            return &reports->interfaces[i];
+        }
+    }
+    return NULL;
+}
+
+static esp_err_t send_key_event(hidra_device_handle_t device, uint8_t usage, uint8_t action, int timeout_ms)
+{
+    if (!device || usage == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t buffer[3] = {HIDRA_REG_KEY_EVENT, usage, action};
+    esp_err_t ret = i2c_master_transmit(device, buffer, sizeof(buffer), timeout_ms);
+    if (ret == ESP_OK) {
+        ESP_LOGD(TAG, "Key 0x%02X %s", usage, action == KEY_EVENT_PRESS ? "pressed" : "released");
+    } else {
+        ESP_LOGE(TAG, "Failed to send key event: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t hidra_key_press(hidra_device_handle_t device, uint8_t usage, int timeout_ms)
+{
+    return send_key_event(device, usage, KEY_EVENT_PRESS, timeout_ms);
+}
+
+esp_err_t hidra_key_release(hidra_device_handle_t device, uint8_t usage, int timeout_ms)
+{
+    return send_key_event(device, usage, KEY_EVENT_RELEASE, timeout_ms);
+}
+
+static esp_err_t send_nkro_keys(hidra_device_handle_t device, uint8_t action, const uint8_t* usages, size_t count, int timeout_ms)
+{
+    if (!device || (count > 0 && !usages) || count > MAX_REPORT_SIZE - 1) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t buffer[MAX_REPORT_SIZE + 1];
+    buffer[0] = HIDRA_REG_NKRO_KEYS;
+    buffer[1] = action;
+    if (count > 0) {
+        memcpy(&buffer[2], usages, count);
+    }
+
+    esp_err_t ret = i2c_master_transmit(device, buffer, count + 2, timeout_ms);
+    if (ret == ESP_OK) {
+        ESP_LOGD(TAG, "NKRO update 0x%02X, %d keys", action, count);
+    } else {
+        ESP_LOGE(TAG, "Failed to send NKRO update: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t hidra_nkro_press(hidra_device_handle_t device, const uint8_t* usages, size_t count, int timeout_ms)
+{
+    if (count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return send_nkro_keys(device, NKRO_KEYS_SET, usages, count, timeout_ms);
+}
+
+esp_err_t hidra_nkro_release(hidra_device_handle_t device, const uint8_t* usages, size_t count, int timeout_ms)
+{
+    if (count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return send_nkro_keys(device, NKRO_KEYS_CLEAR, usages, count, timeout_ms);
+}
+
+esp_err_t hidra_nkro_set_chord(hidra_device_handle_t device, const uint8_t* usages, size_t count, int timeout_ms)
+{
+    return send_nkro_keys(device, NKRO_KEYS_REPLACE, usages, count, timeout_ms);
+}
+
+esp_err_t hidra_send_touch_frame(hidra_device_handle_t device, uint8_t hid_register, const hidra_touch_contact_t* contacts, size_t count, bool button, int timeout_ms)
+{
+    if (!device || (count > 0 && !contacts) || count > TOUCH_MAX_CONTACTS ||
+        (hid_register != HIDRA_REG_TOUCHSCREEN && hid_register != HIDRA_REG_TOUCHPAD)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t buffer[2 + TOUCH_MAX_CONTACTS * TOUCH_CONTACT_SIZE];
+    buffer[0] = hid_register;
+    buffer[1] = TOUCH_FRAME_END | (button ? TOUCH_FRAME_BUTTON : 0);
+    uint8_t* p = &buffer[2];
+    for (size_t i = 0; i < count; i++) {
+        if (contacts[i].id > TOUCH_MAX_CONTACT_ID) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        p[0] = contacts[i].id;
+        p[1] = contacts[i].flags;
+        p[2] = contacts[i].x & 0xFF;
+        p[3] = (contacts[i].x >> 8) & 0xFF;
+        p[4] = contacts[i].y & 0xFF;
+        p[5] = (contacts[i].y >> 8) & 0xFF;
+        p += TOUCH_CONTACT_SIZE;
+    }
+
+    esp_err_t ret = i2c_master_transmit(device, buffer, p - buffer, timeout_ms);
+    if (ret == ESP_OK) {
+        ESP_LOGD(TAG, "Touch frame, %d contacts", count);
+    } else {
+        ESP_LOGE(TAG, "Failed to send touch frame: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+void hidra_macro_init(hidra_macro_t* macro)
+{
+    if (macro) {
+        memset(macro, 0, sizeof(*macro));
+        macro->keymap_step = SIZE_MAX;
+    }
+}
+
+static esp_err_t macro_fail(hidra_macro_t* macro, esp_err_t err)
+{
+    if (macro && macro->error == ESP_OK) {
+        macro->error = err;
+    }
+    return macro ? macro->error : err;
+}
+
+// Append one step: opcode, then operands and data
+static esp_err_t macro_add(hidra_macro_t* macro, const uint8_t* step, size_t step_len, const void* data, size_t data_len)
+{
+    if (!macro) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (macro->error != ESP_OK) {
+        return macro->error;
+    }
+    if (macro->len + step_len + data_len > sizeof(macro->script)) {
+        return macro_fail(macro, ESP_ERR_NO_MEM);
+    }
+
+    memcpy(&macro->script[macro->len], step, step_len);
+    if (data_len > 0) {
+        memcpy(&macro->script[macro->len + step_len], data, data_len);
+    }
+    macro->len += step_len + data_len;
+    macro->keymap_step = SIZE_MAX;
+    return ESP_OK;
+}
+
+esp_err_t hidra_macro_add_report(hidra_macro_t* macro, uint8_t hid_register, const uint8_t* report, size_t report_size)
+{
+    if (!report || report_size == 0 || report_size > MAX_REPORT_SIZE) {
+        return macro_fail(macro, ESP_ERR_INVALID_ARG);
+    }
+    uint8_t step[3] = {MACRO_OP_REPORT, hid_register, (uint8_t)report_size};
+    return macro_add(macro, step, sizeof(step), report, report_size);
+}
+
+esp_err_t hidra_macro_add_delay(hidra_macro_t* macro, uint16_t delay_ms)
+{
+    uint8_t step[3] = {MACRO_OP_DELAY, delay_ms & 0xFF, (delay_ms >> 8) & 0xFF};
+    return macro_add(macro, step, sizeof(step), NULL, 0);
+}
+
+esp_err_t hidra_macro_begin_repeat(hidra_macro_t* macro, uint8_t count)
+{
+    if (count == 0 || (macro && macro->depth >= MACRO_MAX_DEPTH)) {
+        return macro_fail(macro, ESP_ERR_INVALID_ARG);
+    }
+    uint8_t step[2] = {MACRO_OP_REPEAT, count};
+    esp_err_t ret = macro_add(macro, step, sizeof(step), NULL, 0);
+    if (ret == ESP_OK) {
+        macro->depth++;
+    }
+    return ret;
+}
+
+esp_err_t hidra_macro_end_repeat(hidra_macro_t* macro)
+{
+    if (macro && macro->depth == 0) {
+        return macro_fail(macro, ESP_ERR_INVALID_STATE);
+    }
+    uint8_t step = MACRO_OP_LOOP;
+    esp_err_t ret = macro_add(macro, &step, 1, NULL, 0);
+    if (ret == ESP_OK) {
+        macro->depth--;
+    }
+    return ret;
+}
+
+esp_err_t hidra_macro_add_text(hidra_macro_t* macro, const char* text)
+{
+    if (!text) {
+        return macro_fail(macro, ESP_ERR_INVALID_ARG);
+    }
+
+    // A step holds up to 255 characters
+    size_t remaining = strlen(text);
+    esp_err_t ret = macro ? macro->error : ESP_ERR_INVALID_ARG;
+    while (ret == ESP_OK && remaining > 0) {
+        uint8_t count = remaining > UINT8_MAX ? UINT8_MAX : remaining;
+        uint8_t step[2] = {MACRO_OP_TEXT, count};
+        ret = macro_add(macro, step, sizeof(step), text, count);
+        text += count;
+        remaining -= count;
+    }
+    return ret;
+}
+
+esp_err_t hidra_macro_map_character(hidra_macro_t* macro, char character, uint8_t usage, uint8_t modifiers)
+{
+    uint8_t entry[MACRO_KEYMAP_ENTRY_SIZE] = {(uint8_t)character, usage, modifiers};
+
+    // Consecutive entries share one step
+    if (macro && macro->error == ESP_OK && macro->keymap_step != SIZE_MAX &&
+        macro->script[macro->keymap_step + 1] < UINT8_MAX) {
+        if (macro->len + sizeof(entry) > sizeof(macro->script)) {
+            return macro_fail(macro, ESP_ERR_NO_MEM);
+        }
+        memcpy(&macro->script[macro->len], entry, sizeof(entry));
+        macro->len += sizeof(entry);
+        macro->script[macro->keymap_step + 1]++;
+        return ESP_OK;
+    }
+
+    uint8_t step[2] = {MACRO_OP_KEYMAP, 1};
+    size_t offset = macro ? macro->len : 0;
+    esp_err_t ret = macro_add(macro, step, sizeof(step), entry, sizeof(entry));
+    if (ret == ESP_OK) {
+        macro->keymap_step = offset;
+    }
+    return ret;
+}
+
+esp_err_t hidra_macro_upload(hidra_device_handle_t device, uint8_t slot, const hidra_macro_t* macro, int timeout_ms)
+{
+    if (!device || !macro || slot >= MACRO_SLOT_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (macro->error != ESP_OK) {
+        return macro->error;
+    }
+    if (macro->depth != 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // A chunk the slave rejects makes every later one miss its offset too,
+    // so one status read at the end covers the upload
+    uint8_t buffer[1 + MAX_BATCH_SIZE];
+    const size_t chunk_max = MAX_BATCH_SIZE - MACRO_DATA_HEADER_SIZE;
+    size_t offset = 0;
+    esp_err_t ret;
+    do {
+        size_t chunk = macro->len - offset > chunk_max ? chunk_max : macro->len - offset;
+        buffer[0] = MACRO_DATA_REG;
+        buffer[1] = slot;
+        buffer[2] = offset & 0xFF;
+        buffer[3] = (offset >> 8) & 0xFF;
+        memcpy(&buffer[1 + MACRO_DATA_HEADER_SIZE], &macro->script[offset], chunk);
+        ret = i2c_master_transmit(device, buffer, 1 + MACRO_DATA_HEADER_SIZE + chunk, timeout_ms);
+        offset += chunk;
+    } while (ret == ESP_OK && offset < macro->len);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to upload macro: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    uint8_t status = 0;
+    ret = hidra_read_status(device, &status, timeout_ms);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (!(status & STATUS_OK)) {
+        ESP_LOGE(TAG, "Device rejected macro for slot %d, status: 0x%02X", slot, status);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    ESP_LOGI(TAG, "Uploaded macro to slot %d, %zu bytes", slot, macro->len);
+    return ESP_OK;
+}
+
+static esp_err_t send_macro_command(hidra_device_handle_t device, uint8_t reg, uint8_t slot, int timeout_ms)
+{
+    if (!device) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t buffer[2] = {reg, slot};
+    esp_err_t ret = i2c_master_transmit(device, buffer, sizeof(buffer), timeout_ms);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to send macro command 0x%02X: %s", reg, esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t hidra_macro_play(hidra_device_handle_t device, uint8_t slot, int timeout_ms)
+{
+    if (slot >= MACRO_SLOT_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return send_macro_command(device, MACRO_PLAY_REG, slot, timeout_ms);
+}
+
+esp_err_t hidra_macro_stop(hidra_device_handle_t device, int timeout_ms)
+{
+    return send_macro_command(device, MACRO_PLAY_REG, MACRO_STOP, timeout_ms);
+}
+
+esp_err_t hidra_macro_save(hidra_device_handle_t device, uint8_t slot, int timeout_ms)
+{
+    if (slot >= MACRO_SLOT_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return send_macro_command(device, MACRO_SAVE_REG, slot, timeout_ms);
+}
+
+esp_err_t hidra_parse_macro_status(const uint8_t* block, size_t len, hidra_macro_status_t* status_out)
+{
+    if (!block || !status_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len < MACRO_STATUS_SIZE || block[0] > MACRO_STATE_FAILED) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    status_out->state = block[0];
+    status_out->slot = block[1];
+    status_out->position = block[2] | (block[3] << 8);
+    status_out->length = block[4] | (block[5] << 8);
+    status_out->reports = block[6] | (block[7] << 8);
+    return ESP_OK;
+}
+
+esp_err_t hidra_read_macro_status(hidra_device_handle_t device, hidra_macro_status_t* status_out, int timeout_ms)
+{
+    if (!device || !status_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t reg_addr = MACRO_STATUS_REG;
+    uint8_t block[MACRO_STATUS_SIZE];
+    esp_err_t ret = i2c_master_transmit_receive(device, &reg_addr, 1, block, sizeof(block), timeout_ms);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read macro status: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = hidra_parse_macro_status(block, sizeof(block), status_out);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Malformed macro status (state %d)", block[0]);
+    }
+    return ret;
+}
+
+void hidra_clock_init(hidra_clock_t* clock)
+{
+    if (clock) {
+        memset(clock, 0, sizeof(*clock));
+    }
+}
+
+void hidra_clock_add_sample(hidra_clock_t* clock, int64_t master_before_us, int64_t master_after_us, int64_t slave_us)
+{
+    if (!clock || master_after_us < master_before_us) {
+        return;
+    }
+
+    // The slave sampled somewhere inside the round trip: assume the middle,
+    // and trust the shortest round trip most
+    int64_t half_rtt = (master_after_us - master_before_us + 1) / 2;
+    if (clock->samples == 0 || half_rtt < clock->uncertainty_us) {
+        clock->offset_us = slave_us - (master_before_us + half_rtt);
+        clock->uncertainty_us = half_rtt;
+    }
+    clock->samples++;
+}
+
+uint32_t hidra_clock_to_slave(const hidra_clock_t* clock, int64_t master_us)
+{
+    return (uint32_t)(master_us + (clock ? clock->offset_us : 0));
+}
+
+esp_err_t hidra_clock_sync(hidra_device_handle_t device, size_t rounds, hidra_clock_t* clock_out, int timeout_ms)
+{
+    if (!device || rounds == 0 || !clock_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    hidra_clock_init(clock_out);
+    uint8_t reg_addr = CLOCK_REG;
+    esp_err_t ret = ESP_OK;
+    for (size_t i = 0; i < rounds; i++) {
+        uint8_t block[CLOCK_SIZE];
+        int64_t before_us = esp_timer_get_time();
+        ret = i2c_master_transmit_receive(device, &reg_addr, 1, block, sizeof(block), timeout_ms);
+        int64_t after_us = esp_timer_get_time();
+        if (ret != ESP_OK) {
+            // A lost round only costs precision
+            continue;
+        }
+
+        uint64_t slave_us = 0;
+        for (int b = CLOCK_SIZE - 1; b >= 0; b--) {
+            slave_us = (slave_us << 8) | block[b];
+        }
+        hidra_clock_add_sample(clock_out, before_us, after_us, (int64_t)slave_us);
+    }
+
+    if (clock_out->samples == 0) {
+        ESP_LOGE(TAG, "Failed to read slave clock: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ESP_LOGD(TAG, "Slave clock offset %lld us +/- %lld us (%d samples)",
+             (long long)clock_out->offset_us, (long long)clock_out->uncertainty_us, (int)clock_out->samples);
+    return ESP_OK;
+}
+
+esp_err_t hidra_schedule_report(hidra_device_handle_t device, uint32_t slave_time_us, uint8_t hid_register, const uint8_t* report, size_t report_size, int timeout_ms)
+{
+    if (!device || !report || report_size == 0 || report_size > MAX_REPORT_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t buffer[1 + SCHEDULE_HEADER_SIZE + MAX_REPORT_SIZE];
+    buffer[0] = SCHEDULE_REG;
+    buffer[1] = slave_time_us & 0xFF;
+    buffer[2] = (slave_time_us >> 8) & 0xFF;
+    buffer[3] = (slave_time_us >> 16) & 0xFF;
+    buffer[4] = (slave_time_us >> 24) & 0xFF;
+    buffer[5] = hid_register;
+    memcpy(&buffer[1 + SCHEDULE_HEADER_SIZE], report, report_size);
+
+    esp_err_t ret = i2c_master_transmit(device, buffer, 1 + SCHEDULE_HEADER_SIZE + report_size, timeout_ms);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to schedule HID report: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t hidra_schedule_clear(hidra_device_handle_t device, int timeout_ms)
+{
+    if (!device) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t buffer[2] = {SCHEDULE_REG, 0};
+    esp_err_t ret = i2c_master_transmit(device, buffer, sizeof(buffer), timeout_ms);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to clear scheduled reports: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t hidra_stage_report(hidra_device_handle_t device, uint8_t hid_register, const uint8_t* report, size_t report_size, int timeout_ms)
+{
+    if (!device || !report || report_size == 0 || report_size > MAX_REPORT_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t buffer[2 + MAX_REPORT_SIZE];
+    buffer[0] = STAGE_REG;
+    buffer[1] = hid_register;
+    memcpy(&buffer[2], report, report_size);
+
+    esp_err_t ret = i2c_master_transmit(device, buffer, 2 + report_size, timeout_ms);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to stage HID report: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t hidra_stage_clear(hidra_device_handle_t device, int timeout_ms)
+{
+    if (!device) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t buffer[2] = {STAGE_REG, 0};
+    esp_err_t ret = i2c_master_transmit(device, buffer, sizeof(buffer), timeout_ms);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to clear staged reports: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t hidra_latch(hidra_device_handle_t device, int timeout_ms)
+{
+    if (!device) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t buffer[2] = {LATCH_REG, 0};
+    esp_err_t ret = i2c_master_transmit(device, buffer, sizeof(buffer), timeout_ms);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to latch staged reports: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
 esp_err_t hidra_set_composite_device_config(hidra_device_handle_t device, uint16_t device_bitmap, int timeout_ms)
 {
     if (!device) {
@@ -162,12 +964,13 @@ esp_err_t hidra_set_usb_string(hidra_device_handle_t device, uint8_t config_regi
         return ESP_ERR_INVALID_SIZE;
     }
 
-    uint8_t buffer[MAX_STRING_LENGTH + 2];
+    // Sent without the terminator: the slave takes at most MAX_STRING_LENGTH
+    // bytes and terminates the string itself
+    uint8_t buffer[MAX_STRING_LENGTH + 1];
     buffer[0] = config_register;
     memcpy(&buffer[1], str, str_len);
-    buffer[str_len + 1] = '\0'; // Null terminator
 
-    esp_err_t ret = i2c_master_transmit(device, buffer, str_len + 2, timeout_ms);
+    esp_err_t ret = i2c_master_transmit(device, buffer, str_len + 1, timeout_ms);
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "Set USB string (reg 0x%02X): %s", config_register, str);
     } else {
@@ -176,9 +979,40 @@ esp_err_t hidra_set_usb_string(hidra_device_handle_t device, uint8_t config_regi
     return ret;
 }
 
+esp_err_t hidra_set_poll_interval(hidra_device_handle_t device, uint8_t hid_register, uint8_t interval_ms, int timeout_ms)
+{
+    if (!device || interval_ms == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t buffer[3] = {CONFIG_POLL_INTERVAL_REG, hid_register, interval_ms};
+    esp_err_t ret = i2c_master_transmit(device, buffer, sizeof(buffer), timeout_ms);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Set poll interval of register 0x%02X: %d ms", hid_register, interval_ms);
+    } else {
+        ESP_LOGE(TAG, "Failed to set poll interval: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+// The slave answers again once it has recreated its I2C device or rebuilt USB
+static esp_err_t read_status_retrying(hidra_device_handle_t device, uint8_t* status_out, int timeout_ms)
+{
+    esp_err_t ret = ESP_FAIL;
+    for (int attempt = 0; attempt < READDRESS_ATTEMPTS; attempt++) {
+        vTaskDelay(pdMS_TO_TICKS(READDRESS_RETRY_MS));
+        ret = hidra_read_status(device, status_out, timeout_ms);
+        if (ret == ESP_OK) {
+            break;
+        }
+    }
+    return ret;
+}
+
 esp_err_t hidra_reconfigure_address(hidra_device_handle_t* device_handle_ptr, uint8_t new_address, int timeout_ms)
 {
-    if (!device_handle_ptr || !*device_handle_ptr) {
+    // 7-bit addresses outside 0x08-0x77 are reserved; the slave refuses them
+    if (!device_handle_ptr || !*device_handle_ptr || new_address < 0x08 || new_address > 0x77) {
         return ESP_ERR_INVALID_ARG;
     }
 
@@ -195,17 +1029,151 @@ esp_err_t hidra_reconfigure_address(hidra_device_handle_t* device_handle_ptr, ui
         return ret;
     }
 
-    // Wait for device to reboot (typical reboot time)
-    vTaskDelay(pdMS_TO_TICKS(1000));
+    // The slave re-addresses in place without rebooting: follow it with the same handle
+    ret = i2c_master_device_change_address(old_device, new_address, timeout_ms);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to move device handle to 0x%02X: %s", new_address, esp_err_to_name(ret));
+        return ret;
+    }
 
-    // Note: Cannot retrieve bus handle from device in ESP-IDF v5.5
-    // User must provide the bus handle for re-adding the device
-    ESP_LOGW(TAG, "Device address change sent. Device should reboot with new address 0x%02X", new_address);
-    ESP_LOGW(TAG, "Please remove and re-add device with new address using hidra_add_device_to_bus()");
-    
-    // Remove old device
-    hidra_remove_device_from_bus(old_device);
-    *device_handle_ptr = NULL;
+    // The status of the address change is read from the new address
+    uint8_t status = 0;
+    ret = read_status_retrying(old_device, &status, timeout_ms);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (!(status & STATUS_OK)) {
+        ESP_LOGE(TAG, "Device rejected address 0x%02X, status: 0x%02X", new_address, status);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    ESP_LOGI(TAG, "Device now at address 0x%02X", new_address);
+    return ESP_OK;
+}
+
+void hidra_config_txn_init(hidra_config_txn_t* txn)
+{
+    if (txn) {
+        memset(txn, 0, sizeof(*txn));
+    }
+}
+
+static esp_err_t txn_add(hidra_config_txn_t* txn, uint8_t config_register, const uint8_t* payload, size_t len)
+{
+    if (!txn) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (txn->error != ESP_OK) {
+        return txn->error;
+    }
+    if (txn->count >= HIDRA_CONFIG_TXN_MAX_WRITES) {
+        txn->error = ESP_ERR_NO_MEM;
+        return txn->error;
+    }
+
+    uint8_t* write = txn->writes[txn->count];
+    write[0] = config_register;
+    memcpy(&write[1], payload, len);
+    txn->lengths[txn->count++] = len + 1;
+    return ESP_OK;
+}
+
+static esp_err_t txn_fail(hidra_config_txn_t* txn, esp_err_t err)
+{
+    if (txn && txn->error == ESP_OK) {
+        txn->error = err;
+    }
+    return txn ? txn->error : err;
+}
+
+esp_err_t hidra_config_txn_set_composite_device_config(hidra_config_txn_t* txn, uint16_t device_bitmap)
+{
+    uint8_t payload[2] = {device_bitmap & 0xFF, (device_bitmap >> 8) & 0xFF};
+    return txn_add(txn, CONFIG_COMPOSITE_DEVICE_REG, payload, sizeof(payload));
+}
+
+esp_err_t hidra_config_txn_set_usb_ids(hidra_config_txn_t* txn, uint16_t vid, uint16_t pid)
+{
+    uint8_t payload[4] = {vid & 0xFF, (vid >> 8) & 0xFF, pid & 0xFF, (pid >> 8) & 0xFF};
+    return txn_add(txn, CONFIG_USB_IDS_REG, payload, sizeof(payload));
+}
+
+esp_err_t hidra_config_txn_set_usb_string(hidra_config_txn_t* txn, uint8_t config_register, const char* str)
+{
+    if (!str || (config_register != CONFIG_MANUFACTURER_STR_REG && config_register != CONFIG_PRODUCT_STR_REG &&
+                 config_register != CONFIG_SERIAL_STR_REG)) {
+        return txn_fail(txn, ESP_ERR_INVALID_ARG);
+    }
+    size_t str_len = strlen(str);
+    if (str_len > MAX_STRING_LENGTH) {
+        return txn_fail(txn, ESP_ERR_INVALID_SIZE);
+    }
+    // Same framing as hidra_set_usb_string, without the terminator
+    return txn_add(txn, config_register, (const uint8_t*)str, str_len);
+}
+
+esp_err_t hidra_config_txn_set_poll_interval(hidra_config_txn_t* txn, uint8_t hid_register, uint8_t interval_ms)
+{
+    if (interval_ms == 0) {
+        return txn_fail(txn, ESP_ERR_INVALID_ARG);
+    }
+    uint8_t payload[2] = {hid_register, interval_ms};
+    return txn_add(txn, CONFIG_POLL_INTERVAL_REG, payload, sizeof(payload));
+}
+
+esp_err_t hidra_config_txn_set_irq_gpio(hidra_config_txn_t* txn, uint8_t gpio)
+{
+    return txn_add(txn, CONFIG_IRQ_GPIO_REG, &gpio, 1);
+}
+
+esp_err_t hidra_config_txn_send(hidra_device_handle_t device, const hidra_config_txn_t* txn, int timeout_ms)
+{
+    if (!device || !txn) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (txn->error != ESP_OK) {
+        return txn->error;
+    }
+
+    // Control registers need a payload byte; its value is ignored
+    uint8_t begin[2] = {CONFIG_BEGIN_REG, 0};
+    esp_err_t ret = i2c_master_transmit(device, begin, sizeof(begin), timeout_ms);
+    for (size_t i = 0; ret == ESP_OK && i < txn->count; i++) {
+        ret = i2c_master_transmit(device, txn->writes[i], txn->lengths[i], timeout_ms);
+    }
+    if (ret != ESP_OK) {
+        // Best effort: leave no half-built transaction on the slave
+        uint8_t abort_cmd[2] = {CONFIG_ABORT_REG, 0};
+        i2c_master_transmit(device, abort_cmd, sizeof(abort_cmd), timeout_ms);
+        ESP_LOGE(TAG, "Failed to send configuration transaction: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    uint8_t commit[2] = {CONFIG_COMMIT_REG, 0};
+    ret = i2c_master_transmit(device, commit, sizeof(commit), timeout_ms);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to commit configuration: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t hidra_config_txn_commit(hidra_device_handle_t device, const hidra_config_txn_t* txn, int timeout_ms)
+{
+    esp_err_t ret = hidra_config_txn_send(device, txn, timeout_ms);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    uint8_t status = 0;
+    ret = read_status_retrying(device, &status, timeout_ms);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (!(status & STATUS_OK)) {
+        ESP_LOGE(TAG, "Device rejected configuration, status: 0x%02X", status);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
 
+    ESP_LOGI(TAG, "Committed %zu configuration writes", txn->count);
     return ESP_OK;
 }
@@ -9,6 +9,115 @@
 typedef i2c_master_bus_handle_t hidra_bus_handle_t;
 typedef i2c_master_dev_handle_t hidra_device_handle_t;
 
+// SCL clock per device. Fast-mode Plus needs strong external pull-ups.
+typedef enum {
+    HIDRA_SPEED_STANDARD  = 100000,   // Standard-mode, 100 kHz
+    HIDRA_SPEED_FAST      = 400000,   // Fast-mode, 400 kHz
+    HIDRA_SPEED_FAST_PLUS = 1000000,  // Fast-mode Plus, 1 MHz
+} hidra_bus_speed_t;
+
+// One record of a batch write
+typedef struct {
+    uint8_t hid_register;
+    const uint8_t* report;
+    size_t report_size;
+} hidra_report_t;
+
+// Extended status snapshot (EXT_STATUS_REG)
+typedef struct {
+    uint8_t hid_register;
+    uint8_t queued;          // Reports waiting for the host (mouse: button-state segments)
+    uint8_t free_slots;      // Reports the interface can still take before ERROR_QUEUE_FULL
+} hidra_interface_status_t;
+
+typedef struct {
+    bool usb_mounted;
+    bool usb_suspended;
+    uint8_t last_error;      // Error bits of the last failed command, kept across status reads
+    uint32_t dropped;        // Reports dropped on full queues since boot, all interfaces
+    uint8_t interface_count;
+    hidra_interface_status_t interfaces[EXT_STATUS_MAX_INTERFACES];
+} hidra_ext_status_t;
+
+// Latest report the host sent to one interface (OUTPUT_REPORTS_REG)
+typedef struct {
+    uint8_t hid_register;
+    uint8_t report_type;     // OUTPUT_REPORT_TYPE_OUTPUT or OUTPUT_REPORT_TYPE_FEATURE
+    uint8_t report_id;       // The interface's own report ID, 0 if it has none
+    uint8_t length;          // Bytes in data, 0 if the host has sent nothing yet
+    uint8_t data[OUTPUT_REPORT_DATA_SIZE];
+} hidra_output_report_t;
+
+typedef struct {
+    uint16_t change_count;   // Steps whenever any entry changes
+    uint8_t interface_count;
+    hidra_output_report_t interfaces[EXT_STATUS_MAX_INTERFACES];
+} hidra_output_reports_t;
+
+// Configuration transaction: writes collected on the master, sent between
+// CONFIG_BEGIN_REG and CONFIG_COMMIT_REG so the slave applies them once
+#define HIDRA_CONFIG_TXN_MAX_WRITES 12
+
+typedef struct {
+    uint8_t writes[HIDRA_CONFIG_TXN_MAX_WRITES][MAX_STRING_LENGTH + 2];  // Register + payload
+    uint8_t lengths[HIDRA_CONFIG_TXN_MAX_WRITES];
+    size_t count;
+    esp_err_t error;         // First builder error; commit refuses to send
+} hidra_config_txn_t;
+
+// Macro script built on the master (MACRO_OP_* steps). Each builder call
+// appends one step and returns the first error again on later calls.
+typedef struct {
+    uint8_t script[MACRO_SLOT_SIZE];
+    size_t len;
+    uint8_t depth;           // Repeat blocks still open
+    size_t keymap_step;      // Offset of a trailing MACRO_OP_KEYMAP step, or SIZE_MAX
+    esp_err_t error;
+} hidra_macro_t;
+
+// Playback progress (MACRO_STATUS_REG)
+typedef struct {
+    uint8_t state;           // MACRO_STATE_*
+    uint8_t slot;
+    uint16_t position;       // Script offset being played, or of the failing step
+    uint16_t length;         // Script length
+    uint16_t reports;        // Reports queued so far
+} hidra_macro_status_t;
+
+// Offset of a slave's esp_timer clock against the master's, from the read
+// with the shortest round trip
+typedef struct {
+    int64_t offset_us;       // Slave time minus master time
+    int64_t uncertainty_us;  // Half that round trip; the offset is within +/- this
+    size_t samples;
+} hidra_clock_t;
+
+// Where the queued-submission helpers (hidra_async.h, hidra_fleet.h) send
+// their transactions. Same calls as the I2C master driver; NULL in their
+// configuration selects it. A test or a bridge to another bus passes its own.
+typedef struct {
+    esp_err_t (*transmit)(hidra_device_handle_t device, const uint8_t* data, size_t len, int timeout_ms);
+    esp_err_t (*transmit_receive)(hidra_device_handle_t device, const uint8_t* data, size_t len,
+                                  uint8_t* read_buffer, size_t read_len, int timeout_ms);
+} hidra_transport_t;
+
+// Called from the task that writes a queued report (hidra_async.h,
+// hidra_fleet.h) once the write carrying it is done. status is the slave
+// status read after the write (0 if read_status is off); it covers every
+// report of that write.
+typedef void (*hidra_report_done_cb_t)(esp_err_t result, uint8_t status, void* ctx);
+
+// Queued reports collected into one write. The report bytes are not copied:
+// they must stay put until the batch is sent.
+// Smallest records are one report byte, so this many always fit.
+#define HIDRA_REPORT_BATCH_MAX_REPORTS (MAX_BATCH_SIZE / (BATCH_RECORD_HEADER_SIZE + 1))
+
+typedef struct {
+    hidra_report_t reports[HIDRA_REPORT_BATCH_MAX_REPORTS];
+    size_t count;
+    size_t size;             // Batch payload bytes, record headers included
+} hidra_report_batch_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -18,19 +127,159 @@ esp_err_t hidra_master_bus_init(i2c_port_num_t i2c_port, int sda_io_num, int scl
 esp_err_t hidra_master_bus_deinit(hidra_bus_handle_t bus_handle);
 
 // --- Device Management ---
+// Standard-mode (100 kHz)
 esp_err_t hidra_add_device_to_bus(hidra_bus_handle_t bus_handle, uint8_t i2c_address, hidra_device_handle_t* device_handle_out);
+esp_err_t hidra_add_device_to_bus_with_speed(hidra_bus_handle_t bus_handle, uint8_t i2c_address, hidra_bus_speed_t speed, hidra_device_handle_t* device_handle_out);
+// Add the device at the highest speed up to max_speed that gives clean status
+// reads, stepping down one speed at a time. Reading status clears it.
+esp_err_t hidra_add_device_probed(hidra_bus_handle_t bus_handle, uint8_t i2c_address, hidra_bus_speed_t max_speed, hidra_device_handle_t* device_handle_out, hidra_bus_speed_t* speed_out);
 esp_err_t hidra_remove_device_from_bus(hidra_device_handle_t device_handle);
 
 // --- HID Reporting & Status ---
 esp_err_t hidra_send_generic_report(hidra_device_handle_t device, uint8_t hid_register, const uint8_t* report, size_t report_size, int timeout_ms);
+// Send reports for several interfaces in one write; one status covers the batch.
+// Only HID input registers; at most MAX_BATCH_SIZE bytes including 2 bytes per record.
+esp_err_t hidra_send_batch(hidra_device_handle_t device, const hidra_report_t* reports, size_t count, int timeout_ms);
 esp_err_t hidra_read_status(hidra_device_handle_t device, uint8_t* status_out, int timeout_ms);
 
+// Collect queued reports into as few writes as possible. add returns false
+// once the report would not fit in the same write; the batch is unchanged.
+void hidra_report_batch_init(hidra_report_batch_t* batch);
+bool hidra_report_batch_add(hidra_report_batch_t* batch, uint8_t hid_register, const uint8_t* report, size_t report_size);
+// One write: a lone report goes to its own register, saving the record
+// header; several go out as one HIDRA_REG_BATCH write. Then the status is
+// read into status_out, unless it is NULL. transport NULL: the I2C bus.
+esp_err_t hidra_report_batch_send(const hidra_transport_t* transport, hidra_device_handle_t device,
+                                  const hidra_report_batch_t* batch, uint8_t* status_out, int timeout_ms);
+// hidra_read_status() through transport (NULL: the I2C bus)
+esp_err_t hidra_transport_read_status(const hidra_transport_t* transport, hidra_device_handle_t device,
+                                      uint8_t* status_out, int timeout_ms);
+// Queue depths, USB state and error history in one read; nothing is cleared
+esp_err_t hidra_read_extended_status(hidra_device_handle_t device, hidra_ext_status_t* status_out, int timeout_ms);
+esp_err_t hidra_parse_extended_status(const uint8_t* block, size_t len, hidra_ext_status_t* status_out);
+// Free slots of the interface behind hid_register, or -1 if the slave has no such interface
+int hidra_ext_status_free_slots(const hidra_ext_status_t* status, uint8_t hid_register);
+
+// Read every interface's latest host output report (keyboard LEDs, feature
+// reports) in one transfer. reports holds the previous snapshot (zeroed
+// before the first call); *changed_out is false if its change counter is
+// unchanged. changed_out may be NULL.
+esp_err_t hidra_read_output_reports(hidra_device_handle_t device, hidra_output_reports_t* reports, bool* changed_out, int timeout_ms);
+esp_err_t hidra_parse_output_reports(const uint8_t* block, size_t len, hidra_output_reports_t* reports_out);
+// Entry of the interface behind hid_register, NULL if the slave has none
+const hidra_output_report_t* hidra_find_output_report(const hidra_output_reports_t* reports, uint8_t hid_register);
+
+// --- Key Events ---
+// The slave keeps the keyboard state; usage is a Keyboard/Keypad page usage (modifiers 0xE0-0xE7)
+esp_err_t hidra_key_press(hidra_device_handle_t device, uint8_t usage, int timeout_ms);
+esp_err_t hidra_key_release(hidra_device_handle_t device, uint8_t usage, int timeout_ms);
+
+// --- N-Key Rollover Keyboard ---
+// Up to MAX_REPORT_SIZE - 1 usages per call; each call is one I2C write and one USB report
+esp_err_t hidra_nkro_press(hidra_device_handle_t device, const uint8_t* usages, size_t count, int timeout_ms);
+esp_err_t hidra_nkro_release(hidra_device_handle_t device, const uint8_t* usages, size_t count, int timeout_ms);
+// Release every key, then press the given chord (count 0 releases all)
+esp_err_t hidra_nkro_set_chord(hidra_device_handle_t device, const uint8_t* usages, size_t count, int timeout_ms);
+
+// --- Multi-Touch ---
+// One finger of a touch frame; flags are TOUCH_CONTACT_*. Coordinates run
+// 0..TOUCH_LOGICAL_MAX.
+typedef struct {
+    uint8_t id;
+    uint8_t flags;
+    uint16_t x;
+    uint16_t y;
+} hidra_touch_contact_t;
+
+// Send one complete frame (up to TOUCH_MAX_CONTACTS contacts) to
+// HIDRA_REG_TOUCHSCREEN or HIDRA_REG_TOUCHPAD in a single write. A lifted
+// finger is sent once without TOUCH_CONTACT_TIP; button is the touchpad click.
+esp_err_t hidra_send_touch_frame(hidra_device_handle_t device, uint8_t hid_register, const hidra_touch_contact_t* contacts, size_t count, bool button, int timeout_ms);
+
+// --- Macros ---
+// A script is uploaded once and played by the slave at the USB polling
+// rate: typing 500 characters is one upload and one play write instead of
+// 1,000 report writes.
+void hidra_macro_init(hidra_macro_t* macro);
+esp_err_t hidra_macro_add_report(hidra_macro_t* macro, uint8_t hid_register, const uint8_t* report, size_t report_size);
+esp_err_t hidra_macro_add_delay(hidra_macro_t* macro, uint16_t delay_ms);
+// Steps up to the matching hidra_macro_end_repeat() run count (1-255) times
+esp_err_t hidra_macro_begin_repeat(hidra_macro_t* macro, uint8_t count);
+esp_err_t hidra_macro_end_repeat(hidra_macro_t* macro);
+// Typed on the boot keyboard through the slave's layout table
+esp_err_t hidra_macro_add_text(hidra_macro_t* macro, const char* text);
+// Change the layout table for the rest of the playback (usage 0 skips the character)
+esp_err_t hidra_macro_map_character(hidra_macro_t* macro, char character, uint8_t usage, uint8_t modifiers);
+// Replace the script in a slot and check the status once. An empty macro
+// clears the slot. ESP_ERR_INVALID_RESPONSE if the slave rejected it, e.g.
+// because the slot is playing.
+esp_err_t hidra_macro_upload(hidra_device_handle_t device, uint8_t slot, const hidra_macro_t* macro, int timeout_ms);
+// Start (or restart) playback; completion raises IRQ_CAUSE_MACRO_DONE
+esp_err_t hidra_macro_play(hidra_device_handle_t device, uint8_t slot, int timeout_ms);
+esp_err_t hidra_macro_stop(hidra_device_handle_t device, int timeout_ms);
+// Keep the slot across restarts (NVS); saving an empty slot erases it
+esp_err_t hidra_macro_save(hidra_device_handle_t device, uint8_t slot, int timeout_ms);
+esp_err_t hidra_read_macro_status(hidra_device_handle_t device, hidra_macro_status_t* status_out, int timeout_ms);
+esp_err_t hidra_parse_macro_status(const uint8_t* block, size_t len, hidra_macro_status_t* status_out);
+
+// --- Scheduled Reports ---
+// Reports stamped with the slave time they are due at leave the slave in the
+// first USB frame after that time, so their spacing does not depend on when
+// the master got the bus. Crystal drift is tens of microseconds per second:
+// sync again every few seconds during a long replay.
+// Read the slave clock rounds times and keep the best estimate
+esp_err_t hidra_clock_sync(hidra_device_handle_t device, size_t rounds, hidra_clock_t* clock_out, int timeout_ms);
+void hidra_clock_init(hidra_clock_t* clock);
+// Fold in one read: master_before_us and master_after_us bracket the
+// transfer that returned slave_us
+void hidra_clock_add_sample(hidra_clock_t* clock, int64_t master_before_us, int64_t master_after_us, int64_t slave_us);
+// Slave time, as SCHEDULE_REG takes it, of a master esp_timer time
+uint32_t hidra_clock_to_slave(const hidra_clock_t* clock, int64_t master_us);
+// Queue a whole report for slave_time_us (at most SCHEDULE_MAX_LEAD_US ahead).
+// Status ERROR_QUEUE_FULL when SCHEDULE_DEPTH reports are pending.
+esp_err_t hidra_schedule_report(hidra_device_handle_t device, uint32_t slave_time_us, uint8_t hid_register, const uint8_t* report, size_t report_size, int timeout_ms);
+// Drop every report still pending
+esp_err_t hidra_schedule_clear(hidra_device_handle_t device, int timeout_ms);
+
+// --- Staged Reports ---
+// Staged reports wait on the slave until a latch releases them together, in
+// the next USB frame. Staging costs bus time, the latch does not: latch
+// several slaves with hidra_broadcast_latch() to line up their output.
+// Up to STAGE_SIZE bytes, 2 per report plus the report; status
+// ERROR_QUEUE_FULL once full. Any register a batch may carry.
+esp_err_t hidra_stage_report(hidra_device_handle_t device, uint8_t hid_register, const uint8_t* report, size_t report_size, int timeout_ms);
+esp_err_t hidra_stage_clear(hidra_device_handle_t device, int timeout_ms);
+// Release this slave's staged reports; the status covers all of them
+esp_err_t hidra_latch(hidra_device_handle_t device, int timeout_ms);
+
 // --- Device Configuration ---
+// Changes are saved to NVS and applied live: USB settings re-enumerate the
+// slave (a 100 ms detach plus host enumeration) instead of rebooting it
 esp_err_t hidra_set_composite_device_config(hidra_device_handle_t device, uint16_t device_bitmap, int timeout_ms);
 esp_err_t hidra_set_usb_ids(hidra_device_handle_t device, uint16_t vid, uint16_t pid, int timeout_ms);
 esp_err_t hidra_set_usb_string(hidra_device_handle_t device, uint8_t config_register, const char* str, int timeout_ms);
+// USB polling interval (bInterval, 1-255 ms) of the interface behind hid_register
+esp_err_t hidra_set_poll_interval(hidra_device_handle_t device, uint8_t hid_register, uint8_t interval_ms, int timeout_ms);
+// The handle follows the slave to new_address and stays valid
 esp_err_t hidra_reconfigure_address(hidra_device_handle_t* device_handle_ptr, uint8_t new_address, int timeout_ms);
 
+// --- Configuration Transactions ---
+// Several settings, one re-enumeration and one NVS write. The setters only
+// record writes and return the first error again on later calls.
+void hidra_config_txn_init(hidra_config_txn_t* txn);
+esp_err_t hidra_config_txn_set_composite_device_config(hidra_config_txn_t* txn, uint16_t device_bitmap);
+esp_err_t hidra_config_txn_set_usb_ids(hidra_config_txn_t* txn, uint16_t vid, uint16_t pid);
+esp_err_t hidra_config_txn_set_usb_string(hidra_config_txn_t* txn, uint8_t config_register, const char* str);
+esp_err_t hidra_config_txn_set_poll_interval(hidra_config_txn_t* txn, uint8_t hid_register, uint8_t interval_ms);
+// IRQ_GPIO_DISABLED turns the interrupt line off
+esp_err_t hidra_config_txn_set_irq_gpio(hidra_config_txn_t* txn, uint8_t gpio);
+// Send the transaction and read its status once. ESP_ERR_INVALID_RESPONSE if
+// the slave rejected it, in which case nothing was changed. Address changes
+// stay with hidra_reconfigure_address, which moves the handle.
+esp_err_t hidra_config_txn_commit(hidra_device_handle_t device, const hidra_config_txn_t* txn, int timeout_ms);
+// Send the transaction without reading the status (hidra_broadcast.h)
+esp_err_t hidra_config_txn_send(hidra_device_handle_t device, const hidra_config_txn_t* txn, int timeout_ms);
+
 #ifdef __cplusplus
 }
 #endif
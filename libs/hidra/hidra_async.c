@@ -0,0 +1,185 @@
+#include "hidra_async.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "hidra_async";
+
+#define ASYNC_TASK_STACK    3072
+
+typedef struct {
+    uint8_t hid_register;
+    uint8_t len;                 // 0 asks the flush task to stop
+    uint8_t report[MAX_REPORT_SIZE];
+    hidra_async_done_cb_t done_cb;
+    void *ctx;
+} async_entry_t;
+
+struct hidra_async {
+    hidra_device_handle_t device;
+    hidra_async_config_t config;
+    QueueHandle_t queue;
+    SemaphoreHandle_t stopped;
+    atomic_uint pending;         // Submitted but not yet completed
+    hidra_async_stats_t stats;   // Written by the flush task only
+    async_entry_t entries[HIDRA_REPORT_BATCH_MAX_REPORTS];    // Reports of the write in progress
+    hidra_report_batch_t batch;
+};
+
+static void write_batch(hidra_async_handle_t handle)
+{
+    size_t count = handle->batch.count;
+    uint8_t status = 0;
+    esp_err_t ret = hidra_report_batch_send(handle->config.transport, handle->device, &handle->batch,
+                                            handle->config.read_status ? &status : NULL, handle->config.timeout_ms);
+
+    handle->stats.writes++;
+    handle->stats.reports += count;
+    if (ret != ESP_OK) {
+        handle->stats.errors++;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (handle->entries[i].done_cb) {
+            handle->entries[i].done_cb(ret, status, handle->entries[i].ctx);
+        }
+    }
+    atomic_fetch_sub(&handle->pending, count);
+}
+
+static void flush_task(void *arg)
+{
+    hidra_async_handle_t handle = arg;
+
+    while (1) {
+        // Sleep until there is something to write
+        xQueueReceive(handle->queue, &handle->entries[0], portMAX_DELAY);
+        if (handle->entries[0].len == 0) {
+            break;
+        }
+        hidra_report_batch_init(&handle->batch);
+        hidra_report_batch_add(&handle->batch, handle->entries[0].hid_register, handle->entries[0].report, handle->entries[0].len);
+
+        // Take whatever else is already queued, as long as it fits in the same write
+        while (handle->batch.count < HIDRA_REPORT_BATCH_MAX_REPORTS &&
+               xQueuePeek(handle->queue, &handle->entries[handle->batch.count], 0) == pdTRUE) {
+            async_entry_t *next = &handle->entries[handle->batch.count];
+            if (next->len == 0 || !hidra_report_batch_add(&handle->batch, next->hid_register, next->report, next->len)) {
+                break;
+            }
+            xQueueReceive(handle->queue, next, 0);
+        }
+
+        write_batch(handle);
+    }
+
+    xSemaphoreGive(handle->stopped);
+    vTaskDelete(NULL);
+}
+
+esp_err_t hidra_async_create(hidra_device_handle_t device, const hidra_async_config_t* config, hidra_async_handle_t* handle_out)
+{
+    if (!device || !config || !handle_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    hidra_async_handle_t handle = calloc(1, sizeof(*handle));
+    if (!handle) {
+        return ESP_ERR_NO_MEM;
+    }
+    handle->device = device;
+    handle->config = *config;
+    if (handle->config.queue_depth == 0) {
+        handle->config.queue_depth = HIDRA_ASYNC_DEFAULT_DEPTH;
+    }
+    atomic_init(&handle->pending, 0);
+
+    handle->queue = xQueueCreate(handle->config.queue_depth, sizeof(async_entry_t));
+    handle->stopped = xSemaphoreCreateBinary();
+    if (!handle->queue || !handle->stopped ||
+        xTaskCreate(flush_task, "hidra_flush", ASYNC_TASK_STACK, handle, handle->config.task_priority, NULL) != pdPASS) {
+        if (handle->queue) {
+            vQueueDelete(handle->queue);
+        }
+        if (handle->stopped) {
+            vSemaphoreDelete(handle->stopped);
+        }
+        free(handle);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Async submission started, queue depth %u", (unsigned)handle->config.queue_depth);
+    *handle_out = handle;
+    return ESP_OK;
+}
+
+esp_err_t hidra_async_delete(hidra_async_handle_t handle)
+{
+    if (!handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Queued behind any pending reports, so those are still written
+    const async_entry_t stop = {0};
+    xQueueSend(handle->queue, &stop, portMAX_DELAY);
+    xSemaphoreTake(handle->stopped, portMAX_DELAY);
+
+    vSemaphoreDelete(handle->stopped);
+    vQueueDelete(handle->queue);
+    free(handle);
+    return ESP_OK;
+}
+
+esp_err_t hidra_async_submit(hidra_async_handle_t handle, uint8_t hid_register, const uint8_t* report, size_t report_size,
+                             hidra_async_done_cb_t done_cb, void* ctx)
+{
+    if (!handle || !report || report_size == 0 || report_size > MAX_REPORT_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    async_entry_t entry = {
+        .hid_register = hid_register,
+        .len = (uint8_t)report_size,
+        .done_cb = done_cb,
+        .ctx = ctx,
+    };
+    memcpy(entry.report, report, report_size);
+
+    atomic_fetch_add(&handle->pending, 1);
+    if (xQueueSend(handle->queue, &entry, 0) != pdTRUE) {
+        atomic_fetch_sub(&handle->pending, 1);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t hidra_async_flush(hidra_async_handle_t handle, int timeout_ms)
+{
+    if (!handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    while (atomic_load(&handle->pending) > 0) {
+        if ((xTaskGetTickCount() - start) >= pdMS_TO_TICKS(timeout_ms)) {
+            return ESP_ERR_TIMEOUT;
+        }
+        vTaskDelay(1);
+    }
+    return ESP_OK;
+}
+
+esp_err_t hidra_async_get_stats(hidra_async_handle_t handle, hidra_async_stats_t* stats_out)
+{
+    if (!handle || !stats_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *stats_out = handle->stats;
+    return ESP_OK;
+}
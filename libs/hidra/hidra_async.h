@@ -0,0 +1,48 @@
+#pragma once
+
+#include "hidra.h"
+#include "freertos/FreeRTOS.h"
+
+// Asynchronous report submission. Each async handle owns a queue and a flush
+// task for one device: submit copies the report and returns at once, and the
+// flush task writes everything queued in as few I2C transactions as possible
+// (one HIDRA_REG_BATCH write per MAX_BATCH_SIZE bytes).
+typedef struct hidra_async* hidra_async_handle_t;
+
+// Runs in the flush task
+typedef hidra_report_done_cb_t hidra_async_done_cb_t;
+
+typedef struct {
+    size_t queue_depth;          // Reports waiting to be written (0: HIDRA_ASYNC_DEFAULT_DEPTH)
+    int timeout_ms;              // Per I2C transaction
+    UBaseType_t task_priority;
+    bool read_status;            // Read the status register after each write
+    const hidra_transport_t* transport;  // NULL: the I2C bus
+} hidra_async_config_t;
+
+#define HIDRA_ASYNC_DEFAULT_DEPTH 32
+
+typedef struct {
+    uint32_t reports;            // Reports written
+    uint32_t writes;             // I2C write transactions used for them
+    uint32_t errors;             // Writes that failed
+} hidra_async_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t hidra_async_create(hidra_device_handle_t device, const hidra_async_config_t* config, hidra_async_handle_t* handle_out);
+// Writes out whatever is still queued, then stops the flush task
+esp_err_t hidra_async_delete(hidra_async_handle_t handle);
+
+// Never blocks: ESP_ERR_NO_MEM when the queue is full. done_cb may be NULL.
+esp_err_t hidra_async_submit(hidra_async_handle_t handle, uint8_t hid_register, const uint8_t* report, size_t report_size,
+                             hidra_async_done_cb_t done_cb, void* ctx);
+// Wait until every report submitted so far has been written (ESP_ERR_TIMEOUT otherwise)
+esp_err_t hidra_async_flush(hidra_async_handle_t handle, int timeout_ms);
+esp_err_t hidra_async_get_stats(hidra_async_handle_t handle, hidra_async_stats_t* stats_out);
+
+#ifdef __cplusplus
+}
+#endif
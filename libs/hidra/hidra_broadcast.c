@@ -0,0 +1,171 @@
+#include "hidra_broadcast.h"
+#include "esp_log.h"
+#include <stdlib.h>
+
+static const char *TAG = "hidra_broadcast";
+
+#define GENERAL_CALL_ADDR   0x00
+
+struct hidra_broadcast {
+    hidra_device_handle_t device;   // The general-call address on the bus
+};
+
+// Registers that take a whole HID input report. Anything else written to the
+// general-call address reaches every slave's config, macro and key state
+// handling as well.
+static bool is_report_register(uint8_t hid_register)
+{
+    switch (hid_register) {
+        case HIDRA_REG_KEYBOARD:
+        case HIDRA_REG_MOUSE:
+        case HIDRA_REG_JOYSTICK:
+        case HIDRA_REG_GAMEPAD:
+        case HIDRA_REG_CONSUMER:
+        case HIDRA_REG_PEN:
+        case HIDRA_REG_TOUCHSCREEN:
+        case HIDRA_REG_TOUCHPAD:
+        case HIDRA_REG_NKRO_KEYBOARD:
+            return true;
+        default:
+            return false;
+    }
+}
+
+esp_err_t hidra_broadcast_add_to_bus(hidra_bus_handle_t bus_handle, hidra_bus_speed_t speed, hidra_broadcast_handle_t* broadcast_out)
+{
+    if (!bus_handle || !broadcast_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (speed != HIDRA_SPEED_STANDARD && speed != HIDRA_SPEED_FAST && speed != HIDRA_SPEED_FAST_PLUS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct hidra_broadcast* broadcast = calloc(1, sizeof(*broadcast));
+    if (!broadcast) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    i2c_device_config_t dev_cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = GENERAL_CALL_ADDR,
+        .scl_speed_hz = speed,
+    };
+    esp_err_t ret = i2c_master_bus_add_device(bus_handle, &dev_cfg, &broadcast->device);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add general-call address: %s", esp_err_to_name(ret));
+        free(broadcast);
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Broadcast added, %d kHz", (int)speed / 1000);
+    *broadcast_out = broadcast;
+    return ESP_OK;
+}
+
+esp_err_t hidra_broadcast_remove(hidra_broadcast_handle_t broadcast)
+{
+    if (!broadcast) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = i2c_master_bus_rm_device(broadcast->device);
+    if (ret == ESP_OK) {
+        free(broadcast);
+    }
+    return ret;
+}
+
+esp_err_t hidra_broadcast_send_report(hidra_broadcast_handle_t broadcast, uint8_t hid_register, const uint8_t* report, size_t report_size, int timeout_ms)
+{
+    if (!broadcast || !is_report_register(hid_register)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return hidra_send_generic_report(broadcast->device, hid_register, report, report_size, timeout_ms);
+}
+
+esp_err_t hidra_broadcast_send_batch(hidra_broadcast_handle_t broadcast, const hidra_report_t* reports, size_t count, int timeout_ms)
+{
+    if (!broadcast || !reports) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!is_report_register(reports[i].hid_register)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return hidra_send_batch(broadcast->device, reports, count, timeout_ms);
+}
+
+esp_err_t hidra_broadcast_macro_play(hidra_broadcast_handle_t broadcast, uint8_t slot, int timeout_ms)
+{
+    if (!broadcast) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return hidra_macro_play(broadcast->device, slot, timeout_ms);
+}
+
+esp_err_t hidra_broadcast_macro_stop(hidra_broadcast_handle_t broadcast, int timeout_ms)
+{
+    if (!broadcast) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return hidra_macro_stop(broadcast->device, timeout_ms);
+}
+
+esp_err_t hidra_broadcast_config_txn_commit(hidra_broadcast_handle_t broadcast, const hidra_config_txn_t* txn, int timeout_ms)
+{
+    if (!broadcast) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // The transaction setters cannot record an address change, so this is
+    // safe to send to every slave at once
+    esp_err_t ret = hidra_config_txn_send(broadcast->device, txn, timeout_ms);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Broadcast %zu configuration writes", txn->count);
+    }
+    return ret;
+}
+
+esp_err_t hidra_broadcast_latch(hidra_broadcast_handle_t broadcast, int timeout_ms)
+{
+    if (!broadcast) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return hidra_latch(broadcast->device, timeout_ms);
+}
+
+esp_err_t hidra_broadcast_stage_clear(hidra_broadcast_handle_t broadcast, int timeout_ms)
+{
+    if (!broadcast) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return hidra_stage_clear(broadcast->device, timeout_ms);
+}
+
+esp_err_t hidra_broadcast_stage_and_latch(hidra_broadcast_handle_t broadcast, const hidra_staged_report_t* reports, size_t count, int timeout_ms)
+{
+    if (!broadcast || !reports || count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const hidra_staged_report_t* r = &reports[i];
+        if (!r->device || !r->report || r->report_size == 0 || r->report_size > MAX_REPORT_SIZE) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    // Start from empty stages, so a slave releases only what this call staged
+    esp_err_t ret = hidra_stage_clear(broadcast->device, timeout_ms);
+    for (size_t i = 0; ret == ESP_OK && i < count; i++) {
+        const hidra_staged_report_t* r = &reports[i];
+        ret = hidra_stage_report(r->device, r->hid_register, r->report, r->report_size, timeout_ms);
+    }
+    if (ret != ESP_OK) {
+        // Best effort: nothing half staged may go out with a later latch
+        hidra_stage_clear(broadcast->device, timeout_ms);
+        return ret;
+    }
+
+    return hidra_latch(broadcast->device, timeout_ms);
+}
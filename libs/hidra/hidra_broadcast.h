@@ -0,0 +1,59 @@
+#pragma once
+
+#include "hidra.h"
+
+// General-call writes (I2C address 0x00). Every HIDra slave on the bus
+// handles the write as if it had been sent to its own address, so a rack of
+// slaves gets the same report or configuration in one transaction, all at
+// the same moment. Only writes can be broadcast: each slave keeps its own
+// status, which the master reads per device afterwards if it needs it. A
+// write succeeds if at least one slave acknowledged it.
+//
+// Reports and batches take whole HID input reports only: not key events or
+// NKRO updates, which continue from each slave's own keyboard state, and not
+// config or other registers. Configuration goes through a transaction, which
+// cannot carry an address change (every slave would move to the same address).
+typedef struct hidra_broadcast* hidra_broadcast_handle_t;
+
+// One report to stage on one slave
+typedef struct {
+    hidra_device_handle_t device;
+    uint8_t hid_register;
+    const uint8_t* report;
+    size_t report_size;
+} hidra_staged_report_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// speed must suit the slowest slave; clock stretching by any slave holds the bus
+esp_err_t hidra_broadcast_add_to_bus(hidra_bus_handle_t bus_handle, hidra_bus_speed_t speed, hidra_broadcast_handle_t* broadcast_out);
+esp_err_t hidra_broadcast_remove(hidra_broadcast_handle_t broadcast);
+
+// Same payloads as hidra_send_generic_report() and hidra_send_batch(), for
+// HID input registers only; ESP_ERR_INVALID_ARG for any other register
+esp_err_t hidra_broadcast_send_report(hidra_broadcast_handle_t broadcast, uint8_t hid_register, const uint8_t* report, size_t report_size, int timeout_ms);
+esp_err_t hidra_broadcast_send_batch(hidra_broadcast_handle_t broadcast, const hidra_report_t* reports, size_t count, int timeout_ms);
+
+// Start or stop the macro in the same slot on every slave
+esp_err_t hidra_broadcast_macro_play(hidra_broadcast_handle_t broadcast, uint8_t slot, int timeout_ms);
+esp_err_t hidra_broadcast_macro_stop(hidra_broadcast_handle_t broadcast, int timeout_ms);
+
+// Apply one configuration to every slave: one transaction, one
+// re-enumeration each. Check each slave's status to see whether it took it.
+esp_err_t hidra_broadcast_config_txn_commit(hidra_broadcast_handle_t broadcast, const hidra_config_txn_t* txn, int timeout_ms);
+
+// Release the reports staged on every slave in one write, so they all go
+// out in their next USB frame: the skew between slaves is one frame, not
+// the time the staging writes took
+esp_err_t hidra_broadcast_latch(hidra_broadcast_handle_t broadcast, int timeout_ms);
+esp_err_t hidra_broadcast_stage_clear(hidra_broadcast_handle_t broadcast, int timeout_ms);
+// Stage each report on its slave, then latch once. If a staging write
+// fails, every slave's stage is dropped and nothing is released. A slave
+// that was full reports ERROR_QUEUE_FULL in its status after the latch.
+esp_err_t hidra_broadcast_stage_and_latch(hidra_broadcast_handle_t broadcast, const hidra_staged_report_t* reports, size_t count, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
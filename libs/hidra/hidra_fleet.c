@@ -0,0 +1,464 @@
+#include "hidra_fleet.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "hidra_fleet";
+
+#define FLEET_TASK_STACK    3072
+
+typedef struct {
+    uint8_t hid_register;
+    uint8_t len;
+    uint8_t report[MAX_REPORT_SIZE];
+    int64_t submitted_us;
+    hidra_fleet_done_cb_t done_cb;
+    void *ctx;
+} fleet_entry_t;
+
+typedef struct {
+    hidra_device_handle_t device;    // NULL: free slot
+    fleet_entry_t *queue;            // Circular, depth entries
+    size_t depth;
+    size_t head;
+    size_t count;
+    bool removing;
+    int64_t retry_at_us;             // Next probe while offline
+    hidra_fleet_device_stats_t stats;
+} fleet_device_t;
+
+struct hidra_fleet {
+    hidra_fleet_config_t config;
+    SemaphoreHandle_t lock;          // Guards the devices and the scheduler
+    SemaphoreHandle_t stopped;
+    TaskHandle_t task;
+    bool stopping;
+    atomic_uint pending;             // Submitted but not yet completed, all devices
+    uint8_t in_flight;               // Slot the task is using, HIDRA_FLEET_NO_DEVICE otherwise
+    size_t offline;                  // Devices offline
+    hidra_fleet_sched_t sched;
+    fleet_device_t devices[HIDRA_FLEET_MAX_DEVICES];
+    fleet_entry_t entries[HIDRA_REPORT_BATCH_MAX_REPORTS];    // Reports of the write in progress, fleet task only
+    hidra_report_batch_t batch;
+};
+
+static void queue_pop(fleet_device_t *dev)
+{
+    dev->head = (dev->head + 1) % dev->depth;
+    dev->count--;
+}
+
+// Move the device's oldest reports into the batch, as many as fit in one write
+static size_t take_batch(hidra_fleet_handle_t fleet, fleet_device_t *dev)
+{
+    hidra_report_batch_init(&fleet->batch);
+    while (dev->count > 0 && fleet->batch.count < HIDRA_REPORT_BATCH_MAX_REPORTS) {
+        fleet_entry_t *entry = &fleet->entries[fleet->batch.count];
+        *entry = dev->queue[dev->head];
+        if (!hidra_report_batch_add(&fleet->batch, entry->hid_register, entry->report, entry->len)) {
+            break;
+        }
+        queue_pop(dev);
+    }
+    return fleet->batch.count;
+}
+
+// Fail whatever the device still has queued, one report at a time so the
+// callbacks run without the lock
+static void drop_queue(hidra_fleet_handle_t fleet, uint8_t slot)
+{
+    fleet_device_t *dev = &fleet->devices[slot];
+    while (1) {
+        fleet_entry_t entry;
+        xSemaphoreTake(fleet->lock, portMAX_DELAY);
+        bool empty = dev->count == 0;
+        if (!empty) {
+            entry = dev->queue[dev->head];
+            queue_pop(dev);
+            dev->stats.dropped++;
+        }
+        xSemaphoreGive(fleet->lock);
+        if (empty) {
+            break;
+        }
+
+        if (entry.done_cb) {
+            entry.done_cb(ESP_ERR_INVALID_STATE, 0, entry.ctx);
+        }
+        atomic_fetch_sub(&fleet->pending, 1);
+    }
+}
+
+static void run_turn(hidra_fleet_handle_t fleet, uint8_t slot, size_t count)
+{
+    fleet_device_t *dev = &fleet->devices[slot];
+    uint8_t status = 0;
+    esp_err_t ret = hidra_report_batch_send(fleet->config.transport, dev->device, &fleet->batch,
+                                            fleet->config.read_status ? &status : NULL, fleet->config.timeout_ms);
+    int64_t now_us = esp_timer_get_time();
+
+    xSemaphoreTake(fleet->lock, portMAX_DELAY);
+    dev->stats.writes++;
+    bool went_offline = false;
+    if (ret == ESP_OK) {
+        dev->stats.consecutive_errors = 0;
+        dev->stats.reports += count;
+        for (size_t i = 0; i < count; i++) {
+            uint32_t latency_us = (uint32_t)(now_us - fleet->entries[i].submitted_us);
+            dev->stats.total_latency_us += latency_us;
+            if (latency_us > dev->stats.max_latency_us) {
+                dev->stats.max_latency_us = latency_us;
+            }
+        }
+    } else {
+        dev->stats.errors++;
+        dev->stats.last_error = ret;
+        if (dev->stats.consecutive_errors < UINT8_MAX) {
+            dev->stats.consecutive_errors++;
+        }
+        went_offline = dev->stats.consecutive_errors >= fleet->config.offline_after;
+    }
+
+    if (went_offline) {
+        ESP_LOGW(TAG, "Device %u offline after %u failed writes: %s", slot,
+                 dev->stats.consecutive_errors, esp_err_to_name(ret));
+        dev->stats.state = HIDRA_FLEET_DEVICE_OFFLINE;
+        dev->retry_at_us = now_us + (int64_t)fleet->config.retry_ms * 1000;
+        fleet->offline++;
+        hidra_fleet_sched_remove(&fleet->sched, slot);
+    } else {
+        hidra_fleet_sched_done(&fleet->sched, dev->count > 0);
+    }
+    xSemaphoreGive(fleet->lock);
+
+    for (size_t i = 0; i < count; i++) {
+        if (fleet->entries[i].done_cb) {
+            fleet->entries[i].done_cb(ret, status, fleet->entries[i].ctx);
+        }
+    }
+    atomic_fetch_sub(&fleet->pending, count);
+
+    if (went_offline) {
+        drop_queue(fleet, slot);
+    }
+}
+
+// First offline device whose probe is due, marked in flight
+static uint8_t take_due_probe(hidra_fleet_handle_t fleet, int64_t now_us)
+{
+    if (fleet->offline == 0) {
+        return HIDRA_FLEET_NO_DEVICE;
+    }
+    for (uint8_t slot = 0; slot < HIDRA_FLEET_MAX_DEVICES; slot++) {
+        fleet_device_t *dev = &fleet->devices[slot];
+        if (dev->device && dev->stats.state == HIDRA_FLEET_DEVICE_OFFLINE && now_us >= dev->retry_at_us) {
+            dev->retry_at_us = now_us + (int64_t)fleet->config.retry_ms * 1000;
+            fleet->in_flight = slot;
+            return slot;
+        }
+    }
+    return HIDRA_FLEET_NO_DEVICE;
+}
+
+static void probe(hidra_fleet_handle_t fleet, uint8_t slot)
+{
+    fleet_device_t *dev = &fleet->devices[slot];
+    uint8_t status;
+    esp_err_t ret = hidra_transport_read_status(fleet->config.transport, dev->device, &status, fleet->config.timeout_ms);
+
+    xSemaphoreTake(fleet->lock, portMAX_DELAY);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Device %u back online", slot);
+        dev->stats.state = HIDRA_FLEET_DEVICE_ONLINE;
+        dev->stats.consecutive_errors = 0;
+        fleet->offline--;
+    } else {
+        dev->stats.last_error = ret;
+    }
+    fleet->in_flight = HIDRA_FLEET_NO_DEVICE;
+    xSemaphoreGive(fleet->lock);
+}
+
+static void fleet_task(void *arg)
+{
+    hidra_fleet_handle_t fleet = arg;
+
+    while (1) {
+        xSemaphoreTake(fleet->lock, portMAX_DELAY);
+        if (fleet->stopping) {
+            xSemaphoreGive(fleet->lock);
+            break;
+        }
+        uint8_t probe_slot = take_due_probe(fleet, esp_timer_get_time());
+        xSemaphoreGive(fleet->lock);
+
+        if (probe_slot != HIDRA_FLEET_NO_DEVICE) {
+            probe(fleet, probe_slot);
+        }
+
+        xSemaphoreTake(fleet->lock, portMAX_DELAY);
+        uint8_t slot = hidra_fleet_sched_next(&fleet->sched);
+        size_t count = 0;
+        if (slot != HIDRA_FLEET_NO_DEVICE) {
+            count = take_batch(fleet, &fleet->devices[slot]);
+            if (count == 0) {
+                hidra_fleet_sched_remove(&fleet->sched, slot);
+                slot = HIDRA_FLEET_NO_DEVICE;
+            } else {
+                fleet->in_flight = slot;
+            }
+        }
+        TickType_t wait = fleet->offline > 0 ? pdMS_TO_TICKS(fleet->config.retry_ms) : portMAX_DELAY;
+        xSemaphoreGive(fleet->lock);
+
+        if (slot != HIDRA_FLEET_NO_DEVICE) {
+            run_turn(fleet, slot, count);
+            xSemaphoreTake(fleet->lock, portMAX_DELAY);
+            fleet->in_flight = HIDRA_FLEET_NO_DEVICE;
+            xSemaphoreGive(fleet->lock);
+        } else if (probe_slot == HIDRA_FLEET_NO_DEVICE) {
+            // Sleep until a submit, a stop, or the next probe
+            ulTaskNotifyTake(pdTRUE, wait);
+        }
+    }
+
+    xSemaphoreGive(fleet->stopped);
+    vTaskDelete(NULL);
+}
+
+esp_err_t hidra_fleet_create(const hidra_fleet_config_t* config, hidra_fleet_handle_t* fleet_out)
+{
+    if (!config || !fleet_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    hidra_fleet_handle_t fleet = calloc(1, sizeof(*fleet));
+    if (!fleet) {
+        return ESP_ERR_NO_MEM;
+    }
+    fleet->config = *config;
+    if (fleet->config.offline_after == 0) {
+        fleet->config.offline_after = HIDRA_FLEET_DEFAULT_OFFLINE_AFTER;
+    }
+    if (fleet->config.retry_ms == 0) {
+        fleet->config.retry_ms = HIDRA_FLEET_DEFAULT_RETRY_MS;
+    }
+    fleet->in_flight = HIDRA_FLEET_NO_DEVICE;
+    atomic_init(&fleet->pending, 0);
+    hidra_fleet_sched_init(&fleet->sched);
+
+    fleet->lock = xSemaphoreCreateMutex();
+    fleet->stopped = xSemaphoreCreateBinary();
+    if (!fleet->lock || !fleet->stopped ||
+        xTaskCreate(fleet_task, "hidra_fleet", FLEET_TASK_STACK, fleet, fleet->config.task_priority, &fleet->task) != pdPASS) {
+        if (fleet->lock) {
+            vSemaphoreDelete(fleet->lock);
+        }
+        if (fleet->stopped) {
+            vSemaphoreDelete(fleet->stopped);
+        }
+        free(fleet);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Fleet started");
+    *fleet_out = fleet;
+    return ESP_OK;
+}
+
+esp_err_t hidra_fleet_delete(hidra_fleet_handle_t fleet)
+{
+    if (!fleet) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (uint8_t slot = 0; slot < HIDRA_FLEET_MAX_DEVICES; slot++) {
+        if (fleet->devices[slot].device) {
+            hidra_fleet_remove_device(fleet, slot);
+        }
+    }
+
+    xSemaphoreTake(fleet->lock, portMAX_DELAY);
+    fleet->stopping = true;
+    xSemaphoreGive(fleet->lock);
+    xTaskNotifyGive(fleet->task);
+    xSemaphoreTake(fleet->stopped, portMAX_DELAY);
+
+    vSemaphoreDelete(fleet->stopped);
+    vSemaphoreDelete(fleet->lock);
+    free(fleet);
+    return ESP_OK;
+}
+
+esp_err_t hidra_fleet_add_device(hidra_fleet_handle_t fleet, hidra_device_handle_t device,
+                                 const hidra_fleet_device_config_t* config, hidra_fleet_device_id_t* id_out)
+{
+    if (!fleet || !device || !config || !id_out || config->priority > HIDRA_FLEET_MAX_PRIORITY) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t depth = config->queue_depth ? config->queue_depth : HIDRA_FLEET_DEFAULT_DEPTH;
+    fleet_entry_t *queue = calloc(depth, sizeof(*queue));
+    if (!queue) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    xSemaphoreTake(fleet->lock, portMAX_DELAY);
+    for (uint8_t slot = 0; slot < HIDRA_FLEET_MAX_DEVICES; slot++) {
+        if (fleet->devices[slot].device == device) {
+            ret = ESP_ERR_INVALID_STATE;
+            break;
+        }
+    }
+    for (uint8_t slot = 0; ret == ESP_ERR_NO_MEM && slot < HIDRA_FLEET_MAX_DEVICES; slot++) {
+        fleet_device_t *dev = &fleet->devices[slot];
+        if (!dev->device) {
+            dev->device = device;
+            dev->queue = queue;
+            dev->depth = depth;
+            hidra_fleet_sched_set_priority(&fleet->sched, slot, config->priority);
+            *id_out = slot;
+            ret = ESP_OK;
+        }
+    }
+    xSemaphoreGive(fleet->lock);
+
+    if (ret != ESP_OK) {
+        free(queue);
+    }
+    return ret;
+}
+
+esp_err_t hidra_fleet_remove_device(hidra_fleet_handle_t fleet, hidra_fleet_device_id_t id)
+{
+    if (!fleet || id >= HIDRA_FLEET_MAX_DEVICES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    fleet_device_t *dev = &fleet->devices[id];
+    xSemaphoreTake(fleet->lock, portMAX_DELAY);
+    bool valid = dev->device && !dev->removing;
+    if (valid) {
+        dev->removing = true;
+    }
+    xSemaphoreGive(fleet->lock);
+    if (!valid) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Its queue is still written out (or dropped, if it goes offline)
+    while (1) {
+        xSemaphoreTake(fleet->lock, portMAX_DELAY);
+        bool idle = dev->count == 0 && fleet->in_flight != id;
+        if (idle) {
+            hidra_fleet_sched_remove(&fleet->sched, id);
+            if (dev->stats.state == HIDRA_FLEET_DEVICE_OFFLINE) {
+                fleet->offline--;
+            }
+            free(dev->queue);
+            memset(dev, 0, sizeof(*dev));
+        }
+        xSemaphoreGive(fleet->lock);
+        if (idle) {
+            break;
+        }
+        vTaskDelay(1);
+    }
+    return ESP_OK;
+}
+
+esp_err_t hidra_fleet_set_priority(hidra_fleet_handle_t fleet, hidra_fleet_device_id_t id, uint8_t priority)
+{
+    if (!fleet || id >= HIDRA_FLEET_MAX_DEVICES || priority > HIDRA_FLEET_MAX_PRIORITY) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_INVALID_ARG;
+    xSemaphoreTake(fleet->lock, portMAX_DELAY);
+    if (fleet->devices[id].device) {
+        hidra_fleet_sched_set_priority(&fleet->sched, id, priority);
+        ret = ESP_OK;
+    }
+    xSemaphoreGive(fleet->lock);
+    return ret;
+}
+
+esp_err_t hidra_fleet_submit(hidra_fleet_handle_t fleet, hidra_fleet_device_id_t id, uint8_t hid_register,
+                             const uint8_t* report, size_t report_size, hidra_fleet_done_cb_t done_cb, void* ctx)
+{
+    if (!fleet || id >= HIDRA_FLEET_MAX_DEVICES || !report || report_size == 0 || report_size > MAX_REPORT_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    fleet_entry_t entry = {
+        .hid_register = hid_register,
+        .len = (uint8_t)report_size,
+        .submitted_us = esp_timer_get_time(),
+        .done_cb = done_cb,
+        .ctx = ctx,
+    };
+    memcpy(entry.report, report, report_size);
+
+    esp_err_t ret;
+    fleet_device_t *dev = &fleet->devices[id];
+    xSemaphoreTake(fleet->lock, portMAX_DELAY);
+    if (!dev->device) {
+        ret = ESP_ERR_INVALID_ARG;
+    } else if (dev->removing || dev->stats.state == HIDRA_FLEET_DEVICE_OFFLINE) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else if (dev->count == dev->depth) {
+        ret = ESP_ERR_NO_MEM;
+    } else {
+        dev->queue[(dev->head + dev->count) % dev->depth] = entry;
+        dev->count++;
+        hidra_fleet_sched_ready(&fleet->sched, id);
+        atomic_fetch_add(&fleet->pending, 1);
+        ret = ESP_OK;
+    }
+    xSemaphoreGive(fleet->lock);
+
+    if (ret == ESP_OK) {
+        xTaskNotifyGive(fleet->task);
+    }
+    return ret;
+}
+
+esp_err_t hidra_fleet_flush(hidra_fleet_handle_t fleet, int timeout_ms)
+{
+    if (!fleet) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    while (atomic_load(&fleet->pending) > 0) {
+        if ((xTaskGetTickCount() - start) >= pdMS_TO_TICKS(timeout_ms)) {
+            return ESP_ERR_TIMEOUT;
+        }
+        vTaskDelay(1);
+    }
+    return ESP_OK;
+}
+
+esp_err_t hidra_fleet_get_device_stats(hidra_fleet_handle_t fleet, hidra_fleet_device_id_t id, hidra_fleet_device_stats_t* stats_out)
+{
+    if (!fleet || id >= HIDRA_FLEET_MAX_DEVICES || !stats_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_INVALID_ARG;
+    xSemaphoreTake(fleet->lock, portMAX_DELAY);
+    const fleet_device_t *dev = &fleet->devices[id];
+    if (dev->device) {
+        *stats_out = dev->stats;
+        stats_out->queued = dev->count;
+        ret = ESP_OK;
+    }
+    xSemaphoreGive(fleet->lock);
+    return ret;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "hidra.h"
+#include "hidra_fleet_sched.h"
+#include "freertos/FreeRTOS.h"
+
+// Many slaves on one bus. A fleet keeps a report queue per device and one
+// task that owns the bus: it takes the devices with queued reports in
+// weighted round-robin order (hidra_fleet_sched.h) and gives each turn its
+// priority in transactions, every transaction one batch write of that
+// device's queued reports. A busy device cannot starve the others, and a
+// device's wait for the bus depends on the priorities of the devices with
+// work, not on how much they have queued.
+//
+// A device whose transactions keep failing goes offline: its queued
+// reports fail with ESP_ERR_INVALID_STATE, submits are refused, and the
+// fleet probes it with a status read every retry_ms until it answers.
+typedef struct hidra_fleet* hidra_fleet_handle_t;
+
+// Slot of a device in its fleet, 0 - HIDRA_FLEET_MAX_DEVICES - 1
+typedef uint8_t hidra_fleet_device_id_t;
+
+// Runs in the fleet task
+typedef hidra_report_done_cb_t hidra_fleet_done_cb_t;
+
+typedef struct {
+    int timeout_ms;              // Per I2C transaction
+    UBaseType_t task_priority;
+    bool read_status;            // Read the status register after each write
+    uint8_t offline_after;       // Failed transactions in a row that take a device offline (0: HIDRA_FLEET_DEFAULT_OFFLINE_AFTER)
+    uint32_t retry_ms;           // Probe an offline device this often (0: HIDRA_FLEET_DEFAULT_RETRY_MS)
+    const hidra_transport_t* transport;  // NULL: the I2C bus
+} hidra_fleet_config_t;
+
+typedef struct {
+    uint8_t priority;            // Transactions per turn, 1 - HIDRA_FLEET_MAX_PRIORITY (0: 1)
+    size_t queue_depth;          // Reports waiting to be written (0: HIDRA_FLEET_DEFAULT_DEPTH)
+} hidra_fleet_device_config_t;
+
+#define HIDRA_FLEET_DEFAULT_DEPTH           8
+#define HIDRA_FLEET_DEFAULT_OFFLINE_AFTER   3
+#define HIDRA_FLEET_DEFAULT_RETRY_MS        500
+
+typedef enum {
+    HIDRA_FLEET_DEVICE_ONLINE,
+    HIDRA_FLEET_DEVICE_OFFLINE,
+} hidra_fleet_device_state_t;
+
+typedef struct {
+    hidra_fleet_device_state_t state;
+    uint32_t queued;             // Reports waiting now
+    uint32_t reports;            // Reports written
+    uint32_t writes;             // I2C write transactions used for them
+    uint32_t errors;             // Writes that failed
+    uint32_t dropped;            // Reports failed because the device went offline
+    uint8_t consecutive_errors;
+    esp_err_t last_error;        // Of the last failed write or probe
+    uint32_t max_latency_us;     // Submit to write done, over written reports
+    uint64_t total_latency_us;   // Divide by reports for the average
+} hidra_fleet_device_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t hidra_fleet_create(const hidra_fleet_config_t* config, hidra_fleet_handle_t* fleet_out);
+// Removes every device (writing out what they have queued), then stops the task
+esp_err_t hidra_fleet_delete(hidra_fleet_handle_t fleet);
+
+// The device handle stays the caller's: removing it from the fleet does not
+// remove it from the bus. ESP_ERR_NO_MEM when the fleet is full.
+esp_err_t hidra_fleet_add_device(hidra_fleet_handle_t fleet, hidra_device_handle_t device,
+                                 const hidra_fleet_device_config_t* config, hidra_fleet_device_id_t* id_out);
+// Refuses new reports, waits until the queued ones are written, then frees the slot
+esp_err_t hidra_fleet_remove_device(hidra_fleet_handle_t fleet, hidra_fleet_device_id_t id);
+esp_err_t hidra_fleet_set_priority(hidra_fleet_handle_t fleet, hidra_fleet_device_id_t id, uint8_t priority);
+
+// Never blocks: ESP_ERR_NO_MEM when the device's queue is full,
+// ESP_ERR_INVALID_STATE while it is offline or being removed. done_cb may be NULL.
+esp_err_t hidra_fleet_submit(hidra_fleet_handle_t fleet, hidra_fleet_device_id_t id, uint8_t hid_register,
+                             const uint8_t* report, size_t report_size, hidra_fleet_done_cb_t done_cb, void* ctx);
+// Wait until every report submitted so far, to any device, is done (ESP_ERR_TIMEOUT otherwise)
+esp_err_t hidra_fleet_flush(hidra_fleet_handle_t fleet, int timeout_ms);
+esp_err_t hidra_fleet_get_device_stats(hidra_fleet_handle_t fleet, hidra_fleet_device_id_t id, hidra_fleet_device_stats_t* stats_out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,92 @@
+#include "hidra_fleet_sched.h"
+#include <string.h>
+
+static uint8_t ring_at(const hidra_fleet_sched_t *sched, size_t i)
+{
+    return sched->ring[(sched->head + i) % HIDRA_FLEET_MAX_DEVICES];
+}
+
+void hidra_fleet_sched_init(hidra_fleet_sched_t* sched)
+{
+    memset(sched, 0, sizeof(*sched));
+    memset(sched->priority, 1, sizeof(sched->priority));
+}
+
+void hidra_fleet_sched_set_priority(hidra_fleet_sched_t* sched, uint8_t slot, uint8_t priority)
+{
+    if (slot >= HIDRA_FLEET_MAX_DEVICES) {
+        return;
+    }
+    if (priority < 1) {
+        priority = 1;
+    } else if (priority > HIDRA_FLEET_MAX_PRIORITY) {
+        priority = HIDRA_FLEET_MAX_PRIORITY;
+    }
+    sched->priority[slot] = priority;
+}
+
+void hidra_fleet_sched_ready(hidra_fleet_sched_t* sched, uint8_t slot)
+{
+    if (slot >= HIDRA_FLEET_MAX_DEVICES || sched->waiting[slot]) {
+        return;
+    }
+    sched->ring[(sched->head + sched->count) % HIDRA_FLEET_MAX_DEVICES] = slot;
+    sched->count++;
+    sched->waiting[slot] = true;
+}
+
+void hidra_fleet_sched_remove(hidra_fleet_sched_t* sched, uint8_t slot)
+{
+    if (slot >= HIDRA_FLEET_MAX_DEVICES || !sched->waiting[slot]) {
+        return;
+    }
+
+    size_t pos = 0;
+    while (ring_at(sched, pos) != slot) {
+        pos++;
+    }
+    if (pos == 0) {
+        // The next slot starts a fresh turn
+        sched->credit = 0;
+    }
+    for (; pos + 1 < sched->count; pos++) {
+        sched->ring[(sched->head + pos) % HIDRA_FLEET_MAX_DEVICES] = ring_at(sched, pos + 1);
+    }
+    sched->count--;
+    sched->waiting[slot] = false;
+}
+
+uint8_t hidra_fleet_sched_next(hidra_fleet_sched_t* sched)
+{
+    if (sched->count == 0) {
+        return HIDRA_FLEET_NO_DEVICE;
+    }
+
+    uint8_t slot = ring_at(sched, 0);
+    if (sched->credit == 0) {
+        sched->credit = sched->priority[slot];
+    }
+    return slot;
+}
+
+void hidra_fleet_sched_done(hidra_fleet_sched_t* sched, bool more_work)
+{
+    if (sched->count == 0) {
+        return;
+    }
+
+    uint8_t slot = ring_at(sched, 0);
+    if (!more_work) {
+        hidra_fleet_sched_remove(sched, slot);
+        return;
+    }
+    if (sched->credit > 1) {
+        sched->credit--;
+        return;
+    }
+
+    // Turn used up: to the back of the ring
+    sched->head = (sched->head + 1) % HIDRA_FLEET_MAX_DEVICES;
+    sched->ring[(sched->head + sched->count - 1) % HIDRA_FLEET_MAX_DEVICES] = slot;
+    sched->credit = 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Turn order of the devices in a fleet: weighted round-robin, one I2C
+// transaction per step. Devices with work wait in a ring. The one at the
+// head gets up to its priority in transactions in a row, then goes to the
+// back. Between two turns a device waits for at most the sum of the other
+// waiting devices' priorities in transactions, however many devices have
+// work. Not thread safe: the fleet calls it under its lock.
+
+#define HIDRA_FLEET_MAX_DEVICES     112   // Usable 7-bit addresses, 0x08-0x77
+#define HIDRA_FLEET_MAX_PRIORITY    8     // Transactions per turn
+#define HIDRA_FLEET_NO_DEVICE       0xFF
+
+typedef struct {
+    uint8_t ring[HIDRA_FLEET_MAX_DEVICES];       // Slots with work, from head, circular
+    uint8_t head;
+    uint8_t count;
+    uint8_t credit;                              // Transactions left in the head's turn
+    uint8_t priority[HIDRA_FLEET_MAX_DEVICES];
+    bool waiting[HIDRA_FLEET_MAX_DEVICES];       // In the ring
+} hidra_fleet_sched_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Every slot starts at priority 1, not waiting
+void hidra_fleet_sched_init(hidra_fleet_sched_t* sched);
+// 1 - HIDRA_FLEET_MAX_PRIORITY, others are clamped; applies from the slot's next turn
+void hidra_fleet_sched_set_priority(hidra_fleet_sched_t* sched, uint8_t slot, uint8_t priority);
+// The slot has work: it joins the back of the ring unless it is already waiting
+void hidra_fleet_sched_ready(hidra_fleet_sched_t* sched, uint8_t slot);
+// Take the slot out of the ring (removed, or offline)
+void hidra_fleet_sched_remove(hidra_fleet_sched_t* sched, uint8_t slot);
+// Slot that gets the next transaction, HIDRA_FLEET_NO_DEVICE if none has work
+uint8_t hidra_fleet_sched_next(hidra_fleet_sched_t* sched);
+// The transaction of the slot returned by hidra_fleet_sched_next() is done.
+// more_work: it still has reports queued.
+void hidra_fleet_sched_done(hidra_fleet_sched_t* sched, bool more_work);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,156 @@
+#include "hidra_irq.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+static const char *TAG = "hidra_irq";
+
+typedef struct {
+    hidra_device_handle_t device;
+    gpio_num_t gpio;
+} irq_binding_t;
+
+static irq_binding_t g_bindings[HIDRA_IRQ_MAX_DEVICES];
+static size_t g_binding_count = 0;
+static SemaphoreHandle_t g_irq_sem = NULL;
+
+static void IRAM_ATTR irq_isr(void *arg)
+{
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(g_irq_sem, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static bool gpio_in_use(gpio_num_t gpio)
+{
+    for (size_t i = 0; i < g_binding_count; i++) {
+        if (g_bindings[i].gpio == gpio) {
+            return true;
+        }
+    }
+    return false;
+}
+
+esp_err_t hidra_irq_attach(hidra_device_handle_t device, gpio_num_t gpio)
+{
+    if (!device || !GPIO_IS_VALID_GPIO(gpio)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (g_binding_count >= HIDRA_IRQ_MAX_DEVICES) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (!g_irq_sem) {
+        g_irq_sem = xSemaphoreCreateBinary();
+        if (!g_irq_sem) {
+            return ESP_ERR_NO_MEM;
+        }
+        // The application may already have installed the service
+        esp_err_t ret = gpio_install_isr_service(0);
+        if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+            return ret;
+        }
+    }
+
+    // First device on this line: the line is active low, so wake on the falling edge
+    if (!gpio_in_use(gpio)) {
+        gpio_config_t io_conf = {
+            .intr_type = GPIO_INTR_NEGEDGE,
+            .mode = GPIO_MODE_INPUT,
+            .pin_bit_mask = (1ULL << gpio),
+            .pull_down_en = 0,
+            .pull_up_en = 1,
+        };
+        esp_err_t ret = gpio_config(&io_conf);
+        if (ret == ESP_OK) {
+            ret = gpio_isr_handler_add(gpio, irq_isr, NULL);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to set up interrupt line on GPIO %d: %s", gpio, esp_err_to_name(ret));
+            return ret;
+        }
+    }
+
+    g_bindings[g_binding_count++] = (irq_binding_t){.device = device, .gpio = gpio};
+    ESP_LOGI(TAG, "Device attached to interrupt line on GPIO %d", gpio);
+    return ESP_OK;
+}
+
+esp_err_t hidra_irq_detach(hidra_device_handle_t device)
+{
+    if (!device) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (size_t i = 0; i < g_binding_count; i++) {
+        if (g_bindings[i].device != device) {
+            continue;
+        }
+        gpio_num_t gpio = g_bindings[i].gpio;
+        g_bindings[i] = g_bindings[--g_binding_count];
+        if (!gpio_in_use(gpio)) {
+            gpio_isr_handler_remove(gpio);
+            gpio_reset_pin(gpio);
+        }
+        return ESP_OK;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+// Level, not edge: a line still held low is pending even if its edge came
+// before the wait started, or while another slave on the line was served
+static size_t collect_asserted(hidra_device_handle_t* pending_out, size_t max)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < g_binding_count && count < max; i++) {
+        if (gpio_get_level(g_bindings[i].gpio) == 0) {
+            pending_out[count++] = g_bindings[i].device;
+        }
+    }
+    return count;
+}
+
+esp_err_t hidra_irq_wait(hidra_device_handle_t* pending_out, size_t max, size_t* count_out, int timeout_ms)
+{
+    if (!pending_out || max == 0 || !count_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *count_out = 0;
+    if (g_binding_count == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    while (1) {
+        size_t count = collect_asserted(pending_out, max);
+        if (count > 0) {
+            *count_out = count;
+            return ESP_OK;
+        }
+
+        // An edge between the level check and here leaves the semaphore given
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout || xSemaphoreTake(g_irq_sem, timeout - elapsed) != pdTRUE) {
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+}
+
+esp_err_t hidra_read_irq_cause(hidra_device_handle_t device, uint8_t* cause_out, int timeout_ms)
+{
+    if (!device || !cause_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t reg_addr = IRQ_CAUSE_REG;
+    esp_err_t ret = i2c_master_transmit_receive(device, &reg_addr, 1, cause_out, 1, timeout_ms);
+    if (ret == ESP_OK) {
+        ESP_LOGD(TAG, "Interrupt cause: 0x%02X", *cause_out);
+    } else {
+        ESP_LOGE(TAG, "Failed to read interrupt cause: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
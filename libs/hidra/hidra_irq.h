@@ -0,0 +1,30 @@
+#pragma once
+
+#include "hidra.h"
+#include "driver/gpio.h"
+
+// Slave interrupt lines (CONFIG_IRQ_GPIO_REG). Each device is attached to the
+// master GPIO its line is wired to; slaves may share one wired-OR line. The
+// master waits on the lines instead of polling, then reads IRQ_CAUSE_REG of
+// the devices that raised theirs. attach/detach and wait are meant to be
+// called from one task.
+#define HIDRA_IRQ_MAX_DEVICES 16
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Configures gpio as an input with pull-up; an external pull-up is recommended
+esp_err_t hidra_irq_attach(hidra_device_handle_t device, gpio_num_t gpio);
+esp_err_t hidra_irq_detach(hidra_device_handle_t device);
+
+// Block until at least one attached line is low, then list the devices on
+// low lines (up to max). ESP_ERR_TIMEOUT if none was raised in time.
+esp_err_t hidra_irq_wait(hidra_device_handle_t* pending_out, size_t max, size_t* count_out, int timeout_ms);
+
+// Read and clear the IRQ_CAUSE_* bits; releases the slave's line
+esp_err_t hidra_read_irq_cause(hidra_device_handle_t device, uint8_t* cause_out, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
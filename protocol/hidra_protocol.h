@@ -13,14 +13,162 @@
 #define HIDRA_REG_TOUCHSCREEN   0xD4  // Digitizers (0x0D) | Touch Screen (0x04)
 #define HIDRA_REG_TOUCHPAD      0xD5  // Digitizers (0x0D) | Touch Pad (0x05)
 
+// Key Event Register (Write-Only)
+// The slave keeps the keyboard state and sends the resulting boot report
+#define HIDRA_REG_KEY_EVENT     0x70  // Keyboard/Keypad (0x07): 2 bytes [usage, action]
+#define KEY_EVENT_RELEASE       0x00
+#define KEY_EVENT_PRESS         0x01
+
+// N-Key Rollover Keyboard Registers (Write-Only)
+// Report: [modifiers, bitmap of usages 0x00-0xDF], one bit per key
+#define HIDRA_REG_NKRO_KEYBOARD 0x71  // Keyboard/Keypad (0x07): full NKRO report
+#define HIDRA_REG_NKRO_KEYS     0x72  // Keyboard/Keypad (0x07): [action, usage...]
+#define NKRO_KEYS_CLEAR         0x00  // Release the listed keys
+#define NKRO_KEYS_SET           0x01  // Press the listed keys
+#define NKRO_KEYS_REPLACE       0x02  // Release all keys, then press the listed keys
+#define NKRO_KEY_BITMAP_BYTES   28
+#define NKRO_REPORT_SIZE        (1 + NKRO_KEY_BITMAP_BYTES)
+
+// Multi-touch Registers (HIDRA_REG_TOUCHSCREEN, HIDRA_REG_TOUCHPAD, Write-Only)
+// Payload: [frame flags, contact...], contact = [id, flags, x_lo, x_hi, y_lo, y_hi].
+// The contacts of one frame may span several writes; the slave sends the frame
+// to the host as a whole once a write carries TOUCH_FRAME_END. A contact stays
+// down until the master sends it with TOUCH_CONTACT_TIP cleared.
+#define TOUCH_MAX_CONTACTS          10
+#define TOUCH_MAX_CONTACT_ID        63
+#define TOUCH_CONTACT_SIZE          6
+#define TOUCH_LOGICAL_MAX           4095  // X and Y range
+#define TOUCH_FRAME_END             0x01  // Last write of the frame
+#define TOUCH_FRAME_BUTTON          0x02  // Touchpad button pressed (taken from the TOUCH_FRAME_END write)
+#define TOUCH_CONTACT_TIP           0x01  // Finger on the surface
+#define TOUCH_CONTACT_CONFIDENCE    0x02  // A finger, not a palm
+
+// Batch Register (Write-Only)
+// Payload: records of [HID register, report length, report...], back to back.
+// Only input registers may appear in a batch; the status covers the whole batch.
+#define HIDRA_REG_BATCH         0xB0
+#define BATCH_RECORD_HEADER_SIZE 2
+
+// Macro Registers
+// The master uploads an input script into a slot once; a one-byte write to
+// MACRO_PLAY_REG plays it back at the USB polling rate. A script is a list
+// of steps [opcode, operands...], multi-byte operands little-endian.
+#define MACRO_DATA_REG              0xB1  // Write: [slot, offset (uint16_t), script bytes...]
+#define MACRO_PLAY_REG              0xB2  // Write, 1 byte: slot to play (restarts playback), or MACRO_STOP
+#define MACRO_SAVE_REG              0xB3  // Write, 1 byte: keep the slot in NVS (an empty slot is erased)
+#define MACRO_SLOT_COUNT            4
+#define MACRO_SLOT_SIZE             1024  // Script bytes per slot
+#define MACRO_DATA_HEADER_SIZE      3     // Offset 0 starts the slot over; later chunks must append
+#define MACRO_STOP                  0xFF
+#define MACRO_MAX_DEPTH             4     // Nested MACRO_OP_REPEAT blocks
+
+// Macro Script Steps
+#define MACRO_OP_REPORT             0x01  // [HID register, length, report...]: same payload as a register write
+#define MACRO_OP_DELAY              0x02  // [ms (uint16_t)]: counted from when the previous report was queued
+#define MACRO_OP_REPEAT             0x03  // [count (1-255)]: run the steps up to the matching MACRO_OP_LOOP count times
+#define MACRO_OP_LOOP               0x04  // []: end of a MACRO_OP_REPEAT block
+#define MACRO_OP_TEXT               0x05  // [length, characters...]: press and release each character on the boot keyboard
+#define MACRO_OP_KEYMAP             0x06  // [count, {character, usage, modifiers}...]: change the layout table
+#define MACRO_KEYMAP_ENTRY_SIZE     3
+// Playback starts with a US layout table for printable ASCII, '\n', '\t' and
+// '\b'. Characters mapped to usage 0 are skipped.
+
+// Scheduled Reports
+// The master reads the slave's clock to learn its offset, then queues
+// reports stamped with the slave time they are due at. The slave hands each
+// one to its interface when that time comes, so the USB side sends it in the
+// first frame the host polls afterwards, however busy the bus was.
+#define SCHEDULE_REG                0xB4  // Write: [due time (uint32_t, slave µs), HID register, report...],
+                                          // or 1 byte (value ignored) to drop everything pending
+#define SCHEDULE_HEADER_SIZE        5
+#define SCHEDULE_DEPTH              32    // Pending reports; more set ERROR_QUEUE_FULL
+#define SCHEDULE_MAX_LEAD_US        60000000  // Due times further ahead are rejected
+#define CLOCK_REG                   0xB5  // Read: slave esp_timer time in µs (uint64_t), sampled
+                                          // when the read request arrives
+#define CLOCK_SIZE                  8
+
+// Staged Reports
+// Reports written to STAGE_REG are held, not sent. A write to LATCH_REG
+// hands them all to their interfaces at once, exactly like a
+// HIDRA_REG_BATCH write, so a general-call latch releases input on every
+// slave in the same USB frame however long staging them one by one took.
+#define STAGE_REG                   0xB6  // Write: [HID register, report...], or 1 byte (value ignored) to drop the staged reports
+#define LATCH_REG                   0xB7  // Write, 1 byte (value ignored): release the staged reports
+#define STAGE_SIZE                  MAX_BATCH_SIZE  // Staged bytes, 2 per record plus the reports
+
 // Configuration Registers (Write-Only)
 #define CONFIG_USB_IDS_REG          0xF0  // 4 bytes: [VID_LSB, VID_MSB, PID_LSB, PID_MSB]
 #define CONFIG_MANUFACTURER_STR_REG 0xF1  // Variable length, null-terminated UTF-8 (max 63 chars)
 #define CONFIG_PRODUCT_STR_REG      0xF2  // Variable length, null-terminated UTF-8 (max 63 chars)
 #define CONFIG_SERIAL_STR_REG       0xF3  // Variable length, null-terminated UTF-8 (max 63 chars)
 #define CONFIG_COMPOSITE_DEVICE_REG 0xF4  // 2 bytes (uint16_t): bitmap of enabled HID interfaces
+#define CONFIG_POLL_INTERVAL_REG    0xF5  // 2 bytes: [HID register, bInterval in ms (1-255)]
+#define CONFIG_IRQ_GPIO_REG         0xF6  // 1 byte: slave GPIO driving the interrupt line, 0xFF disables
+
+// Configuration Transactions (Write-Only, 1 byte payload, value ignored)
+// Between BEGIN and COMMIT, configuration writes only change a staged copy.
+// COMMIT validates it, applies it once and saves NVS once; ABORT drops it.
+// A failed write inside the transaction makes COMMIT fail with its error bits.
+#define CONFIG_BEGIN_REG            0xF7
+#define CONFIG_COMMIT_REG           0xF8
+#define CONFIG_ABORT_REG            0xF9
 #define CONFIG_I2C_ADDR_REG         0xFE  // 1 byte: new 7-bit I2C slave address
 
+// Interrupt Line (optional, open-drain, active low)
+// The slave pulls the line low while any cause is latched. Reading
+// IRQ_CAUSE_REG returns the causes, clears them and releases the line.
+#define IRQ_CAUSE_REG               0xFC  // 1 byte: cause bits (Read-Only)
+#define IRQ_CAUSE_ERROR             0x01  // A command failed; last error is in the extended status
+#define IRQ_CAUSE_QUEUE_HIGH        0x02  // An interface queue is at least 3/4 full
+#define IRQ_CAUSE_OUTPUT_REPORT     0x04  // The host sent an output or feature report (OUTPUT_REPORTS_REG)
+#define IRQ_CAUSE_MACRO_DONE        0x08  // A macro finished or failed (MACRO_STATUS_REG)
+#define IRQ_GPIO_DISABLED           0xFF
+
+// Extended Status Register (Read-Only)
+// One read of EXT_STATUS_SIZE bytes, multi-byte fields little-endian; not cleared on read.
+// Header: [version, USB state, last error bits, interface count, dropped reports (uint32_t)]
+// Then one entry per interface: [HID register, reports queued, free slots]
+#define EXT_STATUS_REG              0xFD
+#define EXT_STATUS_VERSION          1
+#define EXT_STATUS_MAX_INTERFACES   8
+#define EXT_STATUS_HEADER_SIZE      8
+#define EXT_STATUS_ENTRY_SIZE       3
+#define EXT_STATUS_SIZE             (EXT_STATUS_HEADER_SIZE + EXT_STATUS_MAX_INTERFACES * EXT_STATUS_ENTRY_SIZE)
+#define EXT_USB_MOUNTED             0x01
+#define EXT_USB_SUSPENDED           0x02
+
+// Output Reports Register (Read-Only)
+// One read of OUTPUT_REPORTS_SIZE bytes: the latest output or feature report
+// the host sent to each interface (SET_REPORT). Not cleared on read.
+// Header: [version, interface count, change counter (uint16_t, little-endian)].
+// The counter steps on every report from the host and on reconfiguration,
+// so an unchanged value means there is nothing new.
+// Then one entry per interface: [HID register, report type, report ID, length,
+// data (OUTPUT_REPORT_DATA_SIZE bytes)]. The report ID is the interface's own
+// (0 if it has none); length 0 means the host has sent nothing yet, longer
+// reports keep their first OUTPUT_REPORT_DATA_SIZE bytes.
+#define OUTPUT_REPORTS_REG          0xFB
+#define OUTPUT_REPORTS_VERSION      1
+#define OUTPUT_REPORTS_HEADER_SIZE  4
+#define OUTPUT_REPORT_DATA_SIZE     8
+#define OUTPUT_REPORTS_ENTRY_SIZE   (4 + OUTPUT_REPORT_DATA_SIZE)
+#define OUTPUT_REPORTS_SIZE         (OUTPUT_REPORTS_HEADER_SIZE + EXT_STATUS_MAX_INTERFACES * OUTPUT_REPORTS_ENTRY_SIZE)
+#define OUTPUT_REPORT_TYPE_OUTPUT   2
+#define OUTPUT_REPORT_TYPE_FEATURE  3
+
+// Macro Status Register (Read-Only)
+// One read of MACRO_STATUS_SIZE bytes, not cleared on read:
+// [state, slot, position (uint16_t), length (uint16_t), reports (uint16_t)].
+// position is the script offset of the step being played (of the failing
+// step once failed), reports counts the reports queued so far.
+#define MACRO_STATUS_REG            0xFA
+#define MACRO_STATUS_SIZE           8
+#define MACRO_STATE_IDLE            0
+#define MACRO_STATE_RUNNING         1
+#define MACRO_STATE_DONE            2
+#define MACRO_STATE_STOPPED         3  // Stopped by MACRO_STOP or a USB reconfiguration
+#define MACRO_STATE_FAILED          4  // A report was rejected (e.g. its interface is disabled)
+
 // Status Register (Read-Only)
 #define STATUS_REG                  0xFF  // 1 byte: bitmask of internal state
 
@@ -30,6 +178,9 @@
 #define ERROR_PAYLOAD_TOO_LARGE     0x04  // More data than expected
 #define ERROR_INTERFACE_DISABLED    0x08  // HID report for disabled interface
 #define ERROR_NVS_WRITE_FAILED      0x10  // Failed to save config to NVS
+#define ERROR_QUEUE_FULL            0x20  // HID report dropped, interface queue full (or macro slot busy)
+#define STATUS_MACRO_RUNNING        0x40  // A macro is playing (reflects the current state, not cleared)
+#define ERROR_INVALID_VALUE         0x80  // Config value out of range, or a configuration the device cannot apply
 
 // Default Configuration Values
 #define DEFAULT_I2C_ADDR            0x70
@@ -38,6 +189,8 @@
 #define DEFAULT_MANUFACTURER        "HIDra Project"
 #define DEFAULT_PRODUCT             "HIDra Composite HID"
 #define DEFAULT_COMPOSITE_LAYOUT    0x000B  // Keyboard | Mouse | Gamepad
+#define DEFAULT_POLL_INTERVAL_MS    10
+#define DEFAULT_IRQ_GPIO            IRQ_GPIO_DISABLED
 
 // Composite Layout Bitmap
 #define LAYOUT_KEYBOARD             (1 << 0)
@@ -48,6 +201,11 @@
 #define LAYOUT_PEN                  (1 << 5)
 #define LAYOUT_TOUCHSCREEN          (1 << 6)
 #define LAYOUT_TOUCHPAD             (1 << 7)
+#define LAYOUT_NKRO_KEYBOARD        (1 << 8)
+// Mode flag, not an interface: every enabled interface shares one USB
+// interface and IN endpoint, each device type under its own report ID
+#define LAYOUT_SINGLE_INTERFACE     (1 << 15)
+#define LAYOUT_BIT_COUNT            16
 
 // NVS Keys
 #define NVS_NAMESPACE               "hidra"
@@ -58,8 +216,13 @@
 #define NVS_KEY_PRODUCT             "usb.prod"
 #define NVS_KEY_SERIAL              "usb.serial"
 #define NVS_KEY_COMPOSITE_LAYOUT    "usb.layout"
+#define NVS_KEY_POLL_INTERVALS      "usb.interval"  // Blob: bInterval per layout bit
+#define NVS_KEY_IRQ_GPIO            "irq.gpio"
+#define NVS_KEY_CONFIG_BLOB         "config"        // Versioned blob holding all of the above
+#define NVS_KEY_MACRO_PREFIX        "macro."        // Blob per saved macro slot: "macro.0" ...
 
 // Protocol Limits
 #define MAX_STRING_LENGTH           63
 #define MAX_REPORT_SIZE             64
+#define MAX_BATCH_SIZE              128  // Batch payload bytes, record headers included
 #define FACTORY_RESET_GPIO          0  // GPIO pin for factory reset
@@ -14,9 +14,40 @@ from typing import Optional
 HIDRA_REG_KEYBOARD = 0x16
 HIDRA_REG_MOUSE = 0x12
 HIDRA_REG_GAMEPAD = 0x15
+HIDRA_REG_KEY_EVENT = 0x70
+HIDRA_REG_NKRO_KEYBOARD = 0x71
+HIDRA_REG_NKRO_KEYS = 0x72
+HIDRA_REG_BATCH = 0xB0
+KEY_EVENT_RELEASE = 0x00
+KEY_EVENT_PRESS = 0x01
+MACRO_DATA_REG = 0xB1
+MACRO_PLAY_REG = 0xB2
+MACRO_OP_REPORT = 0x01
+MACRO_OP_TEXT = 0x05
+MACRO_STATUS_REG = 0xFA
+MACRO_STATUS_SIZE = 8
+MACRO_STATE_RUNNING = 1
+MACRO_STATE_DONE = 2
+SCHEDULE_REG = 0xB4
+CLOCK_REG = 0xB5
+CLOCK_SIZE = 8
+STAGE_REG = 0xB6
+LATCH_REG = 0xB7
 CONFIG_USB_IDS_REG = 0xF0
 CONFIG_COMPOSITE_DEVICE_REG = 0xF4
+CONFIG_POLL_INTERVAL_REG = 0xF5
+CONFIG_BEGIN_REG = 0xF7
+CONFIG_COMMIT_REG = 0xF8
+CONFIG_ABORT_REG = 0xF9
 CONFIG_I2C_ADDR_REG = 0xFE
+OUTPUT_REPORTS_REG = 0xFB
+OUTPUT_REPORTS_SIZE = 100
+OUTPUT_REPORTS_VERSION = 1
+OUTPUT_REPORTS_ENTRY_SIZE = 12
+IRQ_CAUSE_REG = 0xFC
+EXT_STATUS_REG = 0xFD
+EXT_STATUS_SIZE = 32
+EXT_STATUS_VERSION = 1
 STATUS_REG = 0xFF
 
 STATUS_OK = 0x01
@@ -24,6 +55,10 @@ ERROR_UNKNOWN_REGISTER = 0x02
 ERROR_PAYLOAD_TOO_LARGE = 0x04
 ERROR_INTERFACE_DISABLED = 0x08
 ERROR_NVS_WRITE_FAILED = 0x10
+ERROR_INVALID_VALUE = 0x80
+
+IRQ_CAUSE_ERROR = 0x01
+ERROR_QUEUE_FULL = 0x20
 
 DEFAULT_I2C_ADDR = 0x70
 
@@ -59,6 +94,191 @@ class HidraTestHarness:
             print(f"Status read failed: {e}")
             return None
 
+    def test_extended_status(self) -> bool:
+        """Test extended status block"""
+        print("Testing extended status...")
+
+        try:
+            self.i2c.write(self.device_addr, bytes([EXT_STATUS_REG]))
+            block = self.i2c.read(self.device_addr, EXT_STATUS_SIZE)
+        except Exception as e:
+            print(f"❌ Extended status read failed: {e}")
+            return False
+
+        if not block or len(block) != EXT_STATUS_SIZE or block[0] != EXT_STATUS_VERSION:
+            print(f"❌ Malformed extended status: {block}")
+            return False
+
+        dropped = int.from_bytes(block[4:8], "little")
+        print(f"USB state 0x{block[1]:02X}, last error 0x{block[2]:02X}, dropped {dropped}")
+        for i in range(block[3]):
+            reg, queued, free = block[8 + 3 * i:11 + 3 * i]
+            print(f"  register 0x{reg:02X}: {queued} queued, {free} free")
+
+        print("✅ Extended status read")
+        return True
+
+    def test_output_reports(self) -> bool:
+        """Test the cached host output reports (toggle Caps Lock on the host first)"""
+        print("Testing output reports...")
+
+        try:
+            self.i2c.write(self.device_addr, bytes([OUTPUT_REPORTS_REG]))
+            block = self.i2c.read(self.device_addr, OUTPUT_REPORTS_SIZE)
+        except Exception as e:
+            print(f"❌ Output reports read failed: {e}")
+            return False
+
+        if not block or len(block) != OUTPUT_REPORTS_SIZE or block[0] != OUTPUT_REPORTS_VERSION:
+            print(f"❌ Malformed output reports: {block}")
+            return False
+
+        changes = int.from_bytes(block[2:4], "little")
+        print(f"{block[1]} interfaces, change counter {changes}")
+        for i in range(block[1]):
+            entry = block[4 + OUTPUT_REPORTS_ENTRY_SIZE * i:4 + OUTPUT_REPORTS_ENTRY_SIZE * (i + 1)]
+            reg, report_type, report_id, length = entry[:4]
+            if length:
+                print(f"  register 0x{reg:02X}: type {report_type}, ID {report_id}, data {entry[4:4 + length].hex()}")
+
+        print("✅ Output reports read")
+        return True
+
+    def play_macro(self, script: bytes) -> Optional[bytes]:
+        """Upload a script to slot 0, play it and return its final status block"""
+        # Slot 0, offset 0
+        if not self.write_register(MACRO_DATA_REG, bytes([0, 0, 0]) + script):
+            print("❌ Failed to upload macro")
+            return None
+        status = self.read_status()
+        if status != STATUS_OK:
+            print(f"❌ Macro upload rejected, status: {status}")
+            return None
+
+        if not self.write_register(MACRO_PLAY_REG, bytes([0])):
+            print("❌ Failed to start macro")
+            return None
+
+        block = None
+        for _ in range(50):
+            time.sleep(0.02)
+            try:
+                self.i2c.write(self.device_addr, bytes([MACRO_STATUS_REG]))
+                block = self.i2c.read(self.device_addr, MACRO_STATUS_SIZE)
+            except Exception as e:
+                print(f"❌ Macro status read failed: {e}")
+                return None
+            if block and block[0] != MACRO_STATE_RUNNING:
+                break
+        return block
+
+    def test_macro(self) -> bool:
+        """Test an uploaded macro typing text on its own (focus a text field first)"""
+        print("Testing macro playback...")
+
+        text = b"hidra"
+        block = self.play_macro(bytes([MACRO_OP_TEXT, len(text)]) + text)
+        if not block or block[0] != MACRO_STATE_DONE:
+            print(f"❌ Macro did not finish: {block}")
+            return False
+        reports = int.from_bytes(block[6:8], "little")
+        if reports != 2 * len(text):
+            print(f"❌ Expected {2 * len(text)} reports, macro queued {reports}")
+            return False
+
+        # Key events play like register writes: press and release "a"
+        script = bytes([MACRO_OP_REPORT, HIDRA_REG_KEY_EVENT, 2, 0x04, KEY_EVENT_PRESS,
+                        MACRO_OP_REPORT, HIDRA_REG_KEY_EVENT, 2, 0x04, KEY_EVENT_RELEASE])
+        block = self.play_macro(script)
+        if not block or block[0] != MACRO_STATE_DONE:
+            print(f"❌ Key event macro did not finish: {block}")
+            return False
+
+        print("✅ Macro played")
+        return True
+
+    def read_clock(self) -> Optional[int]:
+        """Read the slave's esp_timer clock in microseconds"""
+        try:
+            self.i2c.write(self.device_addr, bytes([CLOCK_REG]))
+            block = self.i2c.read(self.device_addr, CLOCK_SIZE)
+        except Exception as e:
+            print(f"Clock read failed: {e}")
+            return None
+        return int.from_bytes(block, "little") if block and len(block) == CLOCK_SIZE else None
+
+    def test_scheduled_report(self) -> bool:
+        """Test the slave clock and a mouse report scheduled ahead of time"""
+        print("Testing scheduled reports...")
+
+        first = self.read_clock()
+        time.sleep(0.05)
+        second = self.read_clock()
+        if first is None or second is None or not 40000 <= second - first <= 500000:
+            print(f"❌ Slave clock not advancing as expected: {first} -> {second}")
+            return False
+
+        # Move right 10 pixels, 50 ms from now
+        due = (second + 50000) & 0xFFFFFFFF
+        report = bytes([0x00, 10, 0, 0])
+        if not self.write_register(SCHEDULE_REG, due.to_bytes(4, "little") + bytes([HIDRA_REG_MOUSE]) + report):
+            print("❌ Failed to schedule report")
+            return False
+        status = self.read_status()
+        if status != STATUS_OK:
+            print(f"❌ Scheduled report rejected, status: {status}")
+            return False
+
+        print("✅ Clock read and report scheduled")
+        return True
+
+    def test_stage_latch(self) -> bool:
+        """Test that a staged report waits for the latch"""
+        print("Testing stage and latch...")
+
+        # Move right 10 pixels, held on the slave
+        if not self.write_register(STAGE_REG, bytes([HIDRA_REG_MOUSE, 0x00, 10, 0, 0])):
+            print("❌ Failed to stage report")
+            return False
+        status = self.read_status()
+        if status != STATUS_OK:
+            print(f"❌ Staging rejected, status: {status}")
+            return False
+
+        if not self.write_register(LATCH_REG, bytes([0])):
+            print("❌ Failed to latch")
+            return False
+        status = self.read_status()
+        if status != STATUS_OK:
+            print(f"❌ Latch failed, status: {status}")
+            return False
+
+        print("✅ Staged report released")
+        return True
+
+    def test_irq_cause(self) -> bool:
+        """Test that an error latches an interrupt cause and reading clears it"""
+        print("Testing interrupt cause register...")
+
+        # Provoke an error, then read the cause twice
+        self.write_register(0x99, bytes([0x01]))
+        time.sleep(0.1)
+        try:
+            self.i2c.write(self.device_addr, bytes([IRQ_CAUSE_REG]))
+            first = self.i2c.read(self.device_addr, 1)
+            self.i2c.write(self.device_addr, bytes([IRQ_CAUSE_REG]))
+            second = self.i2c.read(self.device_addr, 1)
+        except Exception as e:
+            print(f"❌ Interrupt cause read failed: {e}")
+            return False
+
+        if not (first[0] & IRQ_CAUSE_ERROR) or second[0] & IRQ_CAUSE_ERROR:
+            print(f"❌ Unexpected causes: 0x{first[0]:02X}, then 0x{second[0]:02X}")
+            return False
+
+        print("✅ Interrupt cause latched and cleared")
+        return True
+
     def test_status_register(self) -> bool:
         """Test status register functionality"""
         print("Testing status register...")
@@ -121,6 +341,43 @@ class HidraTestHarness:
             print(f"❌ Mouse report failed, status: 0x{status:02X}")
             return False
 
+    def test_batch_report(self) -> bool:
+        """Test keyboard and mouse reports sent in one batch write"""
+        print("Testing batch report...")
+
+        keyboard_report = bytes([0] * 8)
+        mouse_report = bytes([0, 1, 0, 0])
+        batch = (bytes([HIDRA_REG_KEYBOARD, len(keyboard_report)]) + keyboard_report +
+                 bytes([HIDRA_REG_MOUSE, len(mouse_report)]) + mouse_report)
+
+        if not self.write_register(HIDRA_REG_BATCH, batch):
+            print("❌ Failed to send batch")
+            return False
+
+        time.sleep(0.1)
+        status = self.read_status()
+        if status is None:
+            print("❌ Failed to read status after batch")
+            return False
+
+        if status != STATUS_OK:
+            print(f"❌ Batch failed, status: 0x{status:02X}")
+            return False
+
+        # A truncated record rejects the whole batch
+        if not self.write_register(HIDRA_REG_BATCH, batch[:-1]):
+            print("❌ Failed to send truncated batch")
+            return False
+
+        time.sleep(0.1)
+        status = self.read_status()
+        if status is None or not (status & ERROR_PAYLOAD_TOO_LARGE):
+            print(f"❌ Expected payload error for truncated batch, got status: {status}")
+            return False
+
+        print("✅ Batch report successful")
+        return True
+
     def test_unknown_register(self) -> bool:
         """Test error handling for unknown register"""
         print("Testing unknown register error...")
@@ -169,11 +426,38 @@ class HidraTestHarness:
             print(f"❌ Expected payload too large error, got status: 0x{status:02X}")
             return False
 
+    def test_invalid_key_action(self) -> bool:
+        """Test that an unknown key event action is rejected"""
+        print("Testing invalid key action error...")
+
+        # Key event action 0x02 and NKRO action 0x03 do not exist
+        for register, payload in ((HIDRA_REG_KEY_EVENT, bytes([0x04, 0x02])),
+                                  (HIDRA_REG_NKRO_KEYS, bytes([0x03, 0x04]))):
+            if not self.write_register(register, payload):
+                print(f"❌ Failed to write register 0x{register:02X}")
+                return False
+
+            time.sleep(0.1)
+            status = self.read_status()
+            if status is None:
+                print(f"❌ Failed to read status after register 0x{register:02X}")
+                return False
+
+            # Without the NKRO interface in the layout the write is rejected
+            # as disabled before the action is looked at
+            if not (status & ERROR_INVALID_VALUE) and not (
+                    register == HIDRA_REG_NKRO_KEYS and status & ERROR_INTERFACE_DISABLED):
+                print(f"❌ Expected invalid value error, got status: 0x{status:02X}")
+                return False
+
+        print("✅ Invalid key actions rejected correctly")
+        return True
+
     def test_usb_id_configuration(self) -> bool:
         """Test USB ID configuration"""
         print("Testing USB ID configuration...")
         
-        # Set new VID/PID (this will cause device reboot)
+        # Set new VID/PID (applied live: the slave re-enumerates on USB)
         vid = 0x1234
         pid = 0x5678
         usb_ids = bytes([
@@ -182,13 +466,60 @@ class HidraTestHarness:
         ])
         
         print(f"Setting VID: 0x{vid:04X}, PID: 0x{pid:04X}")
-        print("⚠️  Device will reboot after this command")
         
+        start = time.monotonic()
         if not self.write_register(CONFIG_USB_IDS_REG, usb_ids):
             print("❌ Failed to send USB ID configuration")
             return False
-            
-        print("✅ USB ID configuration sent (device should reboot)")
+
+        # The slave answers on I2C again once the new descriptors are up
+        status = None
+        while status is None and time.monotonic() - start < 5.0:
+            status = self.read_status()
+        downtime_ms = (time.monotonic() - start) * 1000
+
+        if status is None or not (status & STATUS_OK):
+            print(f"❌ USB ID configuration failed, status: {status}")
+            return False
+
+        print(f"✅ USB ID configuration applied, I2C back after {downtime_ms:.0f} ms")
+        print("   (the slave logs the USB downtime when the host mounts it again)")
+        return True
+
+    def test_config_transaction(self) -> bool:
+        """Test that a failed write inside a transaction fails its commit"""
+        print("Testing configuration transaction...")
+
+        # No open transaction: nothing to commit
+        self.write_register(CONFIG_COMMIT_REG, bytes([0]))
+        time.sleep(0.1)
+        status = self.read_status()
+        if status is None or not (status & ERROR_UNKNOWN_REGISTER):
+            print(f"❌ Expected unknown register for a stray commit, got status: {status}")
+            return False
+
+        # A zero polling interval is refused while staged, and the commit
+        # reports it without changing anything
+        self.write_register(CONFIG_BEGIN_REG, bytes([0]))
+        self.write_register(CONFIG_USB_IDS_REG, bytes([0x34, 0x12, 0x78, 0x56]))
+        self.write_register(CONFIG_POLL_INTERVAL_REG, bytes([HIDRA_REG_KEYBOARD, 0]))
+        self.write_register(CONFIG_COMMIT_REG, bytes([0]))
+        time.sleep(0.1)
+        status = self.read_status()
+        if status is None or (status & STATUS_OK) or not (status & ERROR_INVALID_VALUE):
+            print(f"❌ Expected the commit to fail, got status: {status}")
+            return False
+
+        # Aborting an empty transaction always succeeds
+        self.write_register(CONFIG_BEGIN_REG, bytes([0]))
+        self.write_register(CONFIG_ABORT_REG, bytes([0]))
+        time.sleep(0.1)
+        status = self.read_status()
+        if status is None or not (status & STATUS_OK):
+            print(f"❌ Abort failed, status: {status}")
+            return False
+
+        print("✅ Rejected transaction left the configuration unchanged")
         return True
 
     def run_all_tests(self) -> bool:
@@ -199,10 +530,19 @@ class HidraTestHarness:
         
         tests = [
             ("Status Register", self.test_status_register),
+            ("Extended Status", self.test_extended_status),
+            ("Interrupt Cause", self.test_irq_cause),
+            ("Output Reports", self.test_output_reports),
             ("Keyboard Report", self.test_keyboard_report),
             ("Mouse Report", self.test_mouse_report),
+            ("Batch Report", self.test_batch_report),
+            ("Macro Playback", self.test_macro),
+            ("Scheduled Report", self.test_scheduled_report),
+            ("Stage and Latch", self.test_stage_latch),
             ("Unknown Register Error", self.test_unknown_register),
             ("Payload Too Large Error", self.test_payload_too_large),
+            ("Invalid Key Action Error", self.test_invalid_key_action),
+            ("Configuration Transaction", self.test_config_transaction),
             ("USB ID Configuration", self.test_usb_id_configuration),
         ]
         
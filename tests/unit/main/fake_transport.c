@@ -0,0 +1,79 @@
+#include "fake_transport.h"
+#include "hid_dispatch.h"
+
+static uint8_t fake_register;
+static uint16_t fake_len;
+static fake_transport_send_fn fake_on_send;
+static bool fake_busy;
+static uint32_t fake_sent;
+
+static uint8_t fake_interface_count(void)
+{
+    return 1;
+}
+
+static uint8_t fake_instance_for_register(uint8_t hid_register)
+{
+    return hid_register == fake_register ? 0 : 0xFF;
+}
+
+static uint8_t fake_register_for_instance(uint8_t instance)
+{
+    return fake_register;
+}
+
+static uint16_t fake_report_len(uint8_t instance)
+{
+    return fake_len;
+}
+
+static bool fake_ready(uint8_t instance)
+{
+    return !fake_busy;
+}
+
+static bool fake_send(uint8_t instance, const uint8_t *report, uint16_t len)
+{
+    if (fake_on_send) {
+        fake_on_send(report, len);
+    }
+    fake_sent++;
+    fake_busy = true;
+    return true;
+}
+
+static const hid_dispatch_transport_t fake_transport = {
+    .interface_count = fake_interface_count,
+    .instance_for_register = fake_instance_for_register,
+    .register_for_instance = fake_register_for_instance,
+    .report_len = fake_report_len,
+    .ready = fake_ready,
+    .send = fake_send,
+};
+
+esp_err_t fake_transport_init(uint8_t hid_register, uint16_t report_len,
+                              fake_transport_send_fn on_send)
+{
+    fake_register = hid_register;
+    fake_len = report_len;
+    fake_on_send = on_send;
+    fake_busy = false;
+    fake_sent = 0;
+    return hid_dispatch_init(&fake_transport);
+}
+
+void fake_transport_complete(void)
+{
+    fake_busy = false;
+    hid_dispatch_report_complete(0);
+}
+
+bool fake_transport_busy(void)
+{
+    return fake_busy;
+}
+
+uint32_t fake_transport_sent(void)
+{
+    return fake_sent;
+}
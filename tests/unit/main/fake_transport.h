@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Single-interface stand-in for the USB side of hid_dispatch. on_send sees
+// every report handed to USB; the interface then stays busy until
+// fake_transport_complete() plays the host picking it up.
+typedef void (*fake_transport_send_fn)(const uint8_t *report, uint16_t len);
+
+// Resets the fake and initialises the dispatcher on it
+esp_err_t fake_transport_init(uint8_t hid_register, uint16_t report_len,
+                              fake_transport_send_fn on_send);
+
+// Frees the interface and tells the dispatcher the report went out
+void fake_transport_complete(void);
+
+bool fake_transport_busy(void);
+uint32_t fake_transport_sent(void);
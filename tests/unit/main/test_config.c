@@ -17,6 +17,9 @@ void test_config_management(void)
     TEST_ASSERT_EQUAL_STRING("usb.prod", NVS_KEY_PRODUCT);
     TEST_ASSERT_EQUAL_STRING("usb.serial", NVS_KEY_SERIAL);
     TEST_ASSERT_EQUAL_STRING("usb.layout", NVS_KEY_COMPOSITE_LAYOUT);
+    TEST_ASSERT_EQUAL_STRING("usb.interval", NVS_KEY_POLL_INTERVALS);
+    TEST_ASSERT_EQUAL_STRING("config", NVS_KEY_CONFIG_BLOB);
+    TEST_ASSERT_EQUAL_UINT8(10, DEFAULT_POLL_INTERVAL_MS);
     
     // Test protocol limits
     TEST_ASSERT_EQUAL_UINT8(63, MAX_STRING_LENGTH);
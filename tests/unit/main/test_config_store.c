@@ -0,0 +1,115 @@
+#include "unity.h"
+#include "config_store.h"
+#include "hidra_protocol.h"
+#include <string.h>
+
+void test_config_store(void)
+{
+    hidra_config_t config = {
+        .i2c_addr = 0x42,
+        .usb_vid = 0x1234,
+        .usb_pid = 0x5678,
+        .manufacturer = "Maker",
+        .product = "Panel",
+        .serial = "SN-1",
+        .composite_layout = LAYOUT_KEYBOARD | LAYOUT_NKRO_KEYBOARD,
+        .irq_gpio = 5,
+    };
+    config.poll_interval_ms[8] = 1;
+
+    // Round trip through one blob
+    uint8_t blob[CONFIG_BLOB_SIZE];
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, config_blob_encode(&config, blob, sizeof(blob) - 1));
+    TEST_ASSERT_EQUAL(ESP_OK, config_blob_encode(&config, blob, sizeof(blob)));
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_BLOB_VERSION, blob[0]);
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_BLOB_PAYLOAD_SIZE & 0xFF, blob[1]);
+
+    hidra_config_t loaded;
+    memset(&loaded, 0xAA, sizeof(loaded));
+    TEST_ASSERT_EQUAL(ESP_OK, config_blob_decode(blob, sizeof(blob), &loaded));
+    TEST_ASSERT_EQUAL_HEX8(0x42, loaded.i2c_addr);
+    TEST_ASSERT_EQUAL_HEX16(0x1234, loaded.usb_vid);
+    TEST_ASSERT_EQUAL_HEX16(0x5678, loaded.usb_pid);
+    TEST_ASSERT_EQUAL_HEX16(LAYOUT_KEYBOARD | LAYOUT_NKRO_KEYBOARD, loaded.composite_layout);
+    TEST_ASSERT_EQUAL_UINT8(5, loaded.irq_gpio);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(config.poll_interval_ms, loaded.poll_interval_ms, LAYOUT_BIT_COUNT);
+    TEST_ASSERT_EQUAL_STRING("Maker", loaded.manufacturer);
+    TEST_ASSERT_EQUAL_STRING("Panel", loaded.product);
+    TEST_ASSERT_EQUAL_STRING("SN-1", loaded.serial);
+
+    // A corrupted payload is rejected and leaves the output untouched
+    hidra_config_t untouched = loaded;
+    blob[CONFIG_BLOB_HEADER_SIZE + 1] ^= 0x01;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_CRC, config_blob_decode(blob, sizeof(blob), &loaded));
+    TEST_ASSERT_EQUAL_MEMORY(&untouched, &loaded, sizeof(loaded));
+    blob[CONFIG_BLOB_HEADER_SIZE + 1] ^= 0x01;
+    blob[3] ^= 0x80;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_CRC, config_blob_decode(blob, sizeof(blob), &loaded));
+    blob[3] ^= 0x80;
+
+    // Unknown version, wrong length field and truncated blobs
+    blob[0] = CONFIG_BLOB_VERSION + 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_VERSION, config_blob_decode(blob, sizeof(blob), &loaded));
+    blob[0] = CONFIG_BLOB_VERSION;
+    blob[1]++;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, config_blob_decode(blob, sizeof(blob), &loaded));
+    blob[1]--;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, config_blob_decode(blob, sizeof(blob) - 1, &loaded));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, config_blob_decode(blob, 3, &loaded));
+    TEST_ASSERT_EQUAL(ESP_OK, config_blob_decode(blob, sizeof(blob), &loaded));
+
+    // Strings are terminated even if the stored field is not
+    hidra_config_t raw = loaded;
+    memset(raw.manufacturer, 'A', sizeof(raw.manufacturer));
+    TEST_ASSERT_EQUAL(ESP_OK, config_blob_encode(&raw, blob, sizeof(blob)));
+    TEST_ASSERT_EQUAL(ESP_OK, config_blob_decode(blob, sizeof(blob), &loaded));
+    TEST_ASSERT_EQUAL(MAX_STRING_LENGTH, strlen(loaded.manufacturer));
+
+    // Layouts the baseline stored that no longer fit: all eight types now
+    // count six USB interfaces, a joystick-only layout counts none
+    hidra_config_t legacy = config;
+    legacy.composite_layout = 0x00FF;
+    TEST_ASSERT_FALSE(config_valid(&legacy));
+    legacy.composite_layout = LAYOUT_JOYSTICK;
+    TEST_ASSERT_FALSE(config_valid(&legacy));
+    legacy.composite_layout = DEFAULT_COMPOSITE_LAYOUT;
+    TEST_ASSERT_TRUE(config_valid(&legacy));
+    legacy.i2c_addr = I2C_ADDR_MAX + 1;
+    TEST_ASSERT_FALSE(config_valid(&legacy));
+
+    // A valid blob whose layout no longer fits keeps every other field
+    legacy = config;
+    legacy.composite_layout = 0x00FF;
+    TEST_ASSERT_EQUAL(ESP_OK, config_blob_encode(&legacy, blob, sizeof(blob)));
+    TEST_ASSERT_EQUAL(ESP_OK, config_blob_decode(blob, sizeof(blob), &loaded));
+    TEST_ASSERT_EQUAL_HEX16(DEFAULT_COMPOSITE_LAYOUT, loaded.composite_layout);
+    TEST_ASSERT_EQUAL_HEX8(0x42, loaded.i2c_addr);
+    TEST_ASSERT_EQUAL_HEX16(0x1234, loaded.usb_vid);
+    TEST_ASSERT_EQUAL_HEX16(0x5678, loaded.usb_pid);
+    TEST_ASSERT_EQUAL_STRING("Maker", loaded.manufacturer);
+    TEST_ASSERT_EQUAL_STRING("Panel", loaded.product);
+    TEST_ASSERT_EQUAL_STRING("SN-1", loaded.serial);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(config.poll_interval_ms, loaded.poll_interval_ms, LAYOUT_BIT_COUNT);
+
+    // So does one with a reserved address
+    legacy = config;
+    legacy.i2c_addr = 0x00;
+    TEST_ASSERT_EQUAL(ESP_OK, config_blob_encode(&legacy, blob, sizeof(blob)));
+    TEST_ASSERT_EQUAL(ESP_OK, config_blob_decode(blob, sizeof(blob), &loaded));
+    TEST_ASSERT_EQUAL_HEX8(DEFAULT_I2C_ADDR, loaded.i2c_addr);
+    TEST_ASSERT_EQUAL_HEX16(LAYOUT_KEYBOARD | LAYOUT_NKRO_KEYBOARD, loaded.composite_layout);
+    TEST_ASSERT_EQUAL_STRING("SN-1", loaded.serial);
+
+    // Repair touches only the failing fields
+    legacy = config;
+    TEST_ASSERT_FALSE(config_repair(&legacy));
+    TEST_ASSERT_EQUAL_HEX8(0x42, legacy.i2c_addr);
+    legacy.composite_layout = LAYOUT_JOYSTICK;
+    legacy.i2c_addr = I2C_ADDR_MAX + 1;
+    TEST_ASSERT_TRUE(config_repair(&legacy));
+    TEST_ASSERT_TRUE(config_valid(&legacy));
+    TEST_ASSERT_EQUAL_HEX16(0x1234, legacy.usb_vid);
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, config_blob_encode(NULL, blob, sizeof(blob)));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, config_blob_decode(NULL, sizeof(blob), &loaded));
+}
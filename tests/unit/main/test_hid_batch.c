@@ -0,0 +1,61 @@
+#include "unity.h"
+#include "hid_batch.h"
+#include "hidra_protocol.h"
+
+void test_hid_batch(void)
+{
+    // Keyboard, mouse and consumer input for one frame
+    const uint8_t frame[] = {
+        HIDRA_REG_KEYBOARD, 8, 0x02, 0, 0x04, 0, 0, 0, 0, 0,
+        HIDRA_REG_MOUSE, 4, 0, 5, 0xFB, 0,
+        HIDRA_REG_CONSUMER, 2, 0xE9, 0x00,
+    };
+    size_t count = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, hid_batch_validate(frame, sizeof(frame), &count));
+    TEST_ASSERT_EQUAL(3, count);
+
+    size_t offset = 0;
+    hid_batch_record_t record;
+    TEST_ASSERT_TRUE(hid_batch_next(frame, sizeof(frame), &offset, &record));
+    TEST_ASSERT_EQUAL_HEX8(HIDRA_REG_KEYBOARD, record.hid_register);
+    TEST_ASSERT_EQUAL_UINT8(8, record.len);
+    TEST_ASSERT_EQUAL_PTR(&frame[2], record.report);
+    TEST_ASSERT_TRUE(hid_batch_next(frame, sizeof(frame), &offset, &record));
+    TEST_ASSERT_EQUAL_HEX8(HIDRA_REG_MOUSE, record.hid_register);
+    TEST_ASSERT_EQUAL_HEX8(0xFB, record.report[2]);
+    TEST_ASSERT_TRUE(hid_batch_next(frame, sizeof(frame), &offset, &record));
+    TEST_ASSERT_EQUAL_HEX8(HIDRA_REG_CONSUMER, record.hid_register);
+    TEST_ASSERT_FALSE(hid_batch_next(frame, sizeof(frame), &offset, &record));
+    TEST_ASSERT_EQUAL(sizeof(frame), offset);
+
+    // Truncated header or report, and empty records, reject the whole batch
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, hid_batch_validate(frame, 0, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, hid_batch_validate(frame, 1, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, hid_batch_validate(frame, sizeof(frame) - 1, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, hid_batch_validate(frame, 11, NULL));
+    const uint8_t empty_report[] = {HIDRA_REG_MOUSE, 0};
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, hid_batch_validate(empty_report, sizeof(empty_report), NULL));
+    uint8_t oversized[MAX_BATCH_SIZE] = {HIDRA_REG_MOUSE, MAX_REPORT_SIZE + 1};
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, hid_batch_validate(oversized, sizeof(oversized), NULL));
+    uint8_t too_long[MAX_BATCH_SIZE + 1] = {0};
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, hid_batch_validate(too_long, sizeof(too_long), NULL));
+
+    // Building the same frame record by record gives the same bytes
+    uint8_t built[MAX_BATCH_SIZE];
+    size_t built_len = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, hid_batch_append(built, sizeof(built), &built_len, HIDRA_REG_KEYBOARD, &frame[2], 8));
+    TEST_ASSERT_EQUAL(ESP_OK, hid_batch_append(built, sizeof(built), &built_len, HIDRA_REG_MOUSE, &frame[12], 4));
+    TEST_ASSERT_EQUAL(ESP_OK, hid_batch_append(built, sizeof(built), &built_len, HIDRA_REG_CONSUMER, &frame[18], 2));
+    TEST_ASSERT_EQUAL(sizeof(frame), built_len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(frame, built, sizeof(frame));
+
+    // A record that does not fit leaves the batch as it was
+    const uint8_t big[MAX_REPORT_SIZE] = {0};
+    TEST_ASSERT_EQUAL(ESP_OK, hid_batch_append(built, sizeof(built), &built_len, HIDRA_REG_GAMEPAD, big, sizeof(big)));
+    size_t full_len = built_len;
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, hid_batch_append(built, sizeof(built), &built_len, HIDRA_REG_GAMEPAD, big, sizeof(big)));
+    TEST_ASSERT_EQUAL(full_len, built_len);
+    TEST_ASSERT_EQUAL(ESP_OK, hid_batch_validate(built, built_len, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, hid_batch_append(built, sizeof(built), &built_len, HIDRA_REG_MOUSE, big, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, hid_batch_append(built, sizeof(built), &built_len, HIDRA_REG_MOUSE, big, MAX_REPORT_SIZE + 1));
+}
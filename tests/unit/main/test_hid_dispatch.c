@@ -0,0 +1,260 @@
+#include "unity.h"
+#include "hid_dispatch.h"
+#include "hidra_protocol.h"
+#include "esp_timer.h"
+#include <string.h>
+
+#define DISPATCH_TEST_REPORTS 10000
+
+// Fake USB side: keyboard and gamepad interfaces, one report in flight per endpoint
+static bool fake_busy[2];
+static uint32_t fake_next_seq[2];
+static uint32_t fake_received;
+static bool fake_out_of_order;
+
+static uint8_t fake_interface_count(void)
+{
+    return 2;
+}
+
+static uint8_t fake_instance_for_register(uint8_t hid_register)
+{
+    switch (hid_register) {
+        case HIDRA_REG_KEYBOARD: return 0;
+        case HIDRA_REG_GAMEPAD: return 1;
+        default: return 0xFF;
+    }
+}
+
+static uint8_t fake_register_for_instance(uint8_t instance)
+{
+    return instance ? HIDRA_REG_GAMEPAD : HIDRA_REG_KEYBOARD;
+}
+
+static uint16_t fake_report_len(uint8_t instance)
+{
+    return instance ? 5 : 8;
+}
+
+static bool fake_ready(uint8_t instance)
+{
+    return !fake_busy[instance];
+}
+
+static bool fake_send(uint8_t instance, const uint8_t *report, uint16_t len)
+{
+    uint32_t seq;
+    memcpy(&seq, report, sizeof(seq));
+    if (len != sizeof(seq) || seq != fake_next_seq[instance]) {
+        fake_out_of_order = true;
+    }
+    fake_next_seq[instance] = seq + 1;
+    fake_busy[instance] = true;
+    fake_received++;
+    return true;
+}
+
+// One host polling interval: every busy endpoint completes its transfer
+static void fake_host_interval(void)
+{
+    for (uint8_t i = 0; i < 2; i++) {
+        if (fake_busy[i]) {
+            fake_busy[i] = false;
+            hid_dispatch_report_complete(i);
+        }
+    }
+}
+
+static const hid_dispatch_transport_t fake_transport = {
+    .interface_count = fake_interface_count,
+    .instance_for_register = fake_instance_for_register,
+    .register_for_instance = fake_register_for_instance,
+    .report_len = fake_report_len,
+    .ready = fake_ready,
+    .send = fake_send,
+};
+
+static uint32_t fake_wakes;
+
+static void fake_wake(void)
+{
+    fake_wakes++;
+}
+
+// Event-driven USB side: producers wake the consumer, at most once per pump
+static void test_hid_dispatch_wake(void)
+{
+    hid_dispatch_transport_t transport = fake_transport;
+    transport.wake = fake_wake;
+    memset(fake_busy, 0, sizeof(fake_busy));
+    memset(fake_next_seq, 0, sizeof(fake_next_seq));
+    fake_received = 0;
+    fake_wakes = 0;
+
+    TEST_ASSERT_EQUAL(ESP_OK, hid_dispatch_init(&transport));
+
+    // A burst of reports asks for one pump
+    uint32_t rx_stamp = (uint32_t)esp_timer_get_time();
+    for (uint32_t seq = 0; seq < 3; seq++) {
+        TEST_ASSERT_EQUAL(ESP_OK, hid_dispatch_submit(HIDRA_REG_KEYBOARD, (const uint8_t *)&seq, sizeof(seq), rx_stamp));
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, fake_wakes);
+
+    // Rejected reports do not wake anyone
+    uint8_t oversized[MAX_REPORT_SIZE] = {0};
+    hid_dispatch_submit(HIDRA_REG_GAMEPAD, oversized, sizeof(oversized), rx_stamp);
+    TEST_ASSERT_EQUAL_UINT32(1, fake_wakes);
+
+    // Once the pump has run, the next report wakes the consumer again
+    hid_dispatch_pump();
+    TEST_ASSERT_EQUAL_UINT32(1, fake_received);
+    uint32_t seq = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, hid_dispatch_submit(HIDRA_REG_GAMEPAD, (const uint8_t *)&seq, sizeof(seq), rx_stamp));
+    TEST_ASSERT_EQUAL_UINT32(2, fake_wakes);
+
+    while (fake_received < 4) {
+        hid_dispatch_pump();
+        fake_host_interval();
+    }
+
+    // Every sent report is timed from the stamp it was submitted with
+    hid_dispatch_latency_t latency;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hid_dispatch_get_latency(NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, hid_dispatch_get_latency(&latency));
+    TEST_ASSERT_EQUAL_UINT32(4, latency.count);
+    TEST_ASSERT_LESS_OR_EQUAL(latency.max_us, latency.min_us);
+    TEST_ASSERT_LESS_THAN_UINT32(1000000, latency.max_us);
+    uint32_t histogram_total = 0;
+    for (int i = 0; i < HID_DISPATCH_LATENCY_BUCKETS; i++) {
+        histogram_total += latency.histogram[i];
+    }
+    TEST_ASSERT_EQUAL_UINT32(latency.count, histogram_total);
+
+    hid_dispatch_reset_latency();
+    TEST_ASSERT_EQUAL(ESP_OK, hid_dispatch_get_latency(&latency));
+    TEST_ASSERT_EQUAL_UINT32(0, latency.count);
+
+    // A report released long after the last I2C write (macro, schedule) is
+    // timed from the stamp it gets, not from that write
+    seq = 1;
+    TEST_ASSERT_EQUAL(ESP_OK, hid_dispatch_submit(HIDRA_REG_GAMEPAD, (const uint8_t *)&seq, sizeof(seq),
+                                                  (uint32_t)esp_timer_get_time()));
+    while (fake_received < 5) {
+        hid_dispatch_pump();
+        fake_host_interval();
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, hid_dispatch_get_latency(&latency));
+    TEST_ASSERT_EQUAL_UINT32(1, latency.count);
+    TEST_ASSERT_LESS_THAN_UINT32(1000000, latency.max_us);
+
+    hid_dispatch_deinit();
+}
+
+void test_hid_dispatch(void)
+{
+    memset(fake_busy, 0, sizeof(fake_busy));
+    memset(fake_next_seq, 0, sizeof(fake_next_seq));
+    fake_received = 0;
+    fake_out_of_order = false;
+
+    TEST_ASSERT_EQUAL(ESP_OK, hid_dispatch_init(&fake_transport));
+    TEST_ASSERT_EQUAL_UINT8(2, hid_dispatch_instance_count());
+
+    // Reports for unknown registers or longer than the interface report are rejected
+    uint8_t oversized[MAX_REPORT_SIZE] = {0};
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, hid_dispatch_submit(HIDRA_REG_PEN, oversized, 1, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, hid_dispatch_submit(HIDRA_REG_GAMEPAD, oversized, 6, 0));
+
+    uint32_t seq[2] = {0, 0};
+    uint32_t submitted = 0;
+    uint32_t intervals = 0;
+
+    while (submitted < DISPATCH_TEST_REPORTS) {
+        // Producer: keyboard and gamepad interleaved until a ring is full
+        while (submitted < DISPATCH_TEST_REPORTS) {
+            uint8_t instance = (submitted % 3 == 0) ? 1 : 0;
+            if (hid_dispatch_submit(fake_register_for_instance(instance), (const uint8_t *)&seq[instance],
+                                    sizeof(uint32_t), (uint32_t)esp_timer_get_time()) != ESP_OK) {
+                break;
+            }
+            seq[instance]++;
+            submitted++;
+        }
+
+        hid_dispatch_pump();
+        fake_host_interval();
+        intervals++;
+    }
+
+    // Drain what is left
+    while (fake_received < DISPATCH_TEST_REPORTS && intervals < 2 * DISPATCH_TEST_REPORTS) {
+        hid_dispatch_pump();
+        fake_host_interval();
+        intervals++;
+    }
+
+    TEST_ASSERT_FALSE(fake_out_of_order);
+    TEST_ASSERT_EQUAL_UINT32(DISPATCH_TEST_REPORTS, fake_received);
+    TEST_ASSERT_EQUAL_UINT32(seq[0], fake_next_seq[0]);
+    TEST_ASSERT_EQUAL_UINT32(seq[1], fake_next_seq[1]);
+
+    // The busiest endpoint sends a report every interval, with no idle gaps
+    TEST_ASSERT_LESS_OR_EQUAL(seq[0], intervals);
+
+    // Rings are sized per interface and report their fill statistics
+    hid_dispatch_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, hid_dispatch_get_stats(0, &stats));
+    TEST_ASSERT_EQUAL_HEX8(HIDRA_REG_KEYBOARD, stats.hid_register);
+    TEST_ASSERT_EQUAL_UINT16(8, stats.slot_size);
+    TEST_ASSERT_EQUAL_UINT16(HID_DISPATCH_RING_DEPTH, stats.capacity);
+    TEST_ASSERT_EQUAL_UINT16(0, stats.depth);
+    TEST_ASSERT_EQUAL_UINT16(HID_DISPATCH_RING_DEPTH, stats.high_water);
+    TEST_ASSERT_EQUAL(ESP_OK, hid_dispatch_get_stats(1, &stats));
+    TEST_ASSERT_EQUAL_UINT16(5, stats.slot_size);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hid_dispatch_get_stats(2, &stats));
+
+    // Extended status block: header, then one entry per interface
+    uint8_t block[EXT_STATUS_SIZE];
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hid_dispatch_encode_ext_status(0, 0, block, EXT_STATUS_SIZE - 1));
+    TEST_ASSERT_EQUAL(ESP_OK, hid_dispatch_encode_ext_status(EXT_USB_MOUNTED, ERROR_QUEUE_FULL, block, sizeof(block)));
+    TEST_ASSERT_EQUAL_HEX8(EXT_STATUS_VERSION, block[0]);
+    TEST_ASSERT_EQUAL_HEX8(EXT_USB_MOUNTED, block[1]);
+    TEST_ASSERT_EQUAL_HEX8(ERROR_QUEUE_FULL, block[2]);
+    TEST_ASSERT_EQUAL_UINT8(2, block[3]);
+    hid_dispatch_stats_t kbd_stats;
+    hid_dispatch_get_stats(0, &kbd_stats);
+    uint32_t dropped = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+    TEST_ASSERT_EQUAL_UINT32(kbd_stats.dropped + stats.dropped, dropped);
+    const uint8_t *entry = &block[EXT_STATUS_HEADER_SIZE];
+    TEST_ASSERT_EQUAL_HEX8(HIDRA_REG_KEYBOARD, entry[0]);
+    TEST_ASSERT_EQUAL_UINT8(0, entry[1]);
+    TEST_ASSERT_EQUAL_UINT8(HID_DISPATCH_RING_DEPTH, entry[2]);
+    TEST_ASSERT_EQUAL_HEX8(HIDRA_REG_GAMEPAD, entry[EXT_STATUS_ENTRY_SIZE]);
+
+    // A queued report takes a slot
+    uint32_t one = seq[1];
+    TEST_ASSERT_EQUAL(ESP_OK, hid_dispatch_submit(HIDRA_REG_GAMEPAD, (const uint8_t *)&one, sizeof(one), (uint32_t)esp_timer_get_time()));
+    hid_dispatch_encode_ext_status(0, 0, block, sizeof(block));
+    TEST_ASSERT_EQUAL_UINT8(1, entry[EXT_STATUS_ENTRY_SIZE + 1]);
+    TEST_ASSERT_EQUAL_UINT8(HID_DISPATCH_RING_DEPTH - 1, entry[EXT_STATUS_ENTRY_SIZE + 2]);
+
+    // GET_REPORT reads the last report sent, not the one still queued
+    uint8_t last[MAX_REPORT_SIZE];
+    uint32_t last_seq;
+    TEST_ASSERT_EQUAL(sizeof(uint32_t), hid_dispatch_get_last_report(1, last, sizeof(last)));
+    memcpy(&last_seq, last, sizeof(last_seq));
+    TEST_ASSERT_EQUAL_UINT32(seq[1] - 1, last_seq);
+    TEST_ASSERT_EQUAL(0, hid_dispatch_get_last_report(1, last, sizeof(uint32_t) - 1));
+    TEST_ASSERT_EQUAL(0, hid_dispatch_get_last_report(2, last, sizeof(last)));
+
+    hid_dispatch_deinit();
+
+    // Before anything is sent the host reads an idle report
+    TEST_ASSERT_EQUAL(ESP_OK, hid_dispatch_init(&fake_transport));
+    memset(last, 0xFF, sizeof(last));
+    TEST_ASSERT_EQUAL(8, hid_dispatch_get_last_report(0, last, sizeof(last)));
+    TEST_ASSERT_EACH_EQUAL_UINT8(0, last, 8);
+    hid_dispatch_deinit();
+
+    test_hid_dispatch_wake();
+}
@@ -0,0 +1,353 @@
+#include "unity.h"
+#include "hidra_fleet.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static hidra_device_handle_t mock_device_handle = (hidra_device_handle_t)0x87654321;
+static hidra_fleet_handle_t mock_fleet_handle = (hidra_fleet_handle_t)0x11223344;
+
+// Slots picked by n transactions; each slot keeps work unless listed in idle
+static void run(hidra_fleet_sched_t *sched, uint8_t *order, size_t n, const bool *idle)
+{
+    for (size_t i = 0; i < n; i++) {
+        order[i] = hidra_fleet_sched_next(sched);
+        hidra_fleet_sched_done(sched, !(idle && idle[order[i]]));
+    }
+}
+
+static void test_sched_round_robin(void)
+{
+    hidra_fleet_sched_t sched;
+    hidra_fleet_sched_init(&sched);
+    TEST_ASSERT_EQUAL_UINT8(HIDRA_FLEET_NO_DEVICE, hidra_fleet_sched_next(&sched));
+
+    // Equal priorities take turns in the order they got work
+    hidra_fleet_sched_ready(&sched, 5);
+    hidra_fleet_sched_ready(&sched, 2);
+    hidra_fleet_sched_ready(&sched, 9);
+    hidra_fleet_sched_ready(&sched, 2);     // Already waiting
+    uint8_t order[6];
+    run(&sched, order, 6, NULL);
+    const uint8_t expected[] = {5, 2, 9, 5, 2, 9};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, order, sizeof(expected));
+
+    // A slot out of work leaves the ring and rejoins at the back
+    bool idle[HIDRA_FLEET_MAX_DEVICES] = {0};
+    idle[2] = true;
+    run(&sched, order, 4, idle);
+    const uint8_t expected_idle[] = {5, 2, 9, 5};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected_idle, order, sizeof(expected_idle));
+    hidra_fleet_sched_ready(&sched, 2);
+    run(&sched, order, 3, NULL);
+    const uint8_t expected_back[] = {9, 5, 2};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected_back, order, sizeof(expected_back));
+}
+
+static void test_sched_priority(void)
+{
+    hidra_fleet_sched_t sched;
+    hidra_fleet_sched_init(&sched);
+
+    // Priority 3 gets three transactions per turn, priority 1 gets one
+    hidra_fleet_sched_set_priority(&sched, 0, 3);
+    hidra_fleet_sched_ready(&sched, 0);
+    hidra_fleet_sched_ready(&sched, 1);
+    hidra_fleet_sched_ready(&sched, 2);
+    uint8_t order[10];
+    run(&sched, order, 10, NULL);
+    const uint8_t expected[] = {0, 0, 0, 1, 2, 0, 0, 0, 1, 2};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, order, sizeof(expected));
+
+    // Out-of-range priorities are clamped
+    hidra_fleet_sched_set_priority(&sched, 1, 0);
+    hidra_fleet_sched_set_priority(&sched, 2, 200);
+    TEST_ASSERT_EQUAL_UINT8(1, sched.priority[1]);
+    TEST_ASSERT_EQUAL_UINT8(HIDRA_FLEET_MAX_PRIORITY, sched.priority[2]);
+}
+
+static void test_sched_remove(void)
+{
+    hidra_fleet_sched_t sched;
+    hidra_fleet_sched_init(&sched);
+    hidra_fleet_sched_set_priority(&sched, 1, 2);
+    for (uint8_t slot = 1; slot <= 4; slot++) {
+        hidra_fleet_sched_ready(&sched, slot);
+    }
+
+    // Removing the head mid-turn hands the next slot a full turn
+    TEST_ASSERT_EQUAL_UINT8(1, hidra_fleet_sched_next(&sched));
+    hidra_fleet_sched_done(&sched, true);
+    hidra_fleet_sched_remove(&sched, 1);
+    hidra_fleet_sched_remove(&sched, 3);
+    hidra_fleet_sched_remove(&sched, 7);    // Not waiting
+    uint8_t order[4];
+    run(&sched, order, 4, NULL);
+    const uint8_t expected[] = {2, 4, 2, 4};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, order, sizeof(expected));
+    TEST_ASSERT_EQUAL_UINT8(2, sched.count);
+    TEST_ASSERT_FALSE(sched.waiting[1]);
+}
+
+static void test_sched_full_bus(void)
+{
+    hidra_fleet_sched_t sched;
+    hidra_fleet_sched_init(&sched);
+
+    // Every address busy: each device waits exactly the sum of the others'
+    // priorities between turns, however long the ring has been turning
+    for (uint8_t slot = 0; slot < HIDRA_FLEET_MAX_DEVICES; slot++) {
+        hidra_fleet_sched_set_priority(&sched, slot, 1 + slot % HIDRA_FLEET_MAX_PRIORITY);
+        hidra_fleet_sched_ready(&sched, slot);
+    }
+    uint32_t total = 0;
+    for (uint8_t slot = 0; slot < HIDRA_FLEET_MAX_DEVICES; slot++) {
+        total += sched.priority[slot];
+    }
+
+    static uint32_t turns[HIDRA_FLEET_MAX_DEVICES];
+    static int32_t last_end[HIDRA_FLEET_MAX_DEVICES];
+    memset(turns, 0, sizeof(turns));
+    for (size_t i = 0; i < HIDRA_FLEET_MAX_DEVICES; i++) {
+        last_end[i] = -1;
+    }
+    for (int32_t step = 0; step < (int32_t)total * 3; step++) {
+        uint8_t slot = hidra_fleet_sched_next(&sched);
+        TEST_ASSERT_NOT_EQUAL(HIDRA_FLEET_NO_DEVICE, slot);
+        if (last_end[slot] >= 0 && step - last_end[slot] > 1) {
+            TEST_ASSERT_EQUAL_INT32(total - sched.priority[slot], step - last_end[slot] - 1);
+        }
+        last_end[slot] = step;
+        turns[slot]++;
+        hidra_fleet_sched_done(&sched, true);
+    }
+    for (uint8_t slot = 0; slot < HIDRA_FLEET_MAX_DEVICES; slot++) {
+        TEST_ASSERT_EQUAL_UINT32(3 * sched.priority[slot], turns[slot]);
+    }
+}
+
+static void test_fleet_arguments(void)
+{
+    hidra_fleet_config_t config = {.timeout_ms = 50, .task_priority = 5};
+    hidra_fleet_handle_t fleet;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_create(NULL, &fleet));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_create(&config, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_delete(NULL));
+
+    hidra_fleet_device_config_t device_config = {.priority = 1};
+    hidra_fleet_device_id_t id;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_add_device(NULL, mock_device_handle, &device_config, &id));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_add_device(mock_fleet_handle, NULL, &device_config, &id));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_add_device(mock_fleet_handle, mock_device_handle, NULL, &id));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_add_device(mock_fleet_handle, mock_device_handle, &device_config, NULL));
+    device_config.priority = HIDRA_FLEET_MAX_PRIORITY + 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_add_device(mock_fleet_handle, mock_device_handle, &device_config, &id));
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_remove_device(NULL, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_remove_device(mock_fleet_handle, HIDRA_FLEET_MAX_DEVICES));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_set_priority(NULL, 0, 1));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_set_priority(mock_fleet_handle, 0, HIDRA_FLEET_MAX_PRIORITY + 1));
+
+    uint8_t report[MAX_REPORT_SIZE + 1] = {0};
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_submit(NULL, 0, HIDRA_REG_MOUSE, report, 4, NULL, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_submit(mock_fleet_handle, HIDRA_FLEET_MAX_DEVICES, HIDRA_REG_MOUSE, report, 4, NULL, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_submit(mock_fleet_handle, 0, HIDRA_REG_MOUSE, NULL, 4, NULL, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_submit(mock_fleet_handle, 0, HIDRA_REG_MOUSE, report, 0, NULL, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_submit(mock_fleet_handle, 0, HIDRA_REG_MOUSE, report, sizeof(report), NULL, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_flush(NULL, 10));
+
+    hidra_fleet_device_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_get_device_stats(NULL, 0, &stats));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_get_device_stats(mock_fleet_handle, 0, NULL));
+}
+
+// Fake bus behind the fleet task: the broken device fails every write and
+// status read, the others answer STATUS_OK. While fake_hold is set each
+// write waits for a give of fake_gate, so reports pile up behind it.
+static hidra_device_handle_t const dev_a = (hidra_device_handle_t)0x1001;
+static hidra_device_handle_t const dev_b = (hidra_device_handle_t)0x1002;
+static hidra_device_handle_t volatile fake_broken;
+static volatile bool fake_hold;
+static SemaphoreHandle_t fake_gate;
+static volatile size_t fake_writes;
+
+static esp_err_t fake_transmit(hidra_device_handle_t device, const uint8_t* data, size_t len, int timeout_ms)
+{
+    fake_writes++;
+    if (fake_hold) {
+        xSemaphoreTake(fake_gate, portMAX_DELAY);
+    }
+    return device == fake_broken ? ESP_ERR_TIMEOUT : ESP_OK;
+}
+
+static esp_err_t fake_transmit_receive(hidra_device_handle_t device, const uint8_t* data, size_t len,
+                                       uint8_t* read_buffer, size_t read_len, int timeout_ms)
+{
+    if (device == fake_broken) {
+        return ESP_ERR_TIMEOUT;
+    }
+    read_buffer[0] = STATUS_OK;
+    return ESP_OK;
+}
+
+static const hidra_transport_t fake_transport = {
+    .transmit = fake_transmit,
+    .transmit_receive = fake_transmit_receive,
+};
+
+static esp_err_t done_results[8];
+static volatile size_t done_count;
+
+static void record_done(esp_err_t result, uint8_t status, void* ctx)
+{
+    done_results[(size_t)ctx] = result;
+    done_count++;
+}
+
+static void wait_writes(size_t n)
+{
+    for (int i = 0; i < 1000 && fake_writes < n; i++) {
+        vTaskDelay(1);
+    }
+    TEST_ASSERT_EQUAL(n, fake_writes);
+}
+
+static hidra_fleet_device_state_t wait_state(hidra_fleet_handle_t fleet, hidra_fleet_device_id_t id,
+                                             hidra_fleet_device_state_t state)
+{
+    hidra_fleet_device_stats_t stats;
+    for (int i = 0; i < 1000; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_get_device_stats(fleet, id, &stats));
+        if (stats.state == state) {
+            break;
+        }
+        vTaskDelay(1);
+    }
+    return stats.state;
+}
+
+static hidra_fleet_handle_t removing_fleet;
+static hidra_fleet_device_id_t removing_id;
+static esp_err_t removed_result;
+static SemaphoreHandle_t removed;
+
+// Unity asserts only from the test task: the result is checked there
+static void remove_task(void *arg)
+{
+    removed_result = hidra_fleet_remove_device(removing_fleet, removing_id);
+    xSemaphoreGive(removed);
+    vTaskDelete(NULL);
+}
+
+static void test_fleet_runtime(void)
+{
+    fake_broken = dev_b;
+    fake_hold = true;
+    fake_writes = 0;
+    done_count = 0;
+    fake_gate = xSemaphoreCreateBinary();
+    removed = xSemaphoreCreateBinary();
+
+    hidra_fleet_config_t config = {.timeout_ms = 50, .task_priority = 5, .read_status = true,
+                                   .offline_after = 2, .retry_ms = 20, .transport = &fake_transport};
+    hidra_fleet_handle_t fleet;
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_create(&config, &fleet));
+    hidra_fleet_device_config_t device_config = {.priority = 1, .queue_depth = 4};
+    hidra_fleet_device_id_t a, b;
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_add_device(fleet, dev_a, &device_config, &a));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_add_device(fleet, dev_b, &device_config, &b));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, hidra_fleet_add_device(fleet, dev_b, &device_config, &b));
+
+    // Two failed writes in a row take B offline; what it still had queued
+    // fails with ESP_ERR_INVALID_STATE instead of waiting for the bus
+    const uint8_t report[4] = {0x01, 0x02, 0x03, 0x04};
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_submit(fleet, b, HIDRA_REG_MOUSE, report, 4, record_done, (void*)0));
+    wait_writes(1);
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_submit(fleet, b, HIDRA_REG_MOUSE, report, 4, record_done, (void*)1));
+    xSemaphoreGive(fake_gate);
+    wait_writes(2);
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_submit(fleet, b, HIDRA_REG_MOUSE, report, 4, record_done, (void*)2));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_submit(fleet, b, HIDRA_REG_MOUSE, report, 4, record_done, (void*)3));
+    fake_hold = false;
+    xSemaphoreGive(fake_gate);
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_flush(fleet, 1000));
+    TEST_ASSERT_EQUAL(4, done_count);
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, done_results[0]);
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, done_results[1]);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, done_results[2]);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, done_results[3]);
+
+    hidra_fleet_device_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_get_device_stats(fleet, b, &stats));
+    TEST_ASSERT_EQUAL(HIDRA_FLEET_DEVICE_OFFLINE, stats.state);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.writes);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.errors);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.dropped);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.reports);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.queued);
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, stats.last_error);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, hidra_fleet_submit(fleet, b, HIDRA_REG_MOUSE, report, 4, NULL, NULL));
+
+    // The other device keeps working; its latency counts from submit to
+    // write done, here 5 ms spent behind a busy bus
+    fake_hold = true;
+    size_t writes = fake_writes;
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_submit(fleet, a, HIDRA_REG_MOUSE, report, 4, record_done, (void*)4));
+    wait_writes(writes + 1);
+    vTaskDelay(5);
+    fake_hold = false;
+    xSemaphoreGive(fake_gate);
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_flush(fleet, 1000));
+    TEST_ASSERT_EQUAL(ESP_OK, done_results[4]);
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_get_device_stats(fleet, a, &stats));
+    TEST_ASSERT_EQUAL(HIDRA_FLEET_DEVICE_ONLINE, stats.state);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.reports);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.writes);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.errors);
+    TEST_ASSERT_GREATER_OR_EQUAL(5000, stats.max_latency_us);
+    TEST_ASSERT_EQUAL_INT64(stats.max_latency_us, stats.total_latency_us);
+
+    // Once B answers a status probe it is back in the rotation
+    fake_broken = NULL;
+    TEST_ASSERT_EQUAL(HIDRA_FLEET_DEVICE_ONLINE, wait_state(fleet, b, HIDRA_FLEET_DEVICE_ONLINE));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_get_device_stats(fleet, b, &stats));
+    TEST_ASSERT_EQUAL_UINT8(0, stats.consecutive_errors);
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_submit(fleet, b, HIDRA_REG_MOUSE, report, 4, record_done, (void*)5));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_flush(fleet, 1000));
+    TEST_ASSERT_EQUAL(ESP_OK, done_results[5]);
+
+    // Removing a device refuses new reports but writes out the queued ones
+    fake_hold = true;
+    writes = fake_writes;
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_submit(fleet, a, HIDRA_REG_MOUSE, report, 4, record_done, (void*)6));
+    wait_writes(writes + 1);
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_submit(fleet, a, HIDRA_REG_MOUSE, report, 4, record_done, (void*)7));
+    removing_fleet = fleet;
+    removing_id = a;
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(remove_task, "remove", 4096, NULL, 5, NULL));
+    for (int i = 0; i < 1000 && hidra_fleet_submit(fleet, a, HIDRA_REG_MOUSE, report, 4, NULL, NULL) == ESP_OK; i++) {
+        vTaskDelay(1);
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, hidra_fleet_submit(fleet, a, HIDRA_REG_MOUSE, report, 4, NULL, NULL));
+    fake_hold = false;
+    xSemaphoreGive(fake_gate);
+    TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(removed, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_EQUAL(ESP_OK, removed_result);
+    TEST_ASSERT_EQUAL(ESP_OK, done_results[6]);
+    TEST_ASSERT_EQUAL(ESP_OK, done_results[7]);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_fleet_get_device_stats(fleet, a, &stats));
+
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_fleet_delete(fleet));
+    vSemaphoreDelete(removed);
+    vSemaphoreDelete(fake_gate);
+}
+
+void test_hidra_fleet(void)
+{
+    test_sched_round_robin();
+    test_sched_priority();
+    test_sched_remove();
+    test_sched_full_bus();
+    test_fleet_arguments();
+    test_fleet_runtime();
+}
@@ -1,12 +1,167 @@
 #include "unity.h"
 #include "hidra.h"
+#include "hidra_async.h"
+#include "hidra_irq.h"
+#include "hidra_broadcast.h"
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include <string.h>
 
 // Mock I2C handles for testing
 static hidra_bus_handle_t mock_bus_handle = (hidra_bus_handle_t)0x12345678;
 static hidra_device_handle_t mock_device_handle = (hidra_device_handle_t)0x87654321;
 
+// Fake bus behind the async flush task: records every write, answers status
+// reads with fake_status, and holds a write while fake_gate is set
+static uint8_t fake_writes[4][MAX_BATCH_SIZE + 1];
+static size_t fake_write_len[4];
+static volatile size_t fake_write_count;
+static volatile size_t fake_status_reads;
+static SemaphoreHandle_t volatile fake_gate;
+static esp_err_t fake_result;
+static const uint8_t fake_status = STATUS_OK;
+
+static esp_err_t fake_transmit(hidra_device_handle_t device, const uint8_t* data, size_t len, int timeout_ms)
+{
+    TEST_ASSERT_EQUAL_PTR(mock_device_handle, device);
+    if (fake_write_count < 4) {
+        memcpy(fake_writes[fake_write_count], data, len);
+        fake_write_len[fake_write_count] = len;
+    }
+    fake_write_count++;
+    SemaphoreHandle_t gate = fake_gate;
+    if (gate) {
+        xSemaphoreTake(gate, portMAX_DELAY);
+    }
+    return fake_result;
+}
+
+static esp_err_t fake_transmit_receive(hidra_device_handle_t device, const uint8_t* data, size_t len,
+                                       uint8_t* read_buffer, size_t read_len, int timeout_ms)
+{
+    TEST_ASSERT_EQUAL_UINT8(STATUS_REG, data[0]);
+    fake_status_reads++;
+    read_buffer[0] = fake_status;
+    return ESP_OK;
+}
+
+static const hidra_transport_t fake_transport = {
+    .transmit = fake_transmit,
+    .transmit_receive = fake_transmit_receive,
+};
+
+static esp_err_t done_results[8];
+static uint8_t done_status[8];
+static volatile size_t done_count;
+
+static void record_done(esp_err_t result, uint8_t status, void* ctx)
+{
+    size_t index = (size_t)ctx;
+    done_results[index] = result;
+    done_status[index] = status;
+    done_count++;
+}
+
+static void test_async_writes(void)
+{
+    fake_write_count = 0;
+    fake_status_reads = 0;
+    fake_result = ESP_OK;
+    done_count = 0;
+    fake_gate = xSemaphoreCreateBinary();
+
+    hidra_async_config_t config = {.timeout_ms = 50, .task_priority = 5, .read_status = true,
+                                   .queue_depth = 4, .transport = &fake_transport};
+    hidra_async_handle_t handle;
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_async_create(mock_device_handle, &config, &handle));
+
+    // The first report is written at once, alone, to its own register; the
+    // flush task then stays inside that write until the gate opens
+    const uint8_t mouse[4] = {0x01, 0x02, 0x03, 0x04};
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_async_submit(handle, HIDRA_REG_MOUSE, mouse, sizeof(mouse), record_done, (void*)0));
+    for (int i = 0; i < 1000 && fake_write_count == 0; i++) {
+        vTaskDelay(1);
+    }
+    TEST_ASSERT_EQUAL(1, fake_write_count);
+
+    // Meanwhile the queue fills up; a full queue refuses without blocking
+    const uint8_t keys[8] = {0, 0, 0x04};
+    const uint8_t consumer[2] = {0xE9, 0x00};
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_async_submit(handle, HIDRA_REG_KEYBOARD, keys, sizeof(keys), record_done, (void*)1));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_async_submit(handle, HIDRA_REG_CONSUMER, consumer, sizeof(consumer), record_done, (void*)2));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_async_submit(handle, HIDRA_REG_MOUSE, mouse, sizeof(mouse), record_done, (void*)3));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_async_submit(handle, HIDRA_REG_KEYBOARD, keys, sizeof(keys), NULL, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, hidra_async_submit(handle, HIDRA_REG_MOUSE, mouse, sizeof(mouse), NULL, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, hidra_async_flush(handle, 20));
+    TEST_ASSERT_EQUAL(0, done_count);
+
+    // Once the bus frees up, the four queued reports go out in one batch write
+    SemaphoreHandle_t gate = fake_gate;
+    fake_gate = NULL;
+    xSemaphoreGive(gate);
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_async_flush(handle, 1000));
+    TEST_ASSERT_EQUAL(2, fake_write_count);
+    TEST_ASSERT_EQUAL(2, fake_status_reads);
+
+    const uint8_t single[] = {HIDRA_REG_MOUSE, 0x01, 0x02, 0x03, 0x04};
+    TEST_ASSERT_EQUAL(sizeof(single), fake_write_len[0]);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(single, fake_writes[0], sizeof(single));
+    TEST_ASSERT_EQUAL(1 + 4 * BATCH_RECORD_HEADER_SIZE + 8 + 2 + 4 + 8, fake_write_len[1]);
+    TEST_ASSERT_EQUAL_UINT8(HIDRA_REG_BATCH, fake_writes[1][0]);
+    const uint8_t first_records[] = {HIDRA_REG_KEYBOARD, 8, 0, 0, 0x04, 0, 0, 0, 0, 0,
+                                     HIDRA_REG_CONSUMER, 2, 0xE9, 0x00, HIDRA_REG_MOUSE, 4};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(first_records, &fake_writes[1][1], sizeof(first_records));
+
+    // Each report's callback gets the result and status of its write
+    TEST_ASSERT_EQUAL(4, done_count);
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, done_results[i]);
+        TEST_ASSERT_EQUAL_UINT8(fake_status, done_status[i]);
+    }
+
+    // A failed write fails every report in it, and no status is read
+    fake_result = ESP_ERR_TIMEOUT;
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_async_submit(handle, HIDRA_REG_MOUSE, mouse, sizeof(mouse), record_done, (void*)4));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_async_flush(handle, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, done_results[4]);
+    TEST_ASSERT_EQUAL_UINT8(0, done_status[4]);
+    TEST_ASSERT_EQUAL(2, fake_status_reads);
+
+    hidra_async_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_async_get_stats(handle, &stats));
+    TEST_ASSERT_EQUAL_UINT32(6, stats.reports);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.writes);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.errors);
+
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_async_delete(handle));
+    vSemaphoreDelete(gate);
+}
+
+static void test_report_batch(void)
+{
+    // Records fill a write up to MAX_BATCH_SIZE bytes, headers included
+    uint8_t report[MAX_REPORT_SIZE] = {0};
+    hidra_report_batch_t batch;
+    hidra_report_batch_init(&batch);
+    TEST_ASSERT_TRUE(hidra_report_batch_add(&batch, HIDRA_REG_KEYBOARD, report, MAX_REPORT_SIZE));
+    TEST_ASSERT_TRUE(hidra_report_batch_add(&batch, HIDRA_REG_MOUSE, report, MAX_BATCH_SIZE - MAX_REPORT_SIZE - 2 * BATCH_RECORD_HEADER_SIZE));
+    TEST_ASSERT_EQUAL(MAX_BATCH_SIZE, batch.size);
+    TEST_ASSERT_FALSE(hidra_report_batch_add(&batch, HIDRA_REG_MOUSE, report, 1));
+    TEST_ASSERT_EQUAL(2, batch.count);
+
+    hidra_report_batch_init(&batch);
+    for (size_t i = 0; i < HIDRA_REPORT_BATCH_MAX_REPORTS; i++) {
+        TEST_ASSERT_TRUE(hidra_report_batch_add(&batch, HIDRA_REG_CONSUMER, report, 1));
+    }
+    TEST_ASSERT_FALSE(hidra_report_batch_add(&batch, HIDRA_REG_CONSUMER, report, 1));
+
+    hidra_report_batch_init(&batch);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_report_batch_send(&fake_transport, mock_device_handle, &batch, NULL, 50));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_report_batch_send(&fake_transport, NULL, &batch, NULL, 50));
+}
+
 void test_hidra_master_api(void)
 {
     // Test parameter validation
@@ -16,6 +171,13 @@ void test_hidra_master_api(void)
     TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_add_device_to_bus(mock_bus_handle, 0x70, NULL));
     TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_remove_device_from_bus(NULL));
     
+    // Test bus speed validation
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_add_device_to_bus_with_speed(NULL, 0x70, HIDRA_SPEED_FAST, &mock_device_handle));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_add_device_to_bus_with_speed(mock_bus_handle, 0x70, (hidra_bus_speed_t)200000, &mock_device_handle));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_add_device_probed(NULL, 0x70, HIDRA_SPEED_FAST_PLUS, &mock_device_handle, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_add_device_probed(mock_bus_handle, 0x70, HIDRA_SPEED_FAST_PLUS, NULL, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_add_device_probed(mock_bus_handle, 0x70, (hidra_bus_speed_t)50000, &mock_device_handle, NULL));
+    
     // Test HID report validation
     uint8_t test_report[8] = {0};
     TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_send_generic_report(NULL, HIDRA_REG_KEYBOARD, test_report, 8, 1000));
@@ -28,9 +190,97 @@ void test_hidra_master_api(void)
     TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_read_status(NULL, &status, 1000));
     TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_read_status(mock_device_handle, NULL, 1000));
     
+    // Test batch validation
+    hidra_report_t batch[3] = {
+        {HIDRA_REG_KEYBOARD, test_report, 8},
+        {HIDRA_REG_MOUSE, test_report, 4},
+        {HIDRA_REG_GAMEPAD, NULL, 8},
+    };
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_send_batch(NULL, batch, 2, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_send_batch(mock_device_handle, NULL, 2, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_send_batch(mock_device_handle, batch, 0, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_send_batch(mock_device_handle, batch, 3, 1000));
+    batch[2].report = test_report;
+    batch[2].report_size = MAX_REPORT_SIZE + 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_send_batch(mock_device_handle, batch, 3, 1000));
+    test_report_batch();
+
+    // Test async submission validation
+    hidra_async_config_t async_config = {.timeout_ms = 100, .task_priority = 5};
+    hidra_async_handle_t async_handle;
+    hidra_async_stats_t async_stats;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_async_create(NULL, &async_config, &async_handle));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_async_create(mock_device_handle, NULL, &async_handle));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_async_create(mock_device_handle, &async_config, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_async_submit(NULL, HIDRA_REG_KEYBOARD, test_report, 8, NULL, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_async_flush(NULL, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_async_get_stats(NULL, &async_stats));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_async_delete(NULL));
+    test_async_writes();
+
+    // Test interrupt line validation
+    hidra_device_handle_t pending[2];
+    size_t pending_count;
+    uint8_t cause;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_irq_attach(NULL, GPIO_NUM_6));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_irq_detach(NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, hidra_irq_detach(mock_device_handle));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_irq_wait(NULL, 2, &pending_count, 10));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_irq_wait(pending, 0, &pending_count, 10));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, hidra_irq_wait(pending, 2, &pending_count, 10));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_read_irq_cause(NULL, &cause, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_read_irq_cause(mock_device_handle, NULL, 1000));
+
+    // Test extended status parsing
+    hidra_ext_status_t ext;
+    uint8_t block[EXT_STATUS_SIZE] = {
+        EXT_STATUS_VERSION, EXT_USB_MOUNTED | EXT_USB_SUSPENDED, ERROR_QUEUE_FULL, 2, 0x34, 0x12, 0, 0,
+        HIDRA_REG_KEYBOARD, 3, 13,
+        HIDRA_REG_MOUSE, 0, 8,
+    };
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_read_extended_status(NULL, &ext, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_read_extended_status(mock_device_handle, NULL, 1000));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_parse_extended_status(block, sizeof(block), &ext));
+    TEST_ASSERT_TRUE(ext.usb_mounted);
+    TEST_ASSERT_TRUE(ext.usb_suspended);
+    TEST_ASSERT_EQUAL_HEX8(ERROR_QUEUE_FULL, ext.last_error);
+    TEST_ASSERT_EQUAL_UINT32(0x1234, ext.dropped);
+    TEST_ASSERT_EQUAL_UINT8(3, ext.interfaces[0].queued);
+    TEST_ASSERT_EQUAL(13, hidra_ext_status_free_slots(&ext, HIDRA_REG_KEYBOARD));
+    TEST_ASSERT_EQUAL(8, hidra_ext_status_free_slots(&ext, HIDRA_REG_MOUSE));
+    TEST_ASSERT_EQUAL(-1, hidra_ext_status_free_slots(&ext, HIDRA_REG_GAMEPAD));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE, hidra_parse_extended_status(block, EXT_STATUS_SIZE - 1, &ext));
+    block[3] = EXT_STATUS_MAX_INTERFACES + 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE, hidra_parse_extended_status(block, sizeof(block), &ext));
+    block[0] = EXT_STATUS_VERSION + 1;
+    block[3] = 2;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE, hidra_parse_extended_status(block, sizeof(block), &ext));
+    
+    // Test key event validation
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_key_press(NULL, 0x04, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_key_release(NULL, 0x04, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_key_press(mock_device_handle, 0x00, 1000));
+    uint8_t chord[MAX_REPORT_SIZE] = {0x04, 0x05};
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_nkro_press(NULL, chord, 2, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_nkro_press(mock_device_handle, NULL, 2, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_nkro_press(mock_device_handle, chord, 0, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_nkro_release(mock_device_handle, chord, 0, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_nkro_set_chord(mock_device_handle, chord, MAX_REPORT_SIZE, 1000));
+
+    // Touch frames: one write of at most TOUCH_MAX_CONTACTS contacts
+    hidra_touch_contact_t contacts[TOUCH_MAX_CONTACTS + 1] = {{.id = 0, .flags = TOUCH_CONTACT_TIP}};
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_send_touch_frame(NULL, HIDRA_REG_TOUCHPAD, contacts, 1, false, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_send_touch_frame(mock_device_handle, HIDRA_REG_MOUSE, contacts, 1, false, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_send_touch_frame(mock_device_handle, HIDRA_REG_TOUCHPAD, NULL, 1, false, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_send_touch_frame(mock_device_handle, HIDRA_REG_TOUCHPAD, contacts, TOUCH_MAX_CONTACTS + 1, false, 1000));
+    contacts[0].id = TOUCH_MAX_CONTACT_ID + 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_send_touch_frame(mock_device_handle, HIDRA_REG_TOUCHSCREEN, contacts, 1, false, 1000));
+    
     // Test configuration validation
     TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_set_composite_device_config(NULL, LAYOUT_KEYBOARD, 1000));
     TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_set_usb_ids(NULL, 0x1234, 0x5678, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_set_poll_interval(NULL, HIDRA_REG_MOUSE, 1, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_set_poll_interval(mock_device_handle, HIDRA_REG_MOUSE, 0, 1000));
     TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_set_usb_string(NULL, CONFIG_MANUFACTURER_STR_REG, "test", 1000));
     TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_set_usb_string(mock_device_handle, CONFIG_MANUFACTURER_STR_REG, NULL, 1000));
     
@@ -42,7 +292,185 @@ void test_hidra_master_api(void)
     
     // Test address reconfiguration validation
     TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_reconfigure_address(NULL, 0x42, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_reconfigure_address(&mock_device_handle, 0x03, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_reconfigure_address(&mock_device_handle, 0x78, 1000));
     
     hidra_device_handle_t null_device = NULL;
     TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_reconfigure_address(&null_device, 0x42, 1000));
+    
+    // Test configuration transaction builder
+    static hidra_config_txn_t txn;
+    hidra_config_txn_init(&txn);
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_config_txn_set_usb_ids(&txn, 0x1234, 0x5678));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_config_txn_set_usb_string(&txn, CONFIG_PRODUCT_STR_REG, "Pad"));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_config_txn_set_composite_device_config(&txn, LAYOUT_KEYBOARD | LAYOUT_MOUSE));
+    TEST_ASSERT_EQUAL(3, txn.count);
+    TEST_ASSERT_EQUAL_HEX8(CONFIG_USB_IDS_REG, txn.writes[0][0]);
+    TEST_ASSERT_EQUAL(5, txn.lengths[0]);
+    TEST_ASSERT_EQUAL(4, txn.lengths[1]);  // Register and "Pad", no terminator
+    TEST_ASSERT_EQUAL_HEX8(LAYOUT_KEYBOARD | LAYOUT_MOUSE, txn.writes[2][1]);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_config_txn_commit(NULL, &txn, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_config_txn_commit(mock_device_handle, NULL, 1000));
+
+    // The first builder error sticks and blocks the commit
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_config_txn_set_poll_interval(&txn, HIDRA_REG_MOUSE, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_config_txn_set_irq_gpio(&txn, 4));
+    TEST_ASSERT_EQUAL(3, txn.count);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_config_txn_commit(mock_device_handle, &txn, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_config_txn_send(mock_device_handle, &txn, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_config_txn_send(NULL, &txn, 1000));
+
+    hidra_config_txn_init(&txn);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, hidra_config_txn_set_usb_string(&txn, CONFIG_SERIAL_STR_REG, long_string));
+
+    // A string of exactly MAX_STRING_LENGTH characters stays within the
+    // MAX_STRING_LENGTH bytes the slave accepts
+    hidra_config_txn_init(&txn);
+    long_string[MAX_STRING_LENGTH] = '\0';
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_config_txn_set_usb_string(&txn, CONFIG_SERIAL_STR_REG, long_string));
+    TEST_ASSERT_EQUAL(1 + MAX_STRING_LENGTH, txn.lengths[0]);
+    TEST_ASSERT_EQUAL_HEX8('A', txn.writes[0][MAX_STRING_LENGTH]);
+    long_string[MAX_STRING_LENGTH] = 'A';
+    hidra_config_txn_init(&txn);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_config_txn_set_usb_string(&txn, CONFIG_USB_IDS_REG, "x"));
+    hidra_config_txn_init(&txn);
+    for (int i = 0; i < HIDRA_CONFIG_TXN_MAX_WRITES; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, hidra_config_txn_set_irq_gpio(&txn, IRQ_GPIO_DISABLED));
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, hidra_config_txn_set_irq_gpio(&txn, IRQ_GPIO_DISABLED));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_config_txn_set_usb_ids(NULL, 0x1234, 0x5678));
+
+    // Macro builder: steps land back to back, keymap entries share a step
+    static hidra_macro_t macro;
+    hidra_macro_init(&macro);
+    const uint8_t click[1] = {0x01};
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_macro_begin_repeat(&macro, 3));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_macro_add_report(&macro, HIDRA_REG_MOUSE, click, sizeof(click)));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_macro_add_delay(&macro, 300));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_macro_end_repeat(&macro));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_macro_map_character(&macro, 'y', 0x1D, 0));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_macro_map_character(&macro, 'z', 0x1C, 0));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_macro_add_text(&macro, "zy"));
+    const uint8_t expected_script[] = {
+        MACRO_OP_REPEAT, 3,
+        MACRO_OP_REPORT, HIDRA_REG_MOUSE, 1, 0x01,
+        MACRO_OP_DELAY, 0x2C, 0x01,
+        MACRO_OP_LOOP,
+        MACRO_OP_KEYMAP, 2, 'y', 0x1D, 0, 'z', 0x1C, 0,
+        MACRO_OP_TEXT, 2, 'z', 'y',
+    };
+    TEST_ASSERT_EQUAL(sizeof(expected_script), macro.len);
+    TEST_ASSERT_EQUAL_MEMORY(expected_script, macro.script, sizeof(expected_script));
+
+    // Long text is split into steps of 255 characters
+    static char long_text[600];
+    memset(long_text, 'a', sizeof(long_text) - 1);
+    hidra_macro_init(&macro);
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_macro_add_text(&macro, long_text));
+    TEST_ASSERT_EQUAL(599 + 3 * 2, macro.len);
+    TEST_ASSERT_EQUAL_UINT8(255, macro.script[1]);
+    TEST_ASSERT_EQUAL_HEX8(MACRO_OP_TEXT, macro.script[2 + 255]);
+    TEST_ASSERT_EQUAL_UINT8(599 - 2 * 255, macro.script[2 * 257 + 1]);
+
+    // The first builder error sticks; unbalanced or oversized scripts are refused
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, hidra_macro_add_text(&macro, long_text));
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, hidra_macro_add_delay(&macro, 1));
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, hidra_macro_upload(mock_device_handle, 0, &macro, 1000));
+    hidra_macro_init(&macro);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, hidra_macro_end_repeat(&macro));
+    hidra_macro_init(&macro);
+    for (int i = 0; i < MACRO_MAX_DEPTH; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, hidra_macro_begin_repeat(&macro, 2));
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, hidra_macro_upload(mock_device_handle, 0, &macro, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_macro_begin_repeat(&macro, 2));
+    hidra_macro_init(&macro);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_macro_begin_repeat(&macro, 0));
+    hidra_macro_init(&macro);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_macro_add_report(&macro, HIDRA_REG_MOUSE, click, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_macro_add_text(NULL, "x"));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_macro_upload(mock_device_handle, MACRO_SLOT_COUNT, &macro, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_macro_play(NULL, 0, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_macro_play(mock_device_handle, MACRO_SLOT_COUNT, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_macro_save(mock_device_handle, MACRO_SLOT_COUNT, 1000));
+
+    // Macro status block
+    const uint8_t macro_block[MACRO_STATUS_SIZE] = {MACRO_STATE_RUNNING, 2, 0x10, 0x01, 0x20, 0x03, 0xE8, 0x03};
+    hidra_macro_status_t macro_status;
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_parse_macro_status(macro_block, sizeof(macro_block), &macro_status));
+    TEST_ASSERT_EQUAL_UINT8(MACRO_STATE_RUNNING, macro_status.state);
+    TEST_ASSERT_EQUAL_UINT8(2, macro_status.slot);
+    TEST_ASSERT_EQUAL_UINT16(0x110, macro_status.position);
+    TEST_ASSERT_EQUAL_UINT16(0x320, macro_status.length);
+    TEST_ASSERT_EQUAL_UINT16(1000, macro_status.reports);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE, hidra_parse_macro_status(macro_block, MACRO_STATUS_SIZE - 1, &macro_status));
+    const uint8_t bad_state[MACRO_STATUS_SIZE] = {MACRO_STATE_FAILED + 1};
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE, hidra_parse_macro_status(bad_state, sizeof(bad_state), &macro_status));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_read_macro_status(NULL, &macro_status, 1000));
+
+    // Clock offset: the shortest round trip wins, whatever order it comes in
+    hidra_clock_t clock;
+    hidra_clock_init(&clock);
+    hidra_clock_add_sample(&clock, 1000, 1400, 51300);   // Midpoint 1200, +/- 200
+    TEST_ASSERT_EQUAL_INT64(50100, clock.offset_us);
+    TEST_ASSERT_EQUAL_INT64(200, clock.uncertainty_us);
+    hidra_clock_add_sample(&clock, 2000, 2100, 52060);   // Midpoint 2050, +/- 50
+    TEST_ASSERT_EQUAL_INT64(50010, clock.offset_us);
+    TEST_ASSERT_EQUAL_INT64(50, clock.uncertainty_us);
+    hidra_clock_add_sample(&clock, 3000, 3300, 60000);   // Worse round trip: ignored
+    hidra_clock_add_sample(&clock, 4000, 3900, 60000);   // Inverted bracket: ignored
+    TEST_ASSERT_EQUAL_INT64(50010, clock.offset_us);
+    TEST_ASSERT_EQUAL(3, clock.samples);
+    TEST_ASSERT_EQUAL_UINT32(50010 + 10000, hidra_clock_to_slave(&clock, 10000));
+
+    // Slave times keep their low 32 bits
+    clock.offset_us = 0x100000000LL;
+    TEST_ASSERT_EQUAL_UINT32(5, hidra_clock_to_slave(&clock, 5));
+    clock.offset_us = -10;
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX - 4, hidra_clock_to_slave(&clock, 5));
+
+    const uint8_t scheduled[4] = {0};
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_clock_sync(NULL, 4, &clock, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_clock_sync(mock_device_handle, 0, &clock, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_schedule_report(NULL, 0, HIDRA_REG_MOUSE, scheduled, 4, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_schedule_report(mock_device_handle, 0, HIDRA_REG_MOUSE, scheduled, 0, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_schedule_report(mock_device_handle, 0, HIDRA_REG_MOUSE, scheduled, MAX_REPORT_SIZE + 1, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_schedule_clear(NULL, 1000));
+
+    // Broadcast
+    hidra_broadcast_handle_t broadcast = NULL;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_broadcast_add_to_bus(NULL, HIDRA_SPEED_FAST, &broadcast));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_broadcast_add_to_bus(mock_bus_handle, (hidra_bus_speed_t)200000, &broadcast));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_broadcast_add_to_bus(mock_bus_handle, HIDRA_SPEED_FAST, NULL));
+    TEST_ASSERT_NULL(broadcast);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_broadcast_remove(NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_broadcast_send_report(NULL, HIDRA_REG_MOUSE, scheduled, 4, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_broadcast_send_batch(NULL, NULL, 0, 1000));
+    // Only whole input reports go to every slave: no key events, no config
+    hidra_broadcast_handle_t mock_broadcast = (hidra_broadcast_handle_t)0x55667788;
+    const uint8_t address[] = {0x42};
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_broadcast_send_report(mock_broadcast, CONFIG_I2C_ADDR_REG, address, 1, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_broadcast_send_report(mock_broadcast, HIDRA_REG_KEY_EVENT, scheduled, 2, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_broadcast_send_report(mock_broadcast, MACRO_PLAY_REG, address, 1, 1000));
+    const hidra_report_t broadcast_batch[] = {
+        {HIDRA_REG_MOUSE, scheduled, 4},
+        {CONFIG_COMPOSITE_DEVICE_REG, scheduled, 2},
+    };
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_broadcast_send_batch(mock_broadcast, broadcast_batch, 2, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_broadcast_macro_play(NULL, 0, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_broadcast_macro_stop(NULL, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_broadcast_config_txn_commit(NULL, &txn, 1000));
+
+    // Staging
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_stage_report(NULL, HIDRA_REG_MOUSE, scheduled, 4, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_stage_report(mock_device_handle, HIDRA_REG_MOUSE, scheduled, 0, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_stage_report(mock_device_handle, HIDRA_REG_MOUSE, NULL, 4, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_stage_clear(NULL, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_latch(NULL, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_broadcast_latch(NULL, 1000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_broadcast_stage_clear(NULL, 1000));
+    const hidra_staged_report_t staged[] = {
+        {mock_device_handle, HIDRA_REG_MOUSE, scheduled, 4},
+    };
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_broadcast_stage_and_latch(NULL, staged, 1, 1000));
 }
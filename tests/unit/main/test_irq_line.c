@@ -0,0 +1,26 @@
+#include "unity.h"
+#include "irq_line.h"
+
+void test_irq_line(void)
+{
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, irq_line_init(200));
+
+    // Without a pin the causes are still latched for IRQ_CAUSE_REG
+    TEST_ASSERT_EQUAL(ESP_OK, irq_line_init(IRQ_GPIO_DISABLED));
+    TEST_ASSERT_EQUAL_HEX8(0, irq_line_pending());
+
+    irq_line_raise(IRQ_CAUSE_QUEUE_HIGH);
+    irq_line_raise(IRQ_CAUSE_ERROR);
+    irq_line_raise(IRQ_CAUSE_QUEUE_HIGH);
+    TEST_ASSERT_EQUAL_HEX8(IRQ_CAUSE_ERROR | IRQ_CAUSE_QUEUE_HIGH, irq_line_pending());
+
+    // Reading the causes clears them
+    TEST_ASSERT_EQUAL_HEX8(IRQ_CAUSE_ERROR | IRQ_CAUSE_QUEUE_HIGH, irq_line_ack());
+    TEST_ASSERT_EQUAL_HEX8(0, irq_line_pending());
+    TEST_ASSERT_EQUAL_HEX8(0, irq_line_ack());
+
+    // Moving the line keeps what is latched
+    irq_line_raise(IRQ_CAUSE_OUTPUT_REPORT);
+    TEST_ASSERT_EQUAL(ESP_OK, irq_line_init(IRQ_GPIO_DISABLED));
+    TEST_ASSERT_EQUAL_HEX8(IRQ_CAUSE_OUTPUT_REPORT, irq_line_ack());
+}
@@ -0,0 +1,132 @@
+#include "unity.h"
+#include "keyboard_state.h"
+#include <string.h>
+
+#define KEY_A       0x04
+#define KEY_LSHIFT  0xE1
+#define KEY_RGUI    0xE7
+
+static void assert_report(const keyboard_state_t *ks, const uint8_t *expected)
+{
+    uint8_t report[KEYBOARD_REPORT_LEN];
+    TEST_ASSERT_EQUAL(KEYBOARD_REPORT_LEN, keyboard_state_build(ks, report, sizeof(report)));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, report, KEYBOARD_REPORT_LEN);
+}
+
+static void test_nkro_state(void)
+{
+    nkro_state_t ns;
+    nkro_state_reset(&ns);
+
+    // A chord far beyond six keys fits in one report
+    for (uint8_t usage = KEY_A; usage < KEY_A + 20; usage++) {
+        TEST_ASSERT_TRUE(nkro_state_apply(&ns, usage, true));
+    }
+    TEST_ASSERT_TRUE(nkro_state_apply(&ns, KEY_LSHIFT, true));
+    TEST_ASSERT_FALSE(nkro_state_apply(&ns, KEY_A, true));
+
+    uint8_t report[NKRO_REPORT_SIZE];
+    TEST_ASSERT_EQUAL(NKRO_REPORT_SIZE, nkro_state_build(&ns, report, sizeof(report)));
+    TEST_ASSERT_EQUAL_HEX8(0x02, report[0]);
+    for (uint8_t usage = 0; usage < NKRO_KEY_BITMAP_BYTES * 8; usage++) {
+        bool expected = usage >= KEY_A && usage < KEY_A + 20;
+        TEST_ASSERT_EQUAL(expected, (report[1 + usage / 8] >> (usage % 8)) & 1);
+    }
+
+    // Error usages and usages past the modifiers are ignored
+    TEST_ASSERT_FALSE(nkro_state_apply(&ns, KEYBOARD_USAGE_ERR_ROLLOVER, true));
+    TEST_ASSERT_FALSE(nkro_state_apply(&ns, KEYBOARD_USAGE_MOD_LAST + 1, true));
+
+    TEST_ASSERT_TRUE(nkro_state_apply(&ns, KEY_A, false));
+    TEST_ASSERT_FALSE(nkro_state_apply(&ns, KEY_A, false));
+
+    // A loaded report drops the error usage bits
+    uint8_t written[NKRO_REPORT_SIZE] = {0x01, 0x0F | (1 << KEY_A)};
+    nkro_state_load(&ns, written, sizeof(written));
+    nkro_state_build(&ns, report, sizeof(report));
+    TEST_ASSERT_EQUAL_HEX8(0x01, report[0]);
+    TEST_ASSERT_EQUAL_HEX8(1 << KEY_A, report[1]);
+
+    TEST_ASSERT_EQUAL(0, nkro_state_build(&ns, report, NKRO_REPORT_SIZE - 1));
+}
+
+void test_keyboard_state(void)
+{
+    keyboard_state_t ks;
+    keyboard_state_reset(&ks);
+
+    // Modifiers map onto the modifier byte
+    TEST_ASSERT_TRUE(keyboard_state_apply(&ks, KEY_LSHIFT, true));
+    TEST_ASSERT_TRUE(keyboard_state_apply(&ks, KEY_RGUI, true));
+    TEST_ASSERT_FALSE(keyboard_state_apply(&ks, KEY_LSHIFT, true));
+    TEST_ASSERT_TRUE(keyboard_state_apply(&ks, KEY_A, true));
+    const uint8_t shift_a[] = {0x82, 0, KEY_A, 0, 0, 0, 0, 0};
+    assert_report(&ks, shift_a);
+
+    TEST_ASSERT_TRUE(keyboard_state_apply(&ks, KEY_RGUI, false));
+    TEST_ASSERT_TRUE(keyboard_state_apply(&ks, KEY_LSHIFT, false));
+    TEST_ASSERT_TRUE(keyboard_state_apply(&ks, KEY_A, false));
+    TEST_ASSERT_FALSE(keyboard_state_apply(&ks, KEY_A, false));
+    TEST_ASSERT_FALSE(keyboard_state_apply(&ks, 0x00, true));
+    const uint8_t idle[KEYBOARD_REPORT_LEN] = {0};
+    assert_report(&ks, idle);
+
+    // Releases keep the remaining keys in press order
+    for (uint8_t k = 0; k < 4; k++) {
+        keyboard_state_apply(&ks, KEY_A + k, true);
+    }
+    keyboard_state_apply(&ks, KEY_A + 1, false);
+    const uint8_t ordered[] = {0, 0, KEY_A, KEY_A + 2, KEY_A + 3, 0, 0, 0};
+    assert_report(&ks, ordered);
+
+    // A seventh key reports ErrorRollOver until one key is released
+    keyboard_state_reset(&ks);
+    for (uint8_t k = 0; k < KEYBOARD_MAX_KEYS; k++) {
+        TEST_ASSERT_TRUE(keyboard_state_apply(&ks, KEY_A + k, true));
+    }
+    TEST_ASSERT_TRUE(keyboard_state_apply(&ks, KEY_LSHIFT, true));
+    TEST_ASSERT_TRUE(keyboard_state_apply(&ks, KEY_A + 6, true));
+    TEST_ASSERT_FALSE(keyboard_state_apply(&ks, KEY_A + 7, true));
+    const uint8_t rollover[] = {0x02, 0, 1, 1, 1, 1, 1, 1};
+    assert_report(&ks, rollover);
+
+    TEST_ASSERT_FALSE(keyboard_state_apply(&ks, KEY_A + 6, false));
+    TEST_ASSERT_TRUE(keyboard_state_apply(&ks, KEY_A + 7, false));
+    const uint8_t six_keys[] = {0x02, 0, KEY_A, KEY_A + 1, KEY_A + 2, KEY_A + 3, KEY_A + 4, KEY_A + 5};
+    assert_report(&ks, six_keys);
+
+    // Overflowed keys are tracked by usage: repeated presses and releases of
+    // idle keys change nothing, and a freed slot goes to a key still held
+    keyboard_state_reset(&ks);
+    for (uint8_t k = 0; k < KEYBOARD_MAX_KEYS + 1; k++) {
+        keyboard_state_apply(&ks, KEY_A + k, true);
+    }
+    TEST_ASSERT_FALSE(keyboard_state_apply(&ks, KEY_A + 6, true));
+    TEST_ASSERT_FALSE(keyboard_state_apply(&ks, KEY_A + 9, false));
+    const uint8_t still_rollover[] = {0, 0, 1, 1, 1, 1, 1, 1};
+    assert_report(&ks, still_rollover);
+
+    TEST_ASSERT_TRUE(keyboard_state_apply(&ks, KEY_A, false));
+    const uint8_t refilled[] = {0, 0, KEY_A + 1, KEY_A + 2, KEY_A + 3, KEY_A + 4, KEY_A + 5, KEY_A + 6};
+    assert_report(&ks, refilled);
+
+    // Released before a slot freed up: gone, not moved into the report
+    TEST_ASSERT_TRUE(keyboard_state_apply(&ks, KEY_A + 7, true));
+    TEST_ASSERT_TRUE(keyboard_state_apply(&ks, KEY_A + 7, false));
+    TEST_ASSERT_TRUE(keyboard_state_apply(&ks, KEY_A + 6, false));
+    const uint8_t five_keys[] = {0, 0, KEY_A + 1, KEY_A + 2, KEY_A + 3, KEY_A + 4, KEY_A + 5, 0};
+    assert_report(&ks, five_keys);
+    TEST_ASSERT_FALSE(keyboard_state_apply(&ks, KEY_A + 7, false));
+
+    // Key events continue from a full report written by the master
+    const uint8_t written[] = {0x01, 0, KEY_A + 9, KEYBOARD_USAGE_ERR_ROLLOVER, 0, 0, 0, 0};
+    keyboard_state_load(&ks, written, sizeof(written));
+    TEST_ASSERT_TRUE(keyboard_state_apply(&ks, KEY_A, true));
+    const uint8_t continued[] = {0x01, 0, KEY_A + 9, KEY_A, 0, 0, 0, 0};
+    assert_report(&ks, continued);
+
+    uint8_t small[KEYBOARD_REPORT_LEN - 1];
+    TEST_ASSERT_EQUAL(0, keyboard_state_build(&ks, small, sizeof(small)));
+
+    test_nkro_state();
+}
@@ -0,0 +1,277 @@
+#include "unity.h"
+#include "macro.h"
+#include "keyboard_state.h"
+#include "hidra_protocol.h"
+#include <string.h>
+
+#define MACRO_TEST_MAX_REPORTS 1200
+
+// Fake dispatcher: records reports, a queue of fake_capacity until drained.
+// Like a layout without a pen interface, HIDRA_REG_PEN is unknown.
+static uint8_t fake_register[MACRO_TEST_MAX_REPORTS];
+static uint8_t fake_report[MACRO_TEST_MAX_REPORTS][KEYBOARD_REPORT_LEN];
+static uint32_t fake_count;
+static uint32_t fake_queued;
+static uint32_t fake_capacity;
+
+static esp_err_t fake_submit(uint8_t hid_register, const uint8_t *report, size_t len)
+{
+    if (hid_register == HIDRA_REG_PEN) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (fake_queued >= fake_capacity) {
+        return ESP_ERR_NO_MEM;
+    }
+    TEST_ASSERT_LESS_THAN(MACRO_TEST_MAX_REPORTS, fake_count);
+    fake_register[fake_count] = hid_register;
+    memset(fake_report[fake_count], 0, KEYBOARD_REPORT_LEN);
+    memcpy(fake_report[fake_count], report, len < KEYBOARD_REPORT_LEN ? len : KEYBOARD_REPORT_LEN);
+    fake_count++;
+    fake_queued++;
+    return ESP_OK;
+}
+
+static void fake_reset(uint32_t capacity)
+{
+    fake_count = 0;
+    fake_queued = 0;
+    fake_capacity = capacity;
+}
+
+static macro_player_t player;
+
+static void test_macro_validate(void)
+{
+    const uint8_t good[] = {
+        MACRO_OP_REPEAT, 2,
+            MACRO_OP_REPORT, HIDRA_REG_MOUSE, 3, 0x00, 0x05, 0x00,
+            MACRO_OP_DELAY, 0x0A, 0x00,
+        MACRO_OP_LOOP,
+        MACRO_OP_TEXT, 2, 'h', 'i',
+        MACRO_OP_KEYMAP, 1, 'z', 0x1C, 0x00,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, macro_validate(good, sizeof(good)));
+
+    // Truncated anywhere in the last step
+    for (size_t len = sizeof(good) - 4; len < sizeof(good); len++) {
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, macro_validate(good, len));
+    }
+
+    const uint8_t unknown[] = {0x7F};
+    const uint8_t empty_report[] = {MACRO_OP_REPORT, HIDRA_REG_MOUSE, 0};
+    const uint8_t zero_repeat[] = {MACRO_OP_REPEAT, 0, MACRO_OP_LOOP};
+    const uint8_t open_block[] = {MACRO_OP_REPEAT, 2};
+    const uint8_t stray_loop[] = {MACRO_OP_LOOP};
+    uint8_t too_deep[2 * (MACRO_MAX_DEPTH + 1) + MACRO_MAX_DEPTH + 1];
+    size_t n = 0;
+    for (int i = 0; i <= MACRO_MAX_DEPTH; i++) {
+        too_deep[n++] = MACRO_OP_REPEAT;
+        too_deep[n++] = 2;
+    }
+    for (int i = 0; i <= MACRO_MAX_DEPTH; i++) {
+        too_deep[n++] = MACRO_OP_LOOP;
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, macro_validate(unknown, sizeof(unknown)));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, macro_validate(empty_report, sizeof(empty_report)));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, macro_validate(zero_repeat, sizeof(zero_repeat)));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, macro_validate(open_block, sizeof(open_block)));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, macro_validate(stray_loop, sizeof(stray_loop)));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, macro_validate(too_deep, n));
+    TEST_ASSERT_EQUAL(ESP_OK, macro_validate(&too_deep[2], n - 3));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, macro_validate(good, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, macro_player_start(&player, 0, open_block, sizeof(open_block)));
+}
+
+static void test_macro_slots(void)
+{
+    // Chunks append; offset 0 starts over
+    const uint8_t text[] = {MACRO_OP_TEXT, 3, 'a', 'b', 'c'};
+    TEST_ASSERT_EQUAL(ESP_OK, macro_slot_write(1, 0, text, 2));
+    TEST_ASSERT_EQUAL(ESP_OK, macro_slot_write(1, 2, &text[2], 3));
+    size_t len;
+    const uint8_t *script = macro_slot_get(1, &len);
+    TEST_ASSERT_EQUAL(sizeof(text), len);
+    TEST_ASSERT_EQUAL_MEMORY(text, script, sizeof(text));
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, macro_slot_write(1, 7, text, 1));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, macro_slot_write(1, 3, text, 1));
+    static uint8_t big[MACRO_SLOT_SIZE + 1];
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, macro_slot_write(1, 0, big, sizeof(big)));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, macro_slot_write(1, sizeof(text), big, MACRO_SLOT_SIZE));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, macro_slot_write(MACRO_SLOT_COUNT, 0, text, 1));
+    TEST_ASSERT_NULL(macro_slot_get(MACRO_SLOT_COUNT, &len));
+
+    // A failed write leaves the slot as it was
+    script = macro_slot_get(1, &len);
+    TEST_ASSERT_EQUAL(sizeof(text), len);
+
+    TEST_ASSERT_EQUAL(ESP_OK, macro_slot_write(1, 0, text, 1));
+    macro_slot_get(1, &len);
+    TEST_ASSERT_EQUAL(1, len);
+    TEST_ASSERT_EQUAL(ESP_OK, macro_slot_write(1, 0, NULL, 0));
+    macro_slot_get(1, &len);
+    TEST_ASSERT_EQUAL(0, len);
+}
+
+static void test_macro_playback(void)
+{
+    // Two clicks, then "aB" with 'a' remapped and an unmapped byte skipped
+    const uint8_t script[] = {
+        MACRO_OP_REPEAT, 2,
+            MACRO_OP_REPORT, HIDRA_REG_MOUSE, 1, 0x01,
+            MACRO_OP_REPORT, HIDRA_REG_MOUSE, 1, 0x00,
+        MACRO_OP_LOOP,
+        MACRO_OP_KEYMAP, 1, 'a', 0x14, 0x00,
+        MACRO_OP_TEXT, 3, 'a', 0x80, 'B',
+    };
+    fake_reset(MACRO_TEST_MAX_REPORTS);
+    TEST_ASSERT_EQUAL(ESP_OK, macro_player_start(&player, 2, script, sizeof(script)));
+    TEST_ASSERT_TRUE(macro_player_running(&player));
+    TEST_ASSERT_EQUAL_UINT32(0, macro_player_run(&player, 0, fake_submit));
+    TEST_ASSERT_EQUAL_UINT8(MACRO_STATE_DONE, player.state);
+
+    TEST_ASSERT_EQUAL_UINT32(8, fake_count);
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_HEX8(HIDRA_REG_MOUSE, fake_register[i]);
+        TEST_ASSERT_EQUAL_HEX8(i % 2 ? 0x00 : 0x01, fake_report[i][0]);
+    }
+    const uint8_t press_q[KEYBOARD_REPORT_LEN] = {0x00, 0, 0x14};
+    const uint8_t press_shift_b[KEYBOARD_REPORT_LEN] = {0x02, 0, 0x05};
+    const uint8_t release[KEYBOARD_REPORT_LEN] = {0};
+    TEST_ASSERT_EQUAL_HEX8(HIDRA_REG_KEYBOARD, fake_register[4]);
+    TEST_ASSERT_EQUAL_MEMORY(press_q, fake_report[4], KEYBOARD_REPORT_LEN);
+    TEST_ASSERT_EQUAL_MEMORY(release, fake_report[5], KEYBOARD_REPORT_LEN);
+    TEST_ASSERT_EQUAL_MEMORY(press_shift_b, fake_report[6], KEYBOARD_REPORT_LEN);
+    TEST_ASSERT_EQUAL_MEMORY(release, fake_report[7], KEYBOARD_REPORT_LEN);
+
+    // Status block: done, with the whole script played
+    uint8_t block[MACRO_STATUS_SIZE];
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, macro_player_encode_status(&player, block, MACRO_STATUS_SIZE - 1));
+    TEST_ASSERT_EQUAL(ESP_OK, macro_player_encode_status(&player, block, sizeof(block)));
+    TEST_ASSERT_EQUAL_UINT8(MACRO_STATE_DONE, block[0]);
+    TEST_ASSERT_EQUAL_UINT8(2, block[1]);
+    TEST_ASSERT_EQUAL_UINT16(sizeof(script), block[2] | (block[3] << 8));
+    TEST_ASSERT_EQUAL_UINT16(sizeof(script), block[4] | (block[5] << 8));
+    TEST_ASSERT_EQUAL_UINT16(8, block[6] | (block[7] << 8));
+
+    // Done is final
+    TEST_ASSERT_EQUAL_UINT32(0, macro_player_run(&player, 0, fake_submit));
+    TEST_ASSERT_EQUAL_UINT32(8, fake_count);
+}
+
+static void test_macro_pacing(void)
+{
+    // 500 characters against a queue of 16 the host drains one per interval:
+    // one press and one release each, in order, nothing lost
+    static uint8_t script[2 * (2 + 250)];
+    char expected[500];
+    for (int i = 0; i < 500; i++) {
+        expected[i] = 'a' + i % 26;
+    }
+    for (int op = 0; op < 2; op++) {
+        script[op * 252] = MACRO_OP_TEXT;
+        script[op * 252 + 1] = 250;
+        memcpy(&script[op * 252 + 2], &expected[op * 250], 250);
+    }
+
+    fake_reset(16);
+    TEST_ASSERT_EQUAL(ESP_OK, macro_player_start(&player, 0, script, sizeof(script)));
+    uint32_t now = 0;
+    int intervals = 0;
+    while (macro_player_running(&player) && intervals < 10000) {
+        uint32_t wait = macro_player_run(&player, now, fake_submit);
+        if (macro_player_running(&player)) {
+            TEST_ASSERT_EQUAL_UINT32(MACRO_RETRY_US, wait);
+        }
+        // One host poll per millisecond
+        now += 1000;
+        if (fake_queued) {
+            fake_queued--;
+        }
+        intervals++;
+    }
+    TEST_ASSERT_EQUAL_UINT8(MACRO_STATE_DONE, player.state);
+    TEST_ASSERT_EQUAL_UINT32(1000, fake_count);
+    TEST_ASSERT_EQUAL_UINT16(1000, player.reports);
+    // Full poll rate: the queue never ran dry before the end
+    TEST_ASSERT_LESS_OR_EQUAL(1000, intervals);
+    for (int i = 0; i < 500; i++) {
+        TEST_ASSERT_EQUAL_HEX8(0x04 + i % 26, fake_report[2 * i][2]);
+        TEST_ASSERT_EQUAL_HEX8(0, fake_report[2 * i + 1][2]);
+    }
+
+    // Delays pause playback until their time has come
+    const uint8_t delayed[] = {
+        MACRO_OP_REPORT, HIDRA_REG_CONSUMER, 2, 0xE9, 0x00,
+        MACRO_OP_DELAY, 0x32, 0x00,
+        MACRO_OP_REPORT, HIDRA_REG_CONSUMER, 2, 0x00, 0x00,
+    };
+    fake_reset(16);
+    TEST_ASSERT_EQUAL(ESP_OK, macro_player_start(&player, 0, delayed, sizeof(delayed)));
+    TEST_ASSERT_EQUAL_UINT32(50000, macro_player_run(&player, 1000, fake_submit));
+    TEST_ASSERT_EQUAL_UINT32(1, fake_count);
+    TEST_ASSERT_EQUAL_UINT32(20000, macro_player_run(&player, 31000, fake_submit));
+    TEST_ASSERT_EQUAL_UINT32(1, fake_count);
+    TEST_ASSERT_EQUAL_UINT32(0, macro_player_run(&player, 51000, fake_submit));
+    TEST_ASSERT_EQUAL_UINT32(2, fake_count);
+    TEST_ASSERT_EQUAL_UINT8(MACRO_STATE_DONE, player.state);
+
+    // Empty loops yield after a bounded number of steps
+    const uint8_t spin[] = {MACRO_OP_REPEAT, 255, MACRO_OP_REPEAT, 255, MACRO_OP_LOOP, MACRO_OP_LOOP};
+    TEST_ASSERT_EQUAL(ESP_OK, macro_player_start(&player, 0, spin, sizeof(spin)));
+    TEST_ASSERT_EQUAL_UINT32(0, macro_player_run(&player, 0, fake_submit));
+    TEST_ASSERT_TRUE(macro_player_running(&player));
+    int calls = 1;
+    while (macro_player_running(&player) && calls < 1000) {
+        macro_player_run(&player, 0, fake_submit);
+        calls++;
+    }
+    TEST_ASSERT_EQUAL_UINT8(MACRO_STATE_DONE, player.state);
+}
+
+static void test_macro_stop_and_fail(void)
+{
+    const uint8_t script[] = {
+        MACRO_OP_TEXT, 2, 'x', 'y',
+        MACRO_OP_REPORT, HIDRA_REG_GAMEPAD, 1, 0x01,
+    };
+
+    // Stopping between press and release lets go of the key
+    fake_reset(1);
+    TEST_ASSERT_EQUAL(ESP_OK, macro_player_start(&player, 3, script, sizeof(script)));
+    TEST_ASSERT_EQUAL_UINT32(MACRO_RETRY_US, macro_player_run(&player, 0, fake_submit));
+    TEST_ASSERT_EQUAL_UINT32(1, fake_count);
+    fake_queued = 0;
+    macro_player_stop(&player, fake_submit);
+    TEST_ASSERT_EQUAL_UINT8(MACRO_STATE_STOPPED, player.state);
+    TEST_ASSERT_EQUAL_UINT32(2, fake_count);
+    const uint8_t release[KEYBOARD_REPORT_LEN] = {0};
+    TEST_ASSERT_EQUAL_MEMORY(release, fake_report[1], KEYBOARD_REPORT_LEN);
+    macro_player_stop(&player, fake_submit);
+    TEST_ASSERT_EQUAL_UINT32(2, fake_count);
+
+    // A rejected report fails the macro at its step
+    const uint8_t bad_register[] = {
+        MACRO_OP_TEXT, 1, 'x',
+        MACRO_OP_REPORT, HIDRA_REG_PEN, 1, 0x01,
+        MACRO_OP_TEXT, 1, 'y',
+    };
+    fake_reset(MACRO_TEST_MAX_REPORTS);
+    TEST_ASSERT_EQUAL(ESP_OK, macro_player_start(&player, 3, bad_register, sizeof(bad_register)));
+    TEST_ASSERT_EQUAL_UINT32(0, macro_player_run(&player, 0, fake_submit));
+    TEST_ASSERT_EQUAL_UINT8(MACRO_STATE_FAILED, player.state);
+    TEST_ASSERT_EQUAL_UINT32(2, fake_count);
+    uint8_t block[MACRO_STATUS_SIZE];
+    macro_player_encode_status(&player, block, sizeof(block));
+    TEST_ASSERT_EQUAL_UINT8(MACRO_STATE_FAILED, block[0]);
+    TEST_ASSERT_EQUAL_UINT16(3, block[2] | (block[3] << 8));
+}
+
+void test_macro(void)
+{
+    test_macro_validate();
+    test_macro_slots();
+    test_macro_playback();
+    test_macro_pacing();
+    test_macro_stop_and_fail();
+}
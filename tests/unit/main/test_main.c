@@ -19,6 +19,18 @@ extern void test_config_management(void);
 extern void test_i2c_protocol(void);
 extern void test_status_register(void);
 extern void test_hid_reports(void);
+extern void test_hid_dispatch(void);
+extern void test_report_ring(void);
+extern void test_mouse_coalesce(void);
+extern void test_touch_frame(void);
+extern void test_keyboard_state(void);
+extern void test_hid_batch(void);
+extern void test_irq_line(void);
+extern void test_config_store(void);
+extern void test_output_cache(void);
+extern void test_macro(void);
+extern void test_report_schedule(void);
+extern void test_hidra_fleet(void);
 
 void app_main(void)
 {
@@ -31,6 +43,7 @@ void app_main(void)
     
     // Master component tests
     RUN_TEST(test_hidra_master_api);
+    RUN_TEST(test_hidra_fleet);
     
     // USB descriptor tests
     RUN_TEST(test_usb_descriptors);
@@ -47,5 +60,22 @@ void app_main(void)
     // HID report tests
     RUN_TEST(test_hid_reports);
     
+    // HID dispatcher tests
+    RUN_TEST(test_report_ring);
+    RUN_TEST(test_hid_dispatch);
+    RUN_TEST(test_mouse_coalesce);
+    RUN_TEST(test_touch_frame);
+    
+    // Key event tests
+    RUN_TEST(test_keyboard_state);
+    RUN_TEST(test_hid_batch);
+    RUN_TEST(test_irq_line);
+    
+    // Configuration storage tests
+    RUN_TEST(test_config_store);
+    RUN_TEST(test_output_cache);
+    RUN_TEST(test_macro);
+    RUN_TEST(test_report_schedule);
+    
     UNITY_END();
 }
@@ -0,0 +1,167 @@
+#include "unity.h"
+#include "mouse_coalesce.h"
+#include "hid_dispatch.h"
+#include "hidra_protocol.h"
+#include "esp_timer.h"
+#include "fake_transport.h"
+#include <string.h>
+
+#define MOUSE_TEST_REPORT_LEN      5
+#define MOUSE_TEST_REPORTS         5000
+#define MOUSE_TEST_PER_INTERVAL    40   // Master sends far faster than the host polls
+
+// Host side of the fake USB interface
+static int64_t fake_out[MOUSE_COALESCE_AXES];
+static uint32_t fake_button_changes;
+static uint8_t fake_last_buttons;
+
+static void mouse_sent(const uint8_t *report, uint16_t len)
+{
+    for (int i = 0; i < MOUSE_COALESCE_AXES; i++) {
+        fake_out[i] += (int8_t)report[i + 1];
+    }
+    if (report[0] != fake_last_buttons) {
+        fake_button_changes++;
+        fake_last_buttons = report[0];
+    }
+}
+
+static void test_mouse_coalesce_accumulator(void)
+{
+    mouse_coalesce_t mc;
+    mouse_coalesce_reset(&mc);
+    TEST_ASSERT_FALSE(mc.pending);
+
+    // Deltas sum past the int8 range and saturate, remainder carried forward
+    const uint8_t move[] = {0x00, 100, (uint8_t)-100, 1, 0};
+    TEST_ASSERT_TRUE(mouse_coalesce_add(&mc, move, sizeof(move), 0));
+    TEST_ASSERT_TRUE(mouse_coalesce_add(&mc, move, sizeof(move), 0));
+    TEST_ASSERT_EQUAL_UINT32(2, mc.reports);
+
+    uint8_t out[MOUSE_TEST_REPORT_LEN];
+    TEST_ASSERT_EQUAL(MOUSE_TEST_REPORT_LEN, mouse_coalesce_build(&mc, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_INT8(127, (int8_t)out[1]);
+    TEST_ASSERT_EQUAL_INT8(-127, (int8_t)out[2]);
+    TEST_ASSERT_EQUAL_INT8(2, (int8_t)out[3]);
+    mouse_coalesce_consume(&mc, out, sizeof(out));
+    TEST_ASSERT_TRUE(mc.pending);
+    TEST_ASSERT_EQUAL_INT32(73, mc.axis[0]);
+    TEST_ASSERT_EQUAL_INT32(-73, mc.axis[1]);
+
+    // A button change waits until the carried motion is out
+    const uint8_t press[] = {0x01, 0, 0, 0};
+    TEST_ASSERT_FALSE(mouse_coalesce_add(&mc, press, sizeof(press), 0));
+    mouse_coalesce_build(&mc, out, sizeof(out));
+    mouse_coalesce_consume(&mc, out, sizeof(out));
+    TEST_ASSERT_FALSE(mc.pending);
+    TEST_ASSERT_TRUE(mouse_coalesce_add(&mc, press, sizeof(press), 0));
+    TEST_ASSERT_TRUE(mc.pending);
+
+    // The segment queue keeps one accumulator per pending button state
+    mouse_coalesce_queue_t q;
+    mouse_coalesce_queue_reset(&q);
+    TEST_ASSERT_EQUAL(0, mouse_coalesce_queue_build(&q, out, sizeof(out), NULL, NULL));
+    TEST_ASSERT_TRUE(mouse_coalesce_queue_add(&q, move, sizeof(move), 10));
+    TEST_ASSERT_TRUE(mouse_coalesce_queue_add(&q, move, sizeof(move), 20));
+    TEST_ASSERT_TRUE(mouse_coalesce_queue_add(&q, press, sizeof(press), 30));
+    TEST_ASSERT_EQUAL_UINT8(2, q.count);
+
+    // Stamps follow the oldest report still waiting, carried motion included
+    uint32_t reports = 0;
+    uint32_t stamp = 0;
+    mouse_coalesce_queue_build(&q, out, sizeof(out), &reports, &stamp);
+    TEST_ASSERT_EQUAL_UINT32(2, reports);
+    TEST_ASSERT_EQUAL_UINT32(10, stamp);
+    TEST_ASSERT_EQUAL_HEX8(0x00, out[0]);
+    mouse_coalesce_queue_consume(&q, out, sizeof(out));
+    mouse_coalesce_queue_build(&q, out, sizeof(out), NULL, &stamp);
+    TEST_ASSERT_EQUAL_UINT32(10, stamp);
+    mouse_coalesce_queue_consume(&q, out, sizeof(out));
+    mouse_coalesce_queue_build(&q, out, sizeof(out), NULL, &stamp);
+    TEST_ASSERT_EQUAL_UINT32(30, stamp);
+    TEST_ASSERT_EQUAL_HEX8(0x01, out[0]);
+    mouse_coalesce_queue_consume(&q, out, sizeof(out));
+    TEST_ASSERT_EQUAL_UINT8(0, q.count);
+
+    // Only a burst of button changes can fill it
+    for (int i = 0; i < MOUSE_COALESCE_SEGMENTS; i++) {
+        const uint8_t toggle[] = {(uint8_t)(i & 1), 1, 0, 0};
+        TEST_ASSERT_TRUE(mouse_coalesce_queue_add(&q, toggle, sizeof(toggle), 0));
+    }
+    const uint8_t right[] = {0x02, 0, 0, 0};
+    TEST_ASSERT_FALSE(mouse_coalesce_queue_add(&q, right, sizeof(right), 0));
+    TEST_ASSERT_EQUAL_UINT8(MOUSE_COALESCE_SEGMENTS, q.high_water);
+}
+
+static void test_mouse_coalesce_slow_host(void)
+{
+    memset(fake_out, 0, sizeof(fake_out));
+    fake_button_changes = 0;
+    fake_last_buttons = 0;
+
+    TEST_ASSERT_EQUAL(ESP_OK, fake_transport_init(HIDRA_REG_MOUSE, MOUSE_TEST_REPORT_LEN, mouse_sent));
+
+    int64_t in[MOUSE_COALESCE_AXES] = {0};
+    uint32_t in_button_changes = 0;
+    uint8_t buttons = 0;
+    uint32_t seed = 12345;
+
+    for (uint32_t n = 0; n < MOUSE_TEST_REPORTS; n++) {
+        // Drags with clicks in between; the summed motion of one interval
+        // regularly exceeds the int8 range and has to be carried
+        if (n % 97 == 96) {
+            buttons ^= 0x01;
+            in_button_changes++;
+        }
+        uint8_t report[MOUSE_TEST_REPORT_LEN] = {buttons};
+        for (int i = 0; i < MOUSE_COALESCE_AXES; i++) {
+            seed = seed * 1103515245u + 12345u;
+            int8_t delta = (int8_t)((seed >> 16) % 31 - 15);
+            if (i == 0) {
+                delta += 3;  // Steady drift to the right
+            }
+            report[i + 1] = (uint8_t)delta;
+        }
+
+        TEST_ASSERT_EQUAL(ESP_OK, hid_dispatch_submit(HIDRA_REG_MOUSE, report, sizeof(report), (uint32_t)esp_timer_get_time()));
+        for (int i = 0; i < MOUSE_COALESCE_AXES; i++) {
+            in[i] += (int8_t)report[i + 1];
+        }
+
+        hid_dispatch_pump();
+        if (n % MOUSE_TEST_PER_INTERVAL == MOUSE_TEST_PER_INTERVAL - 1) {
+            fake_transport_complete();
+        }
+    }
+
+    // Let the host catch up on carried motion
+    for (int i = 0; i < MOUSE_TEST_REPORTS && (fake_transport_busy() || i == 0); i++) {
+        fake_transport_complete();
+    }
+
+    // Same total displacement, every click preserved, far fewer USB reports
+    for (int i = 0; i < MOUSE_COALESCE_AXES; i++) {
+        TEST_ASSERT_EQUAL_INT64(in[i], fake_out[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(in_button_changes, fake_button_changes);
+    TEST_ASSERT_LESS_THAN(2 * MOUSE_TEST_REPORTS / MOUSE_TEST_PER_INTERVAL, fake_transport_sent());
+
+    hid_dispatch_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, hid_dispatch_get_stats(0, &stats));
+    TEST_ASSERT_EQUAL_UINT32(0, stats.dropped);
+    TEST_ASSERT_GREATER_THAN(0, stats.coalesced);
+
+    // GET_REPORT sees the button state without replaying any motion
+    uint8_t last[MAX_REPORT_SIZE];
+    TEST_ASSERT_EQUAL(MOUSE_TEST_REPORT_LEN, hid_dispatch_get_last_report(0, last, sizeof(last)));
+    TEST_ASSERT_EQUAL_HEX8(buttons, last[0]);
+    TEST_ASSERT_EACH_EQUAL_UINT8(0, &last[1], MOUSE_COALESCE_AXES);
+
+    hid_dispatch_deinit();
+}
+
+void test_mouse_coalesce(void)
+{
+    test_mouse_coalesce_accumulator();
+    test_mouse_coalesce_slow_host();
+}
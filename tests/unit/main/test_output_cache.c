@@ -0,0 +1,91 @@
+#include "unity.h"
+#include "output_cache.h"
+#include "usb_descriptors.h"
+#include "hidra.h"
+#include "hidra_protocol.h"
+#include <string.h>
+
+static hidra_config_t output_test_config = {
+    .composite_layout = LAYOUT_KEYBOARD | LAYOUT_MOUSE | LAYOUT_TOUCHPAD
+};
+
+void test_output_cache(void)
+{
+    uint8_t block[OUTPUT_REPORTS_SIZE];
+    hidra_output_reports_t reports;
+    TEST_ASSERT_EQUAL(ESP_OK, usb_descriptors_init(&output_test_config));
+    uint8_t count = usb_get_hid_interface_count();
+    uint8_t keyboard_instance = usb_get_hid_instance_for_register(HIDRA_REG_KEYBOARD);
+    uint8_t touchpad_instance = usb_get_hid_instance_for_register(HIDRA_REG_TOUCHPAD);
+
+    // Nothing from the host yet: every interface has an empty entry
+    output_cache_reset();
+    uint16_t start = output_cache_change_count();
+    TEST_ASSERT_EQUAL(ESP_OK, output_cache_encode(count, block, sizeof(block)));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_parse_output_reports(block, sizeof(block), &reports));
+    TEST_ASSERT_EQUAL_UINT8(3, reports.interface_count);
+    TEST_ASSERT_EQUAL_UINT16(start, reports.change_count);
+    const hidra_output_report_t *keyboard = hidra_find_output_report(&reports, HIDRA_REG_KEYBOARD);
+    TEST_ASSERT_NOT_NULL(keyboard);
+    TEST_ASSERT_EQUAL_UINT8(0, keyboard->length);
+    TEST_ASSERT_NOT_NULL(hidra_find_output_report(&reports, HIDRA_REG_TOUCHPAD));
+
+    // Keyboard LEDs and a touchpad feature report, each kept per interface
+    const uint8_t num_lock = 0x01;
+    const uint8_t caps_lock = 0x02;
+    output_cache_store(keyboard_instance, OUTPUT_REPORT_TYPE_OUTPUT, 0, &num_lock, 1);
+    output_cache_store(keyboard_instance, OUTPUT_REPORT_TYPE_OUTPUT, 0, &caps_lock, 1);
+    const uint8_t input_mode = 3;
+    output_cache_store(touchpad_instance, OUTPUT_REPORT_TYPE_FEATURE, 3, &input_mode, 1);
+    TEST_ASSERT_EQUAL_UINT16((uint16_t)(start + 3), output_cache_change_count());
+
+    TEST_ASSERT_EQUAL(ESP_OK, output_cache_encode(count, block, sizeof(block)));
+    TEST_ASSERT_EQUAL(ESP_OK, hidra_parse_output_reports(block, sizeof(block), &reports));
+    keyboard = hidra_find_output_report(&reports, HIDRA_REG_KEYBOARD);
+    TEST_ASSERT_NOT_NULL(keyboard);
+    TEST_ASSERT_EQUAL_UINT8(OUTPUT_REPORT_TYPE_OUTPUT, keyboard->report_type);
+    TEST_ASSERT_EQUAL_UINT8(1, keyboard->length);
+    TEST_ASSERT_EQUAL_HEX8(caps_lock, keyboard->data[0]);
+    const hidra_output_report_t *touchpad = hidra_find_output_report(&reports, HIDRA_REG_TOUCHPAD);
+    TEST_ASSERT_NOT_NULL(touchpad);
+    TEST_ASSERT_EQUAL_UINT8(OUTPUT_REPORT_TYPE_FEATURE, touchpad->report_type);
+    TEST_ASSERT_EQUAL_UINT8(3, touchpad->report_id);
+    // The mouse has no output reports, but still its entry
+    const hidra_output_report_t *mouse = hidra_find_output_report(&reports, HIDRA_REG_MOUSE);
+    TEST_ASSERT_NOT_NULL(mouse);
+    TEST_ASSERT_EQUAL_UINT8(0, mouse->length);
+    TEST_ASSERT_NULL(hidra_find_output_report(&reports, HIDRA_REG_GAMEPAD));
+
+    // Long reports keep their first bytes; out-of-range instances are ignored
+    uint8_t long_report[OUTPUT_REPORT_DATA_SIZE + 4];
+    for (int i = 0; i < sizeof(long_report); i++) {
+        long_report[i] = i;
+    }
+    output_cache_store(touchpad_instance, OUTPUT_REPORT_TYPE_OUTPUT, 0, long_report, sizeof(long_report));
+    output_cache_store(OUTPUT_CACHE_MAX_INSTANCES, OUTPUT_REPORT_TYPE_OUTPUT, 0, &num_lock, 1);
+    output_cache_encode(count, block, sizeof(block));
+    hidra_parse_output_reports(block, sizeof(block), &reports);
+    TEST_ASSERT_EQUAL_UINT8(OUTPUT_REPORT_DATA_SIZE, reports.interfaces[touchpad_instance].length);
+    TEST_ASSERT_EQUAL_MEMORY(long_report, reports.interfaces[touchpad_instance].data, OUTPUT_REPORT_DATA_SIZE);
+    TEST_ASSERT_EQUAL_UINT16((uint16_t)(start + 4), reports.change_count);
+
+    // A rebuild clears the entries and counts as a change
+    output_cache_reset();
+    TEST_ASSERT_EQUAL_UINT16((uint16_t)(start + 5), output_cache_change_count());
+    output_cache_encode(count, block, sizeof(block));
+    hidra_parse_output_reports(block, sizeof(block), &reports);
+    TEST_ASSERT_EQUAL_UINT8(0, reports.interfaces[keyboard_instance].length);
+    TEST_ASSERT_EQUAL_UINT8(HIDRA_REG_KEYBOARD, reports.interfaces[keyboard_instance].hid_register);
+
+    // Malformed blocks
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, output_cache_encode(2, block, OUTPUT_REPORTS_SIZE - 1));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE, hidra_parse_output_reports(block, OUTPUT_REPORTS_SIZE - 1, &reports));
+    block[0] = OUTPUT_REPORTS_VERSION + 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE, hidra_parse_output_reports(block, sizeof(block), &reports));
+    block[0] = OUTPUT_REPORTS_VERSION;
+    block[1] = EXT_STATUS_MAX_INTERFACES + 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE, hidra_parse_output_reports(block, sizeof(block), &reports));
+    bool changed;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, hidra_read_output_reports(NULL, &reports, &changed, 1000));
+    usb_descriptors_deinit();
+}
@@ -8,11 +8,46 @@ void test_protocol_constants(void)
     TEST_ASSERT_EQUAL_HEX8(0x12, HIDRA_REG_MOUSE);
     TEST_ASSERT_EQUAL_HEX8(0x15, HIDRA_REG_GAMEPAD);
     TEST_ASSERT_EQUAL_HEX8(0xC1, HIDRA_REG_CONSUMER);
+    TEST_ASSERT_EQUAL_HEX8(0x70, HIDRA_REG_KEY_EVENT);
+    TEST_ASSERT_EQUAL_HEX8(0x00, KEY_EVENT_RELEASE);
+    TEST_ASSERT_EQUAL_HEX8(0x01, KEY_EVENT_PRESS);
+    TEST_ASSERT_EQUAL_HEX8(0x71, HIDRA_REG_NKRO_KEYBOARD);
+    TEST_ASSERT_EQUAL_HEX8(0x72, HIDRA_REG_NKRO_KEYS);
+    TEST_ASSERT_EQUAL_HEX16(0x0100, LAYOUT_NKRO_KEYBOARD);
+    TEST_ASSERT_EQUAL(6, TOUCH_CONTACT_SIZE);
+    TEST_ASSERT_LESS_OR_EQUAL(MAX_REPORT_SIZE, 1 + TOUCH_MAX_CONTACTS * TOUCH_CONTACT_SIZE);
+    TEST_ASSERT_EQUAL_HEX8(0xB0, HIDRA_REG_BATCH);
+    TEST_ASSERT_LESS_OR_EQUAL(MAX_BATCH_SIZE, MAX_REPORT_SIZE + BATCH_RECORD_HEADER_SIZE);
+    TEST_ASSERT_LESS_OR_EQUAL(MAX_REPORT_SIZE, NKRO_REPORT_SIZE);
+    TEST_ASSERT_EQUAL_HEX8(0xB1, MACRO_DATA_REG);
+    TEST_ASSERT_EQUAL_HEX8(0xB2, MACRO_PLAY_REG);
+    TEST_ASSERT_EQUAL_HEX8(0xB3, MACRO_SAVE_REG);
+    TEST_ASSERT_LESS_THAN(MACRO_STOP, MACRO_SLOT_COUNT);
+    TEST_ASSERT_EQUAL_HEX8(0xB4, SCHEDULE_REG);
+    TEST_ASSERT_EQUAL_HEX8(0xB5, CLOCK_REG);
+    TEST_ASSERT_EQUAL(8, CLOCK_SIZE);
+    TEST_ASSERT_LESS_OR_EQUAL(MAX_BATCH_SIZE, SCHEDULE_HEADER_SIZE + MAX_REPORT_SIZE);
+    TEST_ASSERT_LESS_THAN(INT32_MAX, SCHEDULE_MAX_LEAD_US);
+    TEST_ASSERT_EQUAL_HEX8(0xB6, STAGE_REG);
+    TEST_ASSERT_EQUAL_HEX8(0xB7, LATCH_REG);
+    TEST_ASSERT_LESS_OR_EQUAL(STAGE_SIZE, MAX_REPORT_SIZE + BATCH_RECORD_HEADER_SIZE);
     
     // Test config register addresses
     TEST_ASSERT_EQUAL_HEX8(0xF0, CONFIG_USB_IDS_REG);
     TEST_ASSERT_EQUAL_HEX8(0xF4, CONFIG_COMPOSITE_DEVICE_REG);
+    TEST_ASSERT_EQUAL_HEX8(0xF5, CONFIG_POLL_INTERVAL_REG);
     TEST_ASSERT_EQUAL_HEX8(0xFE, CONFIG_I2C_ADDR_REG);
+    TEST_ASSERT_EQUAL_HEX8(0xF6, CONFIG_IRQ_GPIO_REG);
+    TEST_ASSERT_EQUAL_HEX8(0xF7, CONFIG_BEGIN_REG);
+    TEST_ASSERT_EQUAL_HEX8(0xF8, CONFIG_COMMIT_REG);
+    TEST_ASSERT_EQUAL_HEX8(0xF9, CONFIG_ABORT_REG);
+    TEST_ASSERT_EQUAL_HEX8(0xFA, MACRO_STATUS_REG);
+    TEST_ASSERT_EQUAL(8, MACRO_STATUS_SIZE);
+    TEST_ASSERT_EQUAL_HEX8(0xFB, OUTPUT_REPORTS_REG);
+    TEST_ASSERT_EQUAL(100, OUTPUT_REPORTS_SIZE);
+    TEST_ASSERT_EQUAL_HEX8(0xFC, IRQ_CAUSE_REG);
+    TEST_ASSERT_EQUAL_HEX8(0xFD, EXT_STATUS_REG);
+    TEST_ASSERT_EQUAL(32, EXT_STATUS_SIZE);
     TEST_ASSERT_EQUAL_HEX8(0xFF, STATUS_REG);
     
     // Test status bits
@@ -21,6 +56,8 @@ void test_protocol_constants(void)
     TEST_ASSERT_EQUAL_HEX8(0x04, ERROR_PAYLOAD_TOO_LARGE);
     TEST_ASSERT_EQUAL_HEX8(0x08, ERROR_INTERFACE_DISABLED);
     TEST_ASSERT_EQUAL_HEX8(0x10, ERROR_NVS_WRITE_FAILED);
+    TEST_ASSERT_EQUAL_HEX8(0x20, ERROR_QUEUE_FULL);
+    TEST_ASSERT_EQUAL_HEX8(0x40, STATUS_MACRO_RUNNING);
     
     // Test default values
     TEST_ASSERT_EQUAL_HEX8(0x70, DEFAULT_I2C_ADDR);
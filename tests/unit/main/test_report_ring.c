@@ -0,0 +1,63 @@
+#include "unity.h"
+#include "report_ring.h"
+#include <string.h>
+
+#define RING_TEST_SLOT_SIZE  5
+#define RING_TEST_SLOTS      4
+
+void test_report_ring(void)
+{
+    static uint8_t storage[REPORT_RING_STORAGE_SIZE(RING_TEST_SLOT_SIZE, RING_TEST_SLOTS)];
+    report_ring_t ring;
+
+    // Slot count must be a power of two, slot size must fit the length byte
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, report_ring_init(&ring, storage, RING_TEST_SLOT_SIZE, 3));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, report_ring_init(&ring, storage, 0, RING_TEST_SLOTS));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, report_ring_init(&ring, NULL, RING_TEST_SLOT_SIZE, RING_TEST_SLOTS));
+    TEST_ASSERT_EQUAL(ESP_OK, report_ring_init(&ring, storage, RING_TEST_SLOT_SIZE, RING_TEST_SLOTS));
+
+    size_t len = 0;
+    TEST_ASSERT_NULL(report_ring_peek(&ring, &len));
+    TEST_ASSERT_EQUAL_UINT16(0, report_ring_depth(&ring));
+    TEST_ASSERT_TRUE(report_ring_has_space(&ring));
+
+    // Oversized reports never enter the ring
+    uint8_t big[RING_TEST_SLOT_SIZE + 1] = {0};
+    TEST_ASSERT_FALSE(report_ring_push(&ring, big, sizeof(big)));
+
+    // Fill, overflow, then drain in FIFO order keeping each report's length
+    for (uint8_t i = 0; i < RING_TEST_SLOTS; i++) {
+        uint8_t report[RING_TEST_SLOT_SIZE];
+        memset(report, i, sizeof(report));
+        TEST_ASSERT_TRUE(report_ring_push(&ring, report, i + 1));
+    }
+    TEST_ASSERT_FALSE(report_ring_has_space(&ring));
+    TEST_ASSERT_FALSE(report_ring_push(&ring, big, 1));
+    TEST_ASSERT_EQUAL_UINT16(RING_TEST_SLOTS, report_ring_depth(&ring));
+    // The head slot of a full ring is the slot being read
+    TEST_ASSERT_EQUAL_UINT16(report_ring_tail_slot(&ring), report_ring_head_slot(&ring));
+    TEST_ASSERT_EQUAL_UINT16(RING_TEST_SLOTS, ring.high_water);
+
+    for (uint8_t i = 0; i < RING_TEST_SLOTS; i++) {
+        const uint8_t *report = report_ring_peek(&ring, &len);
+        TEST_ASSERT_NOT_NULL(report);
+        TEST_ASSERT_EQUAL(i + 1, len);
+        TEST_ASSERT_EACH_EQUAL_UINT8(i, report, len);
+        report_ring_pop(&ring);
+    }
+    TEST_ASSERT_NULL(report_ring_peek(&ring, &len));
+
+    // Indices wrap around the slot array; head and tail slots follow them
+    for (uint32_t i = 0; i < 3 * RING_TEST_SLOTS; i++) {
+        uint8_t value = (uint8_t)i;
+        uint16_t slot = report_ring_head_slot(&ring);
+        TEST_ASSERT_EQUAL_UINT16(i % RING_TEST_SLOTS, slot);
+        TEST_ASSERT_TRUE(report_ring_push(&ring, &value, 1));
+        TEST_ASSERT_EQUAL_UINT16(slot, report_ring_tail_slot(&ring));
+        const uint8_t *report = report_ring_peek(&ring, &len);
+        TEST_ASSERT_NOT_NULL(report);
+        TEST_ASSERT_EQUAL_UINT8(value, report[0]);
+        report_ring_pop(&ring);
+    }
+    TEST_ASSERT_EQUAL_UINT16(RING_TEST_SLOTS, ring.high_water);
+}
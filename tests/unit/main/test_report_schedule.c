@@ -0,0 +1,167 @@
+#include "unity.h"
+#include "report_schedule.h"
+#include "hidra_protocol.h"
+#include <string.h>
+
+// Fake dispatcher: records register and first byte of each report. Reports
+// for a blocked register find their queue full; HIDRA_REG_PEN is unknown.
+static uint8_t fake_register[SCHEDULE_DEPTH * 2];
+static uint8_t fake_tag[SCHEDULE_DEPTH * 2];
+static uint32_t fake_count;
+static uint8_t fake_blocked;
+
+static esp_err_t fake_submit(uint8_t hid_register, const uint8_t *report, size_t len)
+{
+    if (hid_register == HIDRA_REG_PEN) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (hid_register == fake_blocked) {
+        return ESP_ERR_NO_MEM;
+    }
+    TEST_ASSERT_LESS_THAN(SCHEDULE_DEPTH * 2, fake_count);
+    fake_register[fake_count] = hid_register;
+    fake_tag[fake_count] = report[0];
+    fake_count++;
+    return ESP_OK;
+}
+
+static void fake_reset(void)
+{
+    fake_count = 0;
+    fake_blocked = 0;
+    report_schedule_clear();
+    report_schedule_reset_stats();
+}
+
+static esp_err_t add(uint32_t now_us, uint32_t due_us, uint8_t hid_register, uint8_t tag)
+{
+    uint8_t report[4] = {tag};
+    return report_schedule_add(now_us, due_us, hid_register, report, sizeof(report));
+}
+
+static void test_schedule_order(void)
+{
+    fake_reset();
+    uint32_t wait_us;
+
+    // Added out of order, released in time order; equal times keep their order
+    TEST_ASSERT_EQUAL(ESP_OK, add(0, 3000, HIDRA_REG_MOUSE, 3));
+    TEST_ASSERT_EQUAL(ESP_OK, add(0, 1000, HIDRA_REG_MOUSE, 1));
+    TEST_ASSERT_EQUAL(ESP_OK, add(0, 2000, HIDRA_REG_KEYBOARD, 2));
+    TEST_ASSERT_EQUAL(ESP_OK, add(0, 2000, HIDRA_REG_MOUSE, 4));
+
+    TEST_ASSERT_TRUE(report_schedule_release(500, fake_submit, &wait_us));
+    TEST_ASSERT_EQUAL(0, fake_count);
+    TEST_ASSERT_EQUAL_UINT32(500, wait_us);
+
+    TEST_ASSERT_TRUE(report_schedule_release(1000, fake_submit, &wait_us));
+    TEST_ASSERT_EQUAL(1, fake_count);
+    TEST_ASSERT_EQUAL_UINT32(1000, wait_us);
+
+    TEST_ASSERT_TRUE(report_schedule_release(2100, fake_submit, &wait_us));
+    TEST_ASSERT_EQUAL(3, fake_count);
+    TEST_ASSERT_EQUAL_UINT32(900, wait_us);
+
+    // Late by more than a frame: still sent, and counted
+    TEST_ASSERT_FALSE(report_schedule_release(5000, fake_submit, &wait_us));
+    const uint8_t tags[] = {1, 2, 4, 3};
+    TEST_ASSERT_EQUAL(4, fake_count);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(tags, fake_tag, sizeof(tags));
+
+    report_schedule_stats_t stats;
+    report_schedule_get_stats(&stats);
+    TEST_ASSERT_EQUAL_UINT16(0, stats.pending);
+    TEST_ASSERT_EQUAL_UINT32(4, stats.released);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.late);
+    TEST_ASSERT_EQUAL_UINT32(2000, stats.max_late_us);
+
+    // A time already past goes out on the next pass
+    TEST_ASSERT_EQUAL(ESP_OK, add(10000, 9000, HIDRA_REG_MOUSE, 5));
+    TEST_ASSERT_FALSE(report_schedule_release(10000, fake_submit, &wait_us));
+    TEST_ASSERT_EQUAL_UINT8(5, fake_tag[4]);
+}
+
+static void test_schedule_wrap(void)
+{
+    fake_reset();
+    uint32_t wait_us;
+
+    // Due times on both sides of the 32-bit wrap keep their order
+    const uint32_t now = UINT32_MAX - 1000;
+    TEST_ASSERT_EQUAL(ESP_OK, add(now, 500, HIDRA_REG_MOUSE, 2));
+    TEST_ASSERT_EQUAL(ESP_OK, add(now, UINT32_MAX - 500, HIDRA_REG_MOUSE, 1));
+
+    TEST_ASSERT_TRUE(report_schedule_release(now, fake_submit, &wait_us));
+    TEST_ASSERT_EQUAL_UINT32(500, wait_us);
+    TEST_ASSERT_TRUE(report_schedule_release(UINT32_MAX - 500, fake_submit, &wait_us));
+    TEST_ASSERT_EQUAL_UINT32(1001, wait_us);
+    TEST_ASSERT_FALSE(report_schedule_release(500, fake_submit, &wait_us));
+    TEST_ASSERT_EQUAL(2, fake_count);
+    TEST_ASSERT_EQUAL_UINT8(1, fake_tag[0]);
+    TEST_ASSERT_EQUAL_UINT8(2, fake_tag[1]);
+}
+
+static void test_schedule_backpressure(void)
+{
+    fake_reset();
+    uint32_t wait_us;
+
+    // A full keyboard queue holds back later keyboard reports only
+    TEST_ASSERT_EQUAL(ESP_OK, add(0, 100, HIDRA_REG_KEYBOARD, 1));
+    TEST_ASSERT_EQUAL(ESP_OK, add(0, 200, HIDRA_REG_MOUSE, 2));
+    TEST_ASSERT_EQUAL(ESP_OK, add(0, 300, HIDRA_REG_KEYBOARD, 3));
+    TEST_ASSERT_EQUAL(ESP_OK, add(0, 50000, HIDRA_REG_MOUSE, 4));
+    fake_blocked = HIDRA_REG_KEYBOARD;
+    TEST_ASSERT_TRUE(report_schedule_release(400, fake_submit, &wait_us));
+    TEST_ASSERT_EQUAL(1, fake_count);
+    TEST_ASSERT_EQUAL_UINT8(HIDRA_REG_MOUSE, fake_register[0]);
+    TEST_ASSERT_EQUAL_UINT32(REPORT_SCHEDULE_RETRY_US, wait_us);
+
+    fake_blocked = 0;
+    TEST_ASSERT_TRUE(report_schedule_release(1400, fake_submit, &wait_us));
+    TEST_ASSERT_EQUAL(3, fake_count);
+    TEST_ASSERT_EQUAL_UINT8(1, fake_tag[1]);
+    TEST_ASSERT_EQUAL_UINT8(3, fake_tag[2]);
+    TEST_ASSERT_EQUAL_UINT32(50000 - 1400, wait_us);
+
+    // A report its interface rejects is dropped, not retried
+    report_schedule_clear();
+    TEST_ASSERT_EQUAL(ESP_OK, add(0, 0, HIDRA_REG_PEN, 5));
+    TEST_ASSERT_FALSE(report_schedule_release(0, fake_submit, &wait_us));
+    report_schedule_stats_t stats;
+    report_schedule_get_stats(&stats);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.failed);
+}
+
+static void test_schedule_limits(void)
+{
+    fake_reset();
+    uint32_t wait_us;
+    uint8_t report[MAX_REPORT_SIZE + 1] = {0};
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, report_schedule_add(0, 0, HIDRA_REG_MOUSE, report, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, report_schedule_add(0, 0, HIDRA_REG_MOUSE, report, sizeof(report)));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, report_schedule_add(0, 0, HIDRA_REG_MOUSE, NULL, 4));
+    TEST_ASSERT_EQUAL(ESP_OK, report_schedule_add(0, 0, HIDRA_REG_GAMEPAD, report, MAX_REPORT_SIZE));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, add(1000, 1000 + SCHEDULE_MAX_LEAD_US + 1, HIDRA_REG_MOUSE, 0));
+    TEST_ASSERT_EQUAL(ESP_OK, add(1000, 1000 + SCHEDULE_MAX_LEAD_US, HIDRA_REG_MOUSE, 0));
+
+    for (int i = 2; i < SCHEDULE_DEPTH; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, add(0, i, HIDRA_REG_MOUSE, i));
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, add(0, 0, HIDRA_REG_MOUSE, 0));
+
+    // Clearing drops everything pending
+    report_schedule_clear();
+    TEST_ASSERT_FALSE(report_schedule_release(UINT32_MAX / 2, fake_submit, &wait_us));
+    TEST_ASSERT_EQUAL(0, fake_count);
+    TEST_ASSERT_EQUAL(ESP_OK, add(0, 0, HIDRA_REG_MOUSE, 0));
+}
+
+void test_report_schedule(void)
+{
+    test_schedule_order();
+    test_schedule_wrap();
+    test_schedule_backpressure();
+    test_schedule_limits();
+}
@@ -9,11 +9,14 @@ void test_status_register(void)
     TEST_ASSERT_EQUAL_HEX8(0x04, ERROR_PAYLOAD_TOO_LARGE);
     TEST_ASSERT_EQUAL_HEX8(0x08, ERROR_INTERFACE_DISABLED);
     TEST_ASSERT_EQUAL_HEX8(0x10, ERROR_NVS_WRITE_FAILED);
+    TEST_ASSERT_EQUAL_HEX8(0x20, ERROR_QUEUE_FULL);
+    TEST_ASSERT_EQUAL_HEX8(0x80, ERROR_INVALID_VALUE);
     
     // Test bit uniqueness
     uint8_t status_bits[] = {
         STATUS_OK, ERROR_UNKNOWN_REGISTER, ERROR_PAYLOAD_TOO_LARGE,
-        ERROR_INTERFACE_DISABLED, ERROR_NVS_WRITE_FAILED
+        ERROR_INTERFACE_DISABLED, ERROR_NVS_WRITE_FAILED, ERROR_QUEUE_FULL,
+        STATUS_MACRO_RUNNING, ERROR_INVALID_VALUE
     };
     
     size_t bit_count = sizeof(status_bits) / sizeof(status_bits[0]);
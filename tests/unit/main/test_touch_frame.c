@@ -0,0 +1,242 @@
+#include "unity.h"
+#include "touch_frame.h"
+#include "hid_dispatch.h"
+#include "hidra_protocol.h"
+#include "esp_timer.h"
+#include "fake_transport.h"
+#include <string.h>
+
+#define TOUCH_TEST_FRAMES           1000    // 1 s of 1 kHz frames
+#define TOUCH_TEST_PER_INTERVAL     8       // Host polls every 8 ms
+#define TOUCH_TEST_FINGERS          TOUCH_MAX_CONTACTS
+
+// Host side of the fake USB interface
+static uint32_t fake_torn;
+static uint8_t fake_last[TOUCHSCREEN_REPORT_SIZE];
+
+static const uint8_t *report_contact(const uint8_t *report, int i)
+{
+    return &report[1 + i * TOUCH_REPORT_CONTACT_SIZE];
+}
+
+static uint16_t contact_x(const uint8_t *c)
+{
+    return c[1] | (c[2] << 8);
+}
+
+static void touch_sent(const uint8_t *report, uint16_t len)
+{
+    // Every finger down in one report must come from the same frame: the
+    // gesture encodes the frame number in the upper bits of X
+    int frame = -1;
+    uint8_t count = report[1 + TOUCH_MAX_CONTACTS * TOUCH_REPORT_CONTACT_SIZE + 2];
+    for (int i = 0; i < count; i++) {
+        const uint8_t *c = report_contact(report, i);
+        if (!(c[0] & 0x02)) {
+            continue;
+        }
+        int contact_frame = contact_x(c) / 16;
+        if (frame >= 0 && contact_frame != frame) {
+            fake_torn++;
+        }
+        frame = contact_frame;
+    }
+    memcpy(fake_last, report, len);
+}
+
+static size_t put_contact(uint8_t *p, uint8_t id, uint8_t flags, uint16_t x, uint16_t y)
+{
+    p[0] = id;
+    p[1] = flags;
+    p[2] = x & 0xFF;
+    p[3] = x >> 8;
+    p[4] = y & 0xFF;
+    p[5] = y >> 8;
+    return TOUCH_CONTACT_SIZE;
+}
+
+#define DOWN (TOUCH_CONTACT_TIP | TOUCH_CONTACT_CONFIDENCE)
+
+static void test_touch_frame_staging(void)
+{
+    touch_frame_t tf;
+    touch_frame_reset(&tf, true);
+    uint8_t out[TOUCHPAD_REPORT_SIZE];
+    uint8_t write[1 + 2 * TOUCH_CONTACT_SIZE];
+
+    // A frame split over two writes is not reported until it ends
+    write[0] = 0;
+    put_contact(&write[1], 5, DOWN, 100, 200);
+    TEST_ASSERT_EQUAL(ESP_OK, touch_frame_add(&tf, write, 1 + TOUCH_CONTACT_SIZE, 1000));
+    TEST_ASSERT_EQUAL(0, touch_frame_build(&tf, out, sizeof(out), NULL, NULL));
+
+    write[0] = TOUCH_FRAME_END | TOUCH_FRAME_BUTTON;
+    put_contact(&write[1], 9, DOWN, 300, 400);
+    TEST_ASSERT_EQUAL(ESP_OK, touch_frame_add(&tf, write, 1 + TOUCH_CONTACT_SIZE, 1500));
+
+    uint32_t frames = 0;
+    uint32_t stamp = 0;
+    TEST_ASSERT_EQUAL(TOUCHPAD_REPORT_SIZE, touch_frame_build(&tf, out, sizeof(out), &frames, &stamp));
+    TEST_ASSERT_EQUAL_UINT32(1, frames);
+    TEST_ASSERT_EQUAL_UINT32(1500, stamp);
+    TEST_ASSERT_EQUAL_HEX8(TOUCH_REPORT_ID, out[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x01 | 0x02 | (5 << 2), out[1]);
+    TEST_ASSERT_EQUAL_UINT16(100, contact_x(report_contact(out, 0)));
+    TEST_ASSERT_EQUAL_HEX8(0x01 | 0x02 | (9 << 2), report_contact(out, 1)[0]);
+    uint8_t *tail = &out[1 + TOUCH_MAX_CONTACTS * TOUCH_REPORT_CONTACT_SIZE];
+    TEST_ASSERT_EQUAL_UINT16(1500 / TOUCH_SCAN_TIME_UNIT_US, tail[0] | (tail[1] << 8));
+    TEST_ASSERT_EQUAL_UINT8(2, tail[2]);
+    TEST_ASSERT_EQUAL_UINT8(1, tail[3]);
+    touch_frame_consume(&tf);
+    TEST_ASSERT_EQUAL(0, touch_frame_build(&tf, out, sizeof(out), NULL, NULL));
+
+    // Malformed writes are rejected without touching the staged frame
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, touch_frame_add(&tf, write, 0, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, touch_frame_add(&tf, write, 4, 0));
+    put_contact(&write[1], TOUCH_MAX_CONTACT_ID + 1, DOWN, 0, 0);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, touch_frame_add(&tf, write, 1 + TOUCH_CONTACT_SIZE, 0));
+    TEST_ASSERT_EQUAL_UINT8(0, tf.staged_count);
+}
+
+static uint16_t scan_time_after(touch_frame_t *tf, uint32_t stamp)
+{
+    uint8_t write[1 + TOUCH_CONTACT_SIZE] = {TOUCH_FRAME_END};
+    uint8_t out[TOUCHSCREEN_REPORT_SIZE];
+    put_contact(&write[1], 1, DOWN, 10, 10);
+    TEST_ASSERT_EQUAL(ESP_OK, touch_frame_add(tf, write, sizeof(write), stamp));
+    TEST_ASSERT_EQUAL(TOUCHSCREEN_REPORT_SIZE, touch_frame_build(tf, out, sizeof(out), NULL, NULL));
+    touch_frame_consume(tf);
+    const uint8_t *tail = &out[1 + TOUCH_MAX_CONTACTS * TOUCH_REPORT_CONTACT_SIZE];
+    return tail[0] | (tail[1] << 8);
+}
+
+static void test_touch_frame_scan_time(void)
+{
+    touch_frame_t tf;
+    touch_frame_reset(&tf, false);
+
+    // Scan time follows the time between frames, carrying the part of a
+    // unit left over, and keeps counting across the wrap of the 32-bit stamp
+    const uint32_t base = 4294967200u;      // A whole number of units, 96 us before the wrap
+    uint16_t first = scan_time_after(&tf, base);
+    TEST_ASSERT_EQUAL_UINT16(first, scan_time_after(&tf, base + 50));
+    TEST_ASSERT_EQUAL_UINT16(first + 2, scan_time_after(&tf, base + 249));
+    TEST_ASSERT_EQUAL_UINT16(first + 3, scan_time_after(&tf, base + 349));
+    TEST_ASSERT_EQUAL_UINT16(first + 3, scan_time_after(&tf, base + 399));
+}
+
+static void test_touch_frame_taps_and_lifts(void)
+{
+    touch_frame_t tf;
+    touch_frame_reset(&tf, false);
+    uint8_t out[TOUCHSCREEN_REPORT_SIZE];
+    uint8_t write[1 + TOUCH_CONTACT_SIZE];
+    write[0] = TOUCH_FRAME_END;
+
+    // A tap that starts and ends within one host interval is still seen
+    // down once, then up
+    put_contact(&write[1], 3, DOWN, 10, 10);
+    TEST_ASSERT_EQUAL(ESP_OK, touch_frame_add(&tf, write, sizeof(write), 0));
+    put_contact(&write[1], 3, TOUCH_CONTACT_CONFIDENCE, 11, 11);
+    TEST_ASSERT_EQUAL(ESP_OK, touch_frame_add(&tf, write, sizeof(write), 0));
+
+    uint32_t frames = 0;
+    TEST_ASSERT_EQUAL(TOUCHSCREEN_REPORT_SIZE, touch_frame_build(&tf, out, sizeof(out), &frames, NULL));
+    TEST_ASSERT_EQUAL_UINT32(2, frames);
+    TEST_ASSERT_EQUAL_HEX8(0x02, report_contact(out, 0)[0] & 0x02);
+    touch_frame_consume(&tf);
+
+    TEST_ASSERT_EQUAL(TOUCHSCREEN_REPORT_SIZE, touch_frame_build(&tf, out, sizeof(out), &frames, NULL));
+    TEST_ASSERT_EQUAL_UINT32(0, frames);
+    TEST_ASSERT_EQUAL_HEX8(0x00, report_contact(out, 0)[0] & 0x02);
+    TEST_ASSERT_EQUAL_UINT8(1, out[1 + TOUCH_MAX_CONTACTS * TOUCH_REPORT_CONTACT_SIZE + 2]);
+    touch_frame_consume(&tf);
+    TEST_ASSERT_EQUAL_UINT8(0, touch_frame_slots_used(&tf));
+    TEST_ASSERT_EQUAL(0, touch_frame_build(&tf, out, sizeof(out), NULL, NULL));
+
+    // A finger lifted and put down again between reports stays down
+    put_contact(&write[1], 4, DOWN, 20, 20);
+    touch_frame_add(&tf, write, sizeof(write), 0);
+    touch_frame_build(&tf, out, sizeof(out), NULL, NULL);
+    touch_frame_consume(&tf);
+    put_contact(&write[1], 4, TOUCH_CONTACT_CONFIDENCE, 20, 20);
+    touch_frame_add(&tf, write, sizeof(write), 0);
+    put_contact(&write[1], 4, DOWN, 30, 30);
+    touch_frame_add(&tf, write, sizeof(write), 0);
+    TEST_ASSERT_EQUAL(TOUCHSCREEN_REPORT_SIZE, touch_frame_build(&tf, out, sizeof(out), NULL, NULL));
+    TEST_ASSERT_EQUAL_HEX8(0x02, report_contact(out, 0)[0] & 0x02);
+    TEST_ASSERT_EQUAL_UINT16(30, contact_x(report_contact(out, 0)));
+    touch_frame_consume(&tf);
+
+    // Every slot held by fingers the host has not seen lift: a new finger
+    // has to wait
+    touch_frame_reset(&tf, false);
+    for (uint8_t id = 0; id < TOUCH_MAX_CONTACTS; id++) {
+        put_contact(&write[1], id, DOWN, id, id);
+        TEST_ASSERT_EQUAL(ESP_OK, touch_frame_add(&tf, write, sizeof(write), 0));
+    }
+    put_contact(&write[1], 40, DOWN, 0, 0);
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, touch_frame_add(&tf, write, sizeof(write), 0));
+    TEST_ASSERT_EQUAL_UINT8(TOUCH_MAX_CONTACTS, tf.high_water);
+
+    // More contacts than the report holds in one frame
+    uint8_t big[1 + (TOUCH_MAX_CONTACTS + 1) * TOUCH_CONTACT_SIZE] = {0};
+    for (uint8_t id = 0; id <= TOUCH_MAX_CONTACTS; id++) {
+        put_contact(&big[1 + id * TOUCH_CONTACT_SIZE], 20 + id, 0, 0, 0);
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, touch_frame_add(&tf, big, sizeof(big), 0));
+}
+
+static void test_touch_frame_gesture(void)
+{
+    fake_torn = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, fake_transport_init(HIDRA_REG_TOUCHSCREEN, TOUCHSCREEN_REPORT_SIZE, touch_sent));
+
+    // Ten fingers swiping at 1 kHz, each frame sent as two writes of five
+    // contacts; the last frame lifts every finger
+    const int half = TOUCH_TEST_FINGERS / 2;
+    for (int n = 0; n < TOUCH_TEST_FRAMES; n++) {
+        bool last = (n == TOUCH_TEST_FRAMES - 1);
+        for (int part = 0; part < 2; part++) {
+            uint8_t write[1 + TOUCH_MAX_CONTACTS / 2 * TOUCH_CONTACT_SIZE];
+            write[0] = part ? TOUCH_FRAME_END : 0;
+            uint8_t *p = &write[1];
+            for (int f = part * half; f < (part + 1) * half; f++) {
+                uint16_t x = (n % 256) * 16 + f;
+                p += put_contact(p, f, last ? TOUCH_CONTACT_CONFIDENCE : DOWN, x, 100 * f);
+            }
+            TEST_ASSERT_EQUAL(ESP_OK, hid_dispatch_submit(HIDRA_REG_TOUCHSCREEN, write, sizeof(write), (uint32_t)esp_timer_get_time()));
+            hid_dispatch_pump();
+        }
+        if (n % TOUCH_TEST_PER_INTERVAL == TOUCH_TEST_PER_INTERVAL - 1) {
+            fake_transport_complete();
+        }
+    }
+    fake_transport_complete();
+    fake_transport_complete();
+
+    // No report mixes two frames, and the host ends with every finger up
+    TEST_ASSERT_EQUAL_UINT32(0, fake_torn);
+    TEST_ASSERT_LESS_THAN(2 * TOUCH_TEST_FRAMES / TOUCH_TEST_PER_INTERVAL, fake_transport_sent());
+    TEST_ASSERT_EQUAL_UINT8(TOUCH_TEST_FINGERS, fake_last[1 + TOUCH_MAX_CONTACTS * TOUCH_REPORT_CONTACT_SIZE + 2]);
+    for (int i = 0; i < TOUCH_TEST_FINGERS; i++) {
+        TEST_ASSERT_EQUAL_HEX8(0x00, report_contact(fake_last, i)[0] & 0x02);
+    }
+
+    hid_dispatch_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, hid_dispatch_get_stats(0, &stats));
+    TEST_ASSERT_EQUAL_UINT32(0, stats.dropped);
+    TEST_ASSERT_GREATER_THAN(0, stats.coalesced);
+    TEST_ASSERT_EQUAL_UINT16(0, stats.depth);
+    TEST_ASSERT_EQUAL_UINT16(TOUCH_MAX_CONTACTS, stats.capacity);
+
+    hid_dispatch_deinit();
+}
+
+void test_touch_frame(void)
+{
+    test_touch_frame_staging();
+    test_touch_frame_scan_time();
+    test_touch_frame_taps_and_lifts();
+    test_touch_frame_gesture();
+}
@@ -1,6 +1,8 @@
 #include "unity.h"
 #include "usb_descriptors.h"
+#include "touch_frame.h"
 #include "hidra_protocol.h"
+#include <string.h>
 
 // Mock configuration for testing
 static hidra_config_t test_config = {
@@ -30,6 +32,20 @@ void test_usb_descriptors(void)
     // Test descriptor initialization
     TEST_ASSERT_EQUAL(ESP_OK, usb_descriptors_init(&test_config));
     
+    // Descriptors are built in place: same storage on every rebuild
+    const uint8_t *config_desc = tud_descriptor_configuration_cb(0);
+    TEST_ASSERT_NOT_NULL(tud_descriptor_device_cb());
+    TEST_ASSERT_NOT_NULL(config_desc);
+    TEST_ASSERT_EQUAL_UINT16(TUD_CONFIG_DESC_LEN + 2 * TUD_HID_DESC_LEN, config_desc[2] | (config_desc[3] << 8));
+    const uint16_t *product = tud_descriptor_string_cb(2, 0x0409);
+    TEST_ASSERT_NOT_NULL(product);
+    TEST_ASSERT_EQUAL_HEX16((TUSB_DESC_STRING << 8) | ((strlen("Test Product") + 1) * 2), product[0]);
+    TEST_ASSERT_EQUAL_HEX16('T', product[1]);
+    TEST_ASSERT_NULL(tud_descriptor_string_cb(4, 0x0409));
+    TEST_ASSERT_EQUAL(ESP_OK, usb_descriptors_init(&test_config));
+    TEST_ASSERT_EQUAL_PTR(config_desc, tud_descriptor_configuration_cb(0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, usb_descriptors_init(NULL));
+    
     // Test interface management
     TEST_ASSERT_TRUE(usb_is_interface_enabled(HIDRA_REG_KEYBOARD));
     TEST_ASSERT_TRUE(usb_is_interface_enabled(HIDRA_REG_MOUSE));
@@ -41,6 +57,194 @@ void test_usb_descriptors(void)
     uint8_t invalid_instance = usb_get_hid_instance_for_register(HIDRA_REG_GAMEPAD);
     TEST_ASSERT_EQUAL_UINT8(0xFF, invalid_instance);
     
+    // Test per-interface polling interval: unset entries keep the default
+    usb_descriptors_deinit();
+    test_config.poll_interval_ms[usb_get_layout_index_for_register(HIDRA_REG_MOUSE)] = 1;
+    TEST_ASSERT_EQUAL(ESP_OK, usb_descriptors_init(&test_config));
+    config_desc = tud_descriptor_configuration_cb(0);
+    uint16_t total_len = config_desc[2] | (config_desc[3] << 8);
+    uint8_t intervals[2] = {0};
+    int endpoints = 0;
+    for (uint16_t offset = 0; offset < total_len && config_desc[offset] > 0; offset += config_desc[offset]) {
+        if (config_desc[offset + 1] == TUSB_DESC_ENDPOINT && endpoints < 2) {
+            intervals[endpoints++] = config_desc[offset + 6];
+        }
+    }
+    TEST_ASSERT_EQUAL(2, endpoints);
+    TEST_ASSERT_EQUAL_UINT8(DEFAULT_POLL_INTERVAL_MS, intervals[usb_get_hid_instance_for_register(HIDRA_REG_KEYBOARD)]);
+    TEST_ASSERT_EQUAL_UINT8(1, intervals[usb_get_hid_instance_for_register(HIDRA_REG_MOUSE)]);
+    memset(test_config.poll_interval_ms, 0, sizeof(test_config.poll_interval_ms));
+    
+    TEST_ASSERT_EQUAL(0, usb_get_layout_index_for_register(HIDRA_REG_KEYBOARD));
+    TEST_ASSERT_EQUAL(8, usb_get_layout_index_for_register(HIDRA_REG_NKRO_KEYBOARD));
+    TEST_ASSERT_EQUAL(-1, usb_get_layout_index_for_register(HIDRA_REG_KEY_EVENT));
+    TEST_ASSERT_EQUAL_HEX16(LAYOUT_KEYBOARD | LAYOUT_NKRO_KEYBOARD,
+                            usb_get_supported_layout() & (LAYOUT_KEYBOARD | LAYOUT_NKRO_KEYBOARD));
+    TEST_ASSERT_EQUAL_HEX16(0, usb_get_supported_layout() & 0x8000);
+    
+    // Test NKRO keyboard alongside the boot keyboard
+    usb_descriptors_deinit();
+    test_config.composite_layout = LAYOUT_KEYBOARD | LAYOUT_NKRO_KEYBOARD;
+    TEST_ASSERT_EQUAL(ESP_OK, usb_descriptors_init(&test_config));
+    uint8_t nkro_instance = usb_get_hid_instance_for_register(HIDRA_REG_NKRO_KEYBOARD);
+    TEST_ASSERT_NOT_EQUAL(0xFF, nkro_instance);
+    TEST_ASSERT_NOT_EQUAL(usb_get_hid_instance_for_register(HIDRA_REG_KEYBOARD), nkro_instance);
+    TEST_ASSERT_EQUAL_UINT16(NKRO_REPORT_SIZE, usb_get_hid_report_len(nkro_instance));
+    TEST_ASSERT_EQUAL_PTR(hid_report_descriptor_nkro_keyboard, tud_hid_descriptor_report_cb(nkro_instance));
+    
+    // One USB interface per HID instance: a fifth interface does not fit
+    // CFG_TUD_HID, but all of them fit behind one shared interface
+    const uint16_t four = LAYOUT_KEYBOARD | LAYOUT_MOUSE | LAYOUT_GAMEPAD | LAYOUT_CONSUMER;
+    TEST_ASSERT_EQUAL(4, CFG_TUD_HID);
+    TEST_ASSERT_TRUE(usb_layout_fits(four));
+    TEST_ASSERT_FALSE(usb_layout_fits(four | LAYOUT_NKRO_KEYBOARD));
+    TEST_ASSERT_TRUE(usb_layout_fits(four | LAYOUT_NKRO_KEYBOARD | LAYOUT_SINGLE_INTERFACE));
+    TEST_ASSERT_FALSE(usb_layout_fits(0));
+    TEST_ASSERT_FALSE(usb_layout_fits(LAYOUT_JOYSTICK | LAYOUT_SINGLE_INTERFACE));
+    usb_descriptors_deinit();
+    test_config.composite_layout = four | LAYOUT_NKRO_KEYBOARD;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, usb_descriptors_init(&test_config));
+    TEST_ASSERT_EQUAL(0, usb_get_hid_interface_count());
+
+    // The touch interfaces count like any other
+    const uint16_t touch = LAYOUT_TOUCHSCREEN | LAYOUT_TOUCHPAD;
+    TEST_ASSERT_TRUE(usb_layout_fits(touch | LAYOUT_KEYBOARD | LAYOUT_MOUSE));
+    TEST_ASSERT_FALSE(usb_layout_fits(touch | LAYOUT_KEYBOARD | LAYOUT_MOUSE | LAYOUT_NKRO_KEYBOARD));
+    TEST_ASSERT_FALSE(usb_layout_fits(touch | four));
+    TEST_ASSERT_TRUE(usb_layout_fits(touch | four | LAYOUT_NKRO_KEYBOARD | LAYOUT_SINGLE_INTERFACE));
+    test_config.composite_layout = touch | LAYOUT_KEYBOARD | LAYOUT_MOUSE | LAYOUT_GAMEPAD;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, usb_descriptors_init(&test_config));
+
+    // Touch interfaces enumerate with their report IDs and features
+    usb_descriptors_deinit();
+    test_config.composite_layout = LAYOUT_TOUCHSCREEN | LAYOUT_TOUCHPAD;
+    TEST_ASSERT_EQUAL(ESP_OK, usb_descriptors_init(&test_config));
+    TEST_ASSERT_EQUAL(2, usb_get_hid_interface_count());
+    uint8_t screen_instance = usb_get_hid_instance_for_register(HIDRA_REG_TOUCHSCREEN);
+    uint8_t pad_instance = usb_get_hid_instance_for_register(HIDRA_REG_TOUCHPAD);
+    TEST_ASSERT_EQUAL_UINT16(TOUCHSCREEN_REPORT_SIZE, usb_get_hid_report_len(screen_instance));
+    TEST_ASSERT_EQUAL_UINT16(TOUCHPAD_REPORT_SIZE, usb_get_hid_report_len(pad_instance));
+    TEST_ASSERT_EQUAL_PTR(hid_report_descriptor_touchpad, tud_hid_descriptor_report_cb(pad_instance));
+    uint8_t feature[4];
+    TEST_ASSERT_EQUAL_UINT16(1, usb_get_hid_feature_report(screen_instance, TOUCH_FEATURE_MAX_COUNT_ID, feature, sizeof(feature)));
+    TEST_ASSERT_EQUAL_UINT8(TOUCH_MAX_CONTACTS, feature[0]);
+    TEST_ASSERT_EQUAL_UINT16(0, usb_get_hid_feature_report(screen_instance, TOUCH_FEATURE_INPUT_MODE_ID, feature, sizeof(feature)));
+    TEST_ASSERT_EQUAL_UINT16(1, usb_get_hid_feature_report(pad_instance, TOUCH_FEATURE_MAX_COUNT_ID, feature, sizeof(feature)));
+    TEST_ASSERT_EQUAL_UINT8(TOUCH_MAX_CONTACTS, feature[0] & 0x0F);
+    TEST_ASSERT_EQUAL_UINT16(1, usb_get_hid_feature_report(pad_instance, TOUCH_FEATURE_INPUT_MODE_ID, feature, sizeof(feature)));
+    TEST_ASSERT_EQUAL_UINT8(3, feature[0]);
+    
+    // Touchpad settings read back what the host last wrote
+    const uint8_t mouse_mode = 0;
+    const uint8_t surface_only = 0x01;
+    const uint8_t bad_mode = 11;
+    TEST_ASSERT_TRUE(usb_set_hid_feature_report(pad_instance, TOUCH_FEATURE_INPUT_MODE_ID, &mouse_mode, 1));
+    TEST_ASSERT_FALSE(usb_set_hid_feature_report(pad_instance, TOUCH_FEATURE_INPUT_MODE_ID, &bad_mode, 1));
+    TEST_ASSERT_TRUE(usb_set_hid_feature_report(pad_instance, TOUCH_FEATURE_SELECTIVE_ID, &surface_only, 1));
+    TEST_ASSERT_FALSE(usb_set_hid_feature_report(pad_instance, TOUCH_FEATURE_MAX_COUNT_ID, &surface_only, 1));
+    TEST_ASSERT_FALSE(usb_set_hid_feature_report(screen_instance, TOUCH_FEATURE_INPUT_MODE_ID, &mouse_mode, 1));
+    TEST_ASSERT_EQUAL_UINT16(1, usb_get_hid_feature_report(pad_instance, TOUCH_FEATURE_INPUT_MODE_ID, feature, sizeof(feature)));
+    TEST_ASSERT_EQUAL_UINT8(mouse_mode, feature[0]);
+    TEST_ASSERT_EQUAL_UINT16(1, usb_get_hid_feature_report(pad_instance, TOUCH_FEATURE_SELECTIVE_ID, feature, sizeof(feature)));
+    TEST_ASSERT_EQUAL_HEX8(surface_only, feature[0]);
+    
+    // Certification status: a 257-byte GET_REPORT reaches the callback as
+    // TinyUSB passes it, capped at its HID buffer less the report ID, and
+    // gets the whole 256-byte blob
+    uint8_t cert[TOUCH_CERT_BLOB_SIZE + 1];
+    const uint16_t wlength = 1 + TOUCH_CERT_BLOB_SIZE;
+    uint16_t reqlen = (wlength < CFG_TUD_HID_EP_BUFSIZE ? wlength : CFG_TUD_HID_EP_BUFSIZE) - 1;
+    TEST_ASSERT_EQUAL_UINT16(TOUCH_CERT_BLOB_SIZE, reqlen);
+    memset(cert, 0xAA, sizeof(cert));
+    TEST_ASSERT_EQUAL_UINT16(TOUCH_CERT_BLOB_SIZE, usb_get_hid_feature_report(pad_instance, TOUCH_FEATURE_CERT_ID, cert, reqlen));
+    TEST_ASSERT_EQUAL_HEX8(0xAA, cert[TOUCH_CERT_BLOB_SIZE]);
+    TEST_ASSERT_EQUAL_UINT16(64, usb_get_hid_feature_report(pad_instance, TOUCH_FEATURE_CERT_ID, cert, 64));
+    TEST_ASSERT_EQUAL_UINT16(0, usb_get_hid_feature_report(screen_instance, TOUCH_FEATURE_CERT_ID, cert, sizeof(cert)));
+    TEST_ASSERT_EQUAL_HEX16(LAYOUT_TOUCHSCREEN | LAYOUT_TOUCHPAD,
+                            usb_get_supported_layout() & (LAYOUT_TOUCHSCREEN | LAYOUT_TOUCHPAD));
+    
+    // Single-interface mode: one interface and endpoint, one ID per report
+    usb_descriptors_deinit();
+    test_config.composite_layout = LAYOUT_SINGLE_INTERFACE | LAYOUT_KEYBOARD | LAYOUT_MOUSE |
+                                   LAYOUT_GAMEPAD | LAYOUT_CONSUMER | LAYOUT_NKRO_KEYBOARD |
+                                   LAYOUT_TOUCHSCREEN | LAYOUT_TOUCHPAD;
+    test_config.poll_interval_ms[usb_get_layout_index_for_register(HIDRA_REG_MOUSE)] = 1;
+    TEST_ASSERT_EQUAL(ESP_OK, usb_descriptors_init(&test_config));
+    TEST_ASSERT_TRUE(usb_is_single_interface());
+    TEST_ASSERT_EQUAL(7, usb_get_hid_interface_count());
+    config_desc = tud_descriptor_configuration_cb(0);
+    TEST_ASSERT_EQUAL_UINT16(TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN, config_desc[2] | (config_desc[3] << 8));
+    TEST_ASSERT_EQUAL_UINT8(1, config_desc[4]);
+    TEST_ASSERT_EQUAL_UINT8(1, config_desc[TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN - 1]);
+    TEST_ASSERT_NULL(tud_hid_descriptor_report_cb(1));
+    
+    // The merged descriptor declares every wire ID exactly once
+    const uint8_t *merged = tud_hid_descriptor_report_cb(0);
+    uint16_t merged_len = config_desc[TUD_CONFIG_DESC_LEN + 9 + 7] | (config_desc[TUD_CONFIG_DESC_LEN + 9 + 8] << 8);
+    uint8_t id_seen[16] = {0};
+    for (uint16_t i = 0; i < merged_len; i += 1 + ((merged[i] & 0x03) == 3 ? 4 : (merged[i] & 0x03))) {
+        if (merged[i] == 0x85) {
+            TEST_ASSERT_LESS_THAN(16, merged[i + 1]);
+            id_seen[merged[i + 1]]++;
+        }
+    }
+    TEST_ASSERT_EQUAL_HEX8(0x85, merged[0]);
+    TEST_ASSERT_EQUAL_UINT8(1, merged[1]);
+    for (int id = 1; id <= 5 + 2 + 5; id++) {
+        TEST_ASSERT_EQUAL_UINT8(1, id_seen[id]);
+    }
+    TEST_ASSERT_EQUAL_UINT8(0, id_seen[13]);
+    
+    // Reports are routed by ID and map back when they complete
+    usb_hid_route_t route;
+    const uint8_t mouse_report[] = {0, 1, 2, 3};
+    uint8_t mouse_instance = usb_get_hid_instance_for_register(HIDRA_REG_MOUSE);
+    TEST_ASSERT_TRUE(usb_route_hid_report(mouse_instance, mouse_report, sizeof(mouse_report), &route));
+    TEST_ASSERT_EQUAL_UINT8(0, route.itf);
+    TEST_ASSERT_EQUAL_UINT8(2, route.report_id);
+    TEST_ASSERT_EQUAL_PTR(mouse_report, route.data);
+    const uint8_t sent[] = {2, 0, 1, 2, 3};
+    TEST_ASSERT_EQUAL_UINT8(mouse_instance, usb_get_hid_instance_for_report(0, sent, sizeof(sent)));
+    
+    uint8_t touch_report[TOUCHPAD_REPORT_SIZE] = {TOUCH_REPORT_ID};
+    pad_instance = usb_get_hid_instance_for_register(HIDRA_REG_TOUCHPAD);
+    TEST_ASSERT_TRUE(usb_route_hid_report(pad_instance, touch_report, sizeof(touch_report), &route));
+    TEST_ASSERT_EQUAL_UINT8(8, route.report_id);
+    TEST_ASSERT_EQUAL_PTR(&touch_report[1], route.data);
+    TEST_ASSERT_EQUAL_UINT16(TOUCHPAD_REPORT_SIZE - 1, route.len);
+    touch_report[0] = TOUCH_FEATURE_CERT_ID + 1;
+    TEST_ASSERT_FALSE(usb_route_hid_report(pad_instance, touch_report, sizeof(touch_report), &route));
+    TEST_ASSERT_EQUAL_UINT16(1, usb_get_hid_feature_report(0, 8 + TOUCH_FEATURE_INPUT_MODE_ID - 1, feature, sizeof(feature)));
+    TEST_ASSERT_EQUAL_UINT8(3, feature[0]);
+    TEST_ASSERT_EQUAL_UINT16(TOUCH_CERT_BLOB_SIZE, usb_get_hid_feature_report(0, 8 + TOUCH_FEATURE_CERT_ID - 1, cert, reqlen));
+    TEST_ASSERT_EQUAL_UINT16(1, usb_get_hid_feature_report(0, 6 + TOUCH_FEATURE_MAX_COUNT_ID - 1, feature, sizeof(feature)));
+    TEST_ASSERT_EQUAL_UINT8(TOUCH_MAX_CONTACTS, feature[0]);
+    TEST_ASSERT_EQUAL_UINT16(0, usb_get_hid_feature_report(0, 1, feature, sizeof(feature)));
+    memset(test_config.poll_interval_ms, 0, sizeof(test_config.poll_interval_ms));
+    
+    // Per-interface mode sends without IDs, touch keeps its own
+    usb_descriptors_deinit();
+    test_config.composite_layout = LAYOUT_KEYBOARD | LAYOUT_TOUCHSCREEN;
+    TEST_ASSERT_EQUAL(ESP_OK, usb_descriptors_init(&test_config));
+    TEST_ASSERT_FALSE(usb_is_single_interface());
+    TEST_ASSERT_TRUE(usb_route_hid_report(0, mouse_report, sizeof(mouse_report), &route));
+    TEST_ASSERT_EQUAL_UINT8(0, route.report_id);
+    touch_report[0] = TOUCH_REPORT_ID;
+    TEST_ASSERT_TRUE(usb_route_hid_report(1, touch_report, TOUCHSCREEN_REPORT_SIZE, &route));
+    TEST_ASSERT_EQUAL_UINT8(1, route.itf);
+    TEST_ASSERT_EQUAL_UINT8(TOUCH_REPORT_ID, route.report_id);
+    TEST_ASSERT_EQUAL_UINT8(1, usb_get_hid_instance_for_report(1, touch_report, TOUCHSCREEN_REPORT_SIZE));
+    test_config.composite_layout = LAYOUT_KEYBOARD | LAYOUT_MOUSE;
+    
+    // The longest strings still fit the arena
+    memset(test_config.serial, 'S', MAX_STRING_LENGTH);
+    test_config.serial[MAX_STRING_LENGTH] = '\0';
+    TEST_ASSERT_EQUAL(ESP_OK, usb_descriptors_init(&test_config));
+    TEST_ASSERT_EQUAL_HEX16((TUSB_DESC_STRING << 8) | ((MAX_STRING_LENGTH + 1) * 2),
+                            tud_descriptor_string_cb(3, 0x0409)[0]);
+    strcpy(test_config.serial, "TEST123456");
+    
     // Test cleanup
     usb_descriptors_deinit();
+    TEST_ASSERT_NULL(tud_descriptor_configuration_cb(0));
 }
@@ -45,7 +45,8 @@ extern "C" {
 #define CFG_TUD_MIDI                0
 #define CFG_TUD_VENDOR              0
 
-#define CFG_TUD_HID_EP_BUFSIZE      64
+// Room for the touchpad's 256-byte certification report and its ID
+#define CFG_TUD_HID_EP_BUFSIZE      257
 
 #ifdef __cplusplus
 }